@@ -17,6 +17,13 @@
 #define CONFIG_HAS_PTHREADS 1
 #endif
 
+#ifdef __linux__
+#define CONFIG_HAS_EPOLL    1
+#define CONFIG_HAS_FUTEX    1
+#define CONFIG_HAS_SENDFILE 1
+#define CONFIG_HAS_INOTIFY  1
+#endif
+
 #include <sys/types.h>
 #include <sockstr/sstypes.h>
 
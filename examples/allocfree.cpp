@@ -0,0 +1,418 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+// allocfree.cpp
+//
+// Counts the heap allocations made by the server side of a connection
+// once it is warm.  Every form of operator new is replaced with one that
+// counts the calls made on the threads of the servers, which the handlers
+// mark as they first run.  Each case sends some requests to warm up, then as
+// many again, and shows the allocations per request of the second lot:
+// HTTP/1.1 through an HttpRouter, one request at a time and pipelined,
+// with bodies of a Content-Length and chunked, HTTP/2 over one
+// connection, and IPC messages answered inline and by workers.  It also
+// checks that a chunked body reaches the handler de-chunked, and that
+// one above the server's limit is refused with 413.
+// The Date header changes once a second, which adds an entry to the
+// HPACK table of an HTTP/2 connection, so a case passes with less than
+// one allocation per 100 requests.  The exit status is 1 if one fails.
+//
+// Usage:  allocfree [ requests [ port ] ]
+
+#include <sockstr/EventLoop.h>
+#include <sockstr/Http2.h>
+#include <sockstr/HttpBody.h>
+#include <sockstr/HttpRouter.h>
+#include <sockstr/HttpServer.h>
+#include <sockstr/IPC.h>
+#include <sockstr/IpcServer.h>
+#include <sockstr/Socket.h>
+#include <sockstr/SocketAddr.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <thread>
+#include <unistd.h>
+using namespace sockstr;
+
+// Set on the threads whose allocations are counted
+static thread_local bool tCounted = false;
+static std::atomic<unsigned long> gAllocations(0);
+
+// Every replaceable form of operator new comes here, the aligned ones
+// included, as std::pmr::new_delete_resource() uses them
+static void* allocate(std::size_t uSize, std::size_t uAlign) noexcept {
+    if (tCounted) {
+        gAllocations++;
+    }
+    if (uSize == 0) {
+        uSize = 1;
+    }
+    if (uAlign <= alignof(std::max_align_t)) {
+        return malloc(uSize);
+    }
+    return aligned_alloc(uAlign, (uSize + uAlign - 1) / uAlign * uAlign);
+}
+
+static void* allocateOrThrow(std::size_t uSize, std::size_t uAlign) {
+    void* p = allocate(uSize, uAlign);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(std::size_t uSize) {
+    return allocateOrThrow(uSize, 0);
+}
+void* operator new[](std::size_t uSize) {
+    return allocateOrThrow(uSize, 0);
+}
+void* operator new(std::size_t uSize, std::align_val_t align) {
+    return allocateOrThrow(uSize, static_cast<std::size_t>(align));
+}
+void* operator new[](std::size_t uSize, std::align_val_t align) {
+    return allocateOrThrow(uSize, static_cast<std::size_t>(align));
+}
+void* operator new(std::size_t uSize, const std::nothrow_t&) noexcept {
+    return allocate(uSize, 0);
+}
+void* operator new[](std::size_t uSize, const std::nothrow_t&) noexcept {
+    return allocate(uSize, 0);
+}
+void* operator new(std::size_t uSize, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return allocate(uSize, static_cast<std::size_t>(align));
+}
+void* operator new[](std::size_t uSize, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return allocate(uSize, static_cast<std::size_t>(align));
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, std::size_t) noexcept { free(p); }
+void operator delete[](void* p, std::size_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { free(p); }
+
+enum {
+    IPC_Add = 200,
+    IPC_AddReply = IPC_Add
+};
+#pragma pack(2)
+IPC_MESSAGE(Add)
+    DWORD dwA_;
+    DWORD dwB_;
+IPC_ENDMESSAGE
+IPC_REPLY(AddReply)
+    DWORD dwSum_;
+IPC_ENDREPLY
+#pragma pack()
+
+static void item(HttpCall& rCall, void*) {
+    tCounted = true;
+    std::string_view id = rCall.params().get("id");
+    char body[64];
+    int length = snprintf(body, sizeof(body), "{\"id\":%.*s}\n", int(id.size()), id.data());
+    rCall.addHeader("Cache-Control", "no-cache");
+    rCall.reply(200, std::string_view(body, length), "application/json");
+}
+
+static void echo(HttpCall& rCall, void*) {
+    tCounted = true;
+    rCall.reply(200, rCall.body(), "text/plain");
+}
+
+static void add(IpcCall& rCall, void*) {
+    tCounted = true;
+    const Add* pAdd = static_cast<const Add*>(rCall.request());
+    AddReply reply;
+    reply.dwSum_ = pAdd->dwA_ + pAdd->dwB_;
+    rCall.reply(&reply);
+}
+
+// Show the allocations of a case, and whether it passed
+static bool report(const char* pName, unsigned long allocations, long requests) {
+    bool ok = allocations * 100 < static_cast<unsigned long>(requests);
+    printf("%-26s %8lu allocations, %.3f per request%s\n", pName, allocations,
+           double(allocations) / requests, ok ? "" : "  (FAILED)");
+    return ok;
+}
+
+// Send requests over HTTP/1.1, depth at a time, and wait for the responses
+static bool exchange(Socket& rSock, const std::string& request, int depth) {
+    std::string batch;
+    for (int i = 0; i < depth; i++) {
+        batch += request;
+    }
+    rSock.write(batch);
+    static const std::string statusLine = "HTTP/1.1 200";
+    std::string received;
+    char buf[16384];
+    int responses = 0;
+    std::size_t scanned = 0;
+    while (responses < depth) {
+        int n = rSock.read(buf, sizeof(buf));
+        if (n <= 0) {
+            return false;
+        }
+        received.append(buf, n);
+        std::size_t pos;
+        while ((pos = received.find(statusLine, scanned)) != received.npos) {
+            responses++;
+            scanned = pos + statusLine.size();
+        }
+    }
+    return true;
+}
+
+static bool measureHttp1(const char* pName, int port, const std::string& request,
+                         int depth, long requests) {
+    Socket sock;
+    SocketAddr caddr("127.0.0.1", port);
+    if (!sock.open(caddr, Socket::modeReadWrite)) {
+        printf("%-26s could not connect\n", pName);
+        return false;
+    }
+    long rounds = requests / depth;
+    for (long i = 0; i < rounds; i++) {
+        if (!exchange(sock, request, depth)) {
+            printf("%-26s no answer\n", pName);
+            return false;
+        }
+    }
+    unsigned long before = gAllocations;
+    for (long i = 0; i < rounds; i++) {
+        if (!exchange(sock, request, depth)) {
+            printf("%-26s no answer\n", pName);
+            return false;
+        }
+    }
+    return report(pName, gAllocations - before, rounds * depth);
+}
+
+// Send a request and return what comes back until the server closes
+static std::string closingExchange(int port, const std::string& request) {
+    Socket sock;
+    SocketAddr caddr("127.0.0.1", port);
+    std::string received;
+    if (!sock.open(caddr, Socket::modeReadWrite)) {
+        return received;
+    }
+    sock.write(request);
+    char buf[4096];
+    int n;
+    while ((n = sock.read(buf, sizeof(buf))) > 0) {
+        received.append(buf, n);
+    }
+    return received;
+}
+
+static bool checkChunked(int port, uint64_t uMaxBody) {
+    std::string echoed = closingExchange(port, "POST /echo HTTP/1.1\r\n"
+                                               "Host: localhost\r\n"
+                                               "Connection: close\r\n"
+                                               "Transfer-Encoding: chunked\r\n\r\n"
+                                               "6;ext=1\r\nhello \r\n5\r\nworld\r\n"
+                                               "0\r\nTrailer: x\r\n\r\n");
+    bool dechunked = echoed.starts_with("HTTP/1.1 200")
+        && echoed.ends_with("\r\n\r\nhello world");
+    printf("%-26s %s\n", "Chunked body de-chunked", dechunked ? "ok" : "FAILED");
+
+    // One byte past the limit, in a chunk that the server reads whole
+    char sizeLine[24];
+    snprintf(sizeLine, sizeof(sizeLine), "%llx\r\n", (unsigned long long)(uMaxBody + 1));
+    std::string large = "POST /echo HTTP/1.1\r\n"
+                        "Host: localhost\r\n"
+                        "Transfer-Encoding: chunked\r\n\r\n";
+    large += sizeLine;
+    large.append(uMaxBody + 1, 'x');
+    bool refused = closingExchange(port, large).starts_with("HTTP/1.1 413");
+    printf("%-26s %s\n", "Chunked body over limit", refused ? "ok" : "FAILED");
+    return dechunked && refused;
+}
+
+static bool measureHttp2(int port, long requests) {
+    Socket sock;
+    SocketAddr caddr("127.0.0.1", port);
+    Http2Connection h2;
+    if (!sock.open(caddr, Socket::modeReadWrite)
+            || !h2.connect(sock, "127.0.0.1:" + std::to_string(port))) {
+        printf("%-26s could not connect\n", "HTTP/2");
+        return false;
+    }
+    std::string body;
+    HttpBodySink sink(body);
+    auto run = [&] {
+        for (long i = 0; i < requests; i++) {
+            body.clear();
+            UINT id = h2.submit("GET", "/item/1", sink);
+            if (!h2.wait(id)) {
+                return false;
+            }
+            h2.release(id);
+        }
+        return true;
+    };
+    bool ok = run();
+    unsigned long before = gAllocations;
+    ok = run() && ok;
+    unsigned long allocations = gAllocations - before;
+    h2.close();
+    if (!ok) {
+        printf("%-26s no answer\n", "HTTP/2");
+        return false;
+    }
+    return report("HTTP/2", allocations, requests);
+}
+
+static bool measureIpc(int port, UINT workers, long requests) {
+    std::string address = "localhost:" + std::to_string(port);
+    Socket listener(address.c_str(), Socket::modeCreate | Socket::modeReadWrite);
+    std::atomic<EventLoop*> pLoop(nullptr);
+    std::thread server([&] {
+        tCounted = true;
+        EventLoop loop;
+        IpcServer ipc(workers);
+        ipc.registerHandler(IPC_Add, add);
+        pLoop = &loop;
+        loop.spawn(ipc.serve(listener));
+        loop.run();
+    });
+    while (pLoop == nullptr) {
+        usleep(1000);
+    }
+
+    const int batch = 8;
+    Add adds[batch];
+    for (int i = 0; i < batch; i++) {
+        adds[i].dwA_ = i;
+        adds[i].dwB_ = 1;
+    }
+    Socket sock(address.c_str(), Socket::modeReadWrite);
+    auto run = [&] {
+        char buf[4096];
+        for (long i = 0; i < requests / batch; i++) {
+            sock.write(adds, sizeof(adds));
+            std::size_t received = 0;
+            while (received < sizeof(AddReply) * batch) {
+                int n = sock.read(buf, sizeof(buf));
+                if (n <= 0) {
+                    return false;
+                }
+                received += n;
+            }
+        }
+        return true;
+    };
+    bool ok = run();
+    unsigned long before = gAllocations;
+    ok = run() && ok;
+    unsigned long allocations = gAllocations - before;
+    sock.close();
+    pLoop.load()->stop();
+    server.join();
+
+    char pName[32];
+    if (workers) {
+        snprintf(pName, sizeof(pName), "IPC, %u workers", workers);
+    } else {
+        snprintf(pName, sizeof(pName), "IPC, inline");
+    }
+    if (!ok) {
+        printf("%-26s no answer\n", pName);
+        return false;
+    }
+    return report(pName, allocations, requests / batch * batch);
+}
+
+
+int main(int argc, char* argv[]) {
+    long requests = argc > 1 ? atol(argv[1]) : 2000;
+    int port = argc > 2 ? atoi(argv[2]) : 8097;
+    if (requests < 100) {
+        requests = 100;
+    }
+
+    // The count must take in what pmr containers get from upstream
+    tCounted = true;
+    unsigned long before = gAllocations;
+    std::pmr::memory_resource* pUpstream = std::pmr::new_delete_resource();
+    pUpstream->deallocate(pUpstream->allocate(256, 64), 256, 64);
+    ::operator delete[](::operator new[](16, std::nothrow));
+    tCounted = false;
+    if (gAllocations - before != 2) {
+        printf("Aligned or nothrow allocations are not counted\n");
+        return 1;
+    }
+
+    HttpRouter router;
+    router.addRoute("GET", "/item/:id", item);
+    router.addRoute("POST", "/echo", echo);
+    HttpServer server(1);
+    server.setHandler(HttpRouter::handler, &router);
+    HttpParser::Limits limits;
+    limits.uMaxBody = 64 * 1024;
+    server.setLimits(limits);
+    SocketAddr saddr(port);
+    if (!server.start(saddr)) {
+        printf("Error opening server socket on port %d\n", port);
+        return 2;
+    }
+
+    const std::string get = "GET /item/42?lang=en HTTP/1.1\r\n"
+                            "Host: localhost\r\n"
+                            "User-Agent: allocfree\r\n"
+                            "Accept: */*\r\n\r\n";
+    std::string post = "POST /echo HTTP/1.1\r\n"
+                       "Host: localhost\r\n"
+                       "Content-Length: 1000\r\n\r\n";
+    post.append(1000, 'x');
+    std::string chunked = "POST /echo HTTP/1.1\r\n"
+                          "Host: localhost\r\n"
+                          "Transfer-Encoding: chunked\r\n\r\n";
+    for (int i = 0; i < 4; i++) {
+        chunked += "fa\r\n";
+        chunked.append(250, 'x');
+        chunked += "\r\n";
+    }
+    chunked += "0\r\n\r\n";
+
+    bool ok = measureHttp1("HTTP/1.1 GET", port, get, 1, requests);
+    ok = measureHttp1("HTTP/1.1 GET, pipelined", port, get, 8, requests) && ok;
+    ok = measureHttp1("HTTP/1.1 POST", port, post, 1, requests) && ok;
+    ok = measureHttp1("HTTP/1.1 POST, chunked", port, chunked, 1, requests) && ok;
+    ok = checkChunked(port, limits.uMaxBody) && ok;
+    ok = measureHttp2(port, requests) && ok;
+    server.stop();
+
+    ok = measureIpc(port + 1, 0, requests) && ok;
+    ok = measureIpc(port + 1, 2, requests) && ok;
+    return ok ? 0 : 1;
+}
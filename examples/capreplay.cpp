@@ -0,0 +1,203 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+// capreplay.cpp
+//
+// Replays a capture made with SessionCapture against a server.  Every
+// session of the capture becomes a connection that sends what the
+// original client sent: the received bytes of sessions recorded on the
+// server side, the sent bytes of sessions recorded on a client.  The
+// server's answers are read and counted but not compared, since they
+// usually hold times and other things that change.
+//
+// The speed scales the gaps between the records: 1 keeps the original
+// timing, 10 replays ten times faster, 0 sends everything as fast as the
+// server takes it.
+//
+// Usage:  capreplay capture host port [ speed ]
+
+#include <sockstr/EventLoop.h>
+#include <sockstr/SessionCapture.h>
+#include <sockstr/Socket.h>
+
+#include <sys/socket.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace sockstr;
+using std::cout;
+using std::endl;
+
+struct Chunk {
+    uint64_t uTimestamp;
+    std::size_t uOffset;
+    UINT uLength;
+};
+
+struct Session {
+    int nProtocol = SOCK_STREAM;
+    bool bAccepted = false;
+    uint64_t uStart = 0;
+    std::string data;               // Bytes to send, back to back
+    std::vector<Chunk> chunks;
+};
+
+static std::string host;
+static int port = 0;
+static double speed = 1;
+static std::chrono::steady_clock::time_point startTime;
+static uint64_t firstTimestamp = 0;
+
+static long sessionsDone = 0;
+static long sessionsFailed = 0;
+static long long bytesSent = 0;
+static long long bytesReceived = 0;
+static double maxLate = 0;          // Worst delay behind the schedule, in ms
+
+
+// Wait until the time a record was captured, scaled by the speed
+static Task<void> waitFor(uint64_t uTimestamp) {
+    if (speed <= 0) {
+        co_return;
+    }
+    double due = (uTimestamp - firstTimestamp) / speed / 1000.0;
+    double now = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - startTime).count();
+    if (due > now + 1) {
+        co_await EventLoop::current()->sleep(static_cast<UINT>(due - now));
+    } else if (now - due > maxLate) {
+        maxLate = now - due;
+    }
+}
+
+static Task<void> drain(std::shared_ptr<Socket> pSock) {
+    char buf[16384];
+    for (;;) {
+        int sz = co_await pSock->async_read(buf, sizeof(buf));
+        if (sz <= 0) {
+            break;
+        }
+        bytesReceived += sz;
+    }
+    pSock->close();
+}
+
+static Task<void> replay(const Session* pSession) {
+    co_await waitFor(pSession->uStart);
+
+    if (pSession->nProtocol == SOCK_DGRAM) {
+        // One datagram per record; sending never waits for the server
+        SocketAddr saddr(host, port, "udp");
+        Socket sock;
+        if (!sock.open(saddr, Socket::modeReadWrite)) {
+            ++sessionsFailed;
+            co_return;
+        }
+        for (const Chunk& chunk : pSession->chunks) {
+            co_await waitFor(chunk.uTimestamp);
+            sock.write(pSession->data.data() + chunk.uOffset, chunk.uLength);
+            bytesSent += chunk.uLength;
+        }
+        ++sessionsDone;
+        co_return;
+    }
+
+    auto pSock = std::make_shared<Socket>();
+    SocketAddr saddr(host, port);
+    if (!co_await pSock->async_connect(saddr)) {
+        ++sessionsFailed;
+        co_return;
+    }
+    EventLoop::current()->spawn(drain(pSock));
+    for (const Chunk& chunk : pSession->chunks) {
+        co_await waitFor(chunk.uTimestamp);
+        int sz = co_await pSock->async_write(pSession->data.data() + chunk.uOffset,
+                                             chunk.uLength);
+        if (sz != static_cast<int>(chunk.uLength)) {
+            ++sessionsFailed;
+            co_return;
+        }
+        bytesSent += sz;
+    }
+    // The server sees end of file and drain() reads the rest of its answers
+    ::shutdown(pSock->getHandle(), SHUT_WR);
+    ++sessionsDone;
+}
+
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        cout << "Usage: " << argv[0] << " capture host port [ speed ]" << endl;
+        return 2;
+    }
+    host = argv[2];
+    port = atoi(argv[3]);
+    speed = (argc > 4) ? atof(argv[4]) : 1;
+
+    CaptureReader reader;
+    if (!reader.open(argv[1])) {
+        cout << "Cannot read capture file " << argv[1] << endl;
+        return 2;
+    }
+    std::map<UINT, Session> sessions;
+    CaptureRecord record;
+    long records = 0;
+    while (reader.next(record)) {
+        if (records++ == 0) {
+            firstTimestamp = record.uTimestamp;
+        }
+        Session& rSession = sessions[record.uSession];
+        if (record.eKind == captureOpen) {
+            rSession.nProtocol = record.nProtocol;
+            rSession.bAccepted = record.bAccepted;
+            rSession.uStart = record.uTimestamp;
+        } else if (record.eKind == (rSession.bAccepted ? captureReceived : captureSent)) {
+            rSession.chunks.push_back({ record.uTimestamp, rSession.data.size(), record.uLength });
+            rSession.data.append(record.pData, record.uLength);
+        }
+    }
+    if (reader.error()) {
+        cout << "Capture file is damaged after " << records << " records" << endl;
+    }
+
+    EventLoop loop;
+    startTime = std::chrono::steady_clock::now();
+    for (const auto& session : sessions) {
+        if (!session.second.chunks.empty()) {
+            loop.spawn(replay(&session.second));
+        }
+    }
+    loop.run();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime);
+
+    cout << sessionsDone << " sessions replayed, " << sessionsFailed << " failed: "
+         << bytesSent << " bytes sent, " << bytesReceived << " received in "
+         << elapsed.count() << " s";
+    if (speed > 0) {
+        cout << " (at most " << maxLate << " ms behind schedule)";
+    }
+    cout << endl;
+    return sessionsFailed ? 1 : 0;
+}
@@ -0,0 +1,144 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+// coroecho.cpp
+//
+// Echo server and clients written as coroutines on a single EventLoop.
+// Every connection is handled by straight-line code without a thread
+// of its own.
+//
+// Usage:  coroecho [ port [ clients [ messages [ capture ] ] ] ]
+//
+// With a capture file name the server side of every connection is
+// recorded, ready to be replayed with capreplay.
+
+#include <sockstr/EventLoop.h>
+#include <sockstr/SessionCapture.h>
+#include <sockstr/Socket.h>
+#include <sockstr/SocketPool.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+using namespace sockstr;
+using std::cout;
+using std::endl;
+
+static int clientsDone = 0;
+static long messagesEchoed = 0;
+
+
+Task<void> echo(SocketPool<>::Handle client) {
+    char buf[1024];
+    for (;;) {
+        int sz = co_await client->async_read(buf, sizeof(buf));
+        if (sz <= 0) {
+            break;
+        }
+        if (co_await client->async_write(buf, sz) != sz) {
+            break;
+        }
+    }
+}   // client goes back to the pool
+
+Task<void> server(Socket& serverSock, SocketPool<>& pool, int numClients) {
+    for (int i = 0; i < numClients; i++) {
+        auto client = pool.acquire();
+        if (co_await serverSock.async_accept(*client)) {
+            EventLoop::current()->spawn(echo(std::move(client)));
+        }
+    }
+}
+
+Task<void> client(int port, int numMessages) {
+    Socket sock;
+    SocketAddr saddr("127.0.0.1", port);
+    if (!co_await sock.async_connect(saddr)) {
+        cout << "Error connecting to port " << port << endl;
+        co_return;
+    }
+
+    const char msg[] = "Hello from a coroutine";
+    char buf[sizeof(msg)];
+    for (int i = 0; i < numMessages; i++) {
+        co_await sock.async_write(msg, sizeof(msg));
+        UINT got = 0;
+        while (got < sizeof(msg)) {
+            int sz = co_await sock.async_read(buf + got, sizeof(msg) - got);
+            if (sz <= 0) {
+                co_return;
+            }
+            got += sz;
+        }
+        if (memcmp(buf, msg, sizeof(msg)) == 0) {
+            ++messagesEchoed;
+        }
+    }
+    sock.close();
+    ++clientsDone;
+}
+
+
+int main(int argc, char* argv[]) {
+    int port = (argc > 1) ? atoi(argv[1]) : 4322;
+    int numClients = (argc > 2) ? atoi(argv[2]) : 100;
+    int numMessages = (argc > 3) ? atoi(argv[3]) : 1000;
+
+    // Declared first: the sockets refer to it until they are destroyed
+    SessionCapture capture;
+    // Accepted connections reuse closed Socket objects instead of
+    // constructing a new iostream for every client.  The pool must
+    // outlive the loop's tasks that hold its sockets.
+    SocketPool<> pool;
+    EventLoop loop;
+
+    Socket serverSock;
+    SocketAddr saddr(port);
+    if (!serverSock.open(saddr, Socket::modeReadWrite | Socket::modeCreate)) {
+        cout << "Error opening server socket on port " << port << endl;
+        return 2;
+    }
+    if (argc > 4) {
+        if (!capture.open(argv[4])) {
+            cout << "Error creating capture file " << argv[4] << endl;
+            return 2;
+        }
+        // Inherited by every connection the server accepts
+        serverSock.setCapture(&capture);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    loop.spawn(server(serverSock, pool, numClients));
+    for (int i = 0; i < numClients; i++) {
+        loop.spawn(client(port, numMessages));
+    }
+    loop.run();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+    cout << clientsDone << " clients echoed " << messagesEchoed << " messages in "
+         << elapsed.count() << " s ("
+         << static_cast<long>(messagesEchoed / elapsed.count()) << " msg/s)" << endl;
+
+    serverSock.close();
+    return (clientsDone == numClients) ? 0 : 1;
+}
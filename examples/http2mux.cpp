@@ -0,0 +1,227 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+// http2mux.cpp
+//
+// An HttpServer answering "/item/<n>" with a small JSON document and
+// "/big" with a megabyte of text, over HTTP/1.1 and HTTP/2 alike.
+// A client gets the items over one HTTP/2 connection with all the
+// requests in flight at once, then one after the other over an HTTP/1.1
+// connection kept alive, and shows both times along with the frames
+// exchanged and how much HPACK shrank the header fields, which repeat
+// from one request to the next.  It then gets "/big" with small items
+// alongside, to show that they are not held behind it, and upgrades an
+// HTTP/1.1 connection with "Upgrade: h2c".
+// With 0 requests the server runs alone, for other clients such as
+// "curl --http2-prior-knowledge" or "curl --http2".
+//
+// Usage:  http2mux [ requests [ port ] ]
+
+#include <sockstr/Http2.h>
+#include <sockstr/HttpBody.h>
+#include <sockstr/HttpServer.h>
+#include <sockstr/HttpStream.h>
+#include <sockstr/Socket.h>
+#include <sockstr/SocketAddr.h>
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace sockstr;
+using std::cout;
+using std::endl;
+
+typedef std::chrono::steady_clock Clock;
+
+// Header lines a browser would send with every request
+static const char* CLIENT_HEADERS =
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) sockstr-http2mux/1.0\r\n"
+    "Accept: application/json, text/plain, */*\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\n"
+    "Cookie: session=4f2a9c1e77d04b55a0c3e9d8b1f26a47; theme=dark\r\n";
+
+static void handler(HttpCall& rCall, void* ptr) {
+    std::string_view path = rCall.request().path();
+    if (path == "/big") {
+        rCall.reply(200, *static_cast<const std::string*>(ptr), "text/plain");
+    } else if (path.compare(0, 6, "/item/") == 0) {
+        std::string id(path.substr(6));
+        rCall.reply(200, "{\"id\":" + id + ",\"name\":\"item " + id + "\",\"price\":"
+                    + std::to_string(100 + atoi(id.c_str()) % 900) + "}\n",
+                    "application/json");
+    } else {
+        rCall.reply(404, "Not found\n", "text/plain");
+    }
+}
+
+static double seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Get the items over one HTTP/2 connection, all of them at once
+static bool getHttp2(int port, long requests, const std::string& authority) {
+    Socket sock;
+    SocketAddr caddr("127.0.0.1", port);
+    Http2Connection h2;
+    if (!sock.open(caddr, Socket::modeReadWrite) || !h2.connect(sock, authority)) {
+        cout << "Could not connect with HTTP/2" << endl;
+        return false;
+    }
+    std::vector<std::string> bodies(requests);
+    std::vector<HttpBodySink> sinks;
+    sinks.reserve(requests);
+    std::vector<UINT> ids;
+    auto start = Clock::now();
+    for (long i = 0; i < requests; i++) {
+        sinks.emplace_back(bodies[i]);
+        ids.push_back(h2.submit("GET", "/item/" + std::to_string(i), sinks.back(),
+                                std::string_view(), CLIENT_HEADERS));
+    }
+    bool ok = h2.waitAll();
+    double secs = seconds(start);
+    long good = 0;
+    for (UINT id : ids) {
+        good += h2.status(id) == 200;
+    }
+    const Http2Connection::Stats& stats = h2.stats();
+    printf("HTTP/2:   %ld requests on 1 connection in %.3f s, %ld answered 200%s\n",
+           requests, secs, good, ok ? "" : " (FAILED)");
+    printf("          %llu frames sent, %llu received; request headers %llu bytes, "
+           "%llu with HPACK (%.1f%%)\n",
+           static_cast<unsigned long long>(stats.framesSent),
+           static_cast<unsigned long long>(stats.framesReceived),
+           static_cast<unsigned long long>(stats.fieldBytes),
+           static_cast<unsigned long long>(stats.blockBytes),
+           stats.fieldBytes ? 100.0 * stats.blockBytes / stats.fieldBytes : 0.0);
+
+    // A large body does not hold back the small ones beside it
+    std::string big;
+    HttpBodySink bigSink(big);
+    start = Clock::now();
+    UINT bigId = h2.submit("GET", "/big", bigSink, std::string_view(), CLIENT_HEADERS);
+    std::string small[4];
+    std::vector<HttpBodySink> smallSinks;
+    smallSinks.reserve(4);
+    UINT smallIds[4];
+    for (int i = 0; i < 4; i++) {
+        smallSinks.emplace_back(small[i]);
+        smallIds[i] = h2.submit("GET", "/item/" + std::to_string(i), smallSinks.back(),
+                                std::string_view(), CLIENT_HEADERS);
+    }
+    bool smallDone = true;
+    for (int i = 0; i < 4; i++) {
+        smallDone = h2.wait(smallIds[i]) && smallDone;
+    }
+    double smallSecs = seconds(start);
+    bool bigDone = h2.wait(bigId);
+    printf("          /big (%zu bytes) in %.3f s; 4 items beside it in %.3f s%s\n",
+           big.size(), seconds(start), smallSecs, smallDone && bigDone ? "" : " (FAILED)");
+    h2.close();
+    return ok && good == requests;
+}
+
+// Get the items over one HTTP/1.1 connection, one after the other
+static bool getHttp1(int port, long requests) {
+    SocketAddr caddr("127.0.0.1", port);
+    HttpStream http(caddr, Socket::modeReadWrite);
+    if (!http.is_open()) {
+        cout << "Could not connect with HTTP/1.1" << endl;
+        return false;
+    }
+    long good = 0;
+    std::string body;
+    auto start = Clock::now();
+    for (long i = 0; i < requests; i++) {
+        body.clear();
+        HttpBodySink sink(body);
+        good += http.get("/item/" + std::to_string(i), sink) == 200;
+    }
+    printf("HTTP/1.1: %ld requests on 1 connection in %.3f s, %ld answered 200\n",
+           requests, seconds(start), good);
+    return good == requests;
+}
+
+// Upgrade an HTTP/1.1 connection to HTTP/2, then carry on over it
+static bool upgrade(int port, const std::string& authority) {
+    SocketAddr caddr("127.0.0.1", port);
+    HttpStream http(caddr, Socket::modeReadWrite);
+    if (!http.is_open()) {
+        cout << "Could not connect for the upgrade" << endl;
+        return false;
+    }
+    Http2Connection h2;
+    std::string first, second;
+    HttpBodySink firstSink(first), secondSink(second);
+    UINT status = h2.upgrade(http, "/item/1", authority, firstSink);
+    if (status != 101 || !h2.wait(1)) {
+        printf("Upgrade:  answered %u, not switched\n", status);
+        return false;
+    }
+    UINT id = h2.submit("GET", "/item/2", secondSink);
+    bool ok = h2.wait(id);
+    printf("Upgrade:  switched to HTTP/2; stream 1 %s", first.c_str());
+    printf("          stream %u %s", id, second.c_str());
+    h2.close();
+    return ok;
+}
+
+
+int main(int argc, char* argv[]) {
+    long requests = argc > 1 ? atol(argv[1]) : 1000;
+    int port = argc > 2 ? atoi(argv[2]) : 8096;
+
+    std::string big;
+    while (big.size() < 1024 * 1024) {
+        big += "Line " + std::to_string(big.size()) + " of a megabyte of text.\n";
+    }
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    HttpServer server(2);
+    server.setHandler(handler, &big);
+    SocketAddr saddr(port);
+    if (!server.start(saddr)) {
+        cout << "Error opening server socket on port " << port << endl;
+        return 2;
+    }
+    if (requests <= 0) {
+        cout << "Serving on port " << port << endl;
+        int sig;
+        sigwait(&signals, &sig);
+        server.stop();
+        return 0;
+    }
+
+    std::string authority = "127.0.0.1:" + std::to_string(port);
+    bool ok = getHttp2(port, requests, authority);
+    ok = getHttp1(port, requests) && ok;
+    ok = upgrade(port, authority) && ok;
+    server.stop();
+    cout << "Served " << server.requests() << " requests" << endl;
+    return ok ? 0 : 1;
+}
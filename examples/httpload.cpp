@@ -0,0 +1,254 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+// httpload.cpp
+//
+// HTTP load generator.  Keep-alive connections, spread over a number of
+// threads each running an EventLoop, send GET requests for a path as
+// fast as the server answers them, optionally several at a time
+// (pipelined), and the request rate and latency are reported.
+//
+// Usage:  httpload [ -c connections ] [ -t threads ] [ -d seconds ]
+//                  [ -p pipeline ] host:port [ path ]
+
+#include <sockstr/EventLoop.h>
+#include <sockstr/HttpParser.h>
+#include <sockstr/Socket.h>
+#include <sockstr/SocketAddr.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+using namespace sockstr;
+using std::cout;
+using std::endl;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+    std::string host;
+    int port = 8080;
+    std::string path = "/";
+    int connections = 64;
+    int threads = 1;
+    double seconds = 5;
+    int pipeline = 1;
+};
+
+// Results of one thread
+struct Stats {
+    long requests = 0;
+    long errors = 0;
+    long batches = 0;
+    double latency = 0;         // Sum over the batches, in seconds
+    double maxLatency = 0;
+    uint64_t bytes = 0;
+};
+
+
+// Read one response from buf, receiving more as needed.  A body is
+// counted and dropped, so it can be of any size.
+static Task<bool> readResponse(Socket& sock, std::vector<char>& buf, size_t& begin,
+                               size_t& end, HttpParser& parser, Stats& stats) {
+    parser.reset();
+    for (;;) {
+        HttpParser::Result result = parser.parse(buf.data() + begin, end - begin);
+        if (result == HttpParser::parseError) {
+            co_return false;
+        }
+        if (result == HttpParser::parseComplete) {
+            break;
+        }
+        if (begin > 0) {
+            memmove(buf.data(), buf.data() + begin, end - begin);
+            end -= begin;
+            begin = 0;
+        }
+        if (end == buf.size()) {
+            buf.resize(buf.size() * 2);
+        }
+        int sz = co_await sock.async_read(buf.data() + end, buf.size() - end);
+        if (sz <= 0) {
+            co_return false;
+        }
+        end += sz;
+    }
+
+    uint64_t body = 0;
+    if (parser.bodyKind() == HttpParser::bodyLength) {
+        body = parser.contentLength();
+    } else if (parser.bodyKind() != HttpParser::bodyNone) {
+        co_return false;        // Only Content-Length is measured
+    }
+    if (parser.statusCode() >= 400) {
+        ++stats.errors;
+    }
+    begin += parser.headerSize();
+    stats.bytes += parser.headerSize() + body;
+    for (;;) {
+        uint64_t have = std::min<uint64_t>(body, end - begin);
+        begin += have;
+        body -= have;
+        if (body == 0) {
+            co_return true;
+        }
+        begin = end = 0;
+        int sz = co_await sock.async_read(buf.data(), buf.size());
+        if (sz <= 0) {
+            co_return false;
+        }
+        end = sz;
+    }
+}
+
+// Send batches of requests on one connection until the deadline, or the
+// server ends the connection.
+// Returns false on an error.
+static Task<bool> session(const Options& opts, const std::string& batch,
+                          Clock::time_point deadline, Stats& stats) {
+    Socket sock;
+    SocketAddr saddr(opts.host, opts.port);
+    if (!co_await sock.async_connect(saddr)) {
+        co_return false;
+    }
+
+    std::vector<char> buf(65536);
+    size_t begin = 0;
+    size_t end = 0;
+    HttpParser parser(HttpParser::messageResponse);
+
+    while (Clock::now() < deadline) {
+        auto start = Clock::now();
+        if (co_await sock.async_write(batch.data(), batch.size()) != static_cast<int>(batch.size())) {
+            co_return false;
+        }
+        for (int idx = 0; idx < opts.pipeline; idx++) {
+            if (!co_await readResponse(sock, buf, begin, end, parser, stats)) {
+                co_return false;
+            }
+            ++stats.requests;
+            if (!parser.keepAlive()) {
+                // The requests after this one are not answered
+                co_return true;
+            }
+        }
+        double latency = std::chrono::duration<double>(Clock::now() - start).count();
+        stats.latency += latency;
+        stats.maxLatency = std::max(stats.maxLatency, latency);
+        ++stats.batches;
+    }
+    co_return true;
+}
+
+static Task<void> client(const Options& opts, Clock::time_point deadline, Stats& stats) {
+    std::string request = "GET " + opts.path + " HTTP/1.1\r\nHost: " + opts.host + "\r\n\r\n";
+    std::string batch;
+    for (int idx = 0; idx < opts.pipeline; idx++) {
+        batch += request;
+    }
+    // Connect again whenever the server closes the connection
+    while (Clock::now() < deadline) {
+        if (!co_await session(opts, batch, deadline, stats)) {
+            ++stats.errors;
+            break;
+        }
+    }
+}
+
+static void runThread(const Options& opts, int connections, Clock::time_point deadline,
+                      Stats* pStats) {
+    EventLoop loop;
+    for (int idx = 0; idx < connections; idx++) {
+        loop.spawn(client(opts, deadline, *pStats));
+    }
+    loop.run();
+}
+
+
+int main(int argc, char* argv[]) {
+    Options opts;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:t:d:p:")) != -1) {
+        switch (opt) {
+            case 'c': opts.connections = atoi(optarg); break;
+            case 't': opts.threads = atoi(optarg); break;
+            case 'd': opts.seconds = atof(optarg); break;
+            case 'p': opts.pipeline = atoi(optarg); break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    if (optind >= argc || opts.threads < 1 || opts.pipeline < 1) {
+        cout << "Usage:  httpload [ -c connections ] [ -t threads ] [ -d seconds ]" << endl
+             << "                 [ -p pipeline ] host:port [ path ]" << endl;
+        return 1;
+    }
+    std::string target = argv[optind];
+    size_t colon = target.rfind(':');
+    opts.host = target.substr(0, colon);
+    if (colon != std::string::npos) {
+        opts.port = atoi(target.c_str() + colon + 1);
+    }
+    if (optind + 1 < argc) {
+        opts.path = argv[optind + 1];
+    }
+
+    cout << opts.connections << " connections on " << opts.threads << " threads, pipeline "
+         << opts.pipeline << ", " << opts.seconds << " s: GET " << opts.path << endl;
+
+    auto start = Clock::now();
+    auto deadline = start + std::chrono::duration_cast<Clock::duration>(
+                                std::chrono::duration<double>(opts.seconds));
+    std::vector<Stats> stats(opts.threads);
+    std::vector<std::thread> threads;
+    for (int idx = 0; idx < opts.threads; idx++) {
+        int connections = opts.connections / opts.threads
+                          + (idx < opts.connections % opts.threads ? 1 : 0);
+        threads.emplace_back(runThread, std::cref(opts), connections, deadline, &stats[idx]);
+    }
+    for (auto& thr : threads) {
+        thr.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    Stats total;
+    for (const Stats& part : stats) {
+        total.requests += part.requests;
+        total.errors += part.errors;
+        total.batches += part.batches;
+        total.latency += part.latency;
+        total.maxLatency = std::max(total.maxLatency, part.maxLatency);
+        total.bytes += part.bytes;
+    }
+    printf("%ld requests in %.2f s: %.0f requests/s, %.1f MB/s received\n",
+           total.requests, elapsed, total.requests / elapsed, total.bytes / elapsed / 1e6);
+    printf("latency per round trip: mean %.3f ms, max %.3f ms; %ld errors\n",
+           total.batches ? total.latency / total.batches * 1e3 : 0.0,
+           total.maxLatency * 1e3, total.errors);
+    return total.errors ? 1 : 0;
+}
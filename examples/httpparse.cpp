@@ -0,0 +1,292 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+// httpparse.cpp
+//
+// Checks HttpParser on well-formed and malformed requests, parsing each
+// one whole and one byte at a time, checks HttpChunkDecoder the same way,
+// and checks HttpHeaders: names in any case, more fields than it holds
+// inline, set() over duplicates and a parse/appendTo round trip.  It then
+// measures how long it takes to parse a typical browser request.
+//
+// Usage:  httpparse [ seconds ]
+
+#include <sockstr/HttpHeaders.h>
+#include <sockstr/HttpParser.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+using namespace sockstr;
+using std::cout;
+using std::endl;
+
+static const char browserRequest[] =
+    "GET /api/v1/items/42?fields=name,price&lang=en HTTP/1.1\r\n"
+    "Host: shop.example.com\r\n"
+    "Connection: keep-alive\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+    "(KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\n"
+    "Cookie: session=8f14e45fceea167a5a36dedd4bea2543; theme=dark\r\n"
+    "\r\n";
+
+struct Case {
+    const char* text;
+    HttpParser::Result eResult;
+    UINT uStatus;                   // Expected errorStatus()
+};
+
+static const Case cases[] = {
+    { browserRequest, HttpParser::parseComplete, 0 },
+    { "POST /upload HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello", HttpParser::parseComplete, 0 },
+    { "\r\nGET / HTTP/1.0\nHost: a\n\n", HttpParser::parseComplete, 0 },
+    { "POST / HTTP/1.1\r\nTransfer-Encoding: gzip, chunked\r\n\r\n", HttpParser::parseComplete, 0 },
+    { "GET / HTTP/1.1\r\nHost: a\r\n", HttpParser::parseIncomplete, 0 },
+    { "GET  / HTTP/1.1\r\n\r\n", HttpParser::parseError, 400 },
+    { "GET / HTTP/2.0\r\n\r\n", HttpParser::parseError, 505 },
+    { "GET / HTTP/1.1\r\nHost : a\r\n\r\n", HttpParser::parseError, 400 },
+    { "GET / HTTP/1.1\r\nX-A: 1\r\n  folded\r\n\r\n", HttpParser::parseError, 400 },
+    { "GET / HTTP/1.1\r\nX-A: a\x01z\r\n\r\n", HttpParser::parseError, 400 },
+    { "POST / HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 6\r\n\r\n", HttpParser::parseError, 400 },
+    { "POST / HTTP/1.1\r\nContent-Length: -1\r\n\r\n", HttpParser::parseError, 400 },
+    { "POST / HTTP/1.1\r\nContent-Length: 5\r\nTransfer-Encoding: chunked\r\n\r\n",
+      HttpParser::parseError, 400 },
+    { "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n", HttpParser::parseError, 501 },
+    { "POST / HTTP/1.1\r\nContent-Length: 99999999999\r\n\r\n", HttpParser::parseError, 413 },
+};
+
+static bool check(const Case& test) {
+    std::string text = test.text;
+    HttpParser whole;
+    HttpParser::Result eWhole = whole.parse(text.data(), text.size());
+
+    // Byte by byte, moving the buffer on every call
+    HttpParser pieces;
+    HttpParser::Result ePieces = HttpParser::parseIncomplete;
+    std::string received;
+    for (size_t idx = 0; idx < text.size() && ePieces == HttpParser::parseIncomplete; idx++) {
+        received.push_back(text[idx]);
+        received.shrink_to_fit();
+        ePieces = pieces.parse(received.data(), received.size());
+    }
+
+    bool ok = eWhole == test.eResult && ePieces == eWhole
+              && whole.errorStatus() == test.uStatus && pieces.errorStatus() == test.uStatus;
+    if (ok && eWhole == HttpParser::parseComplete) {
+        ok = whole.method() == pieces.method() && whole.uri() == pieces.uri()
+             && whole.headerCount() == pieces.headerCount()
+             && whole.headerSize() == pieces.headerSize()
+             && whole.bodyKind() == pieces.bodyKind()
+             && whole.contentLength() == pieces.contentLength();
+        for (UINT idx = 0; ok && idx < whole.headerCount(); idx++) {
+            ok = whole.headerAt(idx).name == pieces.headerAt(idx).name
+                 && whole.headerAt(idx).value == pieces.headerAt(idx).value;
+        }
+    }
+    if (!ok) {
+        cout << "FAILED: " << std::string(text, 0, text.find('\n')) << endl;
+    }
+    return ok;
+}
+
+struct ChunkCase {
+    const char* text;
+    HttpChunkDecoder::Result eResult;
+    const char* payload;
+};
+
+static const ChunkCase chunkCases[] = {
+    { "5\r\nhello\r\n6;name=value\r\n world\r\n0\r\n\r\n", HttpChunkDecoder::chunkDone,
+      "hello world" },
+    { "A\nabcdefghij\n0\nX-Sum: 1\n\n", HttpChunkDecoder::chunkDone, "abcdefghij" },
+    { "3\r\nabc\r\n", HttpChunkDecoder::chunkMore, "abc" },
+    { "3\r\nabcd\r\n", HttpChunkDecoder::chunkError, "abc" },
+    { "x\r\n", HttpChunkDecoder::chunkError, "" },
+    { "10000000000000000\r\n", HttpChunkDecoder::chunkError, "" },
+};
+
+// Decode text in pieces of uStep bytes
+static HttpChunkDecoder::Result decodeChunks(const std::string& text, size_t uStep,
+                                             std::string& payload) {
+    HttpChunkDecoder decoder;
+    HttpChunkDecoder::Result eResult = HttpChunkDecoder::chunkMore;
+    for (size_t uPos = 0; uPos < text.size() && eResult == HttpChunkDecoder::chunkMore; ) {
+        size_t uUsed;
+        std::string_view piece;
+        eResult = decoder.decode(text.data() + uPos, std::min(uStep, text.size() - uPos),
+                                 uUsed, piece);
+        payload.append(piece);
+        uPos += uUsed;
+    }
+    return eResult;
+}
+
+static bool checkChunks(const ChunkCase& test) {
+    std::string whole, pieces;
+    bool ok = decodeChunks(test.text, strlen(test.text), whole) == test.eResult
+              && decodeChunks(test.text, 1, pieces) == test.eResult
+              && whole == test.payload && pieces == test.payload;
+    if (!ok) {
+        cout << "FAILED: chunks " << test.payload << endl;
+    }
+    return ok;
+}
+
+// Count the fields of a name
+static std::size_t countFields(const HttpHeaders& headers, std::string_view name) {
+    std::size_t uCount = 0;
+    for (std::size_t idx = 0; idx < headers.size(); idx++) {
+        uCount += HttpParser::equalNames(headers.at(idx).name, name) ? 1 : 0;
+    }
+    return uCount;
+}
+
+// Return the number of HttpHeaders checks that failed
+static int checkHeaders() {
+    int failures = 0;
+    auto expect = [&](bool ok, const char* pWhat) {
+        if (!ok) {
+            cout << "FAILED: headers " << pWhat << endl;
+            ++failures;
+        }
+    };
+
+    HttpHeaders headers;
+    headers.add("X-Request-Id", "17");
+    headers.set("CONTENT-TYPE", "text/plain");
+    expect(headers.get("x-request-id") == "17", "get of another case");
+    expect(headers.get(hdrContentType) == "text/plain"
+           && headers.get("content-type") == "text/plain", "set of another case, interned");
+    expect(headers.at(1).name == "Content-Type", "interned name spelled as usual");
+    expect(headers.remove("x-REQUEST-id") && headers.get("X-Request-Id").data() == nullptr
+           && !headers.remove("X-Request-Id") && headers.size() == 1, "remove of another case");
+
+    // Past the fields held inline, with duplicates on both sides
+    headers.clear();
+    headers.add("X-Dup", "first");
+    char name[16], value[16];
+    for (int idx = 1; idx < 40; idx++) {
+        snprintf(name, sizeof(name), "X-Field-%d", idx);
+        snprintf(value, sizeof(value), "v%d", idx);
+        headers.add(name, value);
+        if (idx % 10 == 0) {
+            headers.add("x-dup", value);
+        }
+    }
+    expect(headers.size() == 43 && headers.size() > HttpHeaders::INLINE_FIELDS,
+           "more fields than held inline");
+    expect(headers.get("x-field-39") == "v39" && headers.at(20).name == "X-Field-19"
+           && headers.at(20).value == "v19", "get and at() past the inline fields");
+    expect(headers.get("X-DUP") == "first" && countFields(headers, "x-dup") == 4,
+           "duplicates kept by add()");
+    headers.set("X-Dup", "only");
+    expect(countFields(headers, "X-Dup") == 1 && headers.get("x-dup") == "only"
+           && headers.size() == 40 && headers.get("X-Field-39") == "v39",
+           "set() collapses duplicates");
+    expect(headers.remove("X-Field-5") && headers.size() == 39
+           && headers.get("X-Field-5").data() == nullptr && headers.get("X-Field-6") == "v6",
+           "remove() past the inline fields");
+    // Replaced values are reclaimed without losing the others
+    for (int idx = 0; idx < 1000; idx++) {
+        snprintf(value, sizeof(value), "%d", idx);
+        headers.set(hdrETag, value);
+    }
+    expect(headers.get(hdrETag) == "999" && headers.get("x-field-38") == "v38"
+           && countFields(headers, "ETag") == 1, "values replaced many times");
+
+    // Round trip, with names in their usual spelling or as sent
+    static const char text[] = "Host: shop.example.com\r\n"
+                               "X-Custom: a, b\r\n"
+                               "Accept: */*\r\n"
+                               "x-lower: v\r\n"
+                               "Set-Cookie: a=1\r\n"
+                               "Set-Cookie: b=2\r\n";
+    expect(headers.parse(text, strlen(text)) == 6, "parse() counts the fields");
+    std::string written;
+    headers.appendTo(written);
+    expect(written == text, "parse() and appendTo() round trip");
+    HttpHeaders again;
+    again.parse(written.data(), written.size());
+    std::string rewritten;
+    again.appendTo(rewritten);
+    expect(rewritten == written && again.get(hdrHost) == "shop.example.com",
+           "appendTo() parses back the same");
+    static const char loose[] = "host:shop.example.com\n"
+                                "no colon\n"
+                                "x-lower:   v  \r\n";
+    headers.parse(loose, strlen(loose));
+    written.clear();
+    headers.appendTo(written);
+    expect(written == "Host: shop.example.com\r\nx-lower: v\r\n", "parse() of loose lines");
+    return failures;
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = (argc > 1) ? atof(argv[1]) : 1.0;
+
+    int failures = 0;
+    for (const Case& test : cases) {
+        failures += check(test) ? 0 : 1;
+    }
+    cout << sizeof(cases) / sizeof(cases[0]) - failures << " of "
+         << sizeof(cases) / sizeof(cases[0]) << " parser checks passed" << endl;
+
+    int chunkFailures = 0;
+    for (const ChunkCase& test : chunkCases) {
+        chunkFailures += checkChunks(test) ? 0 : 1;
+    }
+    cout << sizeof(chunkCases) / sizeof(chunkCases[0]) - chunkFailures << " of "
+         << sizeof(chunkCases) / sizeof(chunkCases[0]) << " chunk decoder checks passed" << endl;
+    failures += chunkFailures;
+
+    int headerFailures = checkHeaders();
+    cout << (headerFailures ? "Some header checks FAILED" : "Header checks passed") << endl;
+    failures += headerFailures;
+
+    HttpParser parser;
+    parser.parse(browserRequest, strlen(browserRequest));
+    cout << parser.method() << " " << parser.path() << " ? " << parser.query()
+         << "  (" << parser.headerCount() << " headers, Host " << parser.header("host")
+         << ", keep-alive " << parser.keepAlive() << ")" << endl;
+
+    size_t uLength = strlen(browserRequest);
+    long count = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    do {
+        for (int idx = 0; idx < 1000; idx++, count++) {
+            parser.reset();
+            if (parser.parse(browserRequest, uLength) != HttpParser::parseComplete) {
+                ++failures;
+            }
+        }
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < seconds);
+    printf("%ld requests of %zu bytes in %.2f s: %.0f ns per request, %.0f MB/s\n",
+           count, uLength, elapsed, elapsed * 1e9 / count, count * uLength / elapsed / 1e6);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,207 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+// httproute.cpp
+//
+// Checks HttpRouter matching on a set of overlapping patterns, then times
+// matching with routers of growing size to show that it does not depend
+// on the number of routes.
+//
+// Usage:  httproute [ iterations ]
+
+#include <sockstr/HttpRouter.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+using namespace sockstr;
+
+
+static void nothing(HttpCall&, void*) {
+}
+
+struct Check {
+    const char* method;
+    const char* path;
+    const char* pattern;    // Expected route, nullptr for none
+    const char* captures;   // Expected values, joined with '|'
+};
+
+static const char* patterns[] = {
+    "/", "/users", "/users/:id", "/users/:id/posts", "/users/:id/posts/:post",
+    "/users/new", "/static/*path", "/static/favicon.ico", "/api/v1/:res/:id",
+    "/api/v1/status", "/api/v2/*rest", "/u/:a/x", "/u/:a/:b/y",
+};
+
+static const Check checks[] = {
+    { "GET", "/", "/", "" },
+    { "GET", "/users", "/users", "" },
+    { "GET", "/users/", nullptr, "" },
+    { "GET", "/users/42", "/users/:id", "42" },
+    { "GET", "/users/new", "/users/new", "" },
+    { "GET", "/users/newer", "/users/:id", "newer" },
+    { "GET", "/users/42/posts", "/users/:id/posts", "42" },
+    { "GET", "/users/42/posts/7", "/users/:id/posts/:post", "42|7" },
+    { "GET", "/users/42/posts/7/", nullptr, "" },
+    { "GET", "/static/", "/static/*path", "" },
+    { "GET", "/static/css/site.css", "/static/*path", "css/site.css" },
+    { "GET", "/static/favicon.ico", "/static/favicon.ico", "" },
+    { "GET", "/static/favicon.icon", "/static/*path", "favicon.icon" },
+    { "GET", "/api/v1/status", "/api/v1/status", "" },
+    { "GET", "/api/v1/status/3", "/api/v1/:res/:id", "status|3" },
+    { "GET", "/api/v1/orders/3", "/api/v1/:res/:id", "orders|3" },
+    { "GET", "/api/v2/a/b/c", "/api/v2/*rest", "a/b/c" },
+    { "GET", "/u/1/x", "/u/:a/x", "1" },
+    { "GET", "/u/1/x/y", "/u/:a/:b/y", "1|x" },
+    { "HEAD", "/users/42", "/users/:id", "42" },
+    { "POST", "/users", "/users", "" },
+    { "DELETE", "/users", nullptr, "" },
+    { "GET", "/nowhere", nullptr, "" },
+};
+
+static bool runChecks() {
+    HttpRouter router;
+    for (const char* pattern : patterns) {
+        if (!router.addRoute("GET", pattern, nothing)) {
+            printf("FAIL: could not add %s\n", pattern);
+            return false;
+        }
+    }
+    router.addRoute("POST", "/users", nothing);
+
+    bool bOk = true;
+    const char* rejected[] = { "users", "/a/:", "/a/x:y", "/a/*r/b", "/users/:id" };
+    for (const char* pattern : rejected) {
+        if (router.addRoute("GET", pattern, nothing)) {
+            printf("FAIL: accepted %s\n", pattern);
+            bOk = false;
+        }
+    }
+
+    for (const Check& check : checks) {
+        HttpParams params;
+        std::string allow;
+        HttpRoute* pRoute = router.match(check.method, check.path, params, &allow);
+        std::string captures;
+        for (UINT idx = 0; idx < params.size(); idx++) {
+            captures += (idx ? "|" : "") + std::string(params[idx]);
+        }
+        const char* pattern = pRoute ? pRoute->pattern().c_str() : nullptr;
+        bool bMatch = (pattern && check.pattern) ? std::string(pattern) == check.pattern
+                                                 : pattern == check.pattern;
+        if (!bMatch || captures != check.captures) {
+            printf("FAIL: %s %s gave %s [%s]\n", check.method, check.path,
+                   pattern ? pattern : "no route", captures.c_str());
+            bOk = false;
+        }
+        if (!pRoute && !allow.empty()) {
+            printf("  %s %s: 405, Allow: %s\n", check.method, check.path, allow.c_str());
+        }
+    }
+
+    HttpParams params;
+    router.match("GET", "/users/42/posts/7", params);
+    if (params.get("id") != "42" || params.get("post") != "7" || params.name(1) != "post") {
+        printf("FAIL: capture names\n");
+        bOk = false;
+    }
+
+    // A static pattern routed for other methods does not hide a
+    // parameter or wildcard pattern routed for this one
+    HttpRouter methods;
+    methods.addRoute("GET", "/users/new", nothing);
+    methods.addRoute("POST", "/users/:id", nothing);
+    methods.addRoute("GET", "/files/readme", nothing);
+    methods.addRoute("PUT", "/files/*path", nothing);
+    HttpRoute* pRoute = methods.match("POST", "/users/new", params);
+    if (!pRoute || pRoute->pattern() != "/users/:id" || params.get("id") != "new") {
+        printf("FAIL: POST /users/new did not match /users/:id\n");
+        bOk = false;
+    }
+    pRoute = methods.match("PUT", "/files/readme", params);
+    if (!pRoute || pRoute->pattern() != "/files/*path" || params.get("path") != "readme") {
+        printf("FAIL: PUT /files/readme did not match /files/*path\n");
+        bOk = false;
+    }
+    pRoute = methods.match("HEAD", "/users/new", params);
+    if (!pRoute || pRoute->pattern() != "/users/new") {
+        printf("FAIL: HEAD /users/new did not match /users/new\n");
+        bOk = false;
+    }
+    std::string allow;
+    pRoute = methods.match("DELETE", "/users/new", params, &allow);
+    if (pRoute || allow != "GET, POST, HEAD") {
+        printf("FAIL: DELETE /users/new gave Allow: %s\n", allow.c_str());
+        bOk = false;
+    }
+    return bOk;
+}
+
+// Time matching a mix of paths against a router of uRoutes routes
+static void timeMatch(UINT uRoutes, long nIterations) {
+    HttpRouter router;
+    char szPattern[80];
+    for (UINT idx = 0; idx < uRoutes; idx++) {
+        switch (idx % 4) {
+            case 0: snprintf(szPattern, sizeof(szPattern), "/svc%u/items", idx); break;
+            case 1: snprintf(szPattern, sizeof(szPattern), "/svc%u/items/:id", idx); break;
+            case 2: snprintf(szPattern, sizeof(szPattern), "/svc%u/items/:id/parts/:part", idx); break;
+            case 3: snprintf(szPattern, sizeof(szPattern), "/svc%u/files/*path", idx); break;
+        }
+        router.addRoute("GET", szPattern, nothing);
+    }
+
+    std::vector<std::string> paths;
+    for (UINT idx = 0; idx < 64; idx++) {
+        UINT uRoute = (idx * 2654435761u) % uRoutes;
+        switch (uRoute % 4) {
+            case 0: snprintf(szPattern, sizeof(szPattern), "/svc%u/items", uRoute); break;
+            case 1: snprintf(szPattern, sizeof(szPattern), "/svc%u/items/%u", uRoute, idx); break;
+            case 2: snprintf(szPattern, sizeof(szPattern), "/svc%u/items/%u/parts/x%u", uRoute, idx, idx); break;
+            case 3: snprintf(szPattern, sizeof(szPattern), "/svc%u/files/a/b%u.txt", uRoute, idx); break;
+        }
+        paths.push_back(szPattern);
+    }
+
+    long nFound = 0;
+    HttpParams params;
+    auto start = std::chrono::steady_clock::now();
+    for (long idx = 0; idx < nIterations; idx++) {
+        nFound += router.match("GET", paths[idx % paths.size()], params) != nullptr;
+    }
+    double dElapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%6u routes: %6.1f ns per match%s\n", uRoutes, dElapsed / nIterations * 1e9,
+           nFound == nIterations ? "" : "  (MISSES)");
+}
+
+
+int main(int argc, char* argv[]) {
+    long nIterations = argc > 1 ? atol(argv[1]) : 1000000;
+    if (!runChecks()) {
+        return 1;
+    }
+    printf("Matching checks passed\n");
+    for (UINT uRoutes : { 4u, 40u, 400u, 4000u, 40000u }) {
+        timeMatch(uRoutes, nIterations);
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+// httpserver.cpp
+//
+// An HttpServer answering "/" with a short text, "/json" with a small
+// JSON document, "/echo" with the body of the request and "/users/:id"
+// with the id, and "/text" with a page of text, routed by an HttpRouter.
+// Load it with httpload.
+//
+// With -d, the files of a directory are served under "/files/" from an
+// HttpFileCache, and under "/read/" by reading each file into a string
+// for every request, for comparison.
+//
+// With -z, responses are compressed with gzip at the level given for
+// clients that accept it, as "curl --compressed" does.  Files get their
+// gzip variant whether or not -z is given.
+//
+// Usage:  httpserver [ -t threads ] [ -d directory ] [ -z level ] [ port ]
+//
+// The server runs until it gets SIGINT or SIGTERM, then prints the
+// handler latencies of the routes.
+
+#include <sockstr/HttpFileCache.h>
+#include <sockstr/HttpRouter.h>
+#include <sockstr/HttpServer.h>
+#include <sockstr/HttpStream.h>
+#include <sockstr/SocketAddr.h>
+
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+using namespace sockstr;
+using std::cout;
+using std::endl;
+
+
+static void hello(HttpCall& rCall, void* /*ptr*/) {
+    rCall.reply(200, "Hello, World!\n", "text/plain");
+}
+
+static void json(HttpCall& rCall, void* /*ptr*/) {
+    rCall.addHeader("Cache-Control", "no-store");
+    rCall.reply(200, "{ \"message\": \"Hello, World!\" }\n", "application/json");
+}
+
+static void echo(HttpCall& rCall, void* /*ptr*/) {
+    rCall.reply(200, rCall.body(), "application/octet-stream");
+}
+
+// The simple way: read the whole file for each request
+static void readFile(HttpCall& rCall, void* ptr) {
+    const std::string& root = *static_cast<std::string*>(ptr);
+    std::string_view path = rCall.params().get("path");
+    if (path.find("..") != std::string_view::npos) {
+        rCall.reply(404);
+        return;
+    }
+    std::ifstream file(root + "/" + std::string(path), std::ios::binary);
+    if (!file) {
+        rCall.reply(404);
+        return;
+    }
+    file.seekg(0, std::ios::end);
+    std::string contents(file.tellg(), '\0');
+    file.seekg(0);
+    file.read(contents.data(), contents.size());
+    rCall.reply(200, contents, HttpFileCache::contentType(path));
+}
+
+static void text(HttpCall& rCall, void* ptr) {
+    rCall.reply(200, *static_cast<std::string*>(ptr), "text/plain; charset=utf-8");
+}
+
+static void user(HttpCall& rCall, void* /*ptr*/) {
+    std::string text = "User ";
+    text.append(rCall.params().get("id"));
+    text.append("\n");
+    rCall.reply(200, text, "text/plain");
+}
+
+
+int main(int argc, char* argv[]) {
+    int port = 8080;
+    UINT threads = std::thread::hardware_concurrency();
+    std::string directory;
+    int compression = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:d:z:")) != -1) {
+        switch (opt) {
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 'd':
+                directory = optarg;
+                break;
+            case 'z':
+                compression = atoi(optarg);
+                break;
+            default:
+                cout << "Usage:  httpserver [ -t threads ] [ -d directory ] [ -z level ] [ port ]"
+                     << endl;
+                return 1;
+        }
+    }
+    if (optind < argc) {
+        port = atoi(argv[optind]);
+    }
+
+    // Blocked before the threads start, so only sigwait() sees them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    HttpRouter router;
+    router.addRoute("GET", "/", hello);
+    router.addRoute("GET", "/json", json);
+    router.addRoute("POST", "/echo", echo);
+    router.addRoute("GET", "/users/:id", user);
+    std::string page;
+    for (int line = 1; line <= 200; line++) {
+        page += "Line " + std::to_string(line) + " of a page of text that compresses well.\n";
+    }
+    router.addRoute("GET", "/text", text, &page);
+    std::unique_ptr<HttpFileCache> files;
+    if (!directory.empty()) {
+        files = std::make_unique<HttpFileCache>(directory);
+        if (!files->is_open()) {
+            cout << "Cannot open directory " << directory << endl;
+            return 2;
+        }
+        router.addRoute("GET", "/files/*path", HttpFileCache::handler, files.get());
+        router.addRoute("GET", "/read/*path", readFile, &directory);
+    }
+
+    HttpServer server(threads);
+    server.setHandler(HttpRouter::handler, &router);
+    server.setCompression(compression);
+    SocketAddr saddr(port);
+    if (!server.start(saddr)) {
+        cout << "Error opening server socket on port " << port << endl;
+        return 2;
+    }
+    cout << "Serving on port " << port << " with " << server.threads() << " threads" << endl;
+
+    int sig;
+    sigwait(&signals, &sig);
+    server.stop();
+    cout << "Served " << server.requests() << " requests" << endl;
+    router.writeStats(cout);
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+// httpstream.cpp
+//
+// A server on an EventLoop answers "/export" with a generated CSV report
+// streamed in chunks as it is made, and "/buffered" with the same report
+// built in memory first and sent with a Content-Length.  A client on
+// another thread fetches both over one connection and shows the time to
+// the first byte, the total time and the most of the body the server
+// held in memory.
+//
+// Usage:  httpstream [ rows [ port ] ]
+
+#include <sockstr/EventLoop.h>
+#include <sockstr/HttpStream.h>
+#include <sockstr/SocketAddr.h>
+#include <sockstr/SocketPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+using namespace sockstr;
+using std::cout;
+using std::endl;
+
+typedef std::chrono::steady_clock Clock;
+
+// The streamed report is sent in pieces of about this size
+static const std::size_t BATCH = 16384;
+
+static std::atomic<std::size_t> heldMost(0);
+
+
+static void appendRow(std::string& out, long row) {
+    char line[96];
+    int len = snprintf(line, sizeof(line), "%ld,item-%ld,%ld.%02ld,%s\n", row, row,
+                       row * 7 % 1000, row % 100, row % 3 ? "open" : "closed");
+    out.append(line, len);
+}
+
+Task<void> serve(SocketPool<HttpServerStream>::Handle conn, long rows) {
+    while (co_await conn->async_receive()) {
+        std::string_view path = conn->getParser().path();
+        std::string body;
+        if (path == "/export") {
+            conn->beginResponse("text/csv");
+            for (long row = 0; row < rows; row++) {
+                appendRow(body, row);
+                if (body.size() >= BATCH) {
+                    heldMost = std::max(heldMost.load(), body.size());
+                    if (!co_await conn->async_writeChunk(body)) {
+                        co_return;
+                    }
+                    body.clear();
+                }
+            }
+            co_await conn->async_writeChunk(body);
+            co_await conn->async_endResponse();
+        } else if (path == "/buffered") {
+            for (long row = 0; row < rows; row++) {
+                appendRow(body, row);
+            }
+            heldMost = body.size();
+            conn->appendResponse(body, "text/csv");
+        } else {
+            conn->appendResponse(std::string_view(), 0, 404);
+        }
+    }
+    co_await conn->async_flushResponses();
+}
+
+Task<void> server(Socket& serverSock, SocketPool<HttpServerStream>& pool, long rows) {
+    auto conn = pool.acquire();
+    if (co_await serverSock.async_accept(*conn)) {
+        co_await serve(std::move(conn), rows);
+    }
+}
+
+struct Progress {
+    Clock::time_point start;
+    Clock::time_point first;
+    bool bFirst;
+};
+
+static bool received(const char* /*pData*/, UINT /*uLength*/, void* ptr) {
+    Progress& progress = *static_cast<Progress*>(ptr);
+    if (!progress.bFirst) {
+        progress.first = Clock::now();
+        progress.bFirst = true;
+    }
+    return true;
+}
+
+static void fetch(HttpStream& http, const char* path) {
+    Progress progress = { Clock::now(), Clock::time_point(), false };
+    heldMost = 0;
+    HttpBodySink sink(received, &progress);
+    UINT status = http.get(path, sink);
+    auto end = Clock::now();
+    double firstMs = std::chrono::duration<double, std::milli>(progress.first - progress.start).count();
+    double totalMs = std::chrono::duration<double, std::milli>(end - progress.start).count();
+    printf("%-10s %u  %9llu bytes  first byte %8.2f ms  total %8.2f ms  held %9zu bytes%s\n",
+           path, status, static_cast<unsigned long long>(sink.size()), firstMs, totalMs,
+           heldMost.load(), http.getResponse().header("Transfer-Encoding").empty() ? "" : "  (chunked)");
+}
+
+
+int main(int argc, char* argv[]) {
+    long rows = argc > 1 ? atol(argv[1]) : 1000000;
+    int port = argc > 2 ? atoi(argv[2]) : 8093;
+
+    SocketPool<HttpServerStream> pool;
+    EventLoop loop;
+    Socket serverSock;
+    SocketAddr saddr(port);
+    if (!serverSock.open(saddr, Socket::modeReadWrite | Socket::modeCreate)) {
+        cout << "Error opening server socket on port " << port << endl;
+        return 2;
+    }
+    loop.spawn(server(serverSock, pool, rows));
+
+    std::thread client([port]() {
+        SocketAddr caddr("127.0.0.1", port);
+        HttpStream http(caddr, Socket::modeReadWrite);
+        fetch(http, "/export");
+        fetch(http, "/buffered");
+        fetch(http, "/export");
+        http.close();
+    });
+    loop.run();
+    client.join();
+    serverSock.close();
+    return 0;
+}
@@ -0,0 +1,327 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+// httpupload.cpp
+//
+// A server on an EventLoop streams request bodies larger than 64 KB
+// straight to files in a directory: "PUT /files/<name>" stores the body,
+// and "POST /upload" parses a multipart/form-data body as it arrives,
+// storing each file part under its own name.  A client on another thread
+// uploads a generated file with PUT from a file descriptor (sendfile), a
+// small buffer with PUT, and the same file again in a multipart body made
+// by a callback and sent chunked.  The stored files are compared with the
+// original, and the throughput and peak memory of the process are shown.
+// With 0 megabytes the server runs alone, for uploads made with curl:
+//      curl -T big.iso http://127.0.0.1:8094/files/big.iso
+//      curl -F file=@big.iso http://127.0.0.1:8094/upload
+//
+// Usage:  httpupload [ directory [ megabytes [ port ] ] ]
+
+#include <sockstr/EventLoop.h>
+#include <sockstr/HttpBody.h>
+#include <sockstr/HttpMultipart.h>
+#include <sockstr/HttpStream.h>
+#include <sockstr/SocketAddr.h>
+#include <sockstr/SocketPool.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+using namespace sockstr;
+using std::cout;
+using std::endl;
+
+typedef std::chrono::steady_clock Clock;
+
+static const char BOUNDARY[] = "----httpupload7MA4YWxkTrZu0gW";
+
+
+// Keep only the last component of a name sent by the client
+static std::string baseName(std::string_view name) {
+    std::size_t slash = name.find_last_of("/\\");
+    if (slash != std::string_view::npos) {
+        name.remove_prefix(slash + 1);
+    }
+    if (name.empty() || name == "." || name == "..") {
+        return std::string();
+    }
+    return std::string(name);
+}
+
+// Files of a multipart upload being stored
+struct Upload {
+    std::string dir;
+    int fd = -1;
+    HttpBodySink sink;
+    UINT files = 0;
+};
+
+static HttpBodySink* onPart(const HttpPart& part, bool bEnd, void* ptr) {
+    Upload& upload = *static_cast<Upload*>(ptr);
+    if (bEnd) {
+        if (upload.fd >= 0) {
+            ::close(upload.fd);
+            upload.fd = -1;
+            upload.files++;
+        }
+        return 0;
+    }
+    std::string name = baseName(part.filename);
+    if (name.empty()) {
+        return 0;               // A form field, not a file
+    }
+    upload.fd = open((upload.dir + "/" + name).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (upload.fd < 0) {
+        return 0;
+    }
+    upload.sink = HttpBodySink(upload.fd);
+    return &upload.sink;
+}
+
+Task<bool> store(HttpServerStream& conn, const std::string& path, std::string& result) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        result = "cannot create " + path + "\n";
+        co_return false;
+    }
+    HttpBodySink sink(fd);
+    bool ok = co_await conn.async_readBody(sink);
+    ::close(fd);
+    result = std::to_string(sink.size()) + " bytes stored\n";
+    co_return ok;
+}
+
+Task<bool> storeParts(HttpServerStream& conn, const std::string& dir, std::string& result) {
+    std::string type(conn.getParser().header("Content-Type"));
+    std::string_view boundary = HttpMultipartParser::boundaryOf(type);
+    Upload upload;
+    upload.dir = dir;
+    HttpMultipartParser parser(boundary, onPart, &upload);
+    std::string_view piece;
+    bool ok = !boundary.empty();
+    while (ok && (ok = co_await conn.async_readBody(piece)) && !piece.empty()) {
+        ok = parser.write(piece.data(), piece.size());
+    }
+    if (upload.fd >= 0) {
+        ::close(upload.fd);
+    }
+    ok = ok && parser.finished();
+    result = std::to_string(upload.files) + " files stored\n";
+    co_return ok;
+}
+
+Task<void> serve(SocketPool<HttpServerStream>::Handle conn, std::string dir) {
+    // Bodies go to disk, so their size is not limited
+    HttpParser::Limits limits;
+    limits.uMaxBody = UINT64_MAX;
+    conn->setLimits(limits);
+    conn->setBodyStreaming(65536);
+    while (co_await conn->async_receive()) {
+        const HttpParser& request = conn->getParser();
+        std::string_view path = request.path();
+        std::string result;
+        bool ok;
+        UINT status = 201;
+        if (request.method() == "PUT" && path.substr(0, 7) == "/files/"
+            && !baseName(path.substr(7)).empty()) {
+            ok = co_await store(*conn, dir + "/" + baseName(path.substr(7)), result);
+        } else if (request.method() == "POST" && path == "/upload") {
+            ok = co_await storeParts(*conn, dir, result);
+        } else {
+            ok = true;
+            result = "not found\n";
+            status = 404;
+        }
+        if (!ok) {
+            status = 400;
+            conn->closeAfterResponse();
+        }
+        conn->appendResponse(result, "text/plain", status);
+    }
+    co_await conn->async_flushResponses();
+}
+
+Task<void> server(Socket& serverSock, SocketPool<HttpServerStream>& pool, std::string dir) {
+    for (;;) {
+        auto conn = pool.acquire();
+        if (!co_await serverSock.async_accept(*conn)) {
+            break;
+        }
+        EventLoop::current()->spawn(serve(std::move(conn), dir));
+    }
+}
+
+// Multipart body made from a file as it is sent
+struct Producer {
+    int fd;
+    std::string text;           // Part head or closing delimiter to send
+    std::size_t sent;
+    int stage;
+};
+
+static UINT produce(char* pBuffer, UINT uSize, void* ptr) {
+    Producer& producer = *static_cast<Producer*>(ptr);
+    for (;;) {
+        if (producer.sent < producer.text.size()) {
+            UINT n = std::min<std::size_t>(uSize, producer.text.size() - producer.sent);
+            memcpy(pBuffer, producer.text.data() + producer.sent, n);
+            producer.sent += n;
+            return n;
+        }
+        if (producer.stage == 1) {
+            ssize_t n = ::read(producer.fd, pBuffer, uSize);
+            if (n > 0) {
+                return static_cast<UINT>(n);
+            }
+            producer.text = std::string("\r\n--") + BOUNDARY + "--\r\n";
+            producer.sent = 0;
+        }
+        if (producer.stage++ == 2) {
+            return 0;
+        }
+    }
+}
+
+static bool sameContent(const std::string& a, const std::string& b) {
+    FILE* fa = fopen(a.c_str(), "rb");
+    FILE* fb = fopen(b.c_str(), "rb");
+    bool same = fa && fb;
+    static char bufA[65536], bufB[65536];
+    while (same) {
+        std::size_t na = fread(bufA, 1, sizeof(bufA), fa);
+        std::size_t nb = fread(bufB, 1, sizeof(bufB), fb);
+        same = na == nb && memcmp(bufA, bufB, na) == 0;
+        if (na == 0) {
+            break;
+        }
+    }
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    return same;
+}
+
+static void report(const char* what, UINT status, const std::string& reply, uint64_t bytes,
+                   Clock::time_point start, bool same) {
+    double secs = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("%-24s %u  %-20.*s %8.1f MB/s  %s\n", what, status,
+           static_cast<int>(reply.size() ? reply.size() - 1 : 0), reply.c_str(),
+           bytes / secs / 1e6, same ? "matches" : "DIFFERS");
+}
+
+static void upload(int port, const std::string& dir, const std::string& original,
+                   uint64_t size) {
+    SocketAddr caddr("127.0.0.1", port);
+    HttpStream http(caddr, Socket::modeReadWrite);
+    std::string reply;
+
+    int fd = open(original.c_str(), O_RDONLY);
+    HttpBodySource file(fd, 0, size);
+    HttpBodySink sink(reply);
+    auto start = Clock::now();
+    UINT status = http.put("/files/put.bin", file, sink);
+    report("PUT from file", status, reply, size, start, sameContent(original, dir + "/put.bin"));
+    if (status != 201) {
+        ::close(fd);
+        return;
+    }
+
+    static const char note[] = "A small body goes out with the head\n";
+    HttpBodySource buffer(note, sizeof(note) - 1);
+    reply.clear();
+    start = Clock::now();
+    status = http.put("/files/note.txt", buffer, sink);
+    printf("%-24s %u  %.*s", "PUT from buffer", status, static_cast<int>(reply.size()),
+           reply.c_str());
+
+    lseek(fd, 0, SEEK_SET);
+    Producer producer = { fd, std::string("--") + BOUNDARY + "\r\n"
+                          "Content-Disposition: form-data; name=\"file\"; filename=\"form.bin\"\r\n"
+                          "Content-Type: application/octet-stream\r\n\r\n", 0, 1 };
+    HttpBodySource form(produce, &producer);
+    http.addHeader("Content-Type", std::string("multipart/form-data; boundary=") + BOUNDARY);
+    reply.clear();
+    start = Clock::now();
+    status = http.post("/upload", form, sink);
+    report("POST multipart, chunked", status, reply, size, start,
+           sameContent(original, dir + "/form.bin"));
+    ::close(fd);
+    http.close();
+}
+
+
+int main(int argc, char* argv[]) {
+    std::string dir = argc > 1 ? argv[1] : "/tmp/httpupload";
+    long megabytes = argc > 2 ? atol(argv[2]) : 64;
+    int port = argc > 3 ? atoi(argv[3]) : 8094;
+
+    mkdir(dir.c_str(), 0755);
+    SocketPool<HttpServerStream> pool;
+    EventLoop loop;
+    Socket serverSock;
+    SocketAddr saddr(port);
+    if (!serverSock.open(saddr, Socket::modeReadWrite | Socket::modeCreate)) {
+        cout << "Error opening server socket on port " << port << endl;
+        return 2;
+    }
+    loop.spawn(server(serverSock, pool, dir));
+    if (megabytes <= 0) {
+        loop.run();
+        return 0;
+    }
+
+    std::string original = dir + "/original.bin";
+    FILE* fp = fopen(original.c_str(), "wb");
+    if (!fp) {
+        cout << "Cannot create " << original << endl;
+        return 1;
+    }
+    uint64_t size = static_cast<uint64_t>(megabytes) * 1024 * 1024;
+    std::string block(1024 * 1024, 0);
+    for (long mb = 0; mb < megabytes; mb++) {
+        for (std::size_t i = 0; i < block.size(); i++) {
+            block[i] = static_cast<char>((i * 7 + mb * 13 + (i >> 11)) & 0xff);
+        }
+        fwrite(block.data(), 1, block.size(), fp);
+    }
+    fclose(fp);
+    block = std::string();
+
+    std::thread client([&]() {
+        upload(port, dir, original, size);
+        loop.stop();
+    });
+    loop.run();
+    client.join();
+    serverSock.close();
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("%ld MB uploaded twice, peak memory of the process %ld KB\n", megabytes,
+           usage.ru_maxrss);
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+// ipccodec.cpp
+//
+// Encodes IPC messages with IpcCodec, compares the size of the wire form
+// with the raw struct, reads the fields back through an IpcView and
+// measures how fast both go.
+//
+// Usage:  ipccodec [ count ]
+
+#include <sockstr/IPC.h>
+#include <sockstr/IpcCodec.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+using namespace sockstr;
+using std::cout;
+using std::endl;
+
+enum Priority { PriorityLow, PriorityNormal, PriorityHigh };
+
+enum { IPC_Publish = 1001, IPC_PublishReply = IPC_Publish };
+
+#pragma pack(2)
+IPC_MESSAGE(Publish)
+    DWORD    dwChannel_;
+    UINT     uFlags_;
+    Priority priority_;
+    double   dTimestamp_;
+    char     szTopic_[128];
+    unsigned char payload_[512];
+IPC_ENDMESSAGE
+
+IPC_REPLY(PublishReply)
+    UINT uSubscribers_;
+IPC_ENDREPLY
+#pragma pack()
+
+IPC_FIELDS(Publish, dwChannel_, uFlags_, priority_, dTimestamp_, szTopic_, payload_)
+IPC_FIELDS(PublishReply, uSubscribers_)
+
+
+static void dump(const std::vector<char>& wire) {
+    for (std::size_t idx = 0; idx < wire.size() && idx < 32; idx++) {
+        printf("%02x ", static_cast<unsigned char>(wire[idx]));
+    }
+    printf("%s\n", wire.size() > 32 ? "..." : "");
+}
+
+int main(int argc, const char* argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 1000000;
+    int errors = 0;
+
+    Publish publish;
+    memset(publish.szTopic_, 0, sizeof(publish.szTopic_));
+    memset(publish.payload_, 0, sizeof(publish.payload_));
+    publish.dwSequence_ = 42;
+    publish.dwChannel_ = -3;
+    publish.uFlags_ = 0x81;
+    publish.priority_ = PriorityHigh;
+    publish.dTimestamp_ = 1792300800.25;
+    strcpy(publish.szTopic_, "sensors/temperature");
+    memcpy(publish.payload_, "\x01\x02\x03\x04\x05\x06\x07\x08", 8);
+
+    std::vector<char> wire;
+    IpcCodec<Publish>::encode(publish, wire);
+    cout << "Publish: raw " << sizeof(Publish) << " bytes, encoded " << wire.size()
+         << " bytes (at most " << IpcCodec<Publish>::maxSize << ")" << endl;
+    dump(wire);
+
+    Publish decoded;
+    if (!IpcCodec<Publish>::decode(wire.data(), wire.size(), decoded)
+        || memcmp(&decoded, &publish, sizeof(Publish)) != 0) {
+        cout << "Publish did not survive the round trip" << endl;
+        ++errors;
+    }
+
+    IpcView<Publish> view(wire.data(), wire.size());
+    if (!view.valid() || view.sequence() != 42 || view.get<&Publish::dwChannel_>() != -3
+        || view.get<&Publish::szTopic_>() != "sensors/temperature"
+        || view.get<&Publish::payload_>().size() != 8
+        || view.get<&Publish::priority_>() != PriorityHigh) {
+        cout << "IpcView read the wrong fields" << endl;
+        ++errors;
+    }
+
+    PublishReply reply;
+    reply.dwSequence_ = 42;
+    reply.dwReturn_ = -1;
+    reply.uSubscribers_ = 300;
+    wire.clear();
+    IpcCodec<PublishReply>::encode(reply, wire);
+    cout << "PublishReply: raw " << sizeof(PublishReply) << " bytes, encoded "
+         << wire.size() << " bytes" << endl;
+    dump(wire);
+    IpcView<PublishReply> replyView(wire.data(), wire.size());
+    if (!replyView.valid() || replyView.returnValue() != -1
+        || replyView.get<&PublishReply::uSubscribers_>() != 300) {
+        cout << "PublishReply did not survive the round trip" << endl;
+        ++errors;
+    }
+
+    SocketResponse response;
+    response.wResponse_ = 1;
+    response.wPort_ = 4000;
+    strcpy(response.szServer_, "localhost");
+    wire.clear();
+    IpcCodec<SocketResponse>::encode(response, wire);
+    cout << "SocketResponse: raw " << sizeof(SocketResponse) << " bytes, encoded "
+         << wire.size() << " bytes" << endl;
+
+    // A truncated frame or a wrong message type must be refused
+    if (IpcView<SocketResponse>(wire.data(), wire.size() - 1).valid()
+        || IpcView<Publish>(wire.data(), wire.size()).valid()) {
+        cout << "A bad frame was accepted" << endl;
+        ++errors;
+    }
+
+    wire.resize(IpcCodec<Publish>::maxSize);
+    auto start = std::chrono::steady_clock::now();
+    std::size_t length = 0;
+    for (int idx = 0; idx < count; idx++) {
+        publish.dwChannel_ = idx;
+        length = IpcCodec<Publish>::encode(publish, wire.data(), wire.size());
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cout << "encode: " << static_cast<long>(count / secs) << " msgs/s" << endl;
+
+    start = std::chrono::steady_clock::now();
+    long sum = 0;
+    for (int idx = 0; idx < count; idx++) {
+        IpcView<Publish> msg(wire.data(), length);
+        sum += msg.get<&Publish::dwChannel_>() + msg.get<&Publish::szTopic_>().size();
+    }
+    secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cout << "view:   " << static_cast<long>(count / secs) << " msgs/s" << endl;
+
+    return errors || sum == 0 ? 1 : 0;
+}
@@ -0,0 +1,194 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+// ipccompress.cpp
+//
+// Measures the compression ratio and throughput of ZlibCompressor on a few
+// kinds of IPC payload, then sends compressed messages over a loopback
+// connection and checks that they arrive intact.
+//
+// Usage:  ipccompress [ port [ seconds ] ]
+
+#include <sockstr/IPC.h>
+#include <sockstr/IpcCompressor.h>
+#include <sockstr/Socket.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+using namespace sockstr;
+using std::cout;
+using std::endl;
+
+enum { IPC_Bulk = 1001 };
+
+#pragma pack(2)
+IPC_MESSAGE(Bulk)
+    UINT uChecksum_;
+    char data_[32768];
+IPC_ENDMESSAGE
+#pragma pack()
+
+static const UINT bulkHeader = sizeof(Bulk) - sizeof(Bulk::data_);
+
+
+static UINT checksum(const char* pData, UINT uLength) {
+    UINT uSum = 0;
+    for (UINT idx = 0; idx < uLength; idx++) {
+        uSum = uSum * 31 + static_cast<unsigned char>(pData[idx]);
+    }
+    return uSum;
+}
+
+// Fill the message with uLength bytes of the given kind of payload
+static void fill(Bulk& bulk, const std::string& kind, UINT uLength, std::mt19937& rng) {
+    std::string text;
+    if (kind == "json") {
+        static const char* levels[] = { "debug", "info", "warning", "error" };
+        while (text.size() < uLength) {
+            char record[256];
+            snprintf(record, sizeof(record),
+                     "{\"ts\":%u,\"host\":\"node-%02u.dc%u\",\"level\":\"%s\","
+                     "\"latency_us\":%u,\"path\":\"/api/v1/items/%u\"}\n",
+                     1792300800u + static_cast<UINT>(text.size()), UINT(rng() % 40),
+                     UINT(rng() % 3), levels[rng() % 4], UINT(rng() % 5000),
+                     UINT(rng() % 100000));
+            text += record;
+        }
+        memcpy(bulk.data_, text.data(), uLength);
+    } else if (kind == "telemetry") {
+        int value = 20000;
+        for (UINT idx = 0; idx + sizeof(int) <= uLength; idx += sizeof(int)) {
+            value += static_cast<int>(rng() % 21) - 10;
+            memcpy(bulk.data_ + idx, &value, sizeof(int));
+        }
+    } else {
+        for (UINT idx = 0; idx < uLength; idx++) {
+            bulk.data_[idx] = static_cast<char>(rng());
+        }
+    }
+    bulk.wPacketSize_ = bulkHeader + uLength;
+    bulk.uChecksum_ = checksum(bulk.data_, uLength);
+}
+
+static void benchmark(const std::string& kind, UINT uLength, int nLevel, double seconds) {
+    std::mt19937 rng(1);
+    auto pBulk = std::make_unique<Bulk>();
+    fill(*pBulk, kind, uLength, rng);
+    ZlibCompressor compressor(IpcCompressor::defaultThreshold, nLevel);
+    ZlibCompressor expander;
+
+    const IpcStruct* pPacked = compressor.compress(pBulk.get());
+    UINT uPacked = pPacked->wPacketSize_;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    long rounds = 0;
+    do {
+        for (int idx = 0; idx < 16; idx++, rounds++) {
+            compressor.compress(pBulk.get());
+        }
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < seconds);
+    double compressRate = rounds * double(pBulk->wPacketSize_) / elapsed / 1e6;
+
+    start = std::chrono::steady_clock::now();
+    rounds = 0;
+    const IpcStruct* pExpanded = nullptr;
+    do {
+        for (int idx = 0; idx < 16; idx++, rounds++) {
+            pExpanded = expander.expand(pPacked);
+        }
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < seconds);
+    double expandRate = rounds * double(pBulk->wPacketSize_) / elapsed / 1e6;
+
+    bool ok = pExpanded != nullptr && pExpanded->wPacketSize_ == pBulk->wPacketSize_
+              && memcmp(pExpanded, pBulk.get(), pBulk->wPacketSize_) == 0;
+    // Messages that do not shrink are sent as they are and need no expanding
+    printf("%-10s %6u  level %2d  %6u -> %6u (%5.1f%%)  compress %6.1f MB/s",
+           kind.c_str(), uLength, nLevel, pBulk->wPacketSize_, uPacked,
+           100.0 * uPacked / pBulk->wPacketSize_, compressRate);
+    if (IpcCompressor::isCompressed(pPacked)) {
+        printf("  expand %6.1f MB/s", expandRate);
+    }
+    printf("%s\n", ok ? "" : "  MISMATCH");
+}
+
+static int receiver(Socket* pListener, int messages) {
+    Socket peer;
+    if (!pListener->accept(peer)) {
+        return 1;
+    }
+    peer.setCompressor(std::make_unique<ZlibCompressor>());
+    int errors = 0;
+    for (int idx = 0; idx < messages; idx++) {
+        const Bulk* pBulk = static_cast<const Bulk*>(peer.remoteReadFrame());
+        if (pBulk == nullptr || pBulk->wFunction_ != IPC_Bulk
+            || checksum(pBulk->data_, pBulk->wPacketSize_ - bulkHeader) != pBulk->uChecksum_) {
+            ++errors;
+            break;
+        }
+    }
+    return errors;
+}
+
+int main(int argc, const char* argv[]) {
+    std::string port = argc > 1 ? argv[1] : "9421";
+    double seconds = argc > 2 ? atof(argv[2]) : 0.3;
+
+    for (const char* kind : { "json", "telemetry", "random" }) {
+        for (UINT uLength : { 4096u, 32768u }) {
+            for (int nLevel : { 1, 6 }) {
+                benchmark(kind, uLength, nLevel, seconds);
+            }
+        }
+    }
+
+    // End to end: both peers compress, mixed message kinds and sizes
+    std::string address = "localhost:" + port;
+    Socket listener(address.c_str(), Socket::modeCreate | Socket::modeReadWrite);
+    if (!listener.is_open()) {
+        std::cerr << "Cannot listen on port " << port << endl;
+        return 1;
+    }
+    const int messages = 300;
+    int errors = 0;
+    std::thread peer([&] { errors = receiver(&listener, messages); });
+
+    Socket sender(address.c_str(), Socket::modeReadWrite);
+    sender.setCompressor(std::make_unique<ZlibCompressor>(512, 1));
+    std::mt19937 rng(2);
+    auto pBulk = std::make_unique<Bulk>();
+    static const char* kinds[] = { "json", "telemetry", "random" };
+    for (int idx = 0; idx < messages; idx++) {
+        fill(*pBulk, kinds[idx % 3], 16 + rng() % (sizeof(pBulk->data_) - 16), rng);
+        sender.remoteProcedure(pBulk.get());
+    }
+    peer.join();
+    cout << messages << " messages over loopback: "
+         << (errors ? "CORRUPTED" : "all intact") << endl;
+    return errors ? 1 : 0;
+}
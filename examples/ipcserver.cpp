@@ -0,0 +1,176 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+// ipcserver.cpp
+//
+// An IpcServer with a worker pool answering Add requests, loaded by a
+// number of client connections that each keep several calls in flight
+// with an RpcClient.  Before the load, function numbers out of range
+// must be refused by registerHandler() and dropped when received.
+//
+// Usage:  ipcserver [ port [ workers [ clients [ calls ] ] ] ]
+
+#include <sockstr/EventLoop.h>
+#include <sockstr/IPC.h>
+#include <sockstr/IpcServer.h>
+#include <sockstr/RpcClient.h>
+#include <sockstr/Socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace sockstr;
+using std::cout;
+using std::endl;
+
+enum { IPC_Add = 200, IPC_AddReply = IPC_Add };
+
+#pragma pack(2)
+IPC_MESSAGE(Add)
+    DWORD dwA_;
+    DWORD dwB_;
+IPC_ENDMESSAGE
+
+IPC_REPLY(AddReply)
+    DWORD dwSum_;
+IPC_ENDREPLY
+#pragma pack()
+
+static const int callersPerClient = 16;
+static int callersRunning = 0;
+static long callsFailed = 0;
+
+
+static void add(IpcCall& rCall, void* /*ptr*/) {
+    const Add* pAdd = static_cast<const Add*>(rCall.request());
+    AddReply reply;
+    reply.dwSum_ = pAdd->dwA_ + pAdd->dwB_;
+    rCall.reply(&reply);
+}
+
+Task<void> caller(RpcClient& rpc, int calls) {
+    Add request;
+    AddReply reply;
+    for (int idx = 0; idx < calls; idx++) {
+        request.dwA_ = idx;
+        request.dwB_ = 2;
+        int sz = co_await rpc.async_call(&request, &reply, 0, 5000);
+        if (sz <= 0 || reply.dwSum_ != DWORD(idx + 2)) {
+            ++callsFailed;
+        }
+    }
+    if (--callersRunning == 0) {
+        EventLoop::current()->stop();
+    }
+}
+
+// A message whose function number is out of range gets no reply, even
+// if its low 16 bits name a handler
+static bool dropsBadFunction(const std::string& address) {
+    Socket sock(address.c_str(), Socket::modeReadWrite);
+    Add bad;
+    bad.wFunction_ = 0x10000 + IPC_Add;
+    bad.dwA_ = 1000;
+    bad.dwB_ = 1;
+    Add good;
+    good.dwA_ = 1;
+    good.dwB_ = 2;
+    sock.write(&bad, sizeof(bad));
+    sock.write(&good, sizeof(good));
+    AddReply reply;
+    if (sock.read(&reply, sizeof(reply)) != int(sizeof(reply)) || reply.dwSum_ != 3) {
+        return false;
+    }
+    sock.setTimeout(Socket::timeoutRead, 200);
+    return sock.read(&reply, sizeof(reply)) <= 0 && sock.queryStatus() == SC_TIMEOUT;
+}
+
+int main(int argc, const char* argv[]) {
+    std::string port = argc > 1 ? argv[1] : "9419";
+    UINT workers = argc > 2 ? atoi(argv[2]) : std::thread::hardware_concurrency();
+    int clients = argc > 3 ? atoi(argv[3]) : 8;
+    int calls = argc > 4 ? atoi(argv[4]) : 200000;
+    std::string address = "localhost:" + port;
+
+    Socket listener(address.c_str(), Socket::modeCreate | Socket::modeReadWrite);
+    if (!listener.is_open()) {
+        std::cerr << "Cannot listen on port " << port << endl;
+        return 1;
+    }
+    std::atomic<EventLoop*> pServerLoop(nullptr);
+    std::atomic<bool> badRegistered(false);
+    std::thread serverThread([&] {
+        EventLoop loop;
+        IpcServer server(workers);
+        server.registerHandler(IPC_Add, add);
+        badRegistered = server.registerHandler(-1, add)
+                        || server.registerHandler(0x10000 + IPC_Add, add)
+                        || server.registerHandler(IpcServer::maxFunction + 1, add);
+        pServerLoop = &loop;
+        loop.spawn(server.serve(listener));
+        loop.run();
+    });
+
+    while (pServerLoop == nullptr) {
+        std::this_thread::yield();
+    }
+    if (badRegistered) {
+        cout << "registerHandler accepted a function number out of range" << endl;
+        ++callsFailed;
+    }
+    if (!dropsBadFunction(address)) {
+        cout << "A function number out of range was dispatched" << endl;
+        ++callsFailed;
+    }
+
+    EventLoop loop;
+    std::vector<std::unique_ptr<Socket>> sockets;
+    std::vector<std::unique_ptr<RpcClient>> rpcs;
+    for (int idx = 0; idx < clients; idx++) {
+        sockets.push_back(std::make_unique<Socket>(address.c_str(), Socket::modeReadWrite));
+        if (!sockets.back()->is_open()) {
+            std::cerr << "Cannot connect to port " << port << endl;
+            return 1;
+        }
+        rpcs.push_back(std::make_unique<RpcClient>(*sockets.back()));
+        loop.spawn(rpcs.back()->run());
+        for (int c = 0; c < callersPerClient; c++) {
+            ++callersRunning;
+            loop.spawn(caller(*rpcs.back(), calls / clients / callersPerClient));
+        }
+    }
+    auto start = std::chrono::steady_clock::now();
+    loop.run();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cout << workers << " workers, " << clients << " clients: "
+         << static_cast<long>(calls / secs) << " calls/s" << endl;
+
+    pServerLoop.load()->stop();
+    serverThread.join();
+    if (callsFailed) {
+        cout << callsFailed << " calls failed" << endl;
+    }
+    return callsFailed ? 1 : 0;
+}
@@ -20,7 +20,8 @@
 
 // restserver.cpp
 //
-// An example of a multi-threaded REST server.
+// An example of a multi-threaded REST server.  Each connection is served
+// by a thread of its own, for as many requests as the client keeps it open.
 
 #include <sockstr/HttpHelpers.h>
 #include <sockstr/HttpStream.h>
@@ -33,7 +34,6 @@
 #include <sstream>
 #include <stdlib.h>
 #include <thread>
-#include <vector>
 #include <unistd.h>
 using namespace sockstr;
 using std::cout;
@@ -41,6 +41,8 @@ using std::endl;
 
 
 static bool debugOut = false;
+static UINT maxRequests = 1000;
+static UINT idleMillisec = 15000;
 
 struct Params {
     Params(int lPort, HttpServerStream* lClient) : port(lPort), client(lClient) { }
@@ -54,28 +56,39 @@ void request_handler(Params* params) {
     const char* hostport = *sock;
     cout << "Server thread connected to " << hostport << endl;
     sock->loadDefaultHeaders();
+    sock->setMaxRequests(maxRequests);
+    // A keep-alive connection is dropped when the client leaves it idle
+    sock->setTimeout(Socket::timeoutRead, idleMillisec);
 
     char buf[1024];
     static const char* errorJson = "{ error: { text: \"Malformed request\" } }\r\n";
 
-    if (sock->queryStatus() == SC_OK) {
-        HttpServerStream::HttpFunction funct;
-        std::string url;
-        unsigned int sz = sock->request(buf, sizeof(buf), funct, url);
-        if (sz == 0) {
-            cout << "ERROR on http request" << endl;
-            sock->response(errorJson, strlen(errorJson), "application/json", 404);
-        } else {
-            const char* funcName = sock->functionName(funct);
-            cout << "HttpReq: " << funcName << " " << url << "." << endl;
-            if (debugOut) {
-                cout << std::string(buf, sz) << endl;
+    HttpServerStream::HttpFunction funct;
+    std::string url;
+    unsigned int sz;
+    while (sock->queryStatus() == SC_OK
+           && (sz = sock->request(buf, sizeof(buf), funct, url)) > 0) {
+        const char* funcName = sock->functionName(funct);
+        cout << "HttpReq: " << funcName << " " << url << "." << endl;
+        if (debugOut) {
+            // buf holds as much of the request as fits; the headers are whole
+            const HttpHeaders& headers = sock->getRequestHeaders();
+            for (std::size_t idx = 0; idx < headers.size(); idx++) {
+                HttpHeaders::Field field = headers.at(idx);
+                cout << "  " << field.name << ": " << field.value << endl;
             }
-            std::ostringstream someJson;
-            someJson << "{ http: \"" << funcName << "\", url: \"" << url << "\" }\r\n";
-            sock->response(someJson.str().c_str(), someJson.str().size(), "application/json");
         }
+        std::ostringstream someJson;
+        someJson << "{ http: \"" << funcName << "\", url: \"" << url << "\" }\r\n";
+        sock->response(someJson.str().c_str(), someJson.str().size(), "application/json");
     }
+    // Nothing to answer if the client just went away
+    UINT status = sock->errorStatus();
+    if (status != 0) {
+        cout << "ERROR on http request" << endl;
+        sock->response(errorJson, strlen(errorJson), "application/json", status);
+    }
+    cout << "Server thread served " << sock->requestCount() << " requests" << endl;
 
     sock->close();
     delete sock;
@@ -86,13 +99,20 @@ void request_handler(Params* params) {
 int main(int argc, char* argv[]) {
     int port = 4321;
     int opt;
-    while ((opt = getopt(argc, argv, "D")) != -1) {
+    while ((opt = getopt(argc, argv, "Dn:t:")) != -1) {
         switch (opt) {
             case 'D':
                 debugOut = true;
                 break;
+            case 'n':
+                maxRequests = atoi(optarg);
+                break;
+            case 't':
+                idleMillisec = atoi(optarg) * 1000;
+                break;
             default:
-                cout << "Usage:  restserver [ -D ] [ port ]" << endl;
+                cout << "Usage:  restserver [ -D ] [ -n max-requests ] [ -t idle-seconds ] [ port ]"
+                     << endl;
                 return 1;
         }
     }
@@ -114,21 +134,14 @@ int main(int argc, char* argv[]) {
         return 2;
     }
 
-    std::vector<std::thread> threads;
+    // A thread serves one connection for as long as it is kept alive
     do {
         HttpServerStream* clientSock = (HttpServerStream*) sock.listen();
         if (clientSock) {
             Params* params = new Params(port, clientSock);
-            threads.emplace_back(request_handler, params);
+            std::thread(request_handler, params).detach();
         }
     } while (true);
 
-    for (auto& thr : threads) {
-        if (thr.joinable()) {
-            thr.join();
-        }
-    }
-    threads.clear();
-
     return 0;
 }
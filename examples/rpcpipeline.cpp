@@ -0,0 +1,135 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+// rpcpipeline.cpp
+//
+// Remote procedure calls with an RpcClient, first one at a time and then
+// with many calls in flight on the same connection.  The server is a
+// plain blocking loop in a thread that answers every Add request.
+//
+// Usage:  rpcpipeline [ port [ calls [ depth ] ] ]
+
+#include <sockstr/EventLoop.h>
+#include <sockstr/IPC.h>
+#include <sockstr/RpcClient.h>
+#include <sockstr/Socket.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+using namespace sockstr;
+using std::cout;
+using std::endl;
+
+enum { IPC_Add = 200, IPC_AddReply = IPC_Add };
+
+#pragma pack(2)
+IPC_MESSAGE(Add)
+    DWORD dwA_;
+    DWORD dwB_;
+IPC_ENDMESSAGE
+
+IPC_REPLY(AddReply)
+    DWORD dwSum_;
+IPC_ENDREPLY
+#pragma pack()
+
+static int callsFailed = 0;
+static int callersRunning = 0;
+
+
+static void server(Socket* pServer) {
+    Socket client;
+    if (!pServer->accept(client)) {
+        return;
+    }
+    AddReply reply;
+    while (const IpcStruct* pFrame = client.remoteReadFrame()) {
+        const Add* pAdd = static_cast<const Add*>(pFrame);
+        reply.dwSum_ = pAdd->dwA_ + pAdd->dwB_;
+        client.remoteWriteReply(&reply, pAdd->dwSequence_);
+    }
+}
+
+Task<void> caller(RpcClient& rpc, int calls) {
+    Add request;
+    AddReply reply;
+    for (int idx = 0; idx < calls; idx++) {
+        request.dwA_ = idx;
+        request.dwB_ = 1;
+        int sz = co_await rpc.async_call(&request, &reply, 0, 5000);
+        if (sz <= 0 || reply.dwSum_ != DWORD(idx + 1)) {
+            ++callsFailed;
+        }
+    }
+    --callersRunning;
+}
+
+Task<void> benchmark(Socket& sock, RpcClient& rpc, int calls, int depth) {
+    EventLoop* pLoop = EventLoop::current();
+    for (int d : { 1, depth }) {
+        auto start = std::chrono::steady_clock::now();
+        callersRunning = d;
+        for (int idx = 0; idx < d; idx++) {
+            pLoop->spawn(caller(rpc, calls / d));
+        }
+        while (callersRunning > 0) {
+            co_await pLoop->sleep(1);
+        }
+        double secs = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+        cout << "Depth " << d << ": " << static_cast<long>(calls / secs)
+             << " calls/s" << endl;
+    }
+    sock.close();   // ends rpc.run()
+}
+
+int main(int argc, const char* argv[]) {
+    std::string port = argc > 1 ? argv[1] : "9418";
+    int calls = argc > 2 ? atoi(argv[2]) : 100000;
+    int depth = argc > 3 ? atoi(argv[3]) : 64;
+
+    Socket serverSock(("localhost:" + port).c_str(),
+                      Socket::modeCreate | Socket::modeReadWrite);
+    if (!serverSock.is_open()) {
+        std::cerr << "Cannot listen on port " << port << endl;
+        return 1;
+    }
+    std::thread serverThread(server, &serverSock);
+
+    Socket sock(("localhost:" + port).c_str(), Socket::modeReadWrite);
+    if (!sock.is_open()) {
+        std::cerr << "Cannot connect to port " << port << endl;
+        return 1;
+    }
+    EventLoop loop;
+    RpcClient rpc(sock);
+    loop.spawn(rpc.run());
+    loop.spawn(benchmark(sock, rpc, calls, depth));
+    loop.run();
+
+    serverThread.join();
+    if (callsFailed) {
+        cout << callsFailed << " calls failed" << endl;
+    }
+    return callsFailed ? 1 : 0;
+}
@@ -0,0 +1,132 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+// shmpingpong.cpp
+//
+// Measures IpcStruct messages over a ShmStream between two processes.
+// A forked child attaches to the stream and answers every Ping with a
+// Pong.  The parent first measures the round trip time, then the one-way
+// rate of a stream of messages.
+//
+// Usage:  shmpingpong [ messages [ busy ] ]
+//         Pass "busy" to spin instead of sleeping while waiting.
+
+#include <sockstr/IPC.h>
+#include <sockstr/ShmStream.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
+using namespace sockstr;
+using std::cout;
+using std::endl;
+
+enum { IPC_Ping = 100, IPC_Pong };
+
+#pragma pack(2)
+IPC_MESSAGE(Ping)
+    DWORD dwValue_;
+    WORD  wReplyWanted_;
+IPC_ENDMESSAGE
+
+IPC_REPLY(Pong)
+    DWORD dwValue_;
+IPC_ENDREPLY
+#pragma pack()
+
+static const char* streamName = "shm:shmpingpong";
+
+
+static int child(UINT uFlags) {
+    ShmStream shm(streamName, uFlags);
+    if (!shm.is_open()) {
+        std::cerr << "Child could not attach to " << streamName << endl;
+        return 1;
+    }
+    Ping ping;
+    Pong pong;
+    while (shm.remoteReadData(&ping, sizeof(ping)) > 0) {
+        if (ping.wReplyWanted_) {
+            pong.dwValue_ = ping.dwValue_;
+            shm.remoteWriteReply(&pong, ping.dwSequence_);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, const char* argv[]) {
+    int messages = 1000000;
+    UINT uFlags = 0;
+    if (argc > 1) messages = atoi(argv[1]);
+    if (argc > 2 && !strcmp(argv[2], "busy")) uFlags |= ShmStream::modeBusyWait;
+
+    ShmStream shm(streamName, ShmStream::modeCreate | uFlags);
+    if (!shm.is_open()) {
+        std::cerr << "Could not create " << streamName << endl;
+        return 1;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Do not let the child's copy of shm close the parent's side
+        _exit(child(uFlags));
+    }
+
+    using Clock = std::chrono::steady_clock;
+    Ping ping;
+    Pong pong;
+
+    // Round trips
+    int roundTrips = messages / 10 + 1;
+    ping.wReplyWanted_ = 1;
+    auto start = Clock::now();
+    for (int idx = 0; idx < roundTrips; idx++) {
+        ping.dwValue_ = idx;
+        shm.remoteProcedure(&ping);
+        if (shm.remoteReadData(&pong, sizeof(pong)) <= 0 || pong.dwValue_ != DWORD(idx)) {
+            std::cerr << "Bad reply at " << idx << endl;
+            break;
+        }
+    }
+    double rtt = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    cout << "Round trip: " << rtt / roundTrips << " ns average over "
+         << roundTrips << " messages" << endl;
+
+    // One way, with a final round trip to know the child has read everything
+    ping.wReplyWanted_ = 0;
+    start = Clock::now();
+    for (int idx = 0; idx < messages; idx++) {
+        ping.dwValue_ = idx;
+        shm.remoteProcedure(&ping);
+    }
+    ping.wReplyWanted_ = 1;
+    shm.remoteProcedure(&ping);
+    shm.remoteReadData(&pong, sizeof(pong));
+    double secs = std::chrono::duration<double>(Clock::now() - start).count();
+    cout << "One way:    " << static_cast<long>(messages / secs) << " messages/s ("
+         << sizeof(Ping) << " bytes each)" << endl;
+
+    shm.close();
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
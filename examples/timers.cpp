@@ -0,0 +1,337 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+// timers.cpp
+//
+// Exercises the TimerWheel and the timeouts built on it.  The wheel is
+// driven by hand with timers spread over all four of its levels, and
+// each is checked to expire on its own millisecond, neither before nor
+// after, in order, as the coarser levels cascade down.  Cancelled timers,
+// including ones that have already cascaded, must never fire.  On an
+// EventLoop, sleep() must wake coroutines in order, a read and an accept
+// given a timeout must fail with SC_TIMEOUT and ETIMEDOUT and leave the
+// socket usable, and an idle timeout must shut a silent connection.
+// The exit status is 1 if a check fails.
+//
+// Usage:  timers [ port ]
+
+#include <sockstr/EventLoop.h>
+#include <sockstr/Socket.h>
+#include <sockstr/SocketAddr.h>
+#include <sockstr/TimerWheel.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+using namespace sockstr;
+
+static int failures = 0;
+
+static void check(bool bOk, const char* pWhat) {
+    printf("%-56s %s\n", pWhat, bOk ? "ok" : "FAILED");
+    if (!bOk) {
+        ++failures;
+    }
+}
+
+// A timer that records when it fired
+struct Probe {
+    Timer timer;
+    uint64_t expiry = 0;            // Tick it is due
+    uint64_t fired = 0;             // Time given to advance() when it fired
+};
+
+static uint64_t wheelNow = 0;       // Time the wheel is being advanced to
+static std::vector<uint64_t> firedOrder;
+
+static void probeExpired(Timer*, void* ptr) {
+    Probe* pProbe = static_cast<Probe*>(ptr);
+    pProbe->fired = wheelNow;
+    firedOrder.push_back(pProbe->expiry);
+}
+
+// Advance the wheel straight to uNow
+static std::size_t advanceTo(TimerWheel& rWheel, uint64_t uNow) {
+    wheelNow = uNow;
+    return rWheel.advance(uNow);
+}
+
+// Every timer fires on the millisecond it is due, and in order
+static void wheelOrder() {
+    const UINT delays[] = {
+        1, 2, 3, 255, 256, 257, 511, 512, 1000, 4096,
+        65535, 65536, 65537, 70000, 131072, 1000000,
+        16777215, 16777216, 16777217, 20000000, 50000000
+    };
+    TimerWheel wheel;
+    uint64_t uStart = TimerWheel::monotonicMs();
+    advanceTo(wheel, uStart);
+
+    std::vector<std::unique_ptr<Probe> > probes;
+    unsigned uSeed = 12345;
+    for (UINT uDelay : delays) {
+        probes.push_back(std::make_unique<Probe>());
+        probes.back()->expiry = uStart + uDelay;
+        // Others around it, some due on the same tick
+        for (int i = 0; i < 3; i++) {
+            uSeed = uSeed * 1103515245 + 12345;
+            probes.push_back(std::make_unique<Probe>());
+            probes.back()->expiry = uStart + uDelay + (uSeed >> 16) % 600;
+        }
+    }
+    for (auto& pProbe : probes) {
+        pProbe->timer.setCallback(probeExpired, pProbe.get());
+        wheel.arm(pProbe->timer, UINT(pProbe->expiry - uStart));
+    }
+    check(wheel.size() == probes.size(), "wheel: all timers armed");
+
+    std::vector<uint64_t> expiries;
+    for (auto& pProbe : probes) {
+        expiries.push_back(pProbe->expiry);
+    }
+    std::sort(expiries.begin(), expiries.end());
+    expiries.erase(std::unique(expiries.begin(), expiries.end()), expiries.end());
+
+    bool bOnTime = true;
+    firedOrder.clear();
+    for (uint64_t uExpiry : expiries) {
+        // Nothing due at uExpiry fires a millisecond early...
+        advanceTo(wheel, uExpiry - 1);
+        std::size_t uDue = 0;
+        for (auto& pProbe : probes) {
+            bOnTime = bOnTime && (pProbe->expiry < uExpiry) == (pProbe->fired != 0);
+            uDue += pProbe->expiry <= uExpiry;
+        }
+        // ...and all of it fires on the millisecond
+        advanceTo(wheel, uExpiry);
+        bOnTime = bOnTime && firedOrder.size() == uDue;
+        for (auto& pProbe : probes) {
+            if (pProbe->expiry == uExpiry) {
+                bOnTime = bOnTime && pProbe->fired == uExpiry;
+            }
+        }
+    }
+    check(bOnTime, "wheel: timers fire on time across the cascade");
+    check(std::is_sorted(firedOrder.begin(), firedOrder.end())
+          && firedOrder.size() == probes.size(), "wheel: timers fire in order");
+    check(wheel.size() == 0 && wheel.nextTimeout(wheelNow) == -1, "wheel: empty afterwards");
+}
+
+static int rearmCount = 0;
+static TimerWheel* pRearmWheel = nullptr;
+
+static void rearm(Timer* pTimer, void*) {
+    if (++rearmCount < 10) {
+        pRearmWheel->arm(*pTimer, 300);
+    }
+}
+
+// Cancelled timers never fire; a callback may re-arm its own timer
+static void wheelCancel() {
+    TimerWheel wheel;
+    uint64_t uStart = TimerWheel::monotonicMs();
+    advanceTo(wheel, uStart);
+
+    const UINT delays[] = { 10, 300, 70000, 20000000 };
+    Probe kept[4], cancelled[4];
+    for (int i = 0; i < 4; i++) {
+        kept[i].timer.setCallback(probeExpired, &kept[i]);
+        cancelled[i].timer.setCallback(probeExpired, &cancelled[i]);
+        wheel.arm(kept[i].timer, delays[i]);
+        wheel.arm(cancelled[i].timer, delays[i]);
+    }
+    {
+        // Destroying an armed timer cancels it
+        Probe dropped;
+        dropped.timer.setCallback(probeExpired, &dropped);
+        wheel.arm(dropped.timer, 70000);
+    }
+    check(wheel.size() == 8, "cancel: destroyed timer leaves the wheel");
+    cancelled[0].timer.cancel();
+    wheel.cancel(cancelled[1].timer);
+    // The level 2 timer has cascaded to level 1 by then
+    advanceTo(wheel, uStart + 65600);
+    cancelled[2].timer.cancel();
+    check(kept[0].fired && kept[1].fired && !kept[2].fired, "cancel: earlier timers fired");
+    // Re-arming moves a timer instead of adding it twice
+    wheel.arm(cancelled[3].timer, 1000);
+    wheel.arm(cancelled[3].timer, 30000000);
+    cancelled[3].timer.cancel();
+    check(wheel.size() == 2, "cancel: size counts only armed timers");
+
+    Timer repeat(rearm);
+    pRearmWheel = &wheel;
+    wheel.arm(repeat, 300);
+    uint64_t uNow = uStart + 65600;
+    for (int i = 0; i < 100; i++) {
+        uNow += 97;
+        advanceTo(wheel, uNow);
+    }
+    advanceTo(wheel, uStart + 30000000);
+    bool bNone = true;
+    for (Probe& rProbe : cancelled) {
+        bNone = bNone && rProbe.fired == 0;
+    }
+    check(bNone, "cancel: cancelled timers never fire");
+    check(kept[2].fired != 0 && kept[3].fired != 0, "cancel: the others fire");
+    check(rearmCount == 10, "cancel: callback re-arms its own timer");
+    check(wheel.size() == 0, "cancel: wheel empty afterwards");
+}
+
+//
+// Timeouts on an EventLoop
+//
+
+static std::vector<int> wakeOrder;
+
+static Task<void> sleeper(int ms) {
+    co_await EventLoop::current()->sleep(ms);
+    wakeOrder.push_back(ms);
+}
+
+static Task<void> sleepTimed(uint64_t& rElapsed) {
+    uint64_t uStart = TimerWheel::monotonicMs();
+    co_await EventLoop::current()->sleep(50);
+    rElapsed = TimerWheel::monotonicMs() - uStart;
+}
+
+static Task<void> readTimeout(Socket& rListener, int port) {
+    Socket client;
+    SocketAddr saddr("127.0.0.1", port);
+    Socket peer;
+    if (!co_await client.async_connect(saddr) || !co_await rListener.async_accept(peer)) {
+        check(false, "async read: connect");
+        co_return;
+    }
+    client.setTimeout(Socket::timeoutRead, 60);
+    char buf[16];
+    uint64_t uStart = TimerWheel::monotonicMs();
+    int n = co_await client.async_read(buf, sizeof(buf));
+    uint64_t uElapsed = TimerWheel::monotonicMs() - uStart;
+    check(n == SOCKET_ERROR && client.queryStatus() == SC_TIMEOUT && errno == ETIMEDOUT,
+          "async read: times out with SC_TIMEOUT, ETIMEDOUT");
+    check(uElapsed >= 60 && uElapsed < 1000, "async read: after its timeout");
+    // The connection stays open
+    co_await peer.async_write("ping", 4);
+    n = co_await client.async_read(buf, sizeof(buf));
+    check(n == 4, "async read: socket usable after the timeout");
+}
+
+static Task<void> acceptTimeout(Socket& rListener) {
+    rListener.setTimeout(Socket::timeoutAccept, 40);
+    Socket client;
+    bool bAccepted = co_await rListener.async_accept(client);
+    check(!bAccepted && rListener.queryStatus() == SC_TIMEOUT, "async accept: times out");
+    rListener.setTimeout(Socket::timeoutAccept, 0);
+}
+
+static Task<void> idleTimeout(Socket& rListener, int port) {
+    Socket client;
+    SocketAddr saddr("127.0.0.1", port);
+    Socket peer;
+    if (!co_await client.async_connect(saddr) || !co_await rListener.async_accept(peer)) {
+        check(false, "idle: connect");
+        co_return;
+    }
+    peer.setIdleTimeout(80);
+    char buf[16];
+    // Traffic restarts the timer
+    co_await EventLoop::current()->sleep(40);
+    co_await client.async_write("x", 1);
+    int n = co_await peer.async_read(buf, sizeof(buf));
+    uint64_t uStart = TimerWheel::monotonicMs();
+    // Then the client stays silent
+    int nEnd = co_await peer.async_read(buf, sizeof(buf));
+    uint64_t uElapsed = TimerWheel::monotonicMs() - uStart;
+    check(n == 1 && nEnd == 0, "idle: silent connection is shut down");
+    check(uElapsed >= 70 && uElapsed < 1000, "idle: after the idle time");
+    n = co_await client.async_read(buf, sizeof(buf));
+    check(n == 0, "idle: peer sees end of file");
+}
+
+static void loopTimeouts(int port) {
+    Socket listener;
+    SocketAddr saddr(port);
+    if (!listener.open(saddr, Socket::modeReadWrite | Socket::modeCreate)) {
+        check(false, "open server socket");
+        return;
+    }
+    uint64_t uSlept = 0;
+    {
+        EventLoop loop;
+        loop.spawn(sleeper(30));
+        loop.spawn(sleeper(10));
+        loop.spawn(sleeper(20));
+        loop.spawn(sleepTimed(uSlept));
+        loop.run();
+    }
+    check(wakeOrder == std::vector<int>({ 10, 20, 30 }), "sleep: coroutines wake in order");
+    check(uSlept >= 50 && uSlept < 1000, "sleep: for the time asked");
+
+    {
+        EventLoop loop;
+        loop.spawn(readTimeout(listener, port));
+        loop.run();
+    }
+    {
+        EventLoop loop;
+        loop.spawn(acceptTimeout(listener));
+        loop.run();
+    }
+    {
+        EventLoop loop;
+        loop.spawn(idleTimeout(listener, port));
+        loop.run();
+    }
+
+    // Blocking read
+    Socket client;
+    SocketAddr caddr("127.0.0.1", port);
+    if (!client.open(caddr, Socket::modeReadWrite)) {
+        check(false, "blocking read: connect");
+        return;
+    }
+    Socket peer;
+    listener.accept(peer);
+    client.setTimeout(Socket::timeoutRead, 60);
+    char buf[16];
+    uint64_t uStart = TimerWheel::monotonicMs();
+    client.read(buf, sizeof(buf));
+    uint64_t uElapsed = TimerWheel::monotonicMs() - uStart;
+    check(client.queryStatus() == SC_TIMEOUT && errno == ETIMEDOUT,
+          "blocking read: times out with SC_TIMEOUT, ETIMEDOUT");
+    check(uElapsed >= 60 && uElapsed < 1000, "blocking read: after its timeout");
+    listener.close();
+}
+
+
+int main(int argc, char* argv[]) {
+    int port = (argc > 1) ? atoi(argv[1]) : 4328;
+
+    wheelOrder();
+    wheelCancel();
+    loopTimeouts(port);
+
+    printf("%s\n", failures ? "Some checks FAILED" : "All checks passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,183 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+// unixsock.cpp
+//
+// Round trips a message over Unix domain sockets: a stream socket on a
+// path ("unix:/path"), one in the Linux abstract namespace ("unix:@name")
+// and a datagram socket ("unixdg:/path").  It also checks how socket
+// files are cleaned up.  A file left behind by a server that died is
+// removed when a new server binds the path, for streams and datagrams.  The file of a server that
+// is still running is left alone.  A server removes its file when it
+// closes.
+// The exit status is 1 if a check fails.
+//
+// Usage:  unixsock [ directory ]
+
+#include <sockstr/Socket.h>
+#include <sockstr/SocketAddr.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+using namespace sockstr;
+
+static int failures = 0;
+
+static void check(bool bOk, const char* pWhat) {
+    printf("%-52s %s\n", pWhat, bOk ? "ok" : "FAILED");
+    if (!bOk) {
+        ++failures;
+    }
+}
+
+static bool exists(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0;
+}
+
+// Send a message from the client and an answer back over a connection
+static bool roundTrip(Socket& rClient, Socket& rPeer) {
+    const char request[] = "ping";
+    const char answer[] = "pong";
+    char buf[16];
+    rClient.write(request, sizeof(request));
+    if (rPeer.read(buf, sizeof(buf)) != int(sizeof(request)) || strcmp(buf, request) != 0) {
+        return false;
+    }
+    rPeer.write(answer, sizeof(answer));
+    return rClient.read(buf, sizeof(buf)) == int(sizeof(answer)) && strcmp(buf, answer) == 0;
+}
+
+// Connect to a stream server and round trip over the connection
+static bool streamTrip(Socket& rServer, const std::string& name) {
+    Socket client;
+    if (!client.open(name.c_str(), Socket::modeReadWrite)) {
+        return false;
+    }
+    Socket peer;
+    return rServer.accept(peer) && roundTrip(client, peer);
+}
+
+static void streamPath(const std::string& path) {
+    std::string name = "unix:" + path;
+    SocketAddr saddr(name, 0);
+    check(saddr.isUnix(), "unix:/path is a Unix domain address");
+
+    Socket server;
+    if (!server.open(name.c_str(), Socket::modeCreate | Socket::modeReadWrite)) {
+        check(false, "unix:/path server opens");
+        return;
+    }
+    check(exists(path), "unix:/path server creates its file");
+    check(streamTrip(server, name), "unix:/path round trip");
+
+    // A second server must not take the path from a live one
+    Socket intruder;
+    bool bOpened = intruder.open(name.c_str(), Socket::modeCreate | Socket::modeReadWrite);
+    check(!bOpened && exists(path), "live socket file is left alone");
+    // The probe that found the server alive is an empty connection
+    Socket probe;
+    char buf[4];
+    check(server.accept(probe) && probe.read(buf, sizeof(buf)) == 0,
+          "live server sees the probe as an empty connection");
+    check(streamTrip(server, name), "live server still answers");
+
+    server.close();
+    check(!exists(path) && errno == ENOENT, "server unlinks its path on close");
+}
+
+static void streamAbstract(const std::string& label) {
+    std::string name = "unix:@" + label;
+    Socket server;
+    if (!server.open(name.c_str(), Socket::modeCreate | Socket::modeReadWrite)) {
+        check(false, "unix:@name server opens");
+        return;
+    }
+    check(!exists("@" + label), "unix:@name creates no file");
+    check(streamTrip(server, name), "unix:@name round trip");
+    server.close();
+}
+
+static void stalePath(const std::string& path) {
+    // Leave a socket file behind, as a server that crashed would
+    int hSock = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un sun;
+    memset(&sun, 0, sizeof(sun));
+    sun.sun_family = AF_UNIX;
+    strncpy(sun.sun_path, path.c_str(), sizeof(sun.sun_path) - 1);
+    bool bBound = ::bind(hSock, (const sockaddr*)&sun, sizeof(sun)) == 0;
+    ::close(hSock);
+    check(bBound && exists(path), "stale socket file left behind");
+
+    std::string name = "unix:" + path;
+    Socket server;
+    bool bOpened = server.open(name.c_str(), Socket::modeCreate | Socket::modeReadWrite);
+    check(bOpened, "stale socket file is unlinked and bound again");
+    check(bOpened && streamTrip(server, name), "server on the stale path answers");
+    server.close();
+}
+
+static void datagram(const std::string& path) {
+    std::string name = "unixdg:" + path;
+    Socket server;
+    if (!server.open(name.c_str(), Socket::modeCreate | Socket::modeReadWrite)) {
+        check(false, "unixdg:/path server opens");
+        return;
+    }
+    Socket client;
+    if (!client.open(name.c_str(), Socket::modeReadWrite)) {
+        check(false, "unixdg:/path client opens");
+        return;
+    }
+    // The server answers to the address the request came from
+    check(roundTrip(client, server), "unixdg:/path round trip");
+    client.close();
+    server.close();
+
+    // A datagram server leaves its file; the next one binds it again
+    Socket again;
+    bool bOpened = again.open(name.c_str(), Socket::modeCreate | Socket::modeReadWrite);
+    check(bOpened, "stale datagram socket file is bound again");
+    again.close();
+}
+
+
+int main(int argc, char* argv[]) {
+    std::string dir = (argc > 1) ? argv[1] : "/tmp";
+    std::string label = "sockstr-unixsock-" + std::to_string(::getpid());
+    std::string path = dir + "/" + label + ".sock";
+    std::string dgPath = dir + "/" + label + ".dgram";
+
+    streamPath(path);
+    streamAbstract(label);
+    stalePath(path);
+    datagram(dgPath);
+
+    ::unlink(path.c_str());
+    ::unlink(dgPath.c_str());
+    printf("%s\n", failures ? "Some checks FAILED" : "All checks passed");
+    return failures ? 1 : 0;
+}
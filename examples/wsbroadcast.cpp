@@ -0,0 +1,262 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+// wsbroadcast.cpp
+//
+// A WebSocket hub on an EventLoop: every connection to /ws subscribes,
+// a text message starting with "publish " is broadcast to all
+// subscribers, and any other message is echoed to its sender.  A
+// broadcast is encoded once as a WebSocketFrame and queued on every
+// connection, so the number of frames encoded stays the number of
+// messages published however many subscribers there are.
+// A client on another thread opens the subscribers, publishes messages
+// from one more connection, and checks that each subscriber receives all
+// of them; the frames encoded, the deliveries and their rate are shown.
+// The masking kernel is then timed against a bytewise loop.  With 0
+// subscribers the hub runs alone, for browsers or other clients.
+//
+// Usage:  wsbroadcast [ subscribers [ messages [ port ] ] ]
+
+#include <sockstr/EventLoop.h>
+#include <sockstr/HttpStream.h>
+#include <sockstr/SocketAddr.h>
+#include <sockstr/SocketPool.h>
+#include <sockstr/WebSocket.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+using namespace sockstr;
+using std::cout;
+using std::endl;
+
+typedef std::chrono::steady_clock Clock;
+
+// A connection of the hub; shared by its reader and the flushes under way
+struct Subscriber {
+    SocketPool<HttpServerStream>::Handle conn;
+    WebSocket ws;
+};
+typedef std::shared_ptr<Subscriber> SubscriberPtr;
+
+struct Hub {
+    std::unordered_set<SubscriberPtr> subscribers;
+    uint64_t framesEncoded = 0;
+    uint64_t framesQueued = 0;
+};
+
+Task<void> flushTo(SubscriberPtr pSub) {
+    co_await pSub->ws.async_flush();
+}
+
+static void publish(Hub& hub, std::string_view message) {
+    auto pFrame = std::make_shared<const WebSocketFrame>(message, false, 1);
+    hub.framesEncoded++;
+    for (const SubscriberPtr& pSub : hub.subscribers) {
+        hub.framesQueued++;
+        if (pSub->ws.queue(pFrame)) {
+            EventLoop::current()->spawn(flushTo(pSub));
+        }
+    }
+}
+
+Task<void> serve(SocketPool<HttpServerStream>::Handle conn, Hub& hub) {
+    if (!co_await conn->async_receive()) {
+        co_await conn->async_flushResponses();
+        co_return;
+    }
+    if (conn->getParser().path() != "/ws" || !WebSocket::isUpgrade(conn->getParser())) {
+        conn->closeAfterResponse();
+        conn->appendResponse("Connect to /ws with WebSocket\n", "text/plain", 404);
+        co_await conn->async_flushResponses();
+        co_return;
+    }
+    SubscriberPtr pSub = std::make_shared<Subscriber>();
+    pSub->conn = std::move(conn);
+    if (!co_await pSub->ws.async_accept(*pSub->conn)) {
+        co_return;
+    }
+    hub.subscribers.insert(pSub);
+    std::string message;
+    bool bBinary;
+    while (co_await pSub->ws.async_receive(message, &bBinary)) {
+        if (!bBinary && message.compare(0, 8, "publish ") == 0) {
+            publish(hub, std::string_view(message).substr(8));
+        } else if (!co_await pSub->ws.async_send(message, bBinary)) {
+            break;
+        }
+    }
+    hub.subscribers.erase(pSub);
+}
+
+Task<void> server(Socket& serverSock, SocketPool<HttpServerStream>& pool, Hub& hub) {
+    for (;;) {
+        auto conn = pool.acquire();
+        if (!co_await serverSock.async_accept(*conn)) {
+            break;
+        }
+        EventLoop::current()->spawn(serve(std::move(conn), hub));
+    }
+}
+
+// A connection of the client
+struct Client {
+    std::unique_ptr<HttpStream> http;
+    WebSocket ws;
+};
+
+static bool connectClient(Client& client, int port) {
+    SocketAddr caddr("127.0.0.1", port);
+    client.http.reset(new HttpStream(caddr, Socket::modeReadWrite));
+    return client.http->is_open()
+        && client.ws.connect(*client.http, "/ws", "Host: 127.0.0.1\r\n");
+}
+
+// What the subscribers received
+struct Result {
+    uint64_t delivered = 0;
+    uint64_t bytes = 0;
+    bool complete = false;
+    double secs = 0;
+};
+
+static void subscribe(int port, long subscribers, long messages, Result& result) {
+    std::vector<std::unique_ptr<Client> > clients;
+    for (long i = 0; i < subscribers; i++) {
+        clients.emplace_back(new Client);
+        if (!connectClient(*clients.back(), port)) {
+            cout << "Subscriber " << i << " could not connect" << endl;
+            return;
+        }
+    }
+    Client publisher;
+    if (!connectClient(publisher, port)) {
+        cout << "Publisher could not connect" << endl;
+        return;
+    }
+    std::string reply;
+    publisher.ws.send("hello");
+    publisher.ws.receive(reply);
+    cout << "Echo: " << reply << ", deflate " << (publisher.ws.deflate() ? "on" : "off")
+         << endl;
+
+    auto start = Clock::now();
+    std::string update;
+    for (long m = 0; m < messages; m++) {
+        update = "publish {\"seq\":" + std::to_string(m) + ",\"prices\":[";
+        for (int k = 0; k < 40; k++) {
+            update += std::to_string(1000 + (m * 31 + k * 7) % 97) + (k < 39 ? "," : "]}");
+        }
+        publisher.ws.send(update);
+    }
+
+    // Messages published after the last subscriber joined reach them all
+    result.complete = true;
+    std::string message;
+    for (auto& pClient : clients) {
+        for (long m = 0; m < messages; m++) {
+            if (!pClient->ws.receive(message)) {
+                result.complete = false;
+                break;
+            }
+            result.delivered++;
+            result.bytes += message.size();
+        }
+    }
+    result.secs = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Read up to the answer to the close frame
+    publisher.ws.close();
+    while (publisher.ws.receive(message)) {
+    }
+    for (auto& pClient : clients) {
+        pClient->ws.close();
+        while (pClient->ws.receive(message)) {
+        }
+    }
+}
+
+static void timeMasking() {
+    std::string data(64 * 1024 * 1024, 'x');
+    const unsigned char key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+    auto start = Clock::now();
+    WebSocket::mask(data.data(), data.data(), data.size(), key);
+    double simd = std::chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    char* p = data.data();
+    for (std::size_t i = 0; i < data.size(); i++) {
+        p[i] ^= key[i & 3];
+    }
+    double bytewise = std::chrono::duration<double>(Clock::now() - start).count();
+    bool restored = data.find_first_not_of('x') == std::string::npos;
+    printf("Masking 64 MB: %.0f MB/s, bytewise %.0f MB/s%s\n", data.size() / simd / 1e6,
+           data.size() / bytewise / 1e6, restored ? "" : " (MISMATCH)");
+}
+
+
+int main(int argc, char* argv[]) {
+    long subscribers = argc > 1 ? atol(argv[1]) : 1000;
+    long messages = argc > 2 ? atol(argv[2]) : 100;
+    int port = argc > 3 ? atoi(argv[3]) : 8095;
+
+    SocketPool<HttpServerStream> pool;
+    Hub hub;
+    EventLoop loop;
+    Socket serverSock;
+    SocketAddr saddr(port);
+    if (!serverSock.open(saddr, Socket::modeReadWrite | Socket::modeCreate)) {
+        cout << "Error opening server socket on port " << port << endl;
+        return 2;
+    }
+    loop.spawn(server(serverSock, pool, hub));
+    if (subscribers <= 0) {
+        loop.run();
+        return 0;
+    }
+
+    Result result;
+    std::thread client([&]() {
+        subscribe(port, subscribers, messages, result);
+        loop.stop();
+    });
+    loop.run();
+    client.join();
+    serverSock.close();
+
+    printf("%ld messages to %ld subscribers: %llu frames encoded, %llu queued, "
+           "%llu delivered%s\n", messages, subscribers,
+           static_cast<unsigned long long>(hub.framesEncoded),
+           static_cast<unsigned long long>(hub.framesQueued),
+           static_cast<unsigned long long>(result.delivered),
+           result.complete ? "" : " (INCOMPLETE)");
+    if (result.secs > 0) {
+        printf("%.0f deliveries/s, %.1f MB/s of messages\n", result.delivered / result.secs,
+               result.bytes / result.secs / 1e6);
+    }
+    timeMasking();
+    return 0;
+}
@@ -0,0 +1,109 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+/**
+ *  Monotonic memory for the objects of one request, handed to std::pmr
+ *  containers and to the classes that take a std::pmr::memory_resource.
+ *
+ *  Memory is taken from blocks by moving a pointer, and deallocating does
+ *  nothing.  reset() frees everything at once by moving the pointer back
+ *  to the start of the first block: unlike
+ *  std::pmr::monotonic_buffer_resource::release(), the blocks are kept, so
+ *  an arena reused for one request after another stops asking the
+ *  upstream resource for memory once it has held the largest request.
+ *
+ *  Objects in the arena must be destroyed, or forgotten, before reset().
+ *  An arena is used by one thread at a time.
+ *
+ *  Example:
+ *  @code
+ *      Arena arena;
+ *      for (;;) {
+ *          std::pmr::string head(&arena);
+ *          HttpParser parser(HttpParser::messageRequest, &arena);
+ *          ...
+ *          arena.reset();      // After head and parser are gone
+ *      }
+ *  @endcode
+ */
+class DllExport Arena : public std::pmr::memory_resource {
+public:
+    /** Size of the first block unless one is given */
+    static constexpr std::size_t DEFAULT_BLOCK = 4096;
+
+    /** Construct an arena.  No memory is taken until it is first used.
+     *  @param uBlockSize Size of the first block; each further block is
+     *                    twice the size of the one before
+     *  @param pUpstream  Resource the blocks come from */
+    explicit Arena(std::size_t uBlockSize = DEFAULT_BLOCK,
+                   std::pmr::memory_resource* pUpstream = std::pmr::get_default_resource());
+    /** Gives the blocks back to the upstream resource. */
+    virtual ~Arena();
+
+    // Disable copy constructor and assignment operator
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /** Make all the memory of the arena free again, keeping the blocks. */
+    void reset();
+    /** Give the blocks back to the upstream resource. */
+    void release();
+
+    //! Return the number of bytes handed out since the last reset().
+    std::size_t used() const { return uUsed_; }
+    //! Return the size of the blocks held.
+    std::size_t capacity() const { return uCapacity_; }
+
+protected:
+    virtual void* do_allocate(std::size_t uBytes, std::size_t uAlign);
+    virtual void do_deallocate(void* p, std::size_t uBytes, std::size_t uAlign);
+    virtual bool do_is_equal(const std::pmr::memory_resource& other) const noexcept;
+
+private:
+    struct Block;
+    void* allocateSlow(std::size_t uBytes, std::size_t uAlign);
+
+    std::pmr::memory_resource* pUpstream_;
+    std::size_t uBlockSize_;        // Size of the next block to take
+    Block* pFirst_;
+    Block* pCurrent_;               // Block being handed out
+    char* pNext_;                   // Free space of pCurrent_
+    char* pEnd_;
+    std::size_t uUsed_;
+    std::size_t uCapacity_;
+};
+
+}  // namespace sockstr
@@ -0,0 +1,221 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+#include <sockstr/Task.h>
+#include <sockstr/TimerWheel.h>
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+/**
+ *  Single-threaded event loop that drives coroutines.
+ *
+ *  The loop waits for socket readiness (epoll on Linux, poll elsewhere)
+ *  and resumes the coroutines that are waiting on it.  Coroutines are
+ *  started with spawn(); their frames come from the loop's FramePool.
+ *  A server typically spawns one coroutine per accepted connection and
+ *  writes the request handling as straight-line code using the awaitable
+ *  functions of Socket (async_read, async_write, async_accept and
+ *  async_connect).
+ *
+ *  Example:
+ *  @code
+ *      Task<void> serve(Socket& server) {
+ *          for (;;) {
+ *              auto client = std::make_unique<Socket>();
+ *              if (co_await server.async_accept(*client))
+ *                  EventLoop::current()->spawn(echo(std::move(client)));
+ *          }
+ *      }
+ *      EventLoop loop;
+ *      loop.spawn(serve(server));
+ *      loop.run();
+ *  @endcode
+ *
+ *  All member functions must be called from the thread running the loop,
+ *  except post() and stop() which may be called from any thread.
+ */
+class DllExport EventLoop {
+public:
+    EventLoop();
+    ~EventLoop();
+
+    // Disable copy constructor and assignment operator
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    /** Return the loop that is current for the calling thread.
+     *  A loop is current on the thread that constructed it and on the
+     *  thread that is executing its run() function. */
+    static EventLoop* current();
+
+    /** Start a task and let it run to completion on this loop.
+     *  The loop takes ownership of the coroutine frame. */
+    void spawn(Task<void> task);
+    /** Schedule a suspended coroutine to be resumed by the loop.
+     *  This function is thread safe. */
+    void post(std::coroutine_handle<> handle);
+    /** Resume a suspended coroutine on the next pass of the loop.
+     *  Unlike post(), this must be called on the loop's thread. */
+    void schedule(std::coroutine_handle<> handle) { ready_.push_back(handle); }
+    /** Run the loop until stop() is called or no spawned task remains. */
+    void run();
+    /** Ask run() to return.  This function is thread safe. */
+    void stop();
+
+    /** Return the coroutine frame pool of this loop. */
+    FramePool& framePool() { return framePool_; }
+    /** Return the timer wheel of this loop.  Its timers expire while the
+     *  loop runs; their callbacks are called on the loop's thread. */
+    TimerWheel& timers() { return timers_; }
+
+    /**
+     *  Awaitable returned by readable() and writable().
+     *  The awaiting coroutine is suspended until the handle is ready or,
+     *  if a timeout was given, until the timeout expires.
+     *  co_await yields false if the timeout expired.
+     */
+    class FdAwaiter {
+    public:
+        FdAwaiter(EventLoop& loop, SOCKET hFile, bool bWrite, UINT uTimeoutMs)
+            : loop_(loop), hFile_(hFile), bWrite_(bWrite), uTimeoutMs_(uTimeoutMs)
+            , bTimedOut_(false), timer_(&FdAwaiter::expired, this) { }
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            handle_ = handle;
+            if (uTimeoutMs_) {
+                loop_.timers_.arm(timer_, uTimeoutMs_);
+            }
+            loop_.watch(hFile_, bWrite_, handle);
+        }
+        bool await_resume() noexcept {
+            timer_.cancel();
+            return !bTimedOut_;
+        }
+    private:
+        static void expired(Timer* pTimer, void* ptr);
+
+        EventLoop& loop_;
+        SOCKET hFile_;
+        bool bWrite_;
+        UINT uTimeoutMs_;
+        bool bTimedOut_;
+        Timer timer_;
+        std::coroutine_handle<> handle_;
+    };
+
+    /** Suspend until hFile can be read without blocking.
+     *  @param uTimeoutMs Give up after this many milliseconds (0 = never) */
+    FdAwaiter readable(SOCKET hFile, UINT uTimeoutMs = 0) {
+        return FdAwaiter(*this, hFile, false, uTimeoutMs);
+    }
+    /** Suspend until hFile can be written without blocking.
+     *  @param uTimeoutMs Give up after this many milliseconds (0 = never) */
+    FdAwaiter writable(SOCKET hFile, UINT uTimeoutMs = 0) {
+        return FdAwaiter(*this, hFile, true, uTimeoutMs);
+    }
+
+    /** Awaitable returned by sleep(). */
+    class SleepAwaiter {
+    public:
+        SleepAwaiter(EventLoop& loop, UINT uDelayMs)
+            : loop_(loop), uDelayMs_(uDelayMs), timer_(&SleepAwaiter::expired, this) { }
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            handle_ = handle;
+            loop_.timers_.arm(timer_, uDelayMs_);
+        }
+        void await_resume() noexcept { timer_.cancel(); }
+    private:
+        static void expired(Timer* pTimer, void* ptr);
+
+        EventLoop& loop_;
+        UINT uDelayMs_;
+        Timer timer_;
+        std::coroutine_handle<> handle_;
+    };
+
+    /** Suspend the calling coroutine for uDelayMs milliseconds. */
+    SleepAwaiter sleep(UINT uDelayMs) { return SleepAwaiter(*this, uDelayMs); }
+
+    /** Awaitable returned by yield(). */
+    class YieldAwaiter {
+    public:
+        explicit YieldAwaiter(EventLoop& loop) : loop_(loop) { }
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { loop_.schedule(handle); }
+        void await_resume() const noexcept { }
+    private:
+        EventLoop& loop_;
+    };
+
+    /** Let the other tasks of the loop run before the calling coroutine
+     *  goes on, as a task that rarely waits should now and then. */
+    YieldAwaiter yield() { return YieldAwaiter(*this); }
+    /** Stop watching hFile.  Coroutines that were waiting on the handle are
+     *  resumed so that they can observe the error of the closed handle. */
+    void forget(SOCKET hFile);
+
+private:
+    //! Coroutines waiting for one handle
+    struct Watch {
+        std::coroutine_handle<> reader;
+        std::coroutine_handle<> writer;
+        bool registered = false;
+    };
+
+    void watch(SOCKET hFile, bool bWrite, std::coroutine_handle<> handle);
+    bool unwatch(SOCKET hFile, bool bWrite, std::coroutine_handle<> handle);
+    void rearm(SOCKET hFile, Watch& w);
+    void dispatch(SOCKET hFile, bool bReadable, bool bWritable);
+    void drainPosted();
+    void wait(int nTimeoutMs);
+    void wakeup();
+
+    int hPoll_;                 //!< epoll handle (Linux)
+    int hWakeRead_;             //!< eventfd, or read end of wakeup pipe
+    int hWakeWrite_;            //!< write end of wakeup pipe (same as hWakeRead_ for eventfd)
+    std::vector<Watch> watches_;
+    std::vector<std::coroutine_handle<>> ready_;
+    std::vector<std::coroutine_handle<>> running_;
+    std::mutex postLock_;
+    std::vector<std::coroutine_handle<>> posted_;
+    std::atomic<bool> stop_;
+    std::size_t numTasks_;
+    FramePool framePool_;
+    TimerWheel timers_;
+};
+
+}  // namespace sockstr
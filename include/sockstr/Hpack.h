@@ -0,0 +1,184 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+/**
+ *  The dynamic table of an HPACK encoder or decoder (RFC 7541 section
+ *  2.3.2): the fields most recently added, newest first, within a limit
+ *  on their size.
+ */
+class DllExport HpackTable {
+public:
+    /** Size the RFC counts for each entry besides its name and value */
+    static constexpr std::size_t ENTRY_OVERHEAD = 32;
+    /** Size of the table until SETTINGS_HEADER_TABLE_SIZE says otherwise */
+    static constexpr std::size_t DEFAULT_SIZE = 4096;
+
+    HpackTable() : uSize_(0), uMaxSize_(DEFAULT_SIZE) { }
+
+    /** Add a field, evicting the oldest ones to make room.  A field larger
+     *  than the table empties it. */
+    void add(std::string_view name, std::string_view value);
+    /** Change the limit, evicting what no longer fits. */
+    void setMaxSize(std::size_t uMax);
+    //! Return the limit on the size of the table.
+    std::size_t maxSize() const { return uMaxSize_; }
+    //! Return the size of the entries, as the RFC counts it.
+    std::size_t size() const { return uSize_; }
+    //! Return the number of entries.
+    std::size_t count() const { return entries_.size(); }
+    //! Return the name of an entry, 0 being the newest.
+    std::string_view name(std::size_t uIndex) const { return entries_[uIndex].name; }
+    //! Return the value of an entry, 0 being the newest.
+    std::string_view value(std::size_t uIndex) const { return entries_[uIndex].value; }
+
+private:
+    struct Entry {
+        std::string name;
+        std::string value;
+    };
+    void evict(std::size_t uRoom);
+
+    std::deque<Entry> entries_;
+    std::size_t uSize_;
+    std::size_t uMaxSize_;
+};
+
+/**
+ *  HPACK encoder of the header blocks of one HTTP/2 connection (RFC 7541).
+ *
+ *  Fields found in the static table are looked up by name in a hash
+ *  table, so the pseudo-headers and common fields of a response cost one
+ *  lookup and, for an exact match such as ":status 200", one byte.  Other
+ *  fields go into the dynamic table and are sent as an index the next
+ *  time; strings are Huffman-coded when that makes them shorter.
+ *  Sensitive fields, such as authorization and cookies, are sent as
+ *  never-indexed literals and kept out of the table.
+ */
+class DllExport HpackEncoder {
+public:
+    HpackEncoder();
+
+    // Disable copy constructor and assignment operator
+    HpackEncoder(const HpackEncoder&) = delete;
+    HpackEncoder& operator=(const HpackEncoder&) = delete;
+
+    /** Limit the dynamic table to what the peer allows with
+     *  SETTINGS_HEADER_TABLE_SIZE.  The change is signalled at the start
+     *  of the next header block. */
+    void setMaxTableSize(std::size_t uMax);
+    /** Start a header block: signal a change of table size, if any. */
+    void beginBlock(std::string& out);
+    /** Append a field to a header block.  The name must be lower case.
+     *  @param bSensitive Never index the field, whatever its name */
+    void encode(std::string& out, std::string_view name, std::string_view value,
+                bool bSensitive = false);
+    //! Return the dynamic table.
+    const HpackTable& table() const { return table_; }
+
+    /** Append an integer with an N-bit prefix (RFC 7541 section 5.1).
+     *  @param uFlags Bits above the prefix in the first byte */
+    static void encodeInteger(std::string& out, uint64_t uValue, int nPrefix,
+                              unsigned char uFlags);
+    /** Append a string literal, Huffman-coded if that is shorter. */
+    static void encodeString(std::string& out, std::string_view text);
+    /** Return the length of text once Huffman-coded. */
+    static std::size_t huffmanLength(std::string_view text);
+
+private:
+    HpackTable table_;
+    std::size_t uPendingSize_;      // Size to signal, or NO_UPDATE
+    std::size_t uLowestSize_;       // Smallest limit since the last block
+};
+
+/**
+ *  @typedef HpackField
+ *  Routine given each field of a decoded header block, in order.
+ *  @param name  Name of the field
+ *  @param value Value of the field
+ *  @param ptr   Pointer to user data given to HpackDecoder::decode()
+ *  @return False to stop decoding; decode() then fails.
+ */
+typedef bool (*HpackField)(std::string_view name, std::string_view value, void* ptr);
+
+/**
+ *  HPACK decoder of the header blocks of one HTTP/2 connection.
+ *
+ *  Huffman-coded strings are decoded four bits at a time by a state
+ *  machine built once from the code table.  A block that breaks the
+ *  format, or refers to an entry that does not exist, is a compression
+ *  error, after which the connection cannot go on.
+ */
+class DllExport HpackDecoder {
+public:
+    HpackDecoder();
+
+    // Disable copy constructor and assignment operator
+    HpackDecoder(const HpackDecoder&) = delete;
+    HpackDecoder& operator=(const HpackDecoder&) = delete;
+
+    /** Set the table size advertised with SETTINGS_HEADER_TABLE_SIZE, the
+     *  most the encoder may choose. */
+    void setMaxTableSize(std::size_t uMax) { uAllowedSize_ = uMax; }
+    /** Limit the length of a string in a block. */
+    void setMaxString(std::size_t uMax) { uMaxString_ = uMax; }
+    /** Decode a whole header block.
+     *  @return False if the block is malformed or pField stopped it. */
+    bool decode(const char* pData, std::size_t uLength, HpackField pField, void* ptr);
+    //! Return the dynamic table.
+    const HpackTable& table() const { return table_; }
+
+    /** Decode a Huffman-coded string, appending it to out.
+     *  @return False if the code or its padding is invalid. */
+    static bool decodeHuffman(const unsigned char* pData, std::size_t uLength,
+                              std::string& out);
+
+private:
+    bool decodeInteger(const unsigned char*& p, const unsigned char* pEnd, int nPrefix,
+                       uint64_t& uValue);
+    bool decodeString(const unsigned char*& p, const unsigned char* pEnd, std::string& out);
+    bool field(uint64_t uIndex, std::string_view& name, std::string_view& value) const;
+
+    HpackTable table_;
+    std::size_t uAllowedSize_;
+    std::size_t uMaxString_;
+    std::string name_;              // Literals of the field being decoded
+    std::string value_;
+};
+
+}  // namespace sockstr
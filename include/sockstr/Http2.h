@@ -0,0 +1,318 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+#include <sockstr/Arena.h>
+#include <sockstr/Hpack.h>
+#include <sockstr/HttpParser.h>
+#include <sockstr/HttpServer.h>
+#include <sockstr/Task.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+//
+// FORWARD CLASS DECLARATIONS
+//
+class HttpBodySink;
+class HttpFile;
+class HttpFileCache;
+class HttpServerStream;
+class HttpStream;
+class Socket;
+
+/**
+ *  An HTTP/2 connection (RFC 9113), server or client side, carrying many
+ *  requests at once as streams of frames.
+ *
+ *  A server takes the connection over from an HttpServerStream, either
+ *  when a client starts with the connection preface (prior knowledge) or
+ *  when it asks for "Upgrade: h2c".  Each request is handed to the same
+ *  HttpHandler as an HTTP/1.1 request, through an HttpCall whose request()
+ *  is an HttpParser over the head rebuilt from the decoded fields, so
+ *  routes and handlers do not know which protocol a request came on.
+ *  HttpServer does this by itself unless setHttp2(false) is called.
+ *
+ *  A client opens streams with submit() and waits for their responses;
+ *  requests beyond the number of streams the server allows wait for a
+ *  stream to close.  Over TLS, Socket::setAlpn("h2") before the connection
+ *  is opened asks for HTTP/2, and Socket::alpnProtocol() tells if the
+ *  server agreed.
+ *
+ *  Header blocks are compressed with HPACK.  Response bodies are sent
+ *  round-robin across the streams, within the flow control windows of the
+ *  peer; the windows this side advertises are raised once at the start,
+ *  so a fast peer is not held back by the 64 KB default.
+ *
+ *  Each stream is kept in an Arena with all it allocates, and the arena
+ *  goes to the next stream when it is done, so a connection past its
+ *  first requests serves the next ones without allocating.
+ *
+ *  Example:
+ *  @code
+ *      Http2Connection h2;
+ *      h2.connect(socket, "example.com:8080");
+ *      std::string a, b;
+ *      HttpBodySink sinkA(a), sinkB(b);
+ *      UINT idA = h2.submit("GET", "/a", sinkA);
+ *      UINT idB = h2.submit("GET", "/b", sinkB);
+ *      h2.waitAll();
+ *  @endcode
+ */
+class DllExport Http2Connection {
+public:
+    /** Error codes of RST_STREAM and GOAWAY frames. */
+    enum ErrorCode {
+        errNone = 0x0,
+        errProtocol = 0x1,
+        errInternal = 0x2,
+        errFlowControl = 0x3,
+        errSettingsTimeout = 0x4,
+        errStreamClosed = 0x5,
+        errFrameSize = 0x6,
+        errRefusedStream = 0x7,
+        errCancel = 0x8,
+        errCompression = 0x9,
+        errConnect = 0xa,
+        errEnhanceYourCalm = 0xb,
+        errInadequateSecurity = 0xc,
+        errHttp11Required = 0xd
+    };
+    /** Counters of a connection. */
+    struct Stats {
+        uint64_t framesSent = 0;
+        uint64_t framesReceived = 0;
+        uint64_t streams = 0;           //!< Streams opened
+        uint64_t fieldBytes = 0;        //!< Header fields sent, as HTTP/1.1 lines
+        uint64_t blockBytes = 0;        //!< Header blocks sent, HPACK-encoded
+    };
+
+    Http2Connection();
+    ~Http2Connection();
+
+    // Disable copy constructor and assignment operator
+    Http2Connection(const Http2Connection&) = delete;
+    Http2Connection& operator=(const Http2Connection&) = delete;
+
+    /** Indicate if a request asks for an upgrade to HTTP/2 over cleartext. */
+    static bool isUpgrade(const HttpParser& request);
+
+    // Server side
+
+    /** Set the limits on the size of requests, as HttpServerStream has
+     *  them; a request beyond them is answered with 431 or 413. */
+    void setLimits(const HttpParser::Limits& limits) { limits_ = limits; }
+    /** Limit the number of streams a client may have open at once.  The
+     *  default is 100. */
+    void setMaxStreams(UINT uMax) { uMaxStreams_ = uMax; }
+    /** Set the flow control window advertised for each stream, how much
+     *  of a body the peer may send before it is consumed.  The default is
+     *  1 MB; the window of the connection is 16 times that. */
+    void setWindow(UINT uWindow) { uWindow_ = uWindow; }
+    /** Serve the requests of a connection as HTTP/2 until it ends.  The
+     *  current request of conn must be an upgrade (see isUpgrade()), which
+     *  becomes stream 1, or conn must have failed on the connection
+     *  preface (see HttpServerStream::http2Preface()).
+     *  @return False if the connection ended with an error. */
+    Task<bool> async_serve(HttpServerStream& conn, HttpHandler pHandler, void* ptr);
+
+    // Client side
+
+    /** Start HTTP/2 with prior knowledge on an open connection: send the
+     *  preface and settings.
+     *  @param authority Host and port the requests are for
+     *  @param scheme    "http" or "https"
+     *  @return False if the connection failed. */
+    bool connect(Socket& rSocket, std::string_view authority,
+                 std::string_view scheme = "http");
+    /** Ask for an upgrade to HTTP/2 with a GET request on an HTTP/1.1
+     *  connection.  If the server switches, the response comes on stream 1
+     *  and is waited for with wait(1); if not, the response was read as
+     *  HTTP/1.1, its body passed to sink, and the connection stays HTTP/1.1.
+     *  @param headers Further header lines, each ending with CRLF
+     *  @return Status code of the HTTP/1.1 response, 101 if switched; 0 if
+     *          there was no valid response. */
+    UINT upgrade(HttpStream& http, const std::string& uri, std::string_view authority,
+                 HttpBodySink& sink, std::string_view headers = std::string_view());
+    /** Open a stream for a request.  Nothing is sent until the next call
+     *  to wait() or waitAll().
+     *  @param method  Method of the request, such as "GET"
+     *  @param path    Path and query of the request
+     *  @param sink    Takes the body of the response; must stay valid
+     *                 until the stream is done
+     *  @param body    Body of the request, which must stay valid until
+     *                 the stream is done
+     *  @param headers Further header lines, each ending with CRLF
+     *  @return Identifier of the stream; 0 if the connection is closed. */
+    UINT submit(const char* method, std::string_view path, HttpBodySink& sink,
+                std::string_view body = std::string_view(),
+                std::string_view headers = std::string_view());
+    /** Exchange frames until a stream is done, the others going on
+     *  meanwhile.
+     *  @return False if the stream was reset or the connection failed. */
+    bool wait(UINT uStream);
+    /** Exchange frames until every stream is done.
+     *  @return False if the connection failed. */
+    bool waitAll();
+    /** Return the status code of the response on a stream; 0 until the
+     *  response has come, or if the stream was reset. */
+    UINT status(UINT uStream) const;
+    /** Return the response on a stream, its status line and headers as an
+     *  HTTP/1.1 head; null until it has come. */
+    const HttpParser* response(UINT uStream) const;
+    /** Forget a stream that is done. */
+    void release(UINT uStream);
+    /** Send GOAWAY and close the socket. */
+    void close();
+
+    //! Indicate if the connection can carry more requests.
+    bool isOpen() const { return pSocket_ != 0 && !bFailed_ && !bGoingAway_; }
+    //! Return the error code the connection ended with, errNone if none.
+    ErrorCode error() const { return error_; }
+    //! Return the counters of the connection.
+    const Stats& stats() const { return stats_; }
+
+private:
+    struct Stream;
+    friend class HttpCall;
+
+    // Server side, for HttpCall
+    const HttpParser& request(UINT uStream) const;
+    std::string_view requestBody(UINT uStream) const;
+    void reply(UINT uStream, UINT uStatus, std::string_view body, const char* contentType,
+               std::string_view headers);
+    void replyFile(UINT uStream, HttpFileCache& rCache, std::string_view path);
+
+    void respond(Stream& rStream, UINT uStatus, uint64_t uLength, const char* contentType,
+                 std::string_view headers, const char* pEncoding, bool bEnd);
+    void replyError(Stream& rStream, UINT uStatus);
+
+    void start(Socket& rSocket, bool bServer);
+    void queueSettings();
+    std::string settingsPayload() const;
+    bool applySettings(const char* pData, std::size_t uLength);
+    Stream* find(UINT uStream) const;
+    Stream* open(UINT uStream);
+    void forget(Stream* pStream);
+    void destroy(Stream* pStream);
+    void checkClosed(Stream& rStream);
+    bool idle(UINT uStream) const;
+
+    int step();
+    bool frame(int nType, int nFlags, UINT uStream, const char* pData, std::size_t uLength);
+    bool onData(Stream* pStream, int nFlags, UINT uStream, const char* pData, std::size_t uLength);
+    bool onHeaders(int nFlags, UINT uStream, const char* pData, std::size_t uLength);
+    bool onSettings(int nFlags, const char* pData, std::size_t uLength);
+    bool onWindowUpdate(UINT uStream, const char* pData, std::size_t uLength);
+    bool endHeaders();
+    static bool onField(std::string_view name, std::string_view value, void* ptr);
+    bool field(Stream& rStream, std::string_view name, std::string_view value);
+    bool finishHead(Stream& rStream);
+    void received(Stream& rStream);
+    void handle(Stream& rStream);
+    void consume(Stream* pStream, std::size_t uLength);
+
+    void queueFrame(int nType, int nFlags, UINT uStream, std::string_view payload);
+    void queueHeaders(Stream& rStream, std::string_view block, bool bEnd);
+    void queueReset(UINT uStream, ErrorCode eCode);
+    void encodeLines(std::string& block, std::string_view lines);
+    void ready(Stream& rStream);
+    bool pump();
+    void sent(Stream& rStream);
+    bool fail(ErrorCode eCode);
+    bool streamError(Stream* pStream, UINT uStream, ErrorCode eCode);
+    void openWaiting();
+    void makeRoom();
+
+    bool flush();
+    Task<bool> async_flush();
+    bool exchange();
+
+    Socket* pSocket_;
+    HttpServerStream* pServer_;     // Server side only
+    HttpHandler pHandler_;
+    void* pData_;
+    bool bServer_;
+    std::string authority_;
+    std::string scheme_;
+    HttpParser::Limits limits_;
+    UINT uMaxStreams_;
+    UINT uWindow_;
+
+    HpackEncoder encoder_;
+    HpackDecoder decoder_;
+    std::pmr::unsynchronized_pool_resource nodes_;  // Recycles the nodes of streams_
+    std::pmr::unordered_map<UINT, Stream*> streams_;    // Each in its own arena
+    std::vector<std::unique_ptr<Arena> > spare_;    // Arenas of streams done
+    Arena callArena_;               // Of the HttpCall being handled
+    std::vector<Stream*> ready_;    // Streams with a body to send,
+    std::size_t uReadyHead_;        // from this one on
+    std::deque<Stream*> waiting_;   // Client streams beyond the peer's limit
+    UINT uActive_;                  // Streams open
+    UINT uLastStream_;              // Highest stream opened by the peer
+    UINT uNextStream_;              // Next stream this side opens
+
+    // Settings of the peer
+    UINT uPeerMaxStreams_;
+    UINT uPeerMaxFrame_;
+    int64_t nPeerWindow_;           // Initial window of a stream
+    int64_t nSendWindow_;           // Window of the connection
+    int64_t nRecvWindow_;
+    uint64_t uRecvConsumed_;        // Not yet given back with WINDOW_UPDATE
+
+    std::string recvBuf_;           // Received, from recvBegin_ to recvEnd_
+    std::size_t recvBegin_;
+    std::size_t recvEnd_;
+    bool bPreface_;                 // The preface of the peer has been seen
+    std::string block_;             // Header block being received
+    UINT uBlockStream_;             // Its stream, 0 if none
+    int nBlockFlags_;
+    Stream* pDecoding_;             // Stream whose fields are being decoded
+    std::string outBuf_;            // Frames to write
+    std::string sendLines_;         // Header lines of a response being encoded
+    std::string sendBlock_;         // Its header block
+    std::string sendName_;          // Name of a field, in lower case
+
+    bool bFailed_;
+    bool bGoingAway_;               // GOAWAY sent or received
+    UINT uPeerLastStream_;          // Last stream of a GOAWAY received
+    ErrorCode error_;
+    Stats stats_;
+};
+
+}  // namespace sockstr
@@ -0,0 +1,182 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+//
+// TYPE DEFINITIONS
+//
+/**
+ *  @typedef HttpBodyCallback
+ *  Routine that receives a body piece by piece.
+ *  @param pData   Next piece of the body
+ *  @param uLength Size of the piece
+ *  @param ptr     Pointer to user data given to HttpBodySink
+ *  @return False to stop receiving the body
+ */
+typedef bool (*HttpBodyCallback)(const char* pData, UINT uLength, void* ptr);
+/**
+ *  @typedef HttpBodyProducer
+ *  Routine that makes a body piece by piece, as it is sent.
+ *  @param pBuffer Buffer to put the next piece in
+ *  @param uSize   Size of the buffer
+ *  @param ptr     Pointer to user data given to HttpBodySource
+ *  @return Size of the piece; 0 at the end of the body
+ */
+typedef UINT (*HttpBodyProducer)(char* pBuffer, UINT uSize, void* ptr);
+
+/**
+ *  Destination of the body of an HTTP message.
+ *
+ *  The body is handed over as it is received, without being collected
+ *  first, into a buffer of the caller, a string, a callback or a file
+ *  descriptor.  A buffer that is too small keeps the start of the body;
+ *  the rest is read and dropped so that the connection can be used for
+ *  the next message.
+ *
+ *  Example:
+ *  @code
+ *      int fd = open("download.iso", O_WRONLY | O_CREAT, 0644);
+ *      HttpBodySink sink(fd);
+ *      UINT status = http.get("/images/download.iso", sink);
+ *  @endcode
+ */
+class DllExport HttpBodySink {
+public:
+    /** Drop the body. */
+    HttpBodySink();
+    /** Store the body in a buffer.
+     *  @param pBuffer Buffer
+     *  @param uSize   Size of the buffer; the rest of the body is dropped */
+    HttpBodySink(char* pBuffer, UINT uSize);
+    /** Append the body to a string. */
+    explicit HttpBodySink(std::string& rString);
+    /** Pass the body to a callback. */
+    HttpBodySink(HttpBodyCallback pCallback, void* ptr);
+    /** Write the body to a file descriptor, which stays open. */
+    explicit HttpBodySink(int fd);
+
+    /** Announce the length of the body, when the message tells it. */
+    void expect(uint64_t uLength);
+    /** Take the next piece of the body.
+     *  @return False if the callback or a write to the file failed, in which
+     *          case the rest of the body should not be read. */
+    bool write(const char* pData, std::size_t uLength);
+
+    //! Return the number of bytes of the body received.
+    uint64_t size() const { return uSize_; }
+    //! Return the number of bytes stored into the buffer.
+    UINT stored() const { return uStored_; }
+    //! Indicate if the body did not fit in the buffer.
+    bool truncated() const { return uStored_ < uSize_ && kind_ == sinkBuffer; }
+
+private:
+    enum Kind {
+        sinkDiscard,
+        sinkBuffer,
+        sinkString,
+        sinkCallback,
+        sinkFile
+    };
+
+    Kind kind_;
+    char* pBuffer_;
+    UINT uCapacity_;
+    std::string* pString_;
+    HttpBodyCallback pCallback_;
+    void* pData_;
+    int fd_;
+    uint64_t uSize_;
+    UINT uStored_;
+};
+
+/**
+ *  Origin of the body of an HTTP request.
+ *
+ *  The body is sent as it is read, without being collected first, from a
+ *  buffer of the caller, a callback or a file descriptor.  A buffer is
+ *  sent in the same system call as the head; a file is sent with
+ *  sendfile(2) where the connection allows.  A body whose length is not
+ *  known, from a callback, is sent with chunked transfer coding.
+ *
+ *  Example:
+ *  @code
+ *      int fd = open("backup.tar", O_RDONLY);
+ *      HttpBodySource source(fd, 0, fileSize);
+ *      HttpBodySink sink;
+ *      UINT status = http.put("/backups/backup.tar", source, sink);
+ *  @endcode
+ */
+class DllExport HttpBodySource {
+public:
+    /** Length of a body made by a callback that does not tell it */
+    static constexpr uint64_t UNKNOWN = UINT64_MAX;
+
+    /** No body. */
+    HttpBodySource();
+    /** Send a buffer, which must stay valid until the request is sent. */
+    HttpBodySource(const char* pData, std::size_t uLength);
+    /** Send what a callback makes.
+     *  @param uLength Length of the body, if known */
+    HttpBodySource(HttpBodyProducer pProducer, void* ptr, uint64_t uLength = UNKNOWN);
+    /** Send part of a file, which stays open.
+     *  @param uOffset Offset of the first byte to send */
+    HttpBodySource(int fd, uint64_t uOffset, uint64_t uLength);
+
+    //! Indicate if there is a body, even an empty one, to announce.
+    bool present() const { return kind_ != sourceNone; }
+    //! Return the length of the body, UNKNOWN if the callback does not tell.
+    uint64_t length() const { return uLength_; }
+
+private:
+    friend class HttpStream;
+
+    enum Kind {
+        sourceNone,
+        sourceBuffer,
+        sourceProducer,
+        sourceFile
+    };
+
+    Kind kind_;
+    const char* pData_;
+    HttpBodyProducer pProducer_;
+    void* ptr_;
+    int fd_;
+    uint64_t uOffset_;
+    uint64_t uLength_;
+};
+
+}  // namespace sockstr
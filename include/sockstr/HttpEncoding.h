@@ -0,0 +1,100 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+//
+// FORWARD CLASS DECLARATIONS
+//
+class HttpBodySink;
+
+/**
+ *  Content codings of HTTP bodies.
+ *
+ *  Only gzip is produced.  Compression uses one zlib deflate state per
+ *  thread, created on first use and reset for each body, so a server
+ *  thread pays for deflateInit once rather than for every response.
+ */
+class DllExport HttpEncoding {
+public:
+    /** Bodies smaller than this are not worth compressing. */
+    static constexpr std::size_t MIN_COMPRESSED = 256;
+
+    /** Indicate if an Accept-Encoding value accepts a content coding,
+     *  either by name or through "*", with a q-value above 0.  "x-gzip"
+     *  is taken for "gzip". */
+    static bool accepts(std::string_view acceptEncoding, std::string_view coding);
+    /** Indicate if a media type is worth compressing: text, and the
+     *  JSON, XML and script types.  Images, audio, video, archives and
+     *  unknown types are mostly compressed already. */
+    static bool compressible(const char* contentType);
+    /** Compress data into gzip format.
+     *  @param nLevel zlib level: 1 (fastest) to 9 (smallest)
+     *  @return The compressed data, valid until the next call on this
+     *          thread; empty if it fails or saves nothing. */
+    static std::string_view gzip(std::string_view data, int nLevel);
+};
+
+/**
+ *  Streaming decoder of a gzip body.
+ *
+ *  The body is decoded as it arrives, piece by piece, and the output is
+ *  passed on to an HttpBodySink, so it is never held whole.  Members of
+ *  a gzip file written one after the other are decoded in turn.
+ */
+class DllExport HttpInflater {
+public:
+    HttpInflater();
+    ~HttpInflater();
+
+    // Disable copy constructor and assignment operator
+    HttpInflater(const HttpInflater&) = delete;
+    HttpInflater& operator=(const HttpInflater&) = delete;
+
+    /** Get ready for another body. */
+    void reset();
+    /** Decode the next piece of the body.
+     *  @return False if the data is corrupt or the sink failed. */
+    bool write(const char* pData, std::size_t uLength, HttpBodySink& rSink);
+    //! Indicate if the body decoded so far is empty or ends a whole gzip member.
+    bool finished() const { return bFinished_; }
+
+private:
+    struct Stream;
+    std::unique_ptr<Stream> pStream_;
+    bool bFinished_;
+};
+
+}  // namespace sockstr
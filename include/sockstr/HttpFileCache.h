@@ -0,0 +1,207 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <sys/types.h>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+//
+// FORWARD CLASS DECLARATIONS
+//
+class HttpCall;
+
+/**
+ *  A file of an HttpFileCache, open and ready to be sent.
+ *
+ *  Small files are read when they are cached and their contents kept;
+ *  larger ones are kept open and sent from the descriptor.  An HttpFile
+ *  stays valid while it is held, even if the cache lets go of it.
+ */
+class DllExport HttpFile {
+public:
+    /** Files up to this size are kept in memory. */
+    static constexpr uint64_t MAX_LOADED = 16 * 1024;
+
+    HttpFile();
+    /** Closes the descriptor. */
+    ~HttpFile();
+
+    // Disable copy constructor and assignment operator
+    HttpFile(const HttpFile&) = delete;
+    HttpFile& operator=(const HttpFile&) = delete;
+
+    //! Return the descriptor to send from, -1 if the file is loaded.
+    int fd() const { return fd_; }
+    //! Indicate if the contents of the file are in memory.
+    bool loaded() const { return fd_ < 0; }
+    //! Return the contents of a loaded file.
+    std::string_view contents() const { return contents_; }
+    //! Return the size of the file.
+    uint64_t size() const { return uSize_; }
+    //! Return the time the file was last modified.
+    time_t modified() const { return modified_; }
+    //! Return the entity tag of this version of the file, quotes included.
+    std::string_view etag() const { return etag_; }
+    //! Return the media type, from the extension of the file name.
+    const char* contentType() const { return contentType_; }
+    /** Return the ETag and Last-Modified header lines, each ending with
+     *  CRLF, as HttpServerStream::appendResponse() takes them. */
+    std::string_view headers() const { return headers_; }
+    /** Return the same contents compressed with gzip, or nullptr if there
+     *  is no such variant.  Its headers include Content-Encoding. */
+    const std::shared_ptr<const HttpFile>& gzip() const { return pGzip_; }
+
+private:
+    friend class HttpFileCache;
+
+    int fd_;
+    std::string contents_;
+    uint64_t uSize_;
+    time_t modified_;
+    std::string etag_;
+    const char* contentType_;
+    std::string headers_;
+    std::shared_ptr<const HttpFile> pGzip_;
+    std::string path_;              // Relative to the root of the cache
+    int watch_;                     // inotify watch of its directory
+    dev_t device_;
+    ino_t inode_;
+    int64_t modifiedNanos_;
+};
+
+/**
+ *  Cache of the files of a directory tree, for serving them over HTTP.
+ *
+ *  find() resolves a request path under the root directory and returns
+ *  the file open, with its size, type and validators worked out and its
+ *  ETag and Last-Modified header lines built.  The file is kept for
+ *  later requests, so a cached file costs no system call to find.  On
+ *  Linux a thread watches the cached directories with inotify and drops
+ *  the files that change; elsewhere each find() checks the file with
+ *  stat().
+ *
+ *  HttpServerStream::serveFile() answers a request from the cache,
+ *  including conditional requests, which get 304 without touching the
+ *  file, and sends large files with sendfile(2).
+ *
+ *  A file may have a gzip variant, sent to clients that accept it: a
+ *  precompressed "name.gz" next to the file, or, for a small file of a
+ *  type that compresses, its contents compressed once when it is cached.
+ *  Large files without a ".gz" are sent as they are.
+ *
+ *  Paths are percent-decoded.  Paths with a ".." segment or a segment
+ *  starting with '.' are not served, nor is anything but regular files;
+ *  a path ending in '/' is served from index.html in that directory.
+ *  Symbolic links are followed, even out of the tree.
+ *
+ *  The cache may be used on several threads at once.  Its handler()
+ *  serves the path captured by a route, typically a wildcard pattern
+ *  such as "/static/" followed by "*path", or the whole request path.
+ *
+ *  Example:
+ *  @code
+ *      HttpFileCache files("/var/www");
+ *      HttpServer server;
+ *      server.setHandler(HttpFileCache::handler, &files);
+ *  @endcode
+ */
+class DllExport HttpFileCache {
+public:
+    /** Construct a cache.
+     *  @param root      Directory holding the files
+     *  @param uMaxFiles Number of files to keep; above it one is dropped
+     *                   for each one added */
+    explicit HttpFileCache(const std::string& root, UINT uMaxFiles = 1024);
+    /** Stops the watching thread and closes the files not in use. */
+    ~HttpFileCache();
+
+    // Disable copy constructor and assignment operator
+    HttpFileCache(const HttpFileCache&) = delete;
+    HttpFileCache& operator=(const HttpFileCache&) = delete;
+
+    //! Indicate if the root directory could be opened.
+    bool is_open() const { return rootFd_ >= 0; }
+    //! Indicate if changes are noticed with inotify rather than stat().
+    bool watching() const { return watchFd_ >= 0; }
+
+    /** Find the file for a request path.
+     *  @param path Path under the root, with or without a leading '/'
+     *  @return The file, or nullptr if there is none to serve. */
+    std::shared_ptr<const HttpFile> find(std::string_view path);
+    /** Drop every file. */
+    void clear();
+
+    //! Return the number of find() calls answered from the cache.
+    uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    //! Return the number of find() calls that looked at the file system.
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+    /** Return the media type for the extension of a file name, or
+     *  "application/octet-stream". */
+    static const char* contentType(std::string_view name);
+    /** HttpHandler serving files from the cache given as ptr, for
+     *  HttpServer::setHandler() or HttpRouter::addRoute().  The path is
+     *  the last value captured by the route, if any, or else the path of
+     *  the request. */
+    static void handler(HttpCall& rCall, void* ptr);
+
+private:
+    std::shared_ptr<HttpFile> load(const std::string& key);
+    std::shared_ptr<HttpFile> openFile(const std::string& path) const;
+    static void describe(HttpFile& rFile, const char* tagSuffix);
+    bool stillValid(const HttpFile& rFile) const;
+    int watchDirectories(const std::string& path);
+    void watcher();
+
+    std::string root_;
+    int rootFd_;
+    UINT uMaxFiles_;
+    mutable std::shared_mutex lock_;        //!< Guards files_ and watches_
+    std::unordered_map<std::string, std::shared_ptr<const HttpFile> > files_;
+    std::unordered_map<std::string, int> watches_;  //!< Watched directories
+    uint64_t uGeneration_;                  //!< Counts invalidations
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    int watchFd_;                           //!< inotify descriptor
+    int wakeFd_;                            //!< Stops the watcher
+    std::thread watcher_;
+};
+
+}  // namespace sockstr
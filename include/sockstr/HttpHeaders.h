@@ -0,0 +1,186 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+/**
+ *  Header fields common enough to be interned: a name is looked up once,
+ *  when it is parsed or added, and is then found by comparing its
+ *  identifier instead of its letters.
+ */
+enum HeaderId : uint8_t {
+    hdrOther,               //!< Any field not listed here
+    hdrAccept,
+    hdrAcceptEncoding,
+    hdrAcceptLanguage,
+    hdrAuthorization,
+    hdrCacheControl,
+    hdrConnection,
+    hdrContentEncoding,
+    hdrContentLength,
+    hdrContentType,
+    hdrCookie,
+    hdrDate,
+    hdrETag,
+    hdrExpect,
+    hdrHost,
+    hdrIfModifiedSince,
+    hdrIfNoneMatch,
+    hdrLastModified,
+    hdrLocation,
+    hdrServer,
+    hdrSetCookie,
+    hdrTransferEncoding,
+    hdrUpgrade,
+    hdrUserAgent,
+    hdrVary,
+    hdrCount                //!< Number of identifiers
+};
+
+/**
+ *  Header fields of one HTTP message, in the order they were added.
+ *
+ *  The fields are kept in a small vector: the first INLINE_FIELDS live in
+ *  the object itself, and only a message with more spills into the heap.
+ *  Names and values are copied one after the other into a single buffer,
+ *  which clear() empties without giving back its memory; a container
+ *  reused from one message to the next therefore stops allocating once it
+ *  has held the largest message.
+ *
+ *  The overflow and the buffer come from the std::pmr::memory_resource
+ *  given to the constructor, which may be the Arena of a request.
+ *
+ *  Names are compared without regard to case.  A common name is stored as
+ *  its HeaderId and written back in its usual spelling.  A value replaced
+ *  or removed stays in the buffer until the next clear(), unless the waste
+ *  grows larger than what is in use.
+ *
+ *  Example:
+ *  @code
+ *      HttpHeaders headers;
+ *      headers.parse(head.data(), head.size());
+ *      std::string_view length = headers.get(hdrContentLength);
+ *      std::string_view custom = headers.get("x-request-id");
+ *  @endcode
+ */
+class DllExport HttpHeaders {
+public:
+    /** Number of fields held without allocating */
+    static constexpr std::size_t INLINE_FIELDS = 16;
+
+    /** One header field. */
+    struct Field {
+        HeaderId id;
+        std::string_view name;
+        std::string_view value;
+    };
+
+    explicit HttpHeaders(std::pmr::memory_resource* pMemory = std::pmr::get_default_resource())
+        : overflow_(pMemory), uCount_(0), text_(pMemory), uWaste_(0) { }
+
+    /** Append a field, keeping any other of the same name. */
+    void add(std::string_view name, std::string_view value);
+    void add(HeaderId id, std::string_view value);
+    /** Replace the fields of a name with one field. */
+    void set(std::string_view name, std::string_view value);
+    void set(HeaderId id, std::string_view value);
+    /** Remove the fields of a name.
+     *  @return False if there were none. */
+    bool remove(std::string_view name);
+    bool remove(HeaderId id);
+    /** Find a field.
+     *  @return The value of the first field of the name, or an empty view
+     *          with a null data() if there is none. */
+    std::string_view get(std::string_view name) const;
+    std::string_view get(HeaderId id) const;
+
+    //! Return the number of fields.
+    std::size_t size() const { return uCount_; }
+    //! Indicate if there are no fields.
+    bool empty() const { return uCount_ == 0; }
+    /** Return a field by position.  The views are valid until the
+     *  container is next changed. */
+    Field at(std::size_t uIndex) const;
+    /** Remove every field.  The memory is kept for the next message. */
+    void clear();
+
+    /** Replace the fields with those of header lines, each "Name: value"
+     *  and ending with CRLF or LF.  Lines without a colon are skipped.
+     *  @return Number of fields parsed. */
+    std::size_t parse(const char* pData, std::size_t uSize);
+    /** Append the fields to str as header lines, each ending with CRLF. */
+    void appendTo(std::string& str) const;
+
+    /** Return the identifier of a name, hdrOther if it is not interned. */
+    static HeaderId lookup(std::string_view name);
+    /** Return the usual spelling of an interned name. */
+    static std::string_view nameOf(HeaderId id);
+
+private:
+    // Name and value as offsets into text_, which may move as it grows
+    struct Entry {
+        HeaderId id;
+        uint32_t uName;             // Not used for interned names
+        uint32_t uNameLength;
+        uint32_t uValue;
+        uint32_t uValueLength;
+    };
+
+    Entry& entry(std::size_t uIndex) {
+        return uIndex < INLINE_FIELDS ? inline_[uIndex] : overflow_[uIndex - INLINE_FIELDS];
+    }
+    const Entry& entry(std::size_t uIndex) const {
+        return uIndex < INLINE_FIELDS ? inline_[uIndex] : overflow_[uIndex - INLINE_FIELDS];
+    }
+    std::string_view text(uint32_t uOffset, uint32_t uLength) const {
+        return std::string_view(text_.data() + uOffset, uLength);
+    }
+    std::string_view nameOf(const Entry& rEntry) const;
+    bool matches(const Entry& rEntry, HeaderId id, std::string_view name) const;
+    void append(HeaderId id, std::string_view name, std::string_view value);
+    bool removeAll(HeaderId id, std::string_view name);
+    void compact();
+
+    Entry inline_[INLINE_FIELDS];
+    std::pmr::vector<Entry> overflow_;  // Fields beyond INLINE_FIELDS
+    std::size_t uCount_;
+    std::pmr::string text_;         // Names and values, one after the other
+    std::size_t uWaste_;            // Bytes of text_ no longer referred to
+};
+
+}  // namespace sockstr
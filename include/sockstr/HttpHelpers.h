@@ -28,8 +28,8 @@
 // INCLUDE FILES
 //
 #include <ctime>
-#include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 
 
@@ -76,6 +76,12 @@ public:
     virtual void set(const std::string& value) { value_ = value; }
     /** Get the value as a string. */
     virtual std::string toString() { return value_; }
+    /** Append the value to str.  Encoders that are used for every message
+     *  override this to avoid building a string of their own. */
+    virtual void appendTo(std::string& str) { str += toString(); }
+    /** Indicate if the value never changes, so that a header holding it can
+     *  be encoded once and reused.  Computed values are not fixed. */
+    virtual bool isFixed() const { return false; }
     /** Get a string containing name=value. */
     virtual std::string getNameValue()
     {
@@ -142,6 +148,8 @@ public:
     /** Construct a FixedStringEncoder. */
     FixedStringEncoder(const std::string& name, const std::string& value)
         : HttpParamEncoder(name, value) { }
+
+    virtual bool isFixed() const { return true; }
 };
 
 
@@ -161,9 +169,30 @@ private:
 };
 
 
+/**
+ * Formats dates as HTTP wants them (RFC 9110 5.6.7, "IMF-fixdate").
+ * Example of format: "Sun, 05 May 2013 19:51:06 GMT".
+ */
+class DllExport HttpDate
+{
+public:
+    //! Length of a formatted date
+    static constexpr std::size_t LENGTH = 29;
+
+    /** Format a time into buffer, which must hold LENGTH + 1 characters. */
+    static void format(time_t timeSecs, char* buffer);
+    /** Read a date in the format of format(), the only one HTTP/1.1
+     *  senders may use.
+     *  @return False if text is not such a date. */
+    static bool parse(std::string_view text, time_t& rTimeSecs);
+    /** Return the current date, formatted at most once a second by each
+     *  thread.  The view is valid until the calling thread calls now() again. */
+    static std::string_view now();
+};
+
 /**
  * Encodes Date/time into acceptable W3C format.
- * Example of format: "Sun, 05 May 2013 19:51:06 PDT".
+ * Example of format: "Sun, 05 May 2013 19:51:06 GMT".
  * Defaults to current time, but can be initialized with any epoch time
  * in seconds.
  */
@@ -193,6 +222,8 @@ public:
     TimestampEncoder(bool refresh, DateTimeFormat format = DateTimeRfc822);
 
     virtual std::string toString();
+    virtual void appendTo(std::string& str);
+    virtual bool isFixed() const { return !refresh_; }
 private:
     time_t timeSecs_;
     bool refresh_;
@@ -241,18 +272,21 @@ public:
     int getStatus() const;
     /** Set the status code */
     void setStatus(int status);
+    /** Get the status line, such as "HTTP/1.1 200 OK\r\n". */
     std::string statusLine() const;
+    /** Get the reason phrase with a leading space, such as " OK". */
     std::string statusName() const;
 
-private:
-    void init_();
+    /** Look up the status line of a status code in a table built at
+     *  compile time.
+     *  @return The status line with its CRLF, or an empty view if the code
+     *          is not in the table. */
+    static std::string_view knownStatusLine(int status);
 
 public:
     static const std::string HTTP_HEADER;
 
 private:
-    static std::map<int, std::string> statusNames_;
-
     int status_;
 };
 
@@ -0,0 +1,135 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+//
+// FORWARD CLASS DECLARATIONS
+//
+class HttpBodySink;
+
+/**
+ *  Headers of one part of a multipart body.
+ */
+struct HttpPart {
+    std::string name;           //!< Field name from Content-Disposition
+    std::string filename;       //!< File name from Content-Disposition, if any
+    std::string contentType;    //!< Content-Type of the part, if given
+};
+
+/**
+ *  @typedef HttpPartHandler
+ *  Routine told of the parts of a multipart body.
+ *  @param rPart Headers of the part
+ *  @param bEnd  False when the part starts, true when it has ended
+ *  @param ptr   Pointer to user data given to HttpMultipartParser
+ *  @return At the start of a part, the sink for its content, which must
+ *          stay valid until the part ends; 0 to drop it.  Ignored at
+ *          the end.
+ */
+typedef HttpBodySink* (*HttpPartHandler)(const HttpPart& rPart, bool bEnd, void* ptr);
+
+/**
+ *  Incremental parser of a multipart/form-data body (RFC 7578).
+ *
+ *  The body is given piece by piece, as it is received, and the content
+ *  of each part goes straight to the sink that the handler gives for it,
+ *  so a file upload is written to disk without being held in memory.
+ *  Only a delimiter split between two pieces is held back.
+ *
+ *  Example:
+ *  @code
+ *      HttpMultipartParser parser(HttpMultipartParser::boundaryOf(type),
+ *                                 onPart, &upload);
+ *      while (conn.readBody(piece) && !piece.empty()) {
+ *          if (!parser.write(piece.data(), piece.size()))
+ *              break;
+ *      }
+ *      bool bComplete = parser.finished();
+ *  @endcode
+ */
+class DllExport HttpMultipartParser {
+public:
+    /** Longest header block of a part that is accepted */
+    static constexpr std::size_t maxHeaderBytes = 16384;
+
+    /** Create a parser.
+     *  @param boundary Boundary from the Content-Type of the body */
+    HttpMultipartParser(std::string_view boundary, HttpPartHandler pHandler, void* ptr);
+
+    // Disable copy constructor and assignment operator
+    HttpMultipartParser(const HttpMultipartParser&) = delete;
+    HttpMultipartParser& operator=(const HttpMultipartParser&) = delete;
+
+    /** Find the boundary parameter of a multipart Content-Type.
+     *  @return The boundary, as a view into contentType; empty if the type
+     *          is not multipart or has no valid boundary. */
+    static std::string_view boundaryOf(std::string_view contentType);
+
+    /** Parse the next piece of the body.
+     *  @return False if the body is malformed or a sink failed. */
+    bool write(const char* pData, std::size_t uLength);
+    //! Indicate if the closing delimiter has been parsed.
+    bool finished() const { return state_ == stateEpilogue; }
+
+private:
+    enum State {
+        statePreamble,      // Before the first delimiter
+        stateDelimiter,     // Rest of the line of a delimiter
+        stateHeaders,       // Header block of a part
+        stateBody,          // Content of a part
+        stateEpilogue,      // After the closing delimiter
+        stateError
+    };
+
+    std::size_t scanContent(const char* pData, std::size_t uLength);
+    std::size_t scanLine(const char* pData, std::size_t uLength);
+    std::size_t scanHeaders(const char* pData, std::size_t uLength);
+    bool content(const char* pData, std::size_t uLength);
+    void foundDelimiter();
+    std::size_t partialDelimiter(std::string_view text) const;
+    void parseHeaders();
+
+    std::string delimiter_;         // CRLF, "--" and the boundary
+    HttpPartHandler pHandler_;
+    void* ptr_;
+    State state_;
+    std::string carry_;             // Possible start of a delimiter
+    std::string line_;              // Delimiter line or header block so far
+    HttpPart part_;
+    HttpBodySink* pSink_;
+};
+
+}  // namespace sockstr
@@ -0,0 +1,314 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+#include <sockstr/HttpHeaders.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+/**
+ *  Incremental parser of the head of an HTTP/1.x message.
+ *
+ *  The parser works on the receive buffer of the caller.  parse() is
+ *  called each time more data has arrived, with the start of the message
+ *  and everything received so far; it carries on where the previous call
+ *  stopped, so no byte is looked at twice.  The buffer may be moved or
+ *  grown between calls, as only offsets into it are kept.
+ *
+ *  Once the head is complete, the start line and the headers are available
+ *  as string_views into the buffer passed to the last parse() call, and
+ *  bodyKind() and contentLength() tell how the body is framed.  Nothing is
+ *  allocated per message once the header table has grown to the largest
+ *  number of headers seen.
+ *
+ *  Limits protect against oversized or malicious messages; a message that
+ *  breaks one fails with an error that errorStatus() maps to the HTTP
+ *  status to reply with.
+ *
+ *  Example:
+ *  @code
+ *      HttpParser parser;
+ *      while (parser.parse(buf, uReceived) == HttpParser::parseIncomplete)
+ *          uReceived += read(buf + uReceived, sizeof(buf) - uReceived);
+ *  @endcode
+ */
+class DllExport HttpParser {
+public:
+    /** Kind of message to parse. */
+    enum Kind {
+        messageRequest,
+        messageResponse
+    };
+    /** Result of parse(). */
+    enum Result {
+        parseIncomplete,    //!< More data is needed
+        parseComplete,      //!< The head is complete, see headerSize()
+        parseError          //!< The message is invalid, see error()
+    };
+    /** Reasons a message is rejected. */
+    enum Error {
+        errorNone,
+        errorSyntax,            //!< Malformed start line or header
+        errorVersion,           //!< Not HTTP/1.0 or HTTP/1.1
+        errorLineTooLong,       //!< Start line longer than Limits::uMaxLine
+        errorHeadersTooLarge,   //!< Head longer than Limits::uMaxHeaderBytes
+        errorTooManyHeaders,    //!< More than Limits::uMaxHeaders headers
+        errorBadLength,         //!< Invalid or conflicting Content-Length
+        errorBodyTooLarge,      //!< Content-Length above Limits::uMaxBody
+        errorBadEncoding        //!< Transfer-Encoding that is not chunked
+    };
+    /** How the body of the message is delimited. */
+    enum BodyKind {
+        bodyNone,           //!< There is no body
+        bodyLength,         //!< contentLength() bytes follow the head
+        bodyChunked,        //!< Chunked transfer encoding
+        bodyUntilClose      //!< The body ends when the connection closes
+    };
+
+    /** Limits on the size of a message. */
+    struct Limits {
+        UINT uMaxLine = 8192;           //!< Request or status line
+        UINT uMaxHeaderBytes = 65536;   //!< The whole head
+        UINT uMaxHeaders = 100;         //!< Number of header fields
+        uint64_t uMaxBody = 64 * 1024 * 1024;   //!< Content-Length, or a chunked body
+    };
+
+    /** One header field. */
+    struct Header {
+        std::string_view name;
+        std::string_view value;         //!< Without surrounding white space
+        HeaderId id;                    //!< hdrOther unless the name is interned
+    };
+
+    /** Construct a parser.
+     *  @param pMemory Resource the list of header fields is kept in, such
+     *                 as the Arena of a request */
+    explicit HttpParser(Kind eKind = messageRequest,
+                        std::pmr::memory_resource* pMemory = std::pmr::get_default_resource());
+
+    /** Get ready for the next message.  The limits are kept. */
+    void reset();
+    /** Parse the head of a message.
+     *  @param pData Start of the message
+     *  @param uSize Number of bytes received; never less than in the
+     *               previous call for the same message
+     *  @return parseComplete once the empty line ending the head is seen.
+     *          Further calls return the same result without parsing, but
+     *          the views then refer to pData. */
+    Result parse(const char* pData, std::size_t uSize);
+
+    //! Set the limits on the size of messages.
+    void setLimits(const Limits& limits) { limits_ = limits; }
+    //! Return the limits on the size of messages.
+    const Limits& getLimits() const { return limits_; }
+
+    //! Indicate if the head of the message is complete.
+    bool isComplete() const { return state_ == stateDone; }
+    //! Return the reason parse() failed.
+    Error error() const { return error_; }
+    /** Return the HTTP status to reject a failed request with, such as 400
+     *  or 431; 0 if there was no error. */
+    UINT errorStatus() const;
+
+    // Start line.  The views are valid after parseComplete, and as long
+    // as the buffer given to parse() is.
+
+    //! Return the method of a request, such as "GET".
+    std::string_view method() const { return view(method_); }
+    //! Return the request target, such as "/index.html?lang=en".
+    std::string_view uri() const { return view(uri_); }
+    //! Return the part of the request target before any '?'.
+    std::string_view path() const;
+    //! Return the part of the request target after '?', empty if none.
+    std::string_view query() const;
+    //! Return the status code of a response.
+    UINT statusCode() const { return uStatus_; }
+    //! Return the reason phrase of a response.
+    std::string_view reason() const { return view(reason_); }
+    //! Return the minor version: 0 for HTTP/1.0, 1 for HTTP/1.1.
+    int versionMinor() const { return nMinor_; }
+
+    //! Return the number of header fields.
+    UINT headerCount() const { return static_cast<UINT>(fields_.size()); }
+    //! Return a header field by position.
+    Header headerAt(UINT uIndex) const;
+    /** Find a header field; the name is compared without regard to case.
+     *  @return The value of the first such field, or an empty view with a
+     *          null data() if there is none. */
+    std::string_view header(std::string_view name) const;
+    /** Find a header field by its interned name, without comparing
+     *  letters.  Names are interned as they are parsed. */
+    std::string_view header(HeaderId id) const;
+
+    //! Return the size of the head, including the empty line; the body starts here.
+    std::size_t headerSize() const { return headEnd_; }
+    //! Return how the body is delimited.
+    BodyKind bodyKind() const { return bodyKind_; }
+    //! Return the length of the body for bodyLength.
+    uint64_t contentLength() const { return uLength_; }
+    /** Indicate if the connection stays open after this message, from the
+     *  version and the Connection header. */
+    bool keepAlive() const { return bKeepAlive_; }
+
+    /** Compare two header names without regard to case. */
+    static bool equalNames(std::string_view name1, std::string_view name2);
+    /** Remove the spaces and tabs around a header value or list element. */
+    static std::string_view trim(std::string_view text);
+    /** Indicate if a comma-separated header value lists a token, compared
+     *  without regard to case. */
+    static bool hasToken(std::string_view list, std::string_view token);
+
+private:
+    enum State {
+        stateStart,         // Start line
+        stateHeaders,
+        stateDone,
+        stateError
+    };
+    struct Span {
+        uint32_t uOffset = 0;
+        uint32_t uLength = 0;
+    };
+    struct Field {
+        Span name;
+        Span value;
+        HeaderId id;
+    };
+
+    std::string_view view(Span span) const {
+        return std::string_view(pBase_ + span.uOffset, span.uLength);
+    }
+    Result fail(Error eError);
+    bool parseRequestLine(std::size_t uBegin, std::size_t uEnd);
+    bool parseStatusLine(std::size_t uBegin, std::size_t uEnd);
+    bool parseVersion(const char* pVersion, std::size_t uLength);
+    bool parseHeader(std::size_t uBegin, std::size_t uEnd);
+    Result finish();
+
+    Kind kind_;
+    Limits limits_;
+    State state_;
+    Error error_;
+    const char* pBase_;         // Buffer of the last parse() call
+    std::size_t line_;          // Start of the line being parsed
+    std::size_t scan_;          // Where to resume looking for its end
+    Span method_;
+    Span uri_;
+    Span reason_;
+    UINT uStatus_;
+    int nMinor_;
+    std::pmr::vector<Field> fields_;
+    std::size_t headEnd_;
+    BodyKind bodyKind_;
+    uint64_t uLength_;
+    bool bKeepAlive_;
+};
+
+/**
+ *  Incremental decoder of a body in chunked transfer encoding.
+ *
+ *  decode() is given the bytes received after the head of the message and
+ *  returns the payload in pieces, as views into those bytes, so a body is
+ *  never copied to be de-chunked.  Chunk extensions and trailer fields are
+ *  skipped.
+ *
+ *  Example:
+ *  @code
+ *      while (uUsed < uSize) {
+ *          eResult = decoder.decode(pData + uUsed, uSize - uUsed, uStep, payload);
+ *          if (eResult == HttpChunkDecoder::chunkError)
+ *              break;
+ *          uUsed += uStep;
+ *          consume(payload);
+ *          if (eResult == HttpChunkDecoder::chunkDone)
+ *              break;
+ *      }
+ *  @endcode
+ */
+class DllExport HttpChunkDecoder {
+public:
+    /** Result of decode(). */
+    enum Result {
+        chunkMore,          //!< The body continues
+        chunkDone,          //!< The last chunk and the trailer were read
+        chunkError          //!< The chunked encoding is invalid
+    };
+
+    HttpChunkDecoder();
+
+    /** Get ready for the next body. */
+    void reset();
+    /** Decode the next part of the body.
+     *  @param pData    Bytes received
+     *  @param uSize    Number of bytes at pData
+     *  @param rUsed    Set to the number of bytes consumed
+     *  @param rPayload Set to the payload found, if any, as a view into pData
+     *  @return chunkMore when the input is used up or a piece of payload was
+     *          found, in which case the caller continues after rUsed bytes. */
+    Result decode(const char* pData, std::size_t uSize, std::size_t& rUsed,
+                  std::string_view& rPayload);
+
+    //! Return the number of payload bytes decoded so far.
+    uint64_t bodySize() const { return uTotal_; }
+    //! Indicate if the whole body has been decoded.
+    bool isDone() const { return state_ == stateDone; }
+
+    //! Longest chunk size line, and the longest trailer, that is accepted
+    static constexpr UINT maxLineBytes = 8192;
+
+private:
+    enum State {
+        stateSize,          // Hex digits of the chunk size
+        stateExtension,     // Rest of the chunk size line
+        stateSizeLf,
+        stateData,
+        stateDataCr,        // CRLF after the data of a chunk
+        stateDataLf,
+        stateTrailer,
+        stateDone,
+        stateError
+    };
+
+    void endSizeLine();
+
+    State state_;
+    uint64_t uRemaining_;       // Of the current chunk
+    uint64_t uTotal_;
+    UINT uDigits_;
+    UINT uLineBytes_;
+    bool bLineEmpty_;           // No character yet on the current trailer line
+};
+
+}  // namespace sockstr
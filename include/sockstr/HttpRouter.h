@@ -0,0 +1,232 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+#include <sockstr/HttpServer.h>
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+/**
+ *  Values captured from a path by the parameters and wildcard of a route.
+ *
+ *  The values are views into the request, valid while the handler runs.
+ */
+class DllExport HttpParams {
+public:
+    /** Most captures a route may have. */
+    static constexpr UINT MAX_PARAMS = 16;
+
+    HttpParams() : pNames_(nullptr), uCount_(0) { }
+
+    //! Return the number of captured values.
+    UINT size() const { return uCount_; }
+    //! Return a captured value, in the order of the pattern.
+    std::string_view operator[](UINT uIndex) const { return values_[uIndex]; }
+    /** Return the name a captured value has in the pattern. */
+    std::string_view name(UINT uIndex) const;
+    /** Return the value captured for a name, or an empty view. */
+    std::string_view get(std::string_view name) const;
+
+private:
+    friend class HttpRouter;
+
+    const std::vector<std::string>* pNames_;
+    std::string_view values_[MAX_PARAMS];
+    UINT uCount_;
+};
+
+/**
+ *  Histogram of durations with one bucket per power of two nanoseconds.
+ *
+ *  record() may be called on several threads at once; the counters are
+ *  relaxed atomics, so a reader may see a sample in count() before it is
+ *  in its bucket.
+ */
+class DllExport HttpLatencyHistogram {
+public:
+    /** Number of buckets.  Bucket i holds durations below 2^(i+1) ns, the
+     *  last one everything longer. */
+    static constexpr UINT BUCKETS = 40;
+
+    HttpLatencyHistogram();
+
+    /** Add a duration, in nanoseconds. */
+    void record(uint64_t uNanos);
+    /** Forget every sample. */
+    void reset();
+
+    //! Return the number of samples.
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    //! Return the sum of the samples, in nanoseconds.
+    uint64_t total() const { return total_.load(std::memory_order_relaxed); }
+    //! Return the number of samples in a bucket.
+    uint64_t bucket(UINT uIndex) const { return buckets_[uIndex].load(std::memory_order_relaxed); }
+    /** Return an upper bound of a percentile, in nanoseconds: the top of
+     *  the bucket holding it.
+     *  @param dPercent Percentile from 0 to 100 */
+    uint64_t percentile(double dPercent) const;
+
+private:
+    std::atomic<uint64_t> buckets_[BUCKETS];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> total_;
+};
+
+/**
+ *  A method and path pattern registered with an HttpRouter.
+ */
+class DllExport HttpRoute {
+public:
+    //! Return the method, "*" for any.
+    const std::string& method() const { return method_; }
+    //! Return the pattern as registered.
+    const std::string& pattern() const { return pattern_; }
+    //! Return the time its handler has taken.
+    const HttpLatencyHistogram& latency() const { return latency_; }
+    HttpLatencyHistogram& latency() { return latency_; }
+
+private:
+    friend class HttpRouter;
+
+    std::string method_;
+    std::string pattern_;
+    std::vector<std::string> names_;    // Of the captures, in order
+    HttpHandler pHandler_;
+    void* pData_;
+    HttpLatencyHistogram latency_;
+};
+
+/**
+ *  Dispatches HTTP requests to handlers by method and path.
+ *
+ *  A pattern is a path in which a segment may be a parameter, ":name",
+ *  matching one non-empty segment, and the last segment may be a
+ *  wildcard, "*name", matching the rest of the path, possibly empty.
+ *  So "/users/:id/posts/:post" matches "/users/7/posts/12", capturing
+ *  id and post, and a wildcard "*path" after "/static/" matches
+ *  "/static/css/site.css", capturing "css/site.css" as path.
+ *  The patterns are compiled into a radix tree, so finding the route of a
+ *  request takes time in the length of its path, not the number of
+ *  routes, and allocates nothing.  Where patterns overlap, static text
+ *  is preferred to a parameter and a parameter to a wildcard.  Paths are
+ *  matched as received, without the query and without decoding.
+ *
+ *  A HEAD request is served by the GET route when it has none of its
+ *  own.  A path with no route gets 404, or the handler given to
+ *  setNotFound(); a path with routes for other methods only gets 405.
+ *
+ *  The time each handler takes is kept in the histogram of its route.
+ *
+ *  Routes must be added before the router is used; matching may then go
+ *  on on several threads at once.
+ *
+ *  Example:
+ *  @code
+ *      void getUser(HttpCall& rCall, void*) {
+ *          std::string_view id = rCall.params().get("id");
+ *          ...
+ *      }
+ *      HttpRouter router;
+ *      router.addRoute("GET", "/users/:id", getUser);
+ *      server.setHandler(HttpRouter::handler, &router);
+ *  @endcode
+ */
+class DllExport HttpRouter {
+public:
+    HttpRouter();
+    ~HttpRouter();
+
+    // Disable copy constructor and assignment operator
+    HttpRouter(const HttpRouter&) = delete;
+    HttpRouter& operator=(const HttpRouter&) = delete;
+
+    /** Add a route.
+     *  @param method   Method to match, or "*" for any
+     *  @param pattern  Path pattern, starting with '/'
+     *  @param pHandler Routine handling the matching requests
+     *  @param ptr      User data passed to pHandler
+     *  @return False if the pattern is invalid, has more than
+     *          HttpParams::MAX_PARAMS captures, or is already routed for
+     *          the method. */
+    bool addRoute(std::string_view method, std::string_view pattern,
+                  HttpHandler pHandler, void* ptr = nullptr);
+    /** Set the handler of requests no route matches. */
+    void setNotFound(HttpHandler pHandler, void* ptr = nullptr);
+
+    /** Find the route of a request.
+     *  @param method  Method of the request
+     *  @param path    Path of the request
+     *  @param rParams Receives the captured values
+     *  @param pAllow  If not null and the path has routes but none for the
+     *                 method, receives the methods of all the patterns
+     *                 matching the path, as for an Allow header
+     *  @return The route, or nullptr. */
+    HttpRoute* match(std::string_view method, std::string_view path,
+                     HttpParams& rParams, std::string* pAllow = nullptr) const;
+    /** Handle a request with the handler of its route. */
+    void dispatch(HttpCall& rCall);
+    /** HttpHandler dispatching to the router given as ptr, for
+     *  HttpServer::setHandler(). */
+    static void handler(HttpCall& rCall, void* ptr);
+
+    //! Return the number of routes.
+    UINT routeCount() const { return static_cast<UINT>(routes_.size()); }
+    //! Return a route, in the order they were added.
+    HttpRoute& route(UINT uIndex) { return *routes_[uIndex]; }
+    const HttpRoute& route(UINT uIndex) const { return *routes_[uIndex]; }
+    /** Write the request count and handler latencies of each route that
+     *  has been used, one line each. */
+    void writeStats(std::ostream& os) const;
+
+private:
+    struct Node;
+
+    Node* insertStatic(Node* pNode, std::string_view text);
+    const Node* find(const Node* pNode, std::string_view path, std::string_view method,
+                     HttpParams& rParams) const;
+    static void findMethods(const Node* pNode, std::string_view path,
+                            std::vector<std::string_view>& rMethods);
+    static void addMethods(const Node* pNode, std::vector<std::string_view>& rMethods);
+    static HttpRoute* methodRoute(const Node* pNode, std::string_view method);
+
+    std::unique_ptr<Node> root_;
+    std::vector<std::unique_ptr<HttpRoute> > routes_;
+    HttpHandler pNotFound_;
+    void* pNotFoundData_;
+};
+
+}  // namespace sockstr
@@ -0,0 +1,226 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+#include <sockstr/HttpParser.h>
+#include <sockstr/SocketPool.h>
+#include <sockstr/Task.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+//
+// FORWARD CLASS DECLARATIONS
+//
+class EventLoop;
+class Http2Connection;
+class HttpFileCache;
+class HttpParams;
+class HttpServerStream;
+class SocketAddr;
+
+/**
+ *  One request being handled by an HttpServer handler.
+ */
+class DllExport HttpCall {
+public:
+    explicit HttpCall(HttpServerStream& rStream);
+
+    /** Return the parsed request: method, target and headers. */
+    const HttpParser& request() const;
+    /** Return the body of the request. */
+    std::string_view body() const;
+    /** Return the connection the request came on.  On HTTP/2 it carries
+     *  other requests meanwhile and must not be read or written. */
+    HttpServerStream& stream() { return stream_; }
+    /** Return the HTTP/2 connection of the request, null on HTTP/1.x. */
+    Http2Connection* http2() const { return pHttp2_; }
+    /** Return the values captured from the path by the route of the
+     *  request; empty unless it was dispatched by an HttpRouter. */
+    const HttpParams& params() const;
+
+    /** Add a header to the response.  Call before reply(). */
+    void addHeader(std::string_view name, std::string_view value);
+    /** Send the response.  The body is copied, so it need not outlive the
+     *  call.  A handler replies once; if it does not, the server replies
+     *  500 for it.
+     *  @param uStatus     Status code
+     *  @param body        Body of the response
+     *  @param contentType Value of the Content-Type header, if any */
+    void reply(UINT uStatus, std::string_view body = std::string_view(),
+               const char* contentType = nullptr);
+    /** Send a file of a cache, or 304, 404 or 405 as
+     *  HttpServerStream::serveFile() decides.  Headers added with
+     *  addHeader() are not sent with it.
+     *  @param path Path of the file under the root of the cache */
+    void replyFile(HttpFileCache& rCache, std::string_view path);
+    //! Indicate if reply() has been called.
+    bool replied() const { return bReplied_; }
+
+    /** Get ready for the next request of the connection. */
+    void reset();
+
+private:
+    friend class HttpRouter;
+    friend class Http2Connection;
+
+    /** A request on a stream of an HTTP/2 connection, whose headers are
+     *  kept in the memory of the stream. */
+    HttpCall(HttpServerStream& rStream, Http2Connection* pHttp2, UINT uStream,
+             std::pmr::memory_resource* pMemory);
+
+    HttpServerStream& stream_;
+    Http2Connection* pHttp2_;       // Null on HTTP/1.x
+    UINT uStream_;
+    std::pmr::string headers_;      // Added with addHeader()
+    const HttpParams* pParams_;     // Set by HttpRouter::dispatch()
+    bool bReplied_;
+};
+
+//
+// TYPE DEFINITIONS
+//
+/**
+ *  @typedef HttpHandler
+ *  Routine that handles the requests of an HttpServer.
+ *  @param rCall The request and the means to reply to it
+ *  @param ptr   Pointer to user data given to setHandler()
+ */
+typedef void (*HttpHandler)(HttpCall& rCall, void* ptr);
+
+/**
+ *  Multi-threaded HTTP/1.1 and HTTP/2 server.
+ *
+ *  The server runs a number of threads, each with its own EventLoop and
+ *  its own listening socket on the same port (SO_REUSEPORT), so the
+ *  kernel spreads the connections over the threads and no lock is shared
+ *  on the path of a request.  Each connection is an HttpServerStream
+ *  served by a coroutine: requests are parsed in place from a bounded
+ *  receive buffer, handed to the handler, and the responses are written
+ *  in order, those to pipelined requests together.  Connections are kept
+ *  alive as the protocol and setMaxRequests() allow.  A client that
+ *  speaks HTTP/2 has its connection taken over by an Http2Connection,
+ *  whose requests reach the same handler.
+ *
+ *  The handler runs on the thread of the connection, so it must not
+ *  block and it may be called on several threads at once.
+ *
+ *  Example:
+ *  @code
+ *      void hello(HttpCall& rCall, void*) {
+ *          rCall.reply(200, "Hello, World!\n", "text/plain");
+ *      }
+ *      HttpServer server(4);
+ *      server.setHandler(hello);
+ *      SocketAddr saddr(8080);
+ *      server.start(saddr);
+ *      ...
+ *      server.stop();
+ *  @endcode
+ */
+class DllExport HttpServer {
+public:
+    /** Construct a server.
+     *  @param uThreads Number of event loop threads */
+    explicit HttpServer(UINT uThreads = std::thread::hardware_concurrency());
+    /** Stops the server. */
+    ~HttpServer();
+
+    // Disable copy constructor and assignment operator
+    HttpServer(const HttpServer&) = delete;
+    HttpServer& operator=(const HttpServer&) = delete;
+
+    /** Set the routine that handles every request.  Call before start(). */
+    void setHandler(HttpHandler pHandler, void* ptr = nullptr);
+    /** Set the limits on the size of requests.  The default limits those
+     *  of HttpParser, with bodies up to 1 MB. */
+    void setLimits(const HttpParser::Limits& limits) { limits_ = limits; }
+    /** Set the number of requests served on one connection, 0 for no limit. */
+    void setMaxRequests(UINT uMax) { uMaxRequests_ = uMax; }
+    /** Close connections that are idle for uMillisec, 0 never. */
+    void setIdleTimeout(UINT uMillisec) { uIdleTimeout_ = uMillisec; }
+    /** Compress responses with gzip for the clients that accept it, at a
+     *  zlib level of 1 to 9; 0, the default, for none.  See
+     *  HttpServerStream::setCompression(). */
+    void setCompression(int nLevel) { compression_ = nLevel; }
+    /** Serve HTTP/2 to the clients that ask for it, by prior knowledge or
+     *  with "Upgrade: h2c"; on by default.  See Http2Connection. */
+    void setHttp2(bool bEnable) { bHttp2_ = bEnable; }
+
+    /** Start serving on an address.
+     *  @return False if a listening socket could not be opened. */
+    bool start(SocketAddr& rSockAddr);
+    /** Close the listening sockets and the connections, and wait for the
+     *  threads to finish. */
+    void stop();
+
+    //! Return the number of threads.
+    UINT threads() const { return uThreads_; }
+    //! Return the number of connections being served.
+    std::size_t connections() const;
+    //! Return the number of requests handled, including before a stop().
+    uint64_t requests() const;
+
+private:
+    struct Connection;
+    struct Worker;
+
+    void run(Worker* pWorker);
+    Task<void> acceptor(Worker& rWorker, SocketPool<Connection>& rPool);
+    Task<void> serve(Worker& rWorker, SocketPool<Connection>::Handle pConnection);
+    static void handleHttp2(HttpCall& rCall, void* ptr);
+
+    UINT uThreads_;
+    HttpHandler pHandler_;
+    void* pData_;
+    HttpParser::Limits limits_;
+    UINT uMaxRequests_;
+    UINT uIdleTimeout_;
+    int compression_;
+    bool bHttp2_;
+
+    std::vector<std::unique_ptr<Worker> > workers_;
+    std::mutex lock_;                   //!< Guards the loops of the workers
+    std::condition_variable started_;
+    UINT uStarted_;
+    uint64_t uRequests_;                //!< Handled by the stopped threads
+};
+
+}  // namespace sockstr
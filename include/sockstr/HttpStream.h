@@ -25,8 +25,13 @@
 //
 // INCLUDE FILES
 //
+#include <sockstr/HttpBody.h>
+#include <sockstr/HttpEncoding.h>
+#include <sockstr/HttpHeaders.h>
+#include <sockstr/HttpParser.h>
 #include <sockstr/Socket.h>
-#include <map>
+#include <memory>
+#include <string_view>
 #include <vector>
 
 #include <time.h>
@@ -45,6 +50,8 @@ namespace sockstr
 //
 // FORWARD CLASS DECLARATIONS
 //
+class HttpFile;
+class HttpFileCache;
 class HttpParamEncoder;
 class HttpStatus;
 
@@ -60,9 +67,6 @@ class HttpStatus;
  * Class to handle client-side HTTP protocol over a socket connection.
  */
 class DllExport HttpStream : public Socket {
-protected:
-    typedef std::map<std::string, HttpParamEncoder*> HeaderMap;
-
 public:
     HttpStream();
     HttpStream(const char* lpszFileName, UINT uOpenFlags);
@@ -70,25 +74,127 @@ public:
 
     virtual ~HttpStream();
 
+    /** Close the connection and discard what was received of it. */
+    virtual void close();
+
+    /** Get a resource, passing its body to sink.
+     *  @return Status code of the response; 0 if there was no valid response. */
+    UINT get(const std::string& uri, HttpBodySink& sink);
+    /** Get a resource.
+     *  @param content Set to the body of the response
+     *  @param headers Set to the status line and headers of the response
+     *  @return Size of headers and content; 0 if there was no valid response. */
     UINT get(const std::string& uri, std::string& content, std::string& headers);
 
+    /** The buffer forms store as much of the body of the response as fits in
+     *  buffer, and return its size.  The rest of the body is dropped. */
     UINT get(const std::string& uri, char* buffer, UINT uCount);
+    /** @return Status code of the response; 0 if there was no valid response. */
     UINT head(const std::string& uri);
     UINT post(const std::string& uri, char* message, char* buffer, UINT uCount);
     UINT put(const std::string& uri, char* message, char* buffer, UINT uCount);
+    /** @return Status code of the response; 0 if there was no valid response. */
     UINT deleter(const std::string& uri);
-
+    /** Send a request with a body taken from source, as it is sent, and
+     *  pass the body of the response to sink.
+     *  @param method Method of the request, such as "POST"
+     *  @return Status code of the response; 0 if the request could not be
+     *          sent or there was no valid response. */
+    UINT send(const char* method, const std::string& uri,
+              HttpBodySource& source, HttpBodySink& sink);
+    /** Send a POST request with a body from source; see send(). */
+    UINT post(const std::string& uri, HttpBodySource& source, HttpBodySink& sink);
+    /** Send a PUT request with a body from source; see send(). */
+    UINT put(const std::string& uri, HttpBodySource& source, HttpBodySink& sink);
+    /** Ask the server to switch the connection to another protocol, such
+     *  as WebSocket, with a GET request.
+     *  @param headers Header lines of the request, each ending with CRLF,
+     *                 among them Connection and Upgrade
+     *  @param rest    Set, once switched, to what was received after the
+     *                 response, which belongs to the new protocol
+     *  @param pSink   Takes the body of a response that does not switch;
+     *                 null to drop it
+     *  @return Status code of the response, 101 if the protocol was
+     *          switched; 0 if there was no valid response. */
+    UINT upgrade(const std::string& uri, std::string_view headers, std::string& rest,
+                 HttpBodySink* pSink = 0);
+
+    /** Read the response to a request sent.
+     *  Interim 1xx responses are skipped.  The body, delimited by
+     *  Content-Length, chunked transfer encoding or the end of the
+     *  connection, is passed to sink as it arrives.  Bytes received after
+     *  the response are kept for the next one, so requests may be sent
+     *  ahead of their responses on a keep-alive connection.
+     *  @param bHead Set if the request was HEAD, whose response has no body
+     *  @return Status code of the response; 0 if the connection closed or
+     *          the response is invalid. */
+    UINT readResponse(HttpBodySink& sink, bool bHead = false);
+    //! Return the status line and headers of the last response.
+    const HttpParser& getResponse() const { return response_; }
+    /** Ask for gzip-compressed responses with Accept-Encoding, and
+     *  decompress their bodies on the way to the HttpBodySink.  The
+     *  headers of the response still show the body as it was sent. */
+    void acceptCompressed(bool bAccept);
+
+    /** Set a header of the requests or responses sent, replacing any
+     *  other of the same name, whatever its case. */
     void addHeader(const std::string& header, int value);
     void addHeader(const std::string& header, const std::string& value);
+    /** Set a header whose value is made by an encoder.  The stream takes
+     *  ownership of the encoder; one with a fixed value is encoded at
+     *  once and deleted. */
     void addHeader(const std::string& header, HttpParamEncoder* encoder,
                    const std::string& value = "");
+    //! Remove every header, deleting their encoders.
     void clearHeaders(void);
+    /** Append the headers, and the empty line ending them, to str.
+     *  Headers with fixed values are encoded once into a block that is
+     *  copied as a whole; only computed values, such as the Date, are
+     *  encoded for each message.  A header whose value is changed with
+     *  HttpParamEncoder::set() must be added again to be seen. */
     void expandHeaders(std::string& str);
     virtual void loadDefaultHeaders(void);
-    void parseHeaders(const char* buffer, UINT uSize, HeaderMap& headers);
+    /** Parse header lines into headers, replacing what they held. */
+    void parseHeaders(const char* buffer, UINT uSize, HttpHeaders& headers);
 
 protected:
-    HeaderMap headers_;
+    /** Send a request, with a Content-Length header if there is a body. */
+    bool sendRequest(const char* method, const std::string& uri,
+                     const char* body = 0, std::size_t uLength = 0);
+    /** Send a request with a body from source.
+     *  @return False if the request could not all be sent. */
+    bool sendRequest(const char* method, const std::string& uri, HttpBodySource& source);
+    /** Send the head of a request and a body made by a callback. */
+    bool sendProduced(const std::string& head, HttpBodySource& source, bool bChunked);
+    /** Make room in the receive buffer for a message of uNeed bytes from
+     *  recvBegin_, and for at least one more byte to be received. */
+    void makeRoom(std::size_t uNeed);
+    /** Receive more of a response.
+     *  @return Number of bytes received; 0 if the connection closed. */
+    UINT receiveMore();
+
+    /** Encode the fixed headers into headerBlock_. */
+    void compileHeaders();
+    /** Remove a header with a computed value.
+     *  @return False if there was none. */
+    bool removeComputed(std::string_view header);
+
+protected:
+    HttpHeaders headers_;           //!< Headers with fixed values
+    std::string headerBlock_;       //!< Fixed headers, encoded
+    /** Headers with computed values, as "Name: " and the encoder */
+    std::vector<std::pair<std::string, std::unique_ptr<HttpParamEncoder> > > computedHeaders_;
+    bool headerBlockValid_;         //!< Set if headerBlock_ matches headers_
+
+    std::vector<char> recvBuf_;     //!< Receive buffer
+    std::size_t recvBegin_;         //!< Start of the current message
+    std::size_t recvEnd_;           //!< End of the data received
+
+    HttpParser response_;           //!< Last response
+    std::string responseHead_;      //!< Head of the last response, that response_ refers to
+    HttpChunkDecoder chunks_;
+    HttpInflater inflater_;
+    bool decompress_;               //!< Set by acceptCompressed()
 
 protected:
     static const char* defaultHeaderFields_[];
@@ -100,6 +206,17 @@ private:
 
 /**
  * Class to handle server-side HTTP protocol over a socket connection.
+ *
+ * A connection serves requests until the client or the server ends it.
+ * request() returns 0 once the response to the last request has said
+ * "Connection: close", so a connection is served by a loop:
+ * @code
+ *     while ((sz = sock->request(buf, sizeof(buf), funct, url)) > 0)
+ *         sock->response(body, len, "application/json");
+ * @endcode
+ * Requests that a client sends without waiting for the responses
+ * (pipelining) are answered in order; their responses are held back and
+ * written together once no further request has been received.
  */
 class DllExport HttpServerStream : public HttpStream {
 public:
@@ -110,6 +227,8 @@ public:
     virtual ~HttpServerStream();
 
 	virtual Stream* listen(const int nBacklog = 4);
+    /** Close the connection and discard what was received of it. */
+    virtual void close();
     virtual void loadDefaultHeaders(void);
 
     enum HttpFunction
@@ -125,23 +244,290 @@ public:
 
     static const char* functionName(HttpFunction function);
 
-    HeaderMap getRequestHeaders() const;
+    /** Return the headers of the last request.  They stay valid until
+     *  the next request is read; HttpParser::header() on getParser()
+     *  finds one without copying them. */
+    const HttpHeaders& getRequestHeaders() const;
 
     UINT response(const char* buffer, UINT uCount, 
                   const char* contentType = 0, UINT statusCode = 200);
+    /** Read the next request.
+     *  The request is read into a receive buffer of the stream, across as
+     *  many reads as it takes, until the head and a body delimited by
+     *  Content-Length, or a chunked one, are complete.  The request, as much of it as fits,
+     *  is then copied to buffer.  The parsed request is available from
+     *  getParser() and its body from requestBody().  Bytes received after
+     *  the request are kept for the next call.  Responses held back are
+     *  written before waiting for more of the request.
+     *  @return Size of the request copied to buffer; 0 if the connection
+     *          closed, is to be closed (see keepAlive()) or the request is
+     *          invalid, in which case errorStatus() is the status to
+     *          reply with. */
     UINT request(char* buffer, UINT uCount,
                  HttpFunction& funct, std::string& url);
 
+    /** Awaitable form of request() for use on an EventLoop. */
+    Task<UINT> async_request(char* buffer, UINT uCount,
+                             HttpFunction& funct, std::string& url);
+    /** Awaitable form of response() for use on an EventLoop. */
+    Task<UINT> async_response(const char* buffer, UINT uCount,
+                              const char* contentType = 0, UINT statusCode = 200);
+
+    /** Read the next request, as request() does, but leave it in the
+     *  receive buffer instead of copying it; see getParser() and
+     *  requestBody().
+     *  @return True when a request is complete; false if the connection
+     *          closed, is to be closed or the request is invalid. */
+    bool receive();
+    /** Awaitable form of receive() for use on an EventLoop. */
+    Task<bool> async_receive();
+    /** Queue a whole response, body included, behind those held back.
+     *  It is written before the next request is waited for, or by
+     *  flushResponses().
+     *  @param headers Further header lines, each ending with CRLF */
+    void appendResponse(std::string_view body, const char* contentType = 0,
+                        UINT statusCode = 200, std::string_view headers = std::string_view());
+    /** Awaitable form of flushResponses().
+     *  @return False if the responses could not all be written. */
+    Task<bool> async_flushResponses();
+
+    /** Start a response whose body is written in pieces as it is made,
+     *  with writeChunk(), and ended with endResponse().  The body is sent
+     *  with chunked transfer coding, so its length need not be known; to
+     *  an HTTP/1.0 client it is sent as is and the connection closed
+     *  after it.  The head is held back until the first piece.
+     *  @param headers Further header lines, each ending with CRLF */
+    void beginResponse(const char* contentType = 0, UINT statusCode = 200,
+                       std::string_view headers = std::string_view());
+    /** Write the next piece of a body started with beginResponse(),
+     *  together with whatever is held back, in one vectored write.  An
+     *  empty piece writes only what is held back, such as the head.
+     *  @return False if the connection failed. */
+    bool writeChunk(std::string_view data);
+    /** Awaitable form of writeChunk().  data must stay valid until it
+     *  completes. */
+    Task<bool> async_writeChunk(std::string_view data);
+    /** End a body started with beginResponse().
+     *  @param trailers Trailer lines, each ending with CRLF
+     *  @return False if the connection failed. */
+    bool endResponse(std::string_view trailers = std::string_view());
+    /** Awaitable form of endResponse(). */
+    Task<bool> async_endResponse(std::string_view trailers = std::string_view());
+    //! Indicate if a response started with beginResponse() is not ended.
+    bool streaming() const { return streaming_; }
+    /** Queue the response to a GET or HEAD request for a file: 304 with
+     *  no body if the request's If-None-Match or If-Modified-Since shows
+     *  the client has this version, else 200 with the file.  The body of
+     *  a large file is sent from its descriptor with sendfile(2) when the
+     *  responses are written, and the file is held until then.
+     *  @param pFile File from an HttpFileCache */
+    void appendFile(std::shared_ptr<const HttpFile> pFile);
+    /** Answer the current request with a file of a cache, or with 404, or
+     *  405 if the method is not GET or HEAD.
+     *  @param path Path of the file under the root of the cache */
+    void serveFile(HttpFileCache& rCache, std::string_view path);
+    /** Indicate if the conditions of the current request show that the
+     *  client has this version of a file. */
+    bool notModified(const HttpFile& rFile) const { return notModified(parser_, rFile); }
+    /** Indicate if the conditions of a request show that the client has
+     *  this version of a file. */
+    static bool notModified(const HttpParser& request, const HttpFile& rFile);
+
+    /** Compress response bodies with gzip for clients that accept it.
+     *  Only bodies of a type that compresses (see HttpEncoding), of some
+     *  size and without a Content-Encoding of their own are compressed.
+     *  The gzip variants of files are sent regardless.
+     *  @param nLevel zlib level: 1 (fastest) to 9 (smallest), 0 for none,
+     *                which is the default */
+    void setCompression(int nLevel) { compression_ = nLevel; }
+    //! Return the level of compression of response bodies, 0 for none.
+    int getCompression() const { return compression_; }
+    //! Indicate if the current request accepts gzip-compressed bodies.
+    bool acceptsGzip() const;
+
+    //! Return the parser holding the method, URI and headers of the last request.
+    const HttpParser& getParser() const { return parser_; }
+    /** Return the body of the last request, valid until the next request
+     *  is read.  A chunked body is returned de-chunked. */
+    std::string_view requestBody() const;
+    /** Return the HTTP status to reject the last request with, such as 400
+     *  or 413, when it could not be read; 0 if there was no error. */
+    UINT errorStatus() const;
+
+    /** Stream request bodies larger than uBuffered bytes, and chunked ones,
+     *  rather than reading them whole: receive() returns once the head is
+     *  in, and the body is then read with readBody() through the receive
+     *  buffer, as fast as it is consumed.  Limits::uMaxBody still bounds
+     *  Content-Length.  A chunked body that is not streamed is de-chunked
+     *  into the receive buffer, up to Limits::uMaxBody.  A streamed body that is not read is skipped before
+     *  the next request, or the connection is closed if it is large.
+     *  By default bodies are not streamed. */
+    void setBodyStreaming(uint64_t uBuffered) { uStreamAbove_ = uBuffered; }
+    //! Indicate if the body of the current request is streamed.
+    bool bodyStreamed() const { return bodyStreamed_; }
+    /** Read the next piece of the body of the current request, streamed
+     *  or not.  A client that sent "Expect: 100-continue" is told to go
+     *  on first.
+     *  @param piece Set to the piece, valid until the next call; empty at
+     *               the end of the body
+     *  @return False if the connection failed or the body is malformed. */
+    bool readBody(std::string_view& piece);
+    /** Awaitable form of readBody(). */
+    Task<bool> async_readBody(std::string_view& piece);
+    /** Pass the rest of the body of the current request to sink.
+     *  @return False if the connection or the sink failed, or the body is
+     *          malformed. */
+    bool readBody(HttpBodySink& sink);
+    /** Awaitable form of readBody(HttpBodySink&). */
+    Task<bool> async_readBody(HttpBodySink& sink);
+    //! Set the limits on the size of requests.
+    void setLimits(const HttpParser::Limits& limits) { parser_.setLimits(limits); }
+
+    /** Limit the number of requests served on one connection; the response
+     *  to the last one closes the connection.  0 means no limit; the
+     *  default is 1000. */
+    void setMaxRequests(UINT uMax) { maxRequests_ = uMax; }
+    //! Return the number of requests served on one connection (0 = no limit).
+    UINT getMaxRequests() const { return maxRequests_; }
+    //! Return the number of requests read on this connection.
+    UINT requestCount() const { return requestCount_; }
+    /** Indicate if the connection stays open after the response to the
+     *  last request, as the request, its HTTP version and setMaxRequests()
+     *  allow. */
+    bool keepAlive() const { return !closeAfter_; }
+    //! Close the connection after the next response, which says so.
+    void closeAfterResponse() { closeAfter_ = true; }
+    /** Write the responses held back for pipelined requests.  This is done
+     *  by request() and close(), so it is only needed to get them out
+     *  sooner.
+     *  @return False if the responses could not all be written. */
+    bool flushResponses();
+    /** Answer the current request with "101 Switching Protocols" and hand
+     *  the connection over to another protocol: no further request is
+     *  read.  Responses held back are written first.
+     *  @param headers Header lines of the response, each ending with CRLF,
+     *                 among them Connection and Upgrade
+     *  @param rest    Set to what was received after the request, which
+     *                 belongs to the new protocol
+     *  @return False if the response could not be written. */
+    bool upgrade(std::string_view headers, std::string& rest);
+    /** Awaitable form of upgrade(). */
+    Task<bool> async_upgrade(std::string_view headers, std::string& rest);
+    /** Hand the connection over to another protocol without a response,
+     *  as when a client starts with the HTTP/2 preface: no further request
+     *  is read.
+     *  @param rest Set to what was received and not taken as a request */
+    void handOver(std::string& rest);
+    /** Indicate if the last request failed because it is the preface of
+     *  HTTP/2 with prior knowledge; see handOver(). */
+    bool http2Preface() const;
+
 protected:
-    std::vector<std::string>& split(const std::string &s, char delim,
-                                    std::vector<std::string> &elems);
-    std::vector<std::string>  split(const std::string &s, char delim);
+    /** Discard the previous request and get ready for the next one. */
+    void beginRequest();
+    /** Parse what has been received of the next request.
+     *  @return 1 when the request is complete, 0 when more data is needed
+     *          (with room for it made in the receive buffer), -1 if the
+     *          request is invalid. */
+    int receiveStep();
+    /** De-chunk what has been received of a chunked body in the receive
+     *  buffer.
+     *  @return 1 when the body is complete, 0 when more data is needed,
+     *          -1 if it is invalid or too large; see errorStatus(). */
+    int chunkStep();
+    /** Queue the 101 response of upgrade() and take the rest of the
+     *  receive buffer. */
+    void queueUpgrade(std::string_view headers, std::string& rest);
+    /** Count a complete request and decide whether the connection
+     *  stays open after it. */
+    void completeRequest();
+    /** Hand a complete request to the caller of request(). */
+    UINT finishRequest(char* buffer, UINT uCount,
+                       HttpFunction& funct, std::string& url);
+    /** Append the status line and headers of a response to httpres.
+     *  @param uCount    Length of the body, or STREAMED if it is not known
+     *  @param headers   Further header lines, each ending with CRLF
+     *  @param pEncoding Content-Encoding and Vary lines from encodeBody() */
+    void prepareResponse(std::string& httpres, uint64_t uCount,
+                         const char* contentType, UINT statusCode,
+                         std::string_view headers = std::string_view(),
+                         const char* pEncoding = 0);
+    /** Queue a response behind those held back.  A small or compressed
+     *  body is queued with it; otherwise buffer is left for the caller to
+     *  write.
+     *  @return True if the queue must be written now. */
+    bool queueResponse(const char*& buffer, UINT& uCount,
+                       const char* contentType, UINT statusCode);
+    /** Compress a response body if setCompression(), the client and the
+     *  content allow it.
+     *  @param pEncoding Set to the header lines to send with the body, or 0
+     *  @return The body to send; a compressed body is valid until the
+     *          next one is compressed on this thread. */
+    std::string_view encodeBody(std::string_view body, const char* contentType,
+                                std::string_view headers, const char*& pEncoding);
+    /** Fill in the buffers that write what is held back and a piece of a
+     *  streamed body.
+     *  @param sizeLine Room for the chunk size line
+     *  @return Number of buffers used */
+    int chunkVector(std::string_view data, char (&sizeLine)[24], struct iovec* pVec);
+    /** Finish a streamed body: queue the last chunk and the trailers.
+     *  @return True if the queue must be written now. */
+    bool queueEndOfStream(std::string_view trailers);
+    /** Keep the head of a request whose body is streamed apart, and get
+     *  ready to read the body. */
+    void startBody();
+    /** Take the next piece of the body from the receive buffer.
+     *  @return 1 with a piece, empty at the end; 0 when more data is
+     *          needed (with room made for it); -1 if the body is invalid. */
+    int bodyStep(std::string_view& piece);
+    //! Indicate if the client waits for "100 Continue" before the body.
+    bool expectsContinue() const;
+    /** Read and drop the rest of a streamed body, up to a limit.
+     *  @return False if the connection is to be closed instead. */
+    bool skipBody();
+    /** Awaitable form of skipBody(). */
+    Task<bool> async_skipBody();
+    //! Indicate if another request has been received, at least in part.
+    bool pipelined() const;
+    //! Indicate if the current request is HEAD, whose response has no body.
+    bool headRequest() const;
 
 
 protected:
+    /** Length given to prepareResponse() for a body sent in pieces */
+    static constexpr uint64_t STREAMED = UINT64_MAX;
+
     HttpStatus& status_;
-    /** Request headers */
-    HeaderMap reqHeaders_;
+    /** Request headers, filled in when getRequestHeaders() is called */
+    mutable HttpHeaders reqHeaders_;
+    mutable bool reqHeadersValid_;
+
+    HttpParser parser_;
+    std::size_t requestSize_;       //!< Size of the current request once complete
+    std::string requestHead_;       //!< Head of a request whose body is streamed
+    uint64_t uStreamAbove_;         //!< Larger bodies are streamed
+    uint64_t bodyRemaining_;        //!< Of a streamed body with a Content-Length
+    bool bodyStreamed_;             //!< The current request's body is streamed
+    bool bodyDone_;                 //!< readBody() has reached its end
+    bool continueSent_;             //!< "100 Continue" sent, or not needed
+    UINT bodyReads_;                //!< Buffers of streamed bodies read
+    std::size_t chunkScan_;         //!< Received bytes of a chunked body decoded, 0 before
+    std::size_t chunkBody_;         //!< End of its payload, moved down behind the head
+    UINT bodyError_;                //!< Status for a body that could not be read
+
+    std::string sendBuf_;           //!< Responses held back
+    /** A file body to send after the first uAt bytes of sendBuf_ */
+    struct PendingFile {
+        std::size_t uAt;
+        std::shared_ptr<const HttpFile> pFile;
+    };
+    std::vector<PendingFile> sendFiles_;
+    UINT requestCount_;             //!< Requests read on this connection
+    UINT maxRequests_;
+    int compression_;               //!< zlib level of response bodies, 0 for none
+    bool streaming_;                //!< Between beginResponse() and endResponse()
+    bool chunked_;                  //!< The streamed body is sent in chunks
+    bool closeAfter_;               //!< Close after the response to this request
 
 protected:
     static const char* defaultSrvHeaderFields_[];
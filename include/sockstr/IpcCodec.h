@@ -0,0 +1,671 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+//
+// File       : IpcCodec.h
+//
+// Class      : IpcCodec, IpcView, IpcWireHeader
+//
+// Description: Compact, byte order independent wire form of IPC messages.
+//
+//              A message sent with Stream::remoteProcedure goes out as the
+//              raw struct: host byte order, host sizes of WORD and DWORD,
+//              and every char array in full.  IpcCodec encodes the fields
+//              listed with IPC_FIELDS instead:
+//
+//                frame   := length function sequence [return] field*
+//                length  := 4 byte little endian size of the whole frame
+//                function, sequence := varint
+//                return  := zigzag varint, replies only
+//
+//              Fields are encoded by type:
+//                unsigned integer      varint (LEB128)
+//                signed integer        zigzag varint
+//                bool, 1 byte integer  1 byte
+//                float, double         IEEE 754, little endian
+//                enum                  as its underlying type
+//                char[N]               varint length + bytes up to the NUL
+//                other arrays          varint count + elements, without
+//                                      the trailing zero elements
+//
+//              Decoding checks every length and range, so a frame from an
+//              untrusted peer cannot overrun the message or the buffer.
+//
+
+//
+// INCLUDE FILES
+//
+#include <sockstr/sstypes.h>
+#include <sockstr/IPC.h>
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+/**
+ *  List the fields of an IPC message that IpcCodec encodes, in wire order.
+ *  Use it right after the message, in the same namespace:
+ *  @code
+ *      IPC_MESSAGE(ConnectTo)
+ *          DWORD dwIdentity_;
+ *          char  szName_[24];
+ *      IPC_ENDMESSAGE
+ *      IPC_FIELDS(ConnectTo, dwIdentity_, szName_)
+ *  @endcode
+ *  The header fields of IpcStruct and IpcReplyStruct are always encoded
+ *  and must not be listed.  Up to 81 fields are supported.
+ */
+#define IPC_FIELDS(MSGNAME, ...)                                        \
+    inline constexpr auto ipcFields(const MSGNAME*) {                   \
+        return std::make_tuple(IPC_FIELD_LIST_(MSGNAME __VA_OPT__(, __VA_ARGS__))); \
+    }
+
+#define IPC_FIELD_LIST_(MSGNAME, ...) \
+    __VA_OPT__(IPC_EXPAND_(IPC_FIELD_ONE_(MSGNAME, __VA_ARGS__)))
+#define IPC_FIELD_ONE_(MSGNAME, FIELD, ...) \
+    &MSGNAME::FIELD __VA_OPT__(, IPC_FIELD_AGAIN_ IPC_PARENS_ (MSGNAME, __VA_ARGS__))
+#define IPC_FIELD_AGAIN_() IPC_FIELD_ONE_
+#define IPC_PARENS_ ()
+#define IPC_EXPAND_(...)  IPC_EXPAND3_(IPC_EXPAND3_(IPC_EXPAND3_(__VA_ARGS__)))
+#define IPC_EXPAND3_(...) IPC_EXPAND2_(IPC_EXPAND2_(IPC_EXPAND2_(__VA_ARGS__)))
+#define IPC_EXPAND2_(...) IPC_EXPAND1_(IPC_EXPAND1_(IPC_EXPAND1_(__VA_ARGS__)))
+#define IPC_EXPAND1_(...) IPC_EXPAND0_(IPC_EXPAND0_(IPC_EXPAND0_(__VA_ARGS__)))
+#define IPC_EXPAND0_(...) __VA_ARGS__
+
+
+namespace detail {
+
+template <typename F> inline constexpr bool ipcUnsupported = false;
+
+//! Bounds checked writer of the wire form
+class IpcWriter {
+public:
+    IpcWriter(char* pBuffer, std::size_t uSize)
+        : p_(reinterpret_cast<unsigned char*>(pBuffer)), end_(p_ + uSize), ok_(true) { }
+
+    bool ok() const { return ok_; }
+    unsigned char* position() const { return p_; }
+
+    void byte(unsigned char uByte) {
+        if (p_ == end_) {
+            ok_ = false;
+            return;
+        }
+        *p_++ = uByte;
+    }
+    void varint(std::uint64_t uValue) {
+        while (uValue >= 0x80) {
+            byte(static_cast<unsigned char>(uValue | 0x80));
+            uValue >>= 7;
+        }
+        byte(static_cast<unsigned char>(uValue));
+    }
+    void fixed(std::uint64_t uValue, std::size_t uBytes) {
+        for (std::size_t idx = 0; idx < uBytes; idx++, uValue >>= 8) {
+            byte(static_cast<unsigned char>(uValue));
+        }
+    }
+    void bytes(const void* pData, std::size_t uSize) {
+        if (std::size_t(end_ - p_) < uSize) {
+            ok_ = false;
+            return;
+        }
+        std::memcpy(p_, pData, uSize);
+        p_ += uSize;
+    }
+
+private:
+    unsigned char* p_;
+    unsigned char* end_;
+    bool ok_;
+};
+
+//! Bounds checked reader of the wire form
+class IpcReader {
+public:
+    IpcReader(const void* pData, std::size_t uSize)
+        : p_(static_cast<const unsigned char*>(pData)), end_(p_ + uSize) { }
+
+    const unsigned char* position() const { return p_; }
+
+    bool byte(unsigned char& rByte) {
+        if (p_ == end_) {
+            return false;
+        }
+        rByte = *p_++;
+        return true;
+    }
+    bool varint(std::uint64_t& rValue) {
+        std::uint64_t uValue = 0;
+        for (unsigned shift = 0; shift < 64 && p_ != end_; shift += 7) {
+            unsigned char uByte = *p_++;
+            uValue |= std::uint64_t(uByte & 0x7f) << shift;
+            if (!(uByte & 0x80)) {
+                rValue = uValue;
+                return true;
+            }
+        }
+        return false;
+    }
+    bool fixed(std::uint64_t& rValue, std::size_t uBytes) {
+        if (std::size_t(end_ - p_) < uBytes) {
+            return false;
+        }
+        rValue = 0;
+        for (std::size_t idx = 0; idx < uBytes; idx++) {
+            rValue |= std::uint64_t(*p_++) << (8 * idx);
+        }
+        return true;
+    }
+    const unsigned char* bytes(std::size_t uSize) {
+        if (std::size_t(end_ - p_) < uSize) {
+            return nullptr;
+        }
+        const unsigned char* pBytes = p_;
+        p_ += uSize;
+        return pBytes;
+    }
+
+private:
+    const unsigned char* p_;
+    const unsigned char* end_;
+};
+
+template <typename F>
+constexpr bool ipcIsByte() {
+    return std::is_same_v<F, bool> || (std::is_integral_v<F> && sizeof(F) == 1);
+}
+
+constexpr std::size_t ipcVarintSize(std::uint64_t uValue) {
+    std::size_t uSize = 1;
+    for (; uValue >= 0x80; uValue >>= 7) {
+        uSize++;
+    }
+    return uSize;
+}
+
+//! Largest encoded size of a field of type F
+template <typename F>
+constexpr std::size_t ipcMaxSize() {
+    if constexpr (std::is_array_v<F>) {
+        return ipcVarintSize(std::extent_v<F>)
+             + std::extent_v<F> * ipcMaxSize<std::remove_extent_t<F>>();
+    } else if constexpr (std::is_enum_v<F>) {
+        return ipcMaxSize<std::underlying_type_t<F>>();
+    } else if constexpr (ipcIsByte<F>()) {
+        return 1;
+    } else if constexpr (std::is_floating_point_v<F>) {
+        return sizeof(F);
+    } else if constexpr (std::is_integral_v<F>) {
+        return (sizeof(F) * 8 + 6) / 7;
+    } else {
+        static_assert(ipcUnsupported<F>, "IPC field type cannot be encoded");
+        return 0;
+    }
+}
+
+template <typename F>
+bool ipcIsZero(const F& rValue) {
+    if constexpr (std::is_array_v<F>) {
+        for (const auto& rElement : rValue) {
+            if (!ipcIsZero(rElement)) {
+                return false;
+            }
+        }
+        return true;
+    } else {
+        return rValue == F{};
+    }
+}
+
+//! Number of elements of an array that go on the wire
+template <typename E, std::size_t N>
+std::size_t ipcUsedLength(const E (&rArray)[N]) {
+    if constexpr (std::is_same_v<E, char>) {
+        return ::strnlen(rArray, N);
+    } else {
+        std::size_t uCount = N;
+        while (uCount > 0 && ipcIsZero(rArray[uCount - 1])) {
+            --uCount;
+        }
+        return uCount;
+    }
+}
+
+template <typename F>
+void ipcEncode(IpcWriter& rWriter, const F& rValue) {
+    if constexpr (std::is_array_v<F>) {
+        using E = std::remove_extent_t<F>;
+        std::size_t uCount = ipcUsedLength(rValue);
+        rWriter.varint(uCount);
+        if constexpr (ipcIsByte<E>() && !std::is_same_v<E, bool>) {
+            rWriter.bytes(rValue, uCount);
+        } else {
+            for (std::size_t idx = 0; idx < uCount; idx++) {
+                ipcEncode(rWriter, rValue[idx]);
+            }
+        }
+    } else if constexpr (std::is_enum_v<F>) {
+        ipcEncode(rWriter, static_cast<std::underlying_type_t<F>>(rValue));
+    } else if constexpr (ipcIsByte<F>()) {
+        rWriter.byte(static_cast<unsigned char>(rValue));
+    } else if constexpr (std::is_same_v<F, float>) {
+        rWriter.fixed(std::bit_cast<std::uint32_t>(rValue), 4);
+    } else if constexpr (std::is_same_v<F, double>) {
+        rWriter.fixed(std::bit_cast<std::uint64_t>(rValue), 8);
+    } else if constexpr (std::is_signed_v<F>) {
+        std::int64_t iValue = rValue;
+        rWriter.varint((std::uint64_t(iValue) << 1) ^ std::uint64_t(iValue >> 63));
+    } else {
+        static_assert(std::is_unsigned_v<F>, "IPC field type cannot be encoded");
+        rWriter.varint(rValue);
+    }
+}
+
+template <typename F>
+bool ipcDecode(IpcReader& rReader, F& rValue);
+
+//! Decode an array, zero filling the elements that were not sent
+template <typename E>
+bool ipcDecodeArray(IpcReader& rReader, E* pArray, std::size_t uLength) {
+    std::uint64_t uCount;
+    if (!rReader.varint(uCount) || uCount > uLength) {
+        return false;
+    }
+    if constexpr (ipcIsByte<E>() && !std::is_same_v<E, bool>) {
+        const unsigned char* pBytes = rReader.bytes(uCount);
+        if (pBytes == nullptr) {
+            return false;
+        }
+        std::memcpy(pArray, pBytes, uCount);
+    } else {
+        for (std::size_t idx = 0; idx < uCount; idx++) {
+            if (!ipcDecode(rReader, pArray[idx])) {
+                return false;
+            }
+        }
+    }
+    for (std::size_t idx = uCount; idx < uLength; idx++) {
+        pArray[idx] = E{};
+    }
+    return true;
+}
+
+template <typename F>
+bool ipcDecode(IpcReader& rReader, F& rValue) {
+    if constexpr (std::is_array_v<F>) {
+        return ipcDecodeArray(rReader, rValue, std::extent_v<F>);
+    } else if constexpr (std::is_enum_v<F>) {
+        std::underlying_type_t<F> value;
+        if (!ipcDecode(rReader, value)) {
+            return false;
+        }
+        rValue = static_cast<F>(value);
+        return true;
+    } else if constexpr (ipcIsByte<F>()) {
+        unsigned char uByte;
+        if (!rReader.byte(uByte)) {
+            return false;
+        }
+        if constexpr (std::is_same_v<F, bool>) {
+            rValue = uByte != 0;
+        } else {
+            rValue = static_cast<F>(uByte);
+        }
+        return true;
+    } else if constexpr (std::is_floating_point_v<F>) {
+        std::uint64_t uBits;
+        if (!rReader.fixed(uBits, sizeof(F))) {
+            return false;
+        }
+        if constexpr (sizeof(F) == 4) {
+            rValue = std::bit_cast<F>(static_cast<std::uint32_t>(uBits));
+        } else {
+            rValue = std::bit_cast<F>(uBits);
+        }
+        return true;
+    } else if constexpr (std::is_signed_v<F>) {
+        std::uint64_t uValue;
+        if (!rReader.varint(uValue)) {
+            return false;
+        }
+        std::int64_t iValue = static_cast<std::int64_t>(uValue >> 1) ^ -static_cast<std::int64_t>(uValue & 1);
+        if (iValue < std::numeric_limits<F>::min() || iValue > std::numeric_limits<F>::max()) {
+            return false;
+        }
+        rValue = static_cast<F>(iValue);
+        return true;
+    } else {
+        std::uint64_t uValue;
+        if (!rReader.varint(uValue) || uValue > std::numeric_limits<F>::max()) {
+            return false;
+        }
+        rValue = static_cast<F>(uValue);
+        return true;
+    }
+}
+
+//! Step over a field, checking it as thoroughly as ipcDecode would
+template <typename F>
+bool ipcSkip(IpcReader& rReader) {
+    if constexpr (std::is_array_v<F> && ipcIsByte<std::remove_extent_t<F>>()
+                  && !std::is_same_v<std::remove_extent_t<F>, bool>) {
+        std::uint64_t uCount;
+        return rReader.varint(uCount) && uCount <= std::extent_v<F>
+            && rReader.bytes(uCount) != nullptr;
+    } else {
+        F value;
+        return ipcDecode(rReader, value);
+    }
+}
+
+//! Type of the field a member pointer points to
+template <typename M> struct IpcMember;
+template <typename C, typename F> struct IpcMember<F C::*> { using type = F; };
+template <typename M> struct IpcMember<const M> : IpcMember<M> { };
+
+template <typename T>
+constexpr auto ipcFieldsOf() {
+    return ipcFields(static_cast<const T*>(nullptr));
+}
+
+//! Position of Member in the IPC_FIELDS list of T
+template <typename T, auto Member, std::size_t I = 0>
+constexpr std::size_t ipcFieldIndex() {
+    constexpr auto fields = ipcFieldsOf<T>();
+    using Fields = std::remove_cv_t<decltype(fields)>;
+    static_assert(I < std::tuple_size_v<Fields>, "member is not listed in IPC_FIELDS");
+    if constexpr (std::is_same_v<std::tuple_element_t<I, Fields>, decltype(Member)>) {
+        if constexpr (std::get<I>(fields) == Member) {
+            return I;
+        } else {
+            return ipcFieldIndex<T, Member, I + 1>();
+        }
+    } else {
+        return ipcFieldIndex<T, Member, I + 1>();
+    }
+}
+
+}  // namespace detail
+
+
+/**
+ *  Header of an encoded IPC frame.
+ */
+class DllExport IpcWireHeader {
+public:
+    /** Size of the length prefix that starts every frame. */
+    static constexpr std::size_t prefixSize = 4;
+
+    /** Return the size of the frame starting at pData, or 0 if fewer than
+     *  prefixSize bytes are available.  Use this to split a stream. */
+    static UINT frameLength(const char* pData, std::size_t uSize) {
+        std::uint64_t uLength;
+        detail::IpcReader reader(pData, uSize);
+        return reader.fixed(uLength, prefixSize) ? static_cast<UINT>(uLength) : 0;
+    }
+
+    /** Parse the header of a complete frame.
+     *  @return false if the frame is truncated or malformed. */
+    bool parse(const char* pData, std::size_t uSize) {
+        detail::IpcReader reader(pData, uSize);
+        std::uint64_t uLength, uFunction, uSequence;
+        if (!reader.fixed(uLength, prefixSize) || uLength > uSize
+            || !reader.varint(uFunction) || uFunction > 0xffffffffu
+            || !reader.varint(uSequence) || uSequence > 0xffffffffu) {
+            return false;
+        }
+        uLength_ = static_cast<UINT>(uLength);
+        uFunction_ = static_cast<UINT>(uFunction);
+        uSequence_ = static_cast<UINT>(uSequence);
+        uOffset_ = static_cast<UINT>(reader.position() - reinterpret_cast<const unsigned char*>(pData));
+        return uOffset_ <= uLength_;
+    }
+
+    UINT uLength_;      //!< Size of the whole frame
+    UINT uFunction_;    //!< IpcStruct::wFunction_
+    UINT uSequence_;    //!< IpcStruct::dwSequence_
+    UINT uOffset_;      //!< Where the body starts
+};
+
+
+/**
+ *  Encoder and decoder of the IPC message T, whose fields are listed with
+ *  IPC_FIELDS.
+ *
+ *  Example:
+ *  @code
+ *      std::vector<char> wire;
+ *      IpcCodec<ConnectTo>::encode(request, wire);
+ *      socket.write(wire.data(), wire.size());
+ *      ...
+ *      ConnectTo received;
+ *      if (IpcCodec<ConnectTo>::decode(pFrame, uSize, received)) ...
+ *  @endcode
+ */
+template <typename T>
+class IpcCodec {
+    static_assert(std::is_base_of_v<IpcStruct, T>, "IpcCodec needs an IPC_MESSAGE or IPC_REPLY");
+
+    static constexpr bool isReply_ = std::is_base_of_v<IpcReplyStruct, T>;
+    static constexpr auto fields_ = detail::ipcFieldsOf<T>();
+
+    template <std::size_t... I>
+    static constexpr std::size_t maxFieldsSize(std::index_sequence<I...>) {
+        return (std::size_t(0) + ... + detail::ipcMaxSize<typename detail::IpcMember<
+                    std::tuple_element_t<I, std::remove_cv_t<decltype(fields_)>>>::type>());
+    }
+
+public:
+    /** Number of fields listed with IPC_FIELDS. */
+    static constexpr std::size_t fieldCount = std::tuple_size_v<std::remove_cv_t<decltype(fields_)>>;
+    /** Largest possible size of an encoded T. */
+    static constexpr std::size_t maxSize = IpcWireHeader::prefixSize + 5 + 5 + (isReply_ ? 5 : 0)
+        + maxFieldsSize(std::make_index_sequence<fieldCount>());
+
+    /** Encode a message into a buffer.
+     *  @return the size of the frame, or 0 if it does not fit in uSize. */
+    static std::size_t encode(const T& rMessage, char* pBuffer, std::size_t uSize) {
+        detail::IpcWriter writer(pBuffer, uSize);
+        writer.fixed(0, IpcWireHeader::prefixSize);
+        writer.varint(static_cast<UINT>(rMessage.wFunction_));
+        writer.varint(static_cast<UINT>(rMessage.dwSequence_));
+        if constexpr (isReply_) {
+            detail::ipcEncode(writer, rMessage.dwReturn_);
+        }
+        std::apply([&](auto... members) { (detail::ipcEncode(writer, rMessage.*members), ...); },
+                   fields_);
+        if (!writer.ok()) {
+            return 0;
+        }
+        std::size_t uLength = writer.position() - reinterpret_cast<unsigned char*>(pBuffer);
+        detail::IpcWriter prefix(pBuffer, IpcWireHeader::prefixSize);
+        prefix.fixed(uLength, IpcWireHeader::prefixSize);
+        return uLength;
+    }
+
+    /** Append the encoded message to rBuffer.
+     *  @return the size of the frame. */
+    static std::size_t encode(const T& rMessage, std::vector<char>& rBuffer) {
+        std::size_t uStart = rBuffer.size();
+        rBuffer.resize(uStart + maxSize);
+        std::size_t uLength = encode(rMessage, rBuffer.data() + uStart, maxSize);
+        rBuffer.resize(uStart + uLength);
+        return uLength;
+    }
+
+    /** Decode a frame into rMessage.  Arrays are zero filled past the
+     *  elements that were sent.
+     *  @return false if the frame is not a valid T. */
+    static bool decode(const char* pData, std::size_t uSize, T& rMessage) {
+        IpcWireHeader header;
+        if (!header.parse(pData, uSize)
+            || header.uFunction_ != static_cast<UINT>(rMessage.wFunction_)) {
+            return false;
+        }
+        detail::IpcReader reader(pData + header.uOffset_, header.uLength_ - header.uOffset_);
+        rMessage.dwSequence_ = static_cast<DWORD>(header.uSequence_);
+        if constexpr (isReply_) {
+            if (!detail::ipcDecode(reader, rMessage.dwReturn_)) {
+                return false;
+            }
+        }
+        return std::apply([&](auto... members) {
+                              return (detail::ipcDecode(reader, rMessage.*members) && ...);
+                          }, fields_);
+    }
+};
+
+
+/**
+ *  Read-only view of an encoded T, in place in the receive buffer.
+ *
+ *  The constructor checks the whole frame and notes where each field
+ *  starts; get() then decodes just the field asked for.  Text fields are
+ *  returned as a string_view and unsigned char arrays as a span into the
+ *  buffer, so nothing is copied.  The view is valid as long as the buffer.
+ *
+ *  Example:
+ *  @code
+ *      IpcView<ConnectTo> view(pFrame, uSize);
+ *      if (view.valid())
+ *          lookup(view.get<&ConnectTo::szName_>());
+ *  @endcode
+ */
+template <typename T>
+class IpcView {
+    static constexpr bool isReply_ = std::is_base_of_v<IpcReplyStruct, T>;
+    static constexpr auto fields_ = detail::ipcFieldsOf<T>();
+    static constexpr std::size_t fieldCount_ = std::tuple_size_v<std::remove_cv_t<decltype(fields_)>>;
+
+public:
+    IpcView(const char* pData, std::size_t uSize)
+        : pData_(pData)
+        , header_()
+        , dwReturn_(0)
+        , offsets_()
+        , valid_(false) {
+        if (!header_.parse(pData, uSize)
+            || header_.uFunction_ != static_cast<UINT>(T().wFunction_)) {
+            return;
+        }
+        detail::IpcReader reader(pData + header_.uOffset_, header_.uLength_ - header_.uOffset_);
+        if constexpr (isReply_) {
+            if (!detail::ipcDecode(reader, dwReturn_)) {
+                return;
+            }
+        }
+        valid_ = scan(reader, std::make_index_sequence<fieldCount_>());
+    }
+
+    /** Return true if the frame is a well formed T. */
+    bool valid() const { return valid_; }
+    /** Return the size of the frame. */
+    UINT size() const { return header_.uLength_; }
+    /** Return the sequence number of the message. */
+    DWORD sequence() const { return static_cast<DWORD>(header_.uSequence_); }
+    /** Return the return value of a reply. */
+    DWORD returnValue() const { return dwReturn_; }
+
+    /** Return one field, e.g. get<&ConnectTo::szName_>().  A view that is
+     *  not valid returns empty fields. */
+    template <auto Member>
+    auto get() const {
+        constexpr std::size_t I = detail::ipcFieldIndex<T, Member>();
+        using F = typename detail::IpcMember<decltype(Member)>::type;
+        detail::IpcReader reader(pData_ + offsets_[I], offsets_[I + 1] - offsets_[I]);
+        if constexpr (std::is_array_v<F>) {
+            using E = std::remove_extent_t<F>;
+            if constexpr (std::is_same_v<E, char> || std::is_same_v<E, unsigned char>) {
+                std::uint64_t uCount = 0;
+                reader.varint(uCount);
+                const E* pBytes = reinterpret_cast<const E*>(reader.position());
+                if constexpr (std::is_same_v<E, char>) {
+                    return std::string_view(pBytes, uCount);
+                } else {
+                    return std::span<const E>(pBytes, uCount);
+                }
+            } else {
+                std::array<E, std::extent_v<F>> value;
+                detail::ipcDecodeArray(reader, value.data(), value.size());
+                return value;
+            }
+        } else {
+            F value{};
+            detail::ipcDecode(reader, value);
+            return value;
+        }
+    }
+
+    /** Decode the whole message into rMessage. */
+    bool decode(T& rMessage) const {
+        return valid_ && IpcCodec<T>::decode(pData_, header_.uLength_, rMessage);
+    }
+
+private:
+    template <std::size_t... I>
+    bool scan(detail::IpcReader& rReader, std::index_sequence<I...>) {
+        const unsigned char* pBase = reinterpret_cast<const unsigned char*>(pData_);
+        auto step = [&](auto pMember, std::size_t uIndex) {
+            using F = typename detail::IpcMember<decltype(pMember)>::type;
+            offsets_[uIndex] = static_cast<UINT>(rReader.position() - pBase);
+            return detail::ipcSkip<F>(rReader);
+        };
+        if (!(step(std::get<I>(fields_), I) && ...)) {
+            return false;
+        }
+        offsets_[fieldCount_] = static_cast<UINT>(rReader.position() - pBase);
+        return true;
+    }
+
+    const char* pData_;
+    IpcWireHeader header_;
+    DWORD dwReturn_;
+    std::array<UINT, fieldCount_ + 1> offsets_;
+    bool valid_;
+};
+
+
+// Fields of the general messages of IPC.h.  GenericReply is a raw buffer
+// for any message and has no wire form of its own.
+IPC_FIELDS(EndOfData, wEndFunction_)
+IPC_FIELDS(EndOfFile)
+IPC_FIELDS(SocketResponse, wResponse_, wPort_, szServer_)
+
+}  // namespace sockstr
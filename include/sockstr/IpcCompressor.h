@@ -0,0 +1,156 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+
+#include <memory>
+#include <vector>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+//
+// FORWARD CLASS DECLARATIONS
+//
+class IpcStruct;
+
+/**
+ *  Compression of single IPC messages.
+ *
+ *  A message of at least the threshold size is sent compressed if that
+ *  makes it smaller.  A compressed message keeps its IpcStruct header,
+ *  with compressedFlag set in wFunction_ and wPacketSize_ giving the
+ *  compressed size.  The header is followed by the original wPacketSize_
+ *  (a UINT) and the compressed bytes of the rest of the message.  Every
+ *  message is compressed on its own, so messages can still be skipped or
+ *  dropped independently.
+ *
+ *  This class does the framing; a sub-class supplies the algorithm by
+ *  implementing compressBytes() and expandBytes().  The buffers for the
+ *  compressed and expanded messages are kept and reused, as should be
+ *  any state of the algorithm, so an object is meant to serve one
+ *  connection and is not thread safe.
+ *
+ *  Compression is opt-in per connection and both peers must have it on:
+ *  see Socket::setCompressor().  Applications using it must keep their
+ *  function numbers below compressedFlag.
+ */
+class DllExport IpcCompressor {
+public:
+    /** Construct a compressor.
+     *  @param uThreshold Smallest message (wPacketSize_) that is compressed */
+    explicit IpcCompressor(UINT uThreshold = defaultThreshold);
+    virtual ~IpcCompressor();
+
+    // Disable copy constructor and assignment operator
+    IpcCompressor(const IpcCompressor&) = delete;
+    IpcCompressor& operator=(const IpcCompressor&) = delete;
+
+    /** Compress a message for sending.
+     *  @return The compressed message, valid until the next call, or pFrame
+     *          itself if it is below the threshold or does not shrink. */
+    const IpcStruct* compress(const IpcStruct* pFrame);
+    /** Restore a received message.
+     *  @return The expanded message, valid until the next call, pFrame
+     *          itself if it was not compressed, or nullptr if it is corrupt
+     *          or would expand beyond the maximum size. */
+    const IpcStruct* expand(const IpcStruct* pFrame);
+    /** Indicate if a message is in compressed form. */
+    static bool isCompressed(const IpcStruct* pFrame);
+
+    /** Set the smallest message that is compressed. */
+    void setThreshold(UINT uThreshold) { threshold_ = uThreshold; }
+    //! Return the smallest message that is compressed.
+    UINT getThreshold() const { return threshold_; }
+    /** Set the largest size a received message may expand to. */
+    void setMaxExpanded(UINT uMaxExpanded) { maxExpanded_ = uMaxExpanded; }
+
+    //! Bit of IpcStruct::wFunction_ that marks a compressed message
+    static constexpr WORD compressedFlag = 0x8000;
+    //! Default smallest message that is compressed
+    static constexpr UINT defaultThreshold = 1024;
+    //! Default largest size of an expanded message
+    static constexpr UINT defaultMaxExpanded = 1024 * 1024;
+
+protected:
+    /** Compress uInput bytes into at most uOutput bytes.
+     *  @return The compressed size, or 0 if it does not fit. */
+    virtual UINT compressBytes(const char* pInput, UINT uInput,
+                               char* pOutput, UINT uOutput) = 0;
+    /** Expand uInput bytes to exactly uOutput bytes.
+     *  @return False if the data is corrupt or has a different size. */
+    virtual bool expandBytes(const char* pInput, UINT uInput,
+                             char* pOutput, UINT uOutput) = 0;
+
+private:
+    std::vector<char> compressed_;
+    std::vector<char> expanded_;
+    UINT threshold_;
+    UINT maxExpanded_;
+};
+
+/**
+ *  IpcCompressor using zlib's deflate.
+ *
+ *  Raw deflate streams are used, without the zlib header and checksum,
+ *  which the transport makes redundant.  The deflate and inflate states
+ *  are created on first use and reset for each message.
+ */
+class DllExport ZlibCompressor : public IpcCompressor {
+public:
+    /** Construct a compressor.
+     *  @param uThreshold Smallest message that is compressed
+     *  @param nLevel     zlib level: 1 (fastest) to 9 (smallest), -1 for
+     *                    zlib's default (6) */
+    explicit ZlibCompressor(UINT uThreshold = defaultThreshold, int nLevel = -1);
+    ~ZlibCompressor() override;
+
+protected:
+    UINT compressBytes(const char* pInput, UINT uInput,
+                       char* pOutput, UINT uOutput) override;
+    bool expandBytes(const char* pInput, UINT uInput,
+                     char* pOutput, UINT uOutput) override;
+
+private:
+    struct Streams;
+    std::unique_ptr<Streams> pStreams_;
+    int level_;
+};
+
+//
+// TYPE DEFINITIONS
+//
+/**
+ *  @typedef IpcCompressorFactory
+ *  Routine that creates the compressor of a new connection.
+ *  @param ptr Pointer to user data given with the routine
+ *  @return A new compressor, owned by the connection
+ */
+typedef IpcCompressor* (*IpcCompressorFactory)(void* ptr);
+
+}  // namespace sockstr
@@ -0,0 +1,126 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+//
+// FORWARD CLASS DECLARATIONS
+//
+class IpcStruct;
+class Stream;
+
+/**
+ *  Splits a byte stream into IpcStruct frames.
+ *
+ *  Data is read ahead into a buffer owned by the reader, as much as the
+ *  transport has, and complete frames are handed out as pointers into
+ *  that buffer.  A single read can therefore yield many small messages
+ *  and no frame is copied on the way.
+ *
+ *  A frame whose wPacketSize_ is larger than the maximum frame size is
+ *  skipped: exactly that many bytes are dropped, even when they arrive
+ *  over several reads, so the next frame is found again.  A frame whose
+ *  size is smaller than the IpcStruct header cannot be resynchronized
+ *  and puts the reader in error.
+ *
+ *  The buffer is only allocated on first use.
+ *
+ *  Example (blocking):
+ *  @code
+ *      IpcFrameReader reader;
+ *      while (const IpcStruct* pFrame = reader.read(socket)) {
+ *          dispatch(pFrame);   // valid until the next call on reader
+ *      }
+ *  @endcode
+ *  Example (with an EventLoop):
+ *  @code
+ *      for (;;) {
+ *          while (const IpcStruct* pFrame = reader.parse()) {
+ *              dispatch(pFrame);
+ *          }
+ *          auto space = reader.prepare();
+ *          int sz = co_await socket.async_read(space.first, space.second);
+ *          if (sz <= 0) break;
+ *          reader.commit(sz);
+ *      }
+ *  @endcode
+ */
+class DllExport IpcFrameReader {
+public:
+    /** Construct a reader.
+     *  @param uMaxFrame Largest frame that is returned; larger ones are skipped */
+    explicit IpcFrameReader(UINT uMaxFrame = defaultMaxFrame);
+
+    /** Return the next complete frame in the buffer, or nullptr if more data
+     *  is needed (or the reader is in error).  The frame is consumed; the
+     *  pointer stays valid until the next call to a non-const function. */
+    const IpcStruct* parse();
+    /** Return the next frame, reading from rStream as needed.
+     *  @return nullptr at end of file, on error, or when rStream is
+     *          asynchronous and has no complete frame available. */
+    const IpcStruct* read(Stream& rStream);
+    /** Read once from rStream into the free space of the buffer.
+     *  @return The number of bytes read, 0 if none. */
+    UINT fill(Stream& rStream);
+    /** Return the free space of the buffer for a read by the caller. */
+    std::pair<char*, UINT> prepare();
+    /** Add uCount bytes that the caller has read into prepare()'s space. */
+    void commit(UINT uCount);
+    /** Drop everything that is buffered and clear the error. */
+    void reset();
+
+    /** Number of bytes buffered that have not been returned as frames. */
+    UINT buffered() const { return end_ - begin_; }
+    /** Indicate if a malformed frame was seen. */
+    bool error() const { return error_; }
+    /** Number of oversize frames that were skipped. */
+    std::size_t skipped() const { return skipped_; }
+
+    //! Default largest frame
+    static constexpr UINT defaultMaxFrame = 64 * 1024;
+
+private:
+    void compact(UINT uNeeded);
+
+    std::vector<char> buf_;
+    UINT begin_;                //!< Start of the unparsed data
+    UINT end_;                  //!< End of the data read so far
+    UINT skip_;                 //!< Bytes still to drop of an oversize frame
+    UINT maxFrame_;
+    std::size_t skipped_;
+    bool error_;
+};
+
+}  // namespace sockstr
@@ -0,0 +1,179 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+#include <sockstr/IpcCompressor.h>
+#include <sockstr/Task.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+//
+// FORWARD CLASS DECLARATIONS
+//
+class EventLoop;
+class IpcStruct;
+class IpcReplyStruct;
+class Socket;
+
+/**
+ *  One IPC message being handled by an IpcServer handler.
+ */
+class DllExport IpcCall {
+public:
+    /** @param rReplies Buffer of the server the replies are appended to */
+    IpcCall(const IpcStruct* pRequest, std::vector<char>& rReplies)
+        : pRequest_(pRequest), replies_(rReplies) { }
+
+    /** Return the message that was received. */
+    const IpcStruct* request() const { return pRequest_; }
+    /** Send a reply to the message.  As with Stream::remoteWriteReply, the
+     *  sequence number of the request is filled in.  A handler may reply
+     *  once, several times, or not at all. */
+    void reply(IpcReplyStruct* pReply);
+
+private:
+    const IpcStruct* pRequest_;
+    std::vector<char>& replies_;
+};
+
+//
+// TYPE DEFINITIONS
+//
+/**
+ *  @typedef IpcHandler
+ *  Routine that handles one IPC function.
+ *  @param rCall The received message and the means to reply to it
+ *  @param ptr   Pointer to user data given to registerHandler()
+ */
+typedef void (*IpcHandler)(IpcCall& rCall, void* ptr);
+
+/**
+ *  Server side of the IPC protocol.
+ *
+ *  Handlers are registered for function numbers (the IPC_ values used by
+ *  the IPC_MESSAGE macro).  serve() accepts connections on an EventLoop,
+ *  and each connection is read by a coroutine that splits the input into
+ *  messages.  The messages are handled by a pool of worker threads, and
+ *  the replies go back to the loop, where everything that has collected
+ *  for a connection is sent with one write.
+ *
+ *  With no worker threads the handlers run on the loop's thread, which is
+ *  best when they are short and never block.
+ *
+ *  Handlers must be registered before serve() is started.  Messages with
+ *  no handler are dropped.  The server must outlive the loop running it.
+ *
+ *  Example:
+ *  @code
+ *      void add(IpcCall& rCall, void*) {
+ *          auto pAdd = static_cast<const Add*>(rCall.request());
+ *          AddReply reply;
+ *          reply.dwSum_ = pAdd->dwA_ + pAdd->dwB_;
+ *          rCall.reply(&reply);
+ *      }
+ *      IpcServer server(4);
+ *      server.registerHandler(IPC_Add, add);
+ *      loop.spawn(server.serve(listener));
+ *      loop.run();
+ *  @endcode
+ */
+class DllExport IpcServer {
+public:
+    /** Construct a server.
+     *  @param uWorkers Number of worker threads, 0 to handle on the loop */
+    explicit IpcServer(UINT uWorkers = std::thread::hardware_concurrency());
+    /** Stops the worker threads. */
+    ~IpcServer();
+
+    // Disable copy constructor and assignment operator
+    IpcServer(const IpcServer&) = delete;
+    IpcServer& operator=(const IpcServer&) = delete;
+
+    /** Highest function number; the bit above it marks compressed messages */
+    static constexpr WORD maxFunction = 0x7fff;
+
+    /** Register the handler of one IPC function.
+     *  @param wFunction Function number, as in IpcStruct::wFunction_, from
+     *                   0 to maxFunction
+     *  @param pHandler  Routine called for each such message
+     *  @param ptr       User data passed to pHandler
+     *  @return False if the function number is out of range. */
+    bool registerHandler(WORD wFunction, IpcHandler pHandler, void* ptr = nullptr);
+    /** Compress the messages of the connections accepted from now on.
+     *  Each connection gets its own compressor from pFactory, which is
+     *  used on the loop's thread: received messages are expanded before
+     *  they are dispatched and replies are compressed as they are written.
+     *  @param pFactory Routine creating a compressor, nullptr for none
+     *  @param ptr      User data passed to pFactory */
+    void setCompressor(IpcCompressorFactory pFactory, void* ptr = nullptr);
+    /** Accept and serve connections until the listening socket is closed.
+     *  Spawn this task on the EventLoop. */
+    Task<void> serve(Socket& rListener);
+
+    /** Return the number of connections being served. */
+    std::size_t connections() const { return connections_; }
+
+private:
+    struct Connection;
+    struct Handler {
+        IpcHandler pHandler = nullptr;
+        void* pData = nullptr;
+    };
+    struct Job {
+        std::shared_ptr<Connection> pConnection;
+        Handler handler;
+        std::vector<char> request;
+    };
+
+    Task<void> reader(std::shared_ptr<Connection> pConnection);
+    Task<void> writer(std::shared_ptr<Connection> pConnection);
+    void worker();
+    void deliver(Connection& rConnection, std::vector<char>& rReplies, std::size_t uDone);
+
+    std::vector<Handler> handlers_;     //!< Indexed by function number
+    IpcCompressorFactory pCompressorFactory_;
+    void* pCompressorData_;
+    std::vector<std::thread> workers_;
+    std::mutex queueLock_;
+    std::condition_variable queueReady_;
+    std::vector<Job> queue_;            //!< Jobs from uQueueHead_ on are waiting
+    std::size_t uQueueHead_;
+    std::vector<std::vector<char> > spareRequests_;    //!< Buffers of jobs done
+    bool stopping_;
+    std::size_t connections_;
+};
+
+}  // namespace sockstr
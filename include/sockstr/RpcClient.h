@@ -0,0 +1,183 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+#include <sockstr/EventLoop.h>
+#include <sockstr/IpcFrameReader.h>
+#include <sockstr/Task.h>
+#include <sockstr/TimerWheel.h>
+
+#include <coroutine>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+//
+// FORWARD CLASS DECLARATIONS
+//
+class IpcStruct;
+class IpcReplyStruct;
+class Socket;
+
+//
+// TYPE DEFINITIONS
+//
+/**
+ *  @typedef RpcCompletion
+ *  Routine called when a remote procedure call completes.
+ *  @param pReply The reply, or nullptr if the call timed out or the
+ *                connection was lost.  It is only valid during the call.
+ *  @param ptr    Pointer to user data given with the call
+ */
+typedef void (*RpcCompletion)(const IpcReplyStruct* pReply, void* ptr);
+
+/**
+ *  Client side of remote procedure calls over one connection.
+ *
+ *  Any number of calls, up to the size of the outstanding table, may be
+ *  in flight at the same time.  Each call is stamped with a sequence
+ *  number of this client, and the reply carrying the same dwSequence_
+ *  completes it, in whatever order the replies arrive.  Requests made
+ *  during one pass of the EventLoop go out together in a single write.
+ *
+ *  The client runs on an EventLoop: run() must be spawned to read the
+ *  replies, and the socket is used with async_read and async_write.
+ *  A call with a timeout is completed with a nullptr reply when the
+ *  timeout expires; a reply arriving later is dropped.  If the socket
+ *  has a compressor (Socket::setCompressor), requests are compressed and
+ *  replies expanded with it.
+ *
+ *  The client must outlive run() and the calls it has outstanding.
+ *
+ *  Example:
+ *  @code
+ *      RpcClient rpc(socket);
+ *      loop.spawn(rpc.run());
+ *      ...
+ *      GetStatus request;
+ *      GetStatusReply reply;
+ *      if (co_await rpc.async_call(&request, &reply, 0, 500) > 0)
+ *          use(reply);
+ *  @endcode
+ */
+class DllExport RpcClient {
+public:
+    /** Construct a client for a connected socket.
+     *  @param rSocket         Connection to the server
+     *  @param uMaxOutstanding Size of the outstanding table, rounded up to
+     *                         a power of two */
+    explicit RpcClient(Socket& rSocket, UINT uMaxOutstanding = 256);
+    /** Completes the outstanding calls with a nullptr reply. */
+    ~RpcClient();
+
+    // Disable copy constructor and assignment operator
+    RpcClient(const RpcClient&) = delete;
+    RpcClient& operator=(const RpcClient&) = delete;
+
+    /** Start a remote procedure call.
+     *  @param pRequest    Message to send; its dwSequence_ is filled in
+     *  @param pCompletion Routine called with the reply
+     *  @param ptr         User data passed to pCompletion
+     *  @param uTimeoutMs  Complete the call without a reply after this many
+     *                     milliseconds (0 = never)
+     *  @return False if the connection is lost, or if the table slot for the
+     *          next sequence number is still taken.  pCompletion is then not
+     *          called.  pCompletion is never called from within call(). */
+    bool call(IpcStruct* pRequest, RpcCompletion pCompletion, void* ptr,
+              UINT uTimeoutMs = 0);
+
+    /** Awaitable returned by async_call().  co_await yields the size of the
+     *  reply, or 0 if the call failed, timed out or the reply did not fit. */
+    class CallAwaiter {
+    public:
+        CallAwaiter(RpcClient& rClient, IpcStruct* pRequest, IpcReplyStruct* pReply,
+                    UINT uMaxReply, UINT uTimeoutMs);
+        bool await_ready();
+        void await_suspend(std::coroutine_handle<> handle) { handle_ = handle; }
+        int await_resume() const noexcept { return result_; }
+    private:
+        static void completed(const IpcReplyStruct* pReply, void* ptr);
+
+        RpcClient& client_;
+        IpcStruct* pRequest_;
+        IpcReplyStruct* pReply_;
+        UINT uMaxReply_;
+        UINT uTimeoutMs_;
+        int result_;
+        std::coroutine_handle<> handle_;
+    };
+
+    /** Make a remote procedure call and suspend until its reply arrives.
+     *  @param pRequest   Message to send
+     *  @param pReply     Buffer for the reply
+     *  @param uMaxReply  Size of pReply; 0 to use its wPacketSize_
+     *  @param uTimeoutMs Timeout of the call (0 = never) */
+    CallAwaiter async_call(IpcStruct* pRequest, IpcReplyStruct* pReply,
+                           UINT uMaxReply = 0, UINT uTimeoutMs = 0) {
+        return CallAwaiter(*this, pRequest, pReply, uMaxReply, uTimeoutMs);
+    }
+
+    /** Read replies and complete their calls until the connection is
+     *  closed.  Spawn this task on the EventLoop. */
+    Task<void> run();
+
+    /** Return the number of calls waiting for a reply. */
+    std::size_t outstanding() const { return outstanding_; }
+
+private:
+    //! Entry of the outstanding table
+    struct Slot {
+        RpcClient* pClient = nullptr;
+        DWORD dwSequence = 0;
+        RpcCompletion pCompletion = nullptr;
+        void* pData = nullptr;
+        Timer timer;
+    };
+
+    Task<void> flush();
+    void complete(Slot& rSlot, const IpcReplyStruct* pReply);
+    void failAll();
+    static void expired(Timer* pTimer, void* ptr);
+
+    Socket& socket_;
+    EventLoop& loop_;
+    std::unique_ptr<Slot[]> slots_;
+    UINT mask_;
+    UINT sequence_;             //!< Last sequence number used
+    std::size_t outstanding_;
+    std::vector<char> pending_; //!< Requests waiting to be written
+    std::vector<char> sending_; //!< Requests being written
+    bool flushing_;
+    bool closed_;
+    IpcFrameReader reader_;
+};
+
+}  // namespace sockstr
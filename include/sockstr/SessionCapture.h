@@ -0,0 +1,186 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+//
+// TYPE DEFINITIONS
+//
+/** Kinds of record in a capture file. */
+enum CaptureKind {
+    captureOpen = 1,        //!< A session started; the data is its description
+    captureReceived,        //!< Bytes read from the peer
+    captureSent,            //!< Bytes written to the peer
+    captureClose            //!< The session ended
+};
+
+/**
+ *  One record of a capture file, as returned by CaptureReader.
+ */
+struct CaptureRecord {
+    CaptureKind eKind;
+    UINT uSession;          //!< Session number, unique within the file
+    uint64_t uTimestamp;    //!< Microseconds since the capture was started
+    const char* pData;      //!< Bytes of the record, valid until the next read
+    UINT uLength;
+
+    // Description of a session, filled in for captureOpen records
+    int nProtocol;          //!< SOCK_STREAM or SOCK_DGRAM
+    bool bAccepted;         //!< The session is the server side of a connection
+    std::string peer;       //!< Numeric address of the peer
+};
+
+/**
+ *  Recorder of the traffic of Socket sessions.
+ *
+ *  Give a capture to Socket::setCapture() and every byte the socket reads
+ *  or writes is appended to the capture file with a timestamp.  A capture
+ *  set on a listening socket is inherited by the connections it accepts,
+ *  so a whole server can be recorded with one call.  Any number of sockets,
+ *  on any threads, can share one capture.
+ *
+ *  The file starts with an 8 byte magic and the start time (microseconds
+ *  since the epoch, 8 bytes little endian).  Then follow the records:
+ *
+ *      kind (1 byte)  session (varint)  time delta in us (varint)
+ *      length (varint)  bytes
+ *
+ *  A captureOpen record holds the protocol (1 byte, the socket type), the
+ *  side (1 byte, 1 for accepted) and the peer address.
+ *
+ *  Records are collected in memory and written out in blocks, so capturing
+ *  costs a copy and a lock per read or write rather than a system call.
+ *  close() or the destructor writes what is left.
+ */
+class DllExport SessionCapture {
+public:
+    SessionCapture();
+    /** Closes the capture file. */
+    ~SessionCapture();
+
+    // Disable copy constructor and assignment operator
+    SessionCapture(const SessionCapture&) = delete;
+    SessionCapture& operator=(const SessionCapture&) = delete;
+
+    /** Create the capture file, replacing an existing one.
+     *  @return True if the file could be created. */
+    bool open(const char* lpszFileName);
+    /** Write the remaining records and close the file. */
+    void close();
+    //! Indicate if a capture file is open.
+    bool is_open() const { return pFile_ != nullptr; }
+
+    /** Start a new session.
+     *  @param nProtocol SOCK_STREAM or SOCK_DGRAM
+     *  @param bAccepted True for the server side of a connection
+     *  @param pPeer     Address of the peer
+     *  @return The session number to use with record(); 0 if not open */
+    UINT openSession(int nProtocol, bool bAccepted, const char* pPeer);
+    /** Append traffic of a session. */
+    void record(UINT uSession, CaptureKind eKind, const void* pData, UINT uLength);
+    /** End a session. */
+    void closeSession(UINT uSession) { record(uSession, captureClose, nullptr, 0); }
+
+    //! Magic that starts a capture file
+    static constexpr char magic[8] = { 'S', 'S', 'C', 'A', 'P', 'T', 'R', '1' };
+
+private:
+    void append(CaptureKind eKind, UINT uSession, const void* pData, UINT uLength,
+                const void* pPrefix = nullptr, UINT uPrefix = 0);
+    void flush();
+
+    std::mutex lock_;
+    std::FILE* pFile_;
+    std::vector<char> buffer_;
+    uint64_t start_;        //!< Monotonic time the capture was opened
+    uint64_t last_;         //!< Time of the last record, relative to start_
+    UINT sessions_;
+};
+
+/**
+ *  Sequential reader of a capture file.
+ *
+ *  The file is read in blocks, so captures far larger than memory can be
+ *  replayed.
+ *
+ *  Example:
+ *  @code
+ *      CaptureReader reader;
+ *      CaptureRecord record;
+ *      if (reader.open("server.cap"))
+ *          while (reader.next(record))
+ *              ...
+ *  @endcode
+ */
+class DllExport CaptureReader {
+public:
+    CaptureReader();
+    ~CaptureReader();
+
+    // Disable copy constructor and assignment operator
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+
+    /** Open a capture file and check its header. */
+    bool open(const char* lpszFileName);
+    void close();
+
+    /** Read the next record.
+     *  @return False at the end of the file or if it is corrupt (see error()). */
+    bool next(CaptureRecord& rRecord);
+
+    //! Indicate if the file is not a capture or is damaged.
+    bool error() const { return error_; }
+    //! Return the wall clock time the capture was started (us since the epoch).
+    uint64_t startTime() const { return startTime_; }
+
+    //! Largest record that is accepted
+    static constexpr UINT maxRecord = 64 * 1024 * 1024;
+
+private:
+    bool fill(std::size_t uNeeded);
+
+    std::FILE* pFile_;
+    std::vector<char> buffer_;
+    std::size_t begin_;
+    std::size_t end_;
+    uint64_t startTime_;
+    uint64_t time_;
+    bool error_;
+};
+
+}  // namespace sockstr
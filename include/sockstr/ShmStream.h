@@ -0,0 +1,163 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+#include <sockstr/Stream.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+//
+// FORWARD CLASS DECLARATIONS
+//
+struct ShmRegion;
+struct ShmRing;
+
+/**
+ *  A Stream between two processes on the same host using shared memory.
+ *
+ *  The stream is a named shared memory region holding two single-producer
+ *  single-consumer byte rings, one for each direction.  Data is copied
+ *  once into the ring by the writer and once out of it by the reader;
+ *  no system call is made while the peer keeps up.  A reader that finds
+ *  its ring empty spins for a while and then sleeps on a futex that the
+ *  writer wakes only when somebody actually sleeps.  In busy-wait mode
+ *  the reader never sleeps, which gives the lowest latency at the cost
+ *  of a core.
+ *
+ *  One process opens the stream with modeCreate and the other attaches
+ *  to it by the same name.  Each side must use the stream from a single
+ *  thread at a time.  Because messages are written as a whole, the
+ *  IpcStruct functions (remoteProcedure, remoteReadData and
+ *  remoteWriteReply) work the same as over a Socket.
+ *
+ *  Example:
+ *  @code
+ *      ShmStream server("shm:myapp", ShmStream::modeCreate); // process A
+ *      ShmStream client("shm:myapp", 0);                   // process B
+ *  @endcode
+ */
+class DllExport ShmStream : public Stream {
+public:
+    //! Constructs a closed ShmStream object.
+    ShmStream();
+    /*!
+     *   Constructs a ShmStream object and opens it.
+     *   @param lpszName   Name of the stream, optionally prefixed with "shm:"
+     *   @param uOpenFlags modeCreate to create the stream, 0 to attach
+     */
+    ShmStream(const char* lpszName, UINT uOpenFlags);
+    //! Destruct a ShmStream object and close it.
+    virtual ~ShmStream();
+
+    // Disable copy constructor and assignment operator
+    ShmStream(const ShmStream&) = delete;
+    ShmStream& operator=(const ShmStream&) = delete;
+
+    //!  Wake up a reader or writer that is blocked on the stream.
+    virtual void abort();
+    //!  Close the stream.  A peer that reads from it will see end of file.
+    virtual void close();
+    //!  Shared memory streams do not accept connections; returns nullptr.
+    virtual Stream* listen(const int nBacklog = 4);
+    /** Create or attach to a shared memory stream.
+     *  @param lpszName   Name of the stream, optionally prefixed with "shm:"
+     *  @param uOpenFlags modeCreate to create the stream, otherwise attach
+     *                    to a stream created by another process.
+     *                    modeAsync and modeBusyWait may be added.
+     *  @return True if the open succeeds, otherwise false.
+     */
+    virtual bool open(const char* lpszName, UINT uOpenFlags);
+    /** Create or attach with a given ring size.
+     *  @param uRingSize Size of each ring in bytes when creating; rounded up
+     *                   to a power of two.  Ignored when attaching. */
+    bool open(const char* lpszName, UINT uOpenFlags, UINT uRingSize);
+    /** Read whatever is available, up to uCount bytes.  Blocks until at
+     *  least one byte is available unless asynchronous mode is set.
+     *  @return Number of bytes read, 0 at end of file or if no data. */
+    virtual UINT read(void* pBuf, UINT uCount);
+    //!  Read a string from the stream.
+    virtual UINT read(std::string& str, int delimiter='\n');
+    //!  Read a string from the stream.
+    virtual UINT read(std::string& str, const std::string& delimiter="\r\n");
+    //!  Send an IPC message.  The sequence number is filled in.
+    virtual int remoteProcedure(IpcStruct* pData, Callback pCallback = nullptr);
+    //!  Read an IPC message or reply.
+    virtual int remoteReadData(IpcStruct* pData, UINT uMaxLength = 0);
+    //!  Send a reply to an IPC message.
+    virtual int remoteWriteReply(IpcReplyStruct* pData, DWORD dwSequence = 0);
+    /** In asynchronous mode read() returns immediately with SC_NODATA
+     *  when nothing is available. */
+    virtual void setAsyncMode(const bool bMode);
+    //!  Write all uCount bytes, waiting for space in the ring as needed.
+    virtual void write(const void* pBuf, UINT uCount);
+    //!  Write a string to the stream.
+    virtual void write(const std::string& str);
+    //!  Return the name of the stream.
+    virtual operator const char* (void) const;
+
+    /** Select busy-wait mode.  A waiting reader or writer then spins
+     *  instead of sleeping in the kernel (yielding on a single CPU). */
+    void setBusyWait(bool bBusyWait) { busyWait_ = bBusyWait; }
+    /** Number of times to poll the ring before sleeping (default 2000, or
+     *  0 on a single CPU host). */
+    void setSpinCount(UINT uSpinCount) { spinCount_ = uSpinCount; }
+
+    /** Open flags.  These match the values used by Socket. */
+    static constexpr int modeCreate    = 1;  //!< Create the shared memory region
+    static constexpr int modeAsync     = 2;  //!< Stream will be asynchronous by default
+    static constexpr int modeBusyWait  = 32; //!< Spin instead of sleeping
+
+    //! Default size of each ring
+    static constexpr UINT defaultRingSize = 1 << 20;
+
+private:
+    bool waitForData(ShmRing* pRing);
+    bool waitForSpace(ShmRing* pRing);
+    UINT readFully(void* pBuf, UINT uCount);
+    void unmap();
+
+    ShmRegion* region_;         //!< Mapped shared memory
+    std::size_t mapSize_;
+    ShmRing* in_;               //!< Ring this side reads from
+    ShmRing* out_;              //!< Ring this side writes to
+    int side_;                  //!< 0 for the creator, 1 for the other side
+    std::string name_;
+    bool asyncMode_;
+    bool busyWait_;
+    UINT spinCount_;
+    std::atomic<bool> aborted_;
+    DWORD sequence_;
+};
+
+}  // namespace sockstr
@@ -25,9 +25,16 @@
 #ifdef TARGET_WINDOWS
 #include <WinSock2.h>
 #endif
+#include <sockstr/IpcCompressor.h>
+#include <sockstr/IpcFrameReader.h>
+#include <sockstr/SessionCapture.h>
 #include <sockstr/SocketAddr.h>
 #include <sockstr/Stream.h>
+#include <sockstr/Task.h>
+#include <sockstr/TimerWheel.h>
+#include <memory>
 #include <string>
+#include <string_view>
 
 //
 // FORWARD CLASS DECLARATIONS
@@ -38,6 +45,7 @@ struct ssl_ctx_st;
 typedef struct ssl_st SSL;
 typedef struct ssl_ctx_st SSL_CTX;
 #endif
+struct iovec;
 
 
 namespace sockstr {
@@ -104,6 +112,11 @@ public:
      *   @param uOpenFlags   Mode to open socket
      */
     Socket(SocketAddr& rSockAddr, UINT uOpenFlags);
+    /*!
+     *   Move a Socket object.  The connection is taken over from rSource,
+     *   which is left closed.
+     */
+    Socket(Socket&& rSource) noexcept;
     /*!
      *   Destruct a Socket object and close socket
      */
@@ -136,6 +149,9 @@ public:
      *                      should be appended together with a colon. The URL can be specified as a host name,
      *                      a IPv4 dot address or a IPv6 colon-separated address. If the host portion is
      *                      omitted then a server socket is created that will listen on the specified port.
+     *                      A Unix domain socket is opened with "unix:/path/to/socket" for a stream or
+     *                      "unixdg:/path/to/socket" for datagrams; "unix:@name" uses the Linux abstract
+     *                      namespace.  A stale socket file is removed before a server binds to it.
      *  @param uOpenFlags  Flags to indicate how the socket will be opened. Mode flags can be combined by
      *                     using "|" (OR) from the following: modeCreate, modeAsyncSocket, modeRead,
      *                     modeWrite and modeReadWrite.
@@ -175,8 +191,41 @@ public:
     virtual int remoteProcedure(IpcStruct* pData, Callback pCallback = 0);
     //! Read an IPC message or reply from socket (state-dependent)
     virtual int remoteReadData(IpcStruct* pData, UINT uMaxLength = 0);
+    /** Read an IPC message or reply without copying it.
+     *  The socket reads ahead, so one read can return several messages.
+     *  @return Pointer to the message in the socket's receive buffer, valid
+     *          until the next call; nullptr at end of file, on a malformed
+     *          message, or in asynchronous mode when none is complete. */
+    const IpcStruct* remoteReadFrame();
     //!     RemoteWriteReply Send a reply to an IPC message (state-dependent)
     virtual int remoteWriteReply(IpcReplyStruct* pData, DWORD dwSequence = 0);
+    /** Compress the IPC messages of this connection.
+     *  Messages sent with remoteProcedure() and remoteWriteReply() are
+     *  compressed as the compressor decides, and compressed messages are
+     *  expanded by remoteReadFrame() and remoteReadData().  The peer must
+     *  use a compressor of the same kind.  RpcClient and IpcServer use it
+     *  too.  The compressor is kept when the socket is closed.
+     *  @param pCompressor Compressor, owned by the socket; nullptr to stop
+     *                     compressing */
+    void setCompressor(std::unique_ptr<IpcCompressor> pCompressor);
+    //! Return the compressor of IPC messages, nullptr if there is none.
+    IpcCompressor* getCompressor() const { return m_pCompressor.get(); }
+    /** Record the traffic of this socket.
+     *  Each connection becomes a session of the capture, started when it is
+     *  connected (or at its first read or write) and ended when it is
+     *  closed.  A listening socket passes the capture on to the connections
+     *  it accepts.  Awaitable and blocking reads and writes are recorded;
+     *  TLS connections are not.  The capture is kept when the socket is
+     *  closed.
+     *  @param pCapture Capture, not owned by the socket; nullptr to stop */
+    void setCapture(SessionCapture* pCapture);
+    /** Ask for application protocols with ALPN when a TLS connection is
+     *  opened, most preferred first, separated by commas, such as
+     *  "h2,http/1.1".  The setting is kept when the socket is closed.
+     *  @param protocols Protocols to offer; empty to offer none */
+    void setAlpn(std::string_view protocols);
+    //! Return the protocol the TLS server selected with ALPN, empty if none.
+    const std::string& alpnProtocol() const { return m_alpnSelected; }
     //!   Asynchronous I/O mode on or off.
     virtual void setAsyncMode(const bool bMode);
     //!   Set socket options.
@@ -186,17 +235,100 @@ public:
     virtual void write(const void* pBuf, UINT uCount);
     //!  Write a string to the stream (state-dependent).
     virtual void write(const std::string& str);
+    /** Write part of an open file to the socket.  On Linux the kernel
+     *  copies the data with sendfile(2); on TLS connections, when traffic
+     *  is captured or elsewhere the file is read and written.
+     *  @param fd      Descriptor of the file, read with pread()
+     *  @param uOffset Offset of the first byte to send
+     *  @param uCount  Number of bytes to send
+     *  @return True if all uCount bytes were sent. */
+    bool sendFile(int fd, uint64_t uOffset, uint64_t uCount);
+    /** Write several buffers in order with one system call, sendmsg(2),
+     *  where the kernel allows; on TLS connections, when traffic is
+     *  captured or elsewhere they are written one by one.
+     *  @param pVec   Buffers; the entries are changed as they are written
+     *  @param nCount Number of buffers
+     *  @return True if all the bytes were written. */
+    bool writev(struct iovec* pVec, int nCount);
 
     /** Returns a static, textual representation of an address
      *  (i.e., "host.acme.com:1074").  The value returned is an internal
      *  static and is thus not thread safe.
      */
     virtual operator const char* () const;
-    //!   Assignment operator
-    Socket& operator=(const Socket& rSource);
+    /** Move assignment.  This socket is closed first, then takes over the
+     *  connection of rSource which is left closed. */
+    Socket& operator=(Socket&& rSource) noexcept;
+    // Sockets own their handle and cannot be copied
+    Socket& operator=(const Socket& rSource) = delete;
+
+    /** Accept the next incoming connection on this server socket into a
+     *  socket object owned by the caller.  Unlike listen() no object is
+     *  allocated, so the same client object (or one taken from a
+     *  SocketPool) can be used for connection after connection.
+     *  @param rClient Socket object that receives the connection; it is
+     *                 closed first if still open.
+     *  @return True if rClient is now connected. */
+    bool accept(Socket& rClient);
+
+    // Awaitable I/O.  These must be awaited from a coroutine running on an
+    // EventLoop; instead of blocking, the coroutine is suspended until the
+    // socket is ready.  They are not supported on TLS sockets.
+
+    /** Read whatever is available from the socket, up to uCount bytes.
+     *  @return Number of bytes read, 0 when the peer closed the connection
+     *          or SOCKET_ERROR on failure. */
+    Task<int>  async_read(void* pBuf, UINT uCount);
+    /** Write all uCount bytes to the socket.
+     *  @return Number of bytes written or SOCKET_ERROR on failure. */
+    Task<int>  async_write(const void* pBuf, UINT uCount);
+    /** Awaitable form of sendFile().
+     *  @return True if all uCount bytes were sent. */
+    Task<bool> async_sendFile(int fd, uint64_t uOffset, uint64_t uCount);
+    /** Awaitable form of writev().  The buffers must stay valid until it
+     *  completes.
+     *  @return True if all the bytes were written. */
+    Task<bool> async_writev(struct iovec* pVec, int nCount);
+    /** Accept the next incoming connection on this server socket.
+     *  @param rClient Closed socket object that receives the connection.
+     *                 It can be any sub-class, for example HttpServerStream.
+     *  @return True if rClient is now connected. */
+    Task<bool> async_accept(Socket& rClient);
+    /** Open a client connection without blocking the loop.
+     *  @param rSockAddr  Address to connect to; must stay valid until the
+     *                    returned task completes.
+     *  @param uOpenFlags Mode flags as for open().
+     *  @return True if the connection was established. */
+    Task<bool> async_connect(SocketAddr& rSockAddr, UINT uOpenFlags = modeReadWrite);
+
+    /** Operations that can be given a deadline with setTimeout(). */
+    enum TimeoutKind {
+        timeoutRead,        //!< read() and async_read()
+        timeoutWrite,       //!< write() and async_write()
+        timeoutConnect,     //!< Opening a client socket and async_connect()
+        timeoutAccept,      //!< listen() and async_accept()
+        numTimeouts
+    };
+    /** Limit how long an operation may wait for the peer.
+     *  An operation that times out fails with status SC_TIMEOUT and
+     *  errno set to ETIMEDOUT; the connection itself stays open.
+     *  Timeouts are kept when the socket is closed and re-opened.
+     *  @param eKind     Operation to limit
+     *  @param uMillisec Timeout in milliseconds, 0 (the default) waits forever */
+    void setTimeout(TimeoutKind eKind, UINT uMillisec);
+    //! Return the timeout of an operation in milliseconds (0 = none).
+    UINT getTimeout(TimeoutKind eKind) const;
+    /** Close down a connection that sees no traffic for uMillisec.
+     *  The timer runs on the current EventLoop and is restarted by every
+     *  completed awaitable read or write.  When it expires the connection
+     *  is shut down, so a coroutine waiting on it sees end of file.
+     *  @param uMillisec Idle time in milliseconds, 0 to disable */
+    void setIdleTimeout(UINT uMillisec);
 
 protected:
     Stream* listenIntern(Socket* pClient, const int nBacklog);
+    /** Make pClient the connected end of the accepted handle hClient. */
+    bool attachClient(Socket* pClient, SOCKET hClient);
 
 public:
     /** Open flags. */
@@ -205,6 +337,9 @@ public:
     static constexpr int modeRead         = 4;  //!< Socket can only be read from
     static constexpr int modeWrite        = 8;  //!< Socket can only be written to
     static constexpr int modeReadWrite    = 16; //!< Socket can be read from and written to
+    /** Let several server sockets bind the same port (SO_REUSEPORT), each
+     *  getting a share of the incoming connections. */
+    static constexpr int modeReusePort    = 32;
 
 protected:
     SocketAddr::AddrType m_PeerAddr;
@@ -218,6 +353,22 @@ protected:
 #endif
     ipv6_mreq m_multicastGroup;
     std::string m_interface;
+    UINT m_uTimeouts[numTimeouts] = {};
+    UINT m_uIdleTimeout = 0;
+    Timer m_IdleTimer;
+    IpcFrameReader m_FrameReader;   //!< Read-ahead buffer for IPC messages
+    std::unique_ptr<IpcCompressor> m_pCompressor;
+    SessionCapture* m_pCapture = nullptr;
+    UINT m_uCaptureSession = 0;     //!< Session of the connection, 0 before it starts
+    std::string m_alpn;             //!< Protocols offered with ALPN, in wire format
+    std::string m_alpnSelected;     //!< Protocol the TLS server selected
+
+    /// Record traffic if a capture is set.
+    void captureData(CaptureKind eKind, const void* pData, int iCount) {
+        if (m_pCapture != nullptr && iCount > 0) {
+            recordCapture(eKind, pData, (UINT) iCount);
+        }
+    }
 
 private:
     // Counter for IPC messages (generates magic cookies)
@@ -226,6 +377,20 @@ private:
 private:
     /// Do initializations that are common to all constructors.
     void initialize();
+    /// Take over everything but the Stream part of rSource.
+    void takeOver(Socket& rSource);
+    /// Restart the idle timer after activity on the connection.
+    void touch();
+    /// Start the capture session of the connection.
+    void startCapture();
+    void recordCapture(CaptureKind eKind, const void* pData, UINT uCount);
+    /// Record that an awaitable operation timed out.
+    void timedOut();
+    /// Indicate if sendFile() can hand the data to the kernel.
+    bool canSendFile() const;
+    /// Indicate if writev() can hand the buffers to the kernel at once.
+    bool canWriteDirect() const;
+    static void idleExpired(Timer* pTimer, void* ptr);
 
     // Disable copy constructor
     Socket(const Socket&) = delete;
@@ -39,9 +39,11 @@
 #ifdef WINDOWS
 #include <WinSock2.h>
 #include <WS2tcpip.h>
+#include <afunix.h>
 #else
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <sys/un.h>
 #endif
 #include <string>
 #include <variant>
@@ -65,6 +67,12 @@ class Socket;
  *  be used for sockets. It can be constructed by providing a
  *  host name, TCP/IP 'dot address' or IPv6 address together
  *  with a port number.
+ *
+ *  A Unix domain (AF_UNIX) address is formed by giving a host of the
+ *  form "unix:/path/to/socket", or "unix:@name" for a name in the Linux
+ *  abstract namespace.  The port number is ignored.  With protocol
+ *  "udp" the address is used for a datagram socket, otherwise for a
+ *  stream socket.
  */
 class DllExport SocketAddr {
 public:
@@ -74,7 +82,11 @@ public:
     };
 
     //! Type for holding any IP address
-    using AddrType = std::variant<std::monostate, sockaddr_in, sockaddr_in6, SpecialIP>;
+    using AddrType = std::variant<std::monostate, sockaddr_in, sockaddr_in6, SpecialIP,
+                                  sockaddr_un>;
+
+    //! Prefix of host names that denote a Unix domain socket
+    static constexpr const char* unixPrefix = "unix:";
 
     /**
      * Construct a SocketAddr object.
@@ -122,6 +134,16 @@ public:
      *  @return True if this is a multicast address, otherwise false.
      */
     bool isMulticast() const;
+    /** Return whether or not this is a Unix domain (AF_UNIX) address. */
+    bool isUnix() const;
+    /** Return the length of a Unix domain address as it must be passed
+     *  to bind, connect or sendto.  An abstract name is not terminated,
+     *  so its length cannot be taken from sizeof.
+     */
+    static socklen_t unixAddrLength(const sockaddr_un& sun);
+    /** Return the text form ("unix:/path" or "unix:@name") of a Unix
+     *  domain address. */
+    static std::string unixAddrName(const sockaddr_un& sun);
     /** Return the network address (if resolved) in internal format
      *  or one of the special IP statuses AddrNone or AddrAny.
      */
@@ -0,0 +1,117 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/Socket.h>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace sockstr {
+
+/**
+ *  Pool of recycled Socket objects.
+ *
+ *  Constructing a Socket builds a complete iostream with its locale and
+ *  StreamBuf.  A server with a high connection churn can instead take
+ *  its client objects from a pool and accept into them with
+ *  Socket::accept() or Socket::async_accept().  When the returned handle
+ *  goes out of scope the socket is closed and goes back to the pool.
+ *
+ *  T must be Socket or a sub-class that is default constructible.
+ *  State kept by a sub-class for a connection should be reset by its
+ *  close() function, since that is all the pool does to recycle it.
+ *
+ *  The pool is not thread safe; use one pool per thread (or EventLoop).
+ *  It must outlive every handle it has given out.
+ *
+ *  Example:
+ *  @code
+ *      SocketPool<> pool;
+ *      for (;;) {
+ *          auto client = pool.acquire();
+ *          if (server.accept(*client))
+ *              serve(*client);
+ *      }   // client is closed and recycled here
+ *  @endcode
+ */
+template <class T = Socket>
+class SocketPool {
+public:
+    //! Deleter that returns a socket to its pool.
+    struct Recycler {
+        SocketPool* pPool;
+        void operator()(T* pSocket) const { pPool->release(pSocket); }
+    };
+    //! Owning handle to a pooled socket.
+    typedef std::unique_ptr<T, Recycler> Handle;
+
+    /** Construct a pool.
+     *  @param uMaxIdle Maximum number of closed sockets kept for reuse */
+    explicit SocketPool(std::size_t uMaxIdle = 64)
+        : uMaxIdle_(uMaxIdle) { }
+    ~SocketPool() {
+        for (T* pSocket : idle_) {
+            delete pSocket;
+        }
+    }
+
+    // Disable copy constructor and assignment operator
+    SocketPool(const SocketPool&) = delete;
+    SocketPool& operator=(const SocketPool&) = delete;
+
+    /** Take a closed socket from the pool.  A new one is constructed only
+     *  when no idle socket is available. */
+    Handle acquire() {
+        T* pSocket;
+        if (idle_.empty()) {
+            pSocket = new T;
+        } else {
+            pSocket = idle_.back();
+            idle_.pop_back();
+        }
+        return Handle(pSocket, Recycler{ this });
+    }
+
+    /** Close a socket and keep it for reuse.  Normally called by the
+     *  handle returned from acquire(). */
+    void release(T* pSocket) {
+        if (pSocket == nullptr) {
+            return;
+        }
+        pSocket->close();
+        if (idle_.size() < uMaxIdle_) {
+            idle_.push_back(pSocket);
+        } else {
+            delete pSocket;
+        }
+    }
+
+    /** Return the number of idle sockets in the pool. */
+    std::size_t idle() const { return idle_.size(); }
+
+private:
+    std::size_t uMaxIdle_;
+    std::vector<T*> idle_;
+};
+
+}  // namespace sockstr
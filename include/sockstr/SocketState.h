@@ -119,6 +119,13 @@ protected:
     IOPARAMS*
     createIOParams(Socket* pSocket, const void* pBuf, UINT uCount,
                    Callback pCallback);
+    /** Wait until the socket can be read (or written) without blocking.
+     *  Returns false with the status set to SC_TIMEOUT if uTimeoutMs
+     *  elapses first.  A timeout of 0 returns true immediately. */
+    bool waitReady(Socket* pSocket, bool bWrite, UINT uTimeoutMs);
+    /** Connect the socket handle, giving up after uTimeoutMs (0 = never). */
+    bool connectSocket(Socket* pSocket, const sockaddr* pAddr,
+                       socklen_t len, UINT uTimeoutMs);
 };
 
 
@@ -164,6 +171,7 @@ class SSListening : public SocketState {
 public:
     static SocketState* instance();
 
+    virtual void   close(Socket* pSocket);
     virtual SOCKET listen(Socket* pSocket, const int nBacklog);
 
 private:
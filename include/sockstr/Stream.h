@@ -46,7 +46,8 @@ namespace sockstr {
 enum STATUSCODE {
     SC_OK,		//!< Stream status is good.
     SC_NODATA,	//!< No data is available on stream (useful for asynchronous streams.
-    SC_FAILED	//!< Stream has an error.
+    SC_FAILED,	//!< Stream has an error.
+    SC_TIMEOUT	//!< An operation on the stream timed out.
 };
 
 
@@ -149,6 +150,13 @@ protected:
     //!              by this Stream.
     Stream(const UINT hFile);
 
+    /** Move constructor for sub-classes.  The handle, status, callback
+     *  and any buffered data are taken over from rSource, which is left
+     *  without a handle. */
+    Stream(Stream&& rSource) noexcept;
+    //! Move assignment for sub-classes (see the move constructor).
+    Stream& operator=(Stream&& rSource) noexcept;
+
     // Disable copy constructor and assignment operator
     Stream(const Stream&) = delete;
     Stream& operator=(const Stream&) = delete;
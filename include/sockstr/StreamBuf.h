@@ -48,6 +48,11 @@ public:
     virtual ~StreamBuf();
 
     StreamBuf* open(Stream* strm);
+    /** Take over the buffered data of rSource, which is left empty.
+     *  Used when the Stream that owns rSource is moved. */
+    void moveFrom(StreamBuf& rSource);
+    /** Discard all buffered input and output. */
+    void reset();
 
 protected:
     virtual int overflow(int ch = EOF);
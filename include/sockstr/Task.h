@@ -0,0 +1,243 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+//
+// FORWARD CLASS DECLARATIONS
+//
+class EventLoop;
+
+/**
+ *  Pool of coroutine frames.
+ *
+ *  Frames are carved out of size-classed free lists, so a server that runs
+ *  one coroutine per connection does not go to the global heap for every
+ *  frame.  Each EventLoop owns a FramePool.  The pool is not thread safe:
+ *  frames must be created and destroyed on the thread that owns the pool.
+ *  Frames created while no pool is current come from the global heap.
+ */
+class DllExport FramePool {
+public:
+    FramePool();
+    ~FramePool();
+
+    // Disable copy constructor and assignment operator
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    /** Allocate a coroutine frame from the current pool (or the heap). */
+    static void* allocateFrame(std::size_t uSize);
+    /** Return a frame allocated by allocateFrame() to its owner. */
+    static void  deallocateFrame(void* pFrame, std::size_t uSize);
+
+    /** Return the pool that is current for the calling thread. */
+    static FramePool* current();
+    /** Make pPool current for the calling thread.
+     *  @return the previously current pool. */
+    static FramePool* setCurrent(FramePool* pPool);
+
+private:
+    void* allocate(std::size_t uSize);
+    void  deallocate(void* pBlock, std::size_t uSize);
+
+    static constexpr std::size_t granularity_ = 64;
+    static constexpr std::size_t numClasses_  = 64;   // up to 4 KB frames
+
+    struct FreeBlock { FreeBlock* pNext; };
+    FreeBlock* freeLists_[numClasses_];
+    std::vector<void*> slabs_;
+};
+
+
+template <typename T = void> class Task;
+
+namespace detail {
+
+/**
+ *  Common part of the promise for all Task types.  Frames are allocated
+ *  from the current FramePool, a task is lazily started, and on completion
+ *  control is transferred back to whoever co_await'ed the task.
+ */
+struct TaskPromiseBase {
+    static void* operator new(std::size_t uSize) {
+        return FramePool::allocateFrame(uSize);
+    }
+    static void operator delete(void* pFrame, std::size_t uSize) {
+        FramePool::deallocateFrame(pFrame, uSize);
+    }
+
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+            TaskPromiseBase& promise = h.promise();
+            if (promise.continuation_) {
+                return promise.continuation_;
+            }
+            if (promise.pLiveCount_) {
+                // Detached task (see EventLoop::spawn) owns its own frame
+                if (promise.exception_) {
+                    std::terminate();
+                }
+                --*promise.pLiveCount_;
+                h.destroy();
+            }
+            return std::noop_coroutine();
+        }
+        void await_resume() const noexcept { }
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() { exception_ = std::current_exception(); }
+
+    std::coroutine_handle<> continuation_;
+    std::exception_ptr exception_;
+    //! Set when the task is detached; counts the live tasks of the loop.
+    std::size_t* pLiveCount_ = nullptr;
+};
+
+}  // namespace detail
+
+
+/**
+ *  A lazily started coroutine returning a value of type T.
+ *
+ *  A Task does nothing until it is co_await'ed or handed to
+ *  EventLoop::spawn().  Awaiting a task starts it and suspends the awaiting
+ *  coroutine until the task returns.  Exceptions thrown inside the task
+ *  are rethrown from the co_await expression.
+ */
+template <typename T>
+class Task {
+public:
+    struct promise_type : detail::TaskPromiseBase {
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        template <typename U>
+        void return_value(U&& value) { value_.emplace(std::forward<U>(value)); }
+
+        std::optional<T> value_;
+    };
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) { }
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    ~Task() { if (handle_) handle_.destroy(); }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle_.promise().continuation_ = awaiting;
+        return handle_;
+    }
+    T await_resume() {
+        if (handle_.promise().exception_) {
+            std::rethrow_exception(handle_.promise().exception_);
+        }
+        return std::move(*handle_.promise().value_);
+    }
+
+    /** Give up ownership of the coroutine frame. */
+    handle_type release() noexcept { return std::exchange(handle_, nullptr); }
+
+private:
+    explicit Task(handle_type h) : handle_(h) { }
+
+    handle_type handle_ = nullptr;
+};
+
+
+/**
+ *  Task specialization for coroutines that do not return a value.
+ */
+template <>
+class Task<void> {
+public:
+    struct promise_type : detail::TaskPromiseBase {
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        void return_void() const noexcept { }
+    };
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) { }
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    ~Task() { if (handle_) handle_.destroy(); }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle_.promise().continuation_ = awaiting;
+        return handle_;
+    }
+    void await_resume() {
+        if (handle_.promise().exception_) {
+            std::rethrow_exception(handle_.promise().exception_);
+        }
+    }
+
+    /** Give up ownership of the coroutine frame. */
+    handle_type release() noexcept { return std::exchange(handle_, nullptr); }
+
+private:
+    explicit Task(handle_type h) : handle_(h) { }
+
+    handle_type handle_ = nullptr;
+};
+
+}  // namespace sockstr
@@ -0,0 +1,144 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+//
+// FORWARD CLASS DECLARATIONS
+//
+class Timer;
+class TimerWheel;
+
+//
+// TYPE DEFINITIONS
+//
+/**
+ *  @typedef TimerCallback
+ *  Routine called when a Timer expires.
+ *  @param pTimer The timer that expired (it is no longer armed)
+ *  @param ptr    Pointer to user data given to the Timer
+ */
+typedef void (*TimerCallback)(Timer* pTimer, void* ptr);
+
+/**
+ *  A timer that can be armed on a TimerWheel.
+ *
+ *  The timer is an intrusive list node, so arming and cancelling never
+ *  allocate.  It is typically embedded in the object it times out, such
+ *  as a connection.  Destroying an armed timer cancels it.
+ */
+class DllExport Timer {
+public:
+    Timer(TimerCallback pCallback = nullptr, void* ptr = nullptr);
+    ~Timer();
+
+    // Disable copy constructor and assignment operator
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+    /** Indicate if the timer is armed on a wheel. */
+    bool isArmed() const { return pWheel_ != nullptr; }
+    /** Cancel the timer if it is armed. */
+    void cancel();
+    /** Change the routine that is called on expiry. */
+    void setCallback(TimerCallback pCallback, void* ptr);
+
+private:
+    friend class TimerWheel;
+
+    Timer* pPrev_;
+    Timer* pNext_;
+    TimerWheel* pWheel_;        //!< Wheel the timer is armed on, or nullptr
+    uint64_t expiry_;           //!< Tick at which the timer expires
+    unsigned short level_;
+    unsigned short slot_;
+    TimerCallback pCallback_;
+    void* pData_;
+};
+
+/**
+ *  Hashed hierarchical timer wheel.
+ *
+ *  Four wheels of 256 slots each cover delays of up to 2^32 ticks of one
+ *  millisecond.  Arming and cancelling a timer are O(1); timers on the
+ *  coarser wheels are cascaded down as time advances.  This allows every
+ *  one of a very large number of connections to carry its own deadline.
+ *
+ *  A TimerWheel is not thread safe.  Each EventLoop owns one and advances
+ *  it while it runs.
+ */
+class DllExport TimerWheel {
+public:
+    TimerWheel();
+    ~TimerWheel();
+
+    // Disable copy constructor and assignment operator
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /** Arm (or re-arm) a timer to expire uDelayMs milliseconds from now. */
+    void arm(Timer& rTimer, UINT uDelayMs);
+    /** Cancel an armed timer. */
+    void cancel(Timer& rTimer);
+    /** Expire all timers that are due at time uNowMs.
+     *  @return The number of timers that expired. */
+    std::size_t advance(uint64_t uNowMs);
+    /** Return the number of milliseconds until the wheel next needs to be
+     *  advanced, or -1 if no timer is armed. */
+    int nextTimeout(uint64_t uNowMs) const;
+    /** Return the number of armed timers. */
+    std::size_t size() const { return count_; }
+
+    /** Current time in milliseconds of the monotonic clock. */
+    static uint64_t monotonicMs();
+
+private:
+    static constexpr unsigned levels_ = 4;
+    static constexpr unsigned slotBits_ = 8;
+    static constexpr unsigned slots_ = 1u << slotBits_;
+    static constexpr unsigned slotMask_ = slots_ - 1;
+
+    void place(Timer& rTimer);
+    void unlink(Timer& rTimer);
+    void tick();
+    void cascade(unsigned uLevel);
+    uint64_t nextEvent() const;
+
+    Timer* wheel_[levels_][slots_];
+    uint64_t occupied_[levels_][slots_ / 64];   //!< Bitmap of non-empty slots
+    uint64_t now_;                              //!< Last processed tick
+    std::size_t count_;
+};
+
+}  // namespace sockstr
@@ -0,0 +1,278 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+#pragma once
+
+#include <sockstr/sstypes.h>
+#include <sockstr/Task.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace sockstr {
+
+//
+// MACRO DEFINITIONS
+//
+#ifndef DllExport
+#define DllExport
+#endif
+
+//
+// FORWARD CLASS DECLARATIONS
+//
+class HttpParser;
+class HttpServerStream;
+class HttpStream;
+class Socket;
+
+/**
+ *  A message encoded once as a server frame, to be sent on any number of
+ *  connections.
+ *
+ *  Frames from a server are not masked, so the same bytes go to every
+ *  subscriber of a broadcast: a connection queues a reference to the
+ *  frame, and the frames queued are written from where they are with
+ *  vectored writes.  With permessage-deflate each message is compressed
+ *  on its own (no context takeover), so a compressed form is shared too.
+ */
+class DllExport WebSocketFrame {
+public:
+    /** Encode a message.
+     *  @param bBinary  Binary message rather than text
+     *  @param nDeflate zlib level of a compressed form for the connections
+     *                  that negotiated permessage-deflate, 0 for none */
+    WebSocketFrame(std::string_view message, bool bBinary = false, int nDeflate = 0);
+
+    //! Return the frame to send on a connection with or without compression.
+    std::string_view data(bool bDeflate) const {
+        return bDeflate && !deflated_.empty() ? deflated_ : plain_;
+    }
+
+private:
+    friend class WebSocket;
+    WebSocketFrame() = default;
+
+    std::string plain_;
+    std::string deflated_;          // Empty if not smaller than plain_
+};
+
+/**
+ *  A WebSocket connection (RFC 6455) over an HTTP connection that has
+ *  been upgraded.
+ *
+ *  A server accepts the upgrade of an HttpServerStream, a client asks for
+ *  it on an HttpStream; the stream then carries frames and must not be
+ *  used for HTTP again.  Messages are received whole, fragments joined;
+ *  pings are answered as they arrive, and the close handshake is
+ *  completed.  The permessage-deflate extension (RFC 7692) is offered and
+ *  accepted unless setDeflate(0) is called first.  Masking runs 16 or
+ *  32 bytes at a time with SSE2, AVX2 or NEON.
+ *
+ *  On an EventLoop a connection writes through a queue, so a message
+ *  being sent is never interleaved with a pong or a broadcast frame.  A
+ *  broadcast is a WebSocketFrame queued on every subscriber:
+ *  @code
+ *      auto pFrame = std::make_shared<const WebSocketFrame>(update, false, 1);
+ *      for (Subscriber* pSub : subscribers)
+ *          if (pSub->ws.queue(pFrame))
+ *              loop.spawn(pSub->ws.async_flush());
+ *  @endcode
+ */
+class DllExport WebSocket {
+public:
+    /** Frame opcodes. */
+    enum Opcode {
+        opContinuation = 0x0,
+        opText = 0x1,
+        opBinary = 0x2,
+        opClose = 0x8,
+        opPing = 0x9,
+        opPong = 0xA
+    };
+    /** Status codes of a close frame. */
+    enum CloseCode {
+        closeNormal = 1000,
+        closeGoingAway = 1001,
+        closeProtocolError = 1002,
+        closeUnsupported = 1003,
+        closeNoStatus = 1005,
+        closeAbnormal = 1006,
+        closeInvalidData = 1007,
+        closePolicy = 1008,
+        closeTooBig = 1009,
+        closeInternalError = 1011
+    };
+
+    WebSocket();
+    ~WebSocket();
+
+    // Disable copy constructor and assignment operator
+    WebSocket(const WebSocket&) = delete;
+    WebSocket& operator=(const WebSocket&) = delete;
+
+    /** Indicate if a request asks for an upgrade to WebSocket. */
+    static bool isUpgrade(const HttpParser& request);
+    /** Complete the handshake of the current request of conn.  A request
+     *  that is not a valid upgrade is answered with 400, or 426 for
+     *  another version of the protocol, and conn stays HTTP.
+     *  @param protocol Subprotocol to select if the client offers it
+     *  @return False if the request was refused or the connection failed. */
+    bool accept(HttpServerStream& conn, const char* protocol = 0);
+    /** Awaitable form of accept(). */
+    Task<bool> async_accept(HttpServerStream& conn, const char* protocol = 0);
+    /** Ask for an upgrade to WebSocket on a client connection.
+     *  @param headers  Further header lines, each ending with CRLF, such as Host
+     *  @param protocol Subprotocol to ask for
+     *  @return False if the server refused or the connection failed. */
+    bool connect(HttpStream& http, const std::string& uri,
+                 std::string_view headers = std::string_view(), const char* protocol = 0);
+
+    /** Offer or accept permessage-deflate; called before the handshake.
+     *  @param nLevel zlib level of the messages sent: 1 (fastest, the
+     *                default) to 9, or 0 to neither offer nor accept it */
+    void setDeflate(int nLevel) { deflateLevel_ = nLevel; }
+    //! Indicate if permessage-deflate was negotiated.
+    bool deflate() const { return bDeflate_; }
+    //! Return the subprotocol agreed on, empty if none.
+    const std::string& protocol() const { return protocol_; }
+    /** Limit the size of a message received, after decompression; a
+     *  larger one closes the connection with 1009.  The default is 16 MB. */
+    void setMaxMessage(std::size_t uMax) { uMaxMessage_ = uMax; }
+    //! Indicate if the handshake is done and no close frame was received.
+    bool isOpen() const { return pSocket_ != 0 && !bClosed_; }
+    //! Return the status code of the close frame received, 0 if none.
+    UINT closeCode() const { return closeCode_; }
+    //! Return the number of pongs received.
+    UINT pongs() const { return pongs_; }
+
+    /** Receive the next message, joining its fragments.  Control frames
+     *  are handled on the way: pings answered, pongs counted and a close
+     *  frame answered.
+     *  @param pBinary Set to true for a binary message
+     *  @return False once the connection is closed or failed; closeCode()
+     *          tells why. */
+    bool receive(std::string& message, bool* pBinary = 0);
+    /** Awaitable form of receive(). */
+    Task<bool> async_receive(std::string& message, bool* pBinary = 0);
+
+    /** Send a message in one frame.
+     *  @return False if the connection failed. */
+    bool send(std::string_view message, bool bBinary = false);
+    /** Awaitable form of send().  The message is copied. */
+    Task<bool> async_send(std::string_view message, bool bBinary = false);
+    /** Send one fragment of a message too large to hold at once.  The
+     *  first fragment gives the type; the last has bFinal set.  Fragments
+     *  are not compressed.
+     *  @return False if the connection failed. */
+    bool sendFragment(std::string_view data, bool bBinary, bool bFinal);
+    /** Awaitable form of sendFragment(). */
+    Task<bool> async_sendFragment(std::string_view data, bool bBinary, bool bFinal);
+    /** Send a ping of up to 125 bytes; the pong is counted by pongs(). */
+    bool ping(std::string_view payload = std::string_view());
+    /** Awaitable form of ping(). */
+    Task<bool> async_ping(std::string_view payload = std::string_view());
+    /** Start the close handshake; receive() then returns false when the
+     *  peer answers. */
+    bool close(UINT uCode = closeNormal, std::string_view reason = std::string_view());
+    /** Awaitable form of close(). */
+    Task<bool> async_close(UINT uCode = closeNormal, std::string_view reason = std::string_view());
+
+    /** Queue a shared frame behind those waiting on a server connection.
+     *  @return True if no flush is under way, so the caller should start
+     *          async_flush(). */
+    bool queue(std::shared_ptr<const WebSocketFrame> pFrame);
+    //! Return the number of bytes queued and not yet written.
+    std::size_t queued() const { return uQueued_; }
+    /** Write the frames queued, several to a system call.
+     *  @return False if the connection failed. */
+    bool flush();
+    /** Awaitable form of flush().  Frames queued while it waits are
+     *  written too; a second flush started meanwhile returns at once. */
+    Task<bool> async_flush();
+
+    /** XOR data with a masking key, from pSrc to pDst, which may be the
+     *  same.
+     *  @param uPhase Offset in the payload of the first byte, which gives
+     *                the first byte of the key to use */
+    static void mask(char* pDst, const char* pSrc, std::size_t uLength,
+                     const unsigned char key[4], std::size_t uPhase = 0);
+
+private:
+    struct Inflater;
+
+    UINT handshake(const HttpParser& request, const char* protocol, std::string& headers);
+    bool negotiate(std::string_view offers, std::string& response);
+    bool agreed(const HttpParser& response, const std::string& key, const char* protocol);
+    void opened(Socket& rSocket, std::string& rest, bool bClient);
+    std::shared_ptr<WebSocketFrame> makeFrame(int opcode, std::string_view payload, bool bFinal,
+                                              bool bCompress);
+    int step(std::string& message, bool* pBinary);
+    int frame(std::string& message, bool* pBinary);
+    int control(int opcode, std::string_view payload);
+    int fail(UINT uCode);
+    bool push(std::shared_ptr<const WebSocketFrame> pFrame);
+    bool sendFrame(int opcode, std::string_view payload, bool bFinal, bool bCompress);
+    std::string_view encodePayload(std::string_view payload, bool bCompress, bool& bCompressed,
+                                   const unsigned char* pKey);
+    int fragmentOpcode(bool bBinary, bool bFinal);
+    void makeRoom();
+
+    Socket* pSocket_;
+    bool bClient_;
+    int deflateLevel_;
+    bool bDeflate_;                 // permessage-deflate negotiated
+    std::string protocol_;
+    std::size_t uMaxMessage_;
+    std::unique_ptr<Inflater> pInflater_;
+
+    std::string recvBuf_;           // Received, from recvBegin_ to recvEnd_
+    std::size_t recvBegin_;
+    std::size_t recvEnd_;
+    // Frame being received
+    bool bInFrame_;
+    int frameOpcode_;
+    bool bFrameFinal_;
+    unsigned char frameKey_[4];
+    bool bFrameMasked_;
+    uint64_t uFrameLeft_;
+    uint64_t uFrameDone_;
+    // Message being received
+    int messageOpcode_;             // opContinuation when none
+    bool bMessageCompressed_;
+    std::string compressed_;        // Compressed message so far
+    bool bFragmenting_;             // A fragmented message is being sent
+    std::string sendScratch_;       // Payload compressed or masked to send
+
+    std::deque<std::shared_ptr<const WebSocketFrame> > queue_;
+    std::size_t uQueued_;
+    bool bFlushing_;
+    bool bFailed_;
+    bool bCloseSent_;
+    bool bClosed_;                  // Close frame received, or failed
+    UINT closeCode_;
+    UINT pongs_;
+};
+
+}  // namespace sockstr
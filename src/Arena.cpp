@@ -0,0 +1,158 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : Arena.cpp
+//
+// Class      : Arena
+//
+// Description: Monotonic memory resource whose blocks outlive a reset.
+//
+// Decisions  : The blocks are a singly linked list, each with its header
+//              at its start.  An allocation that does not fit the current
+//              block moves on to the next block kept from before the
+//              reset, if it is large enough, or takes a new one and links
+//              it in after the current block; the rest of the block left
+//              behind is not used until the next reset.  Blocks double in
+//              size, so a request that needs much memory takes few of them.
+//
+
+#include "config.h"
+#include <cassert>
+#include <cstdint>
+
+#include <sockstr/Arena.h>
+
+using namespace sockstr;
+
+struct Arena::Block {
+    Block* pNext;
+    std::size_t uSize;              // Including this header
+
+    char* begin() { return reinterpret_cast<char*>(this + 1); }
+    char* end() { return reinterpret_cast<char*>(this) + uSize; }
+};
+
+namespace {
+
+// Round p up to a multiple of uAlign, a power of two
+inline char* alignUp(char* p, std::size_t uAlign) {
+    uintptr_t uAddr = reinterpret_cast<uintptr_t>(p);
+    return reinterpret_cast<char*>((uAddr + uAlign - 1) & ~(uintptr_t(uAlign) - 1));
+}
+
+}  // namespace
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+Arena::Arena(std::size_t uBlockSize, std::pmr::memory_resource* pUpstream)
+    : pUpstream_(pUpstream)
+    , uBlockSize_(uBlockSize < sizeof(Block) * 2 ? sizeof(Block) * 2 : uBlockSize)
+    , pFirst_(nullptr)
+    , pCurrent_(nullptr)
+    , pNext_(nullptr)
+    , pEnd_(nullptr)
+    , uUsed_(0)
+    , uCapacity_(0) {
+}
+
+Arena::~Arena() {
+    release();
+}
+
+void Arena::reset() {
+    pCurrent_ = pFirst_;
+    pNext_ = pFirst_ ? pFirst_->begin() : nullptr;
+    pEnd_ = pFirst_ ? pFirst_->end() : nullptr;
+    uUsed_ = 0;
+}
+
+void Arena::release() {
+    while (pFirst_) {
+        Block* pBlock = pFirst_;
+        pFirst_ = pBlock->pNext;
+        pUpstream_->deallocate(pBlock, pBlock->uSize, alignof(std::max_align_t));
+    }
+    pCurrent_ = nullptr;
+    pNext_ = pEnd_ = nullptr;
+    uUsed_ = 0;
+    uCapacity_ = 0;
+}
+
+void* Arena::do_allocate(std::size_t uBytes, std::size_t uAlign) {
+    char* p = alignUp(pNext_, uAlign);
+    if (pNext_ == nullptr || p + uBytes > pEnd_) {
+        return allocateSlow(uBytes, uAlign);
+    }
+    pNext_ = p + uBytes;
+    uUsed_ += uBytes;
+    return p;
+}
+
+void Arena::do_deallocate(void*, std::size_t, std::size_t) {
+    // Freed by reset()
+}
+
+bool Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+// Abstract : Hand out memory from a block after the current one
+//
+// Returns  : The memory
+// Params   :
+//   uBytes                    Size wanted
+//   uAlign                    Alignment wanted
+//
+// Remarks  : Blocks kept from before the last reset are used in order;
+//            one too small for the request is passed over.
+//
+void* Arena::allocateSlow(std::size_t uBytes, std::size_t uAlign) {
+    std::size_t uNeed = sizeof(Block) + uBytes + uAlign;
+    Block* pBlock = pCurrent_ ? pCurrent_->pNext : pFirst_;
+    while (pBlock && pBlock->uSize < uNeed) {
+        pBlock = pBlock->pNext;
+    }
+    if (pBlock == nullptr) {
+        while (uBlockSize_ < uNeed) {
+            uBlockSize_ *= 2;
+        }
+        pBlock = static_cast<Block*>(pUpstream_->allocate(uBlockSize_, alignof(std::max_align_t)));
+        pBlock->uSize = uBlockSize_;
+        uCapacity_ += uBlockSize_;
+        uBlockSize_ *= 2;
+        if (pCurrent_) {
+            pBlock->pNext = pCurrent_->pNext;
+            pCurrent_->pNext = pBlock;
+        } else {
+            pBlock->pNext = pFirst_;
+            pFirst_ = pBlock;
+        }
+    }
+    pCurrent_ = pBlock;
+    char* p = alignUp(pBlock->begin(), uAlign);
+    pNext_ = p + uBytes;
+    pEnd_ = pBlock->end();
+    uUsed_ += uBytes;
+    return p;
+}
@@ -0,0 +1,474 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : EventLoop.cpp
+//
+// Class      : EventLoop, FramePool
+//
+// Description: Readiness based event loop that resumes coroutines when
+//              their socket can be read or written, and the pool that
+//              provides memory for the coroutine frames.
+//
+// Decisions  : The loop is strictly single threaded.  Scaling to several
+//              cores is done by running one loop per thread, each with its
+//              own FramePool, so neither the frame pool nor the watch table
+//              needs any locking.  Only the posted queue is shared.
+//              Watches are one-shot: a coroutine first tries its operation
+//              and only waits for readiness when the operation would block.
+//              Timeouts live on a TimerWheel whose next expiry bounds the
+//              time spent waiting for readiness.
+//
+
+#include "config.h"
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+#include <unistd.h>
+#include <fcntl.h>
+#if CONFIG_HAS_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#else
+#include <poll.h>
+#endif
+
+#include <sockstr/EventLoop.h>
+
+using namespace sockstr;
+
+//
+// DATA DEFINITIONS
+//
+namespace {
+
+thread_local FramePool* currentPool_ = nullptr;
+thread_local EventLoop* currentLoop_ = nullptr;
+
+// Every frame is preceded by a header recording the pool that owns it.
+// The header keeps the frame aligned for any fundamental type.
+struct FrameHeader {
+    FramePool* pPool;
+    std::size_t uBlockSize;
+};
+constexpr std::size_t frameHeaderSize =
+    (sizeof(FrameHeader) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+constexpr std::size_t slabSize = 64 * 1024;
+
+}  // namespace
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+FramePool::FramePool() {
+    for (std::size_t i = 0; i < numClasses_; i++) {
+        freeLists_[i] = nullptr;
+    }
+}
+
+FramePool::~FramePool() {
+    if (currentPool_ == this) {
+        currentPool_ = nullptr;
+    }
+    for (void* pSlab : slabs_) {
+        ::operator delete(pSlab);
+    }
+}
+
+FramePool* FramePool::current() {
+    return currentPool_;
+}
+
+FramePool* FramePool::setCurrent(FramePool* pPool) {
+    FramePool* pOld = currentPool_;
+    currentPool_ = pPool;
+    return pOld;
+}
+
+// Abstract : Allocate memory for a coroutine frame
+//
+// Returns  : Pointer to the frame
+// Params   :
+//   uSize                     Size of the frame requested by the compiler
+//
+// Post     : The frame is taken from the pool that is current for the calling
+//            thread.  If no pool is current, or the frame is too large for
+//            the pool's size classes, the global heap is used.
+//
+void* FramePool::allocateFrame(std::size_t uSize) {
+    std::size_t uBlockSize = uSize + frameHeaderSize;
+    FramePool* pPool = currentPool_;
+    void* pBlock;
+    if (pPool != nullptr && uBlockSize <= granularity_ * numClasses_) {
+        uBlockSize = (uBlockSize + granularity_ - 1) & ~(granularity_ - 1);
+        pBlock = pPool->allocate(uBlockSize);
+    } else {
+        pPool = nullptr;
+        pBlock = ::operator new(uBlockSize);
+    }
+    FrameHeader* pHeader = static_cast<FrameHeader*>(pBlock);
+    pHeader->pPool = pPool;
+    pHeader->uBlockSize = uBlockSize;
+    return static_cast<char*>(pBlock) + frameHeaderSize;
+}
+
+void FramePool::deallocateFrame(void* pFrame, std::size_t /*uSize*/) {
+    void* pBlock = static_cast<char*>(pFrame) - frameHeaderSize;
+    FrameHeader* pHeader = static_cast<FrameHeader*>(pBlock);
+    if (pHeader->pPool != nullptr) {
+        pHeader->pPool->deallocate(pBlock, pHeader->uBlockSize);
+    } else {
+        ::operator delete(pBlock);
+    }
+}
+
+void* FramePool::allocate(std::size_t uSize) {
+    std::size_t uClass = uSize / granularity_ - 1;
+    FreeBlock* pBlock = freeLists_[uClass];
+    if (pBlock == nullptr) {
+        // Carve a new slab into blocks of this size class
+        char* pSlab = static_cast<char*>(::operator new(slabSize));
+        slabs_.push_back(pSlab);
+        for (std::size_t off = 0; off + uSize <= slabSize; off += uSize) {
+            FreeBlock* pFree = reinterpret_cast<FreeBlock*>(pSlab + off);
+            pFree->pNext = pBlock;
+            pBlock = pFree;
+        }
+    }
+    freeLists_[uClass] = pBlock->pNext;
+    return pBlock;
+}
+
+void FramePool::deallocate(void* pBlock, std::size_t uSize) {
+    std::size_t uClass = uSize / granularity_ - 1;
+    FreeBlock* pFree = static_cast<FreeBlock*>(pBlock);
+    pFree->pNext = freeLists_[uClass];
+    freeLists_[uClass] = pFree;
+}
+
+
+// Abstract : Constructs an EventLoop
+//
+// Post     : The loop is made current for the constructing thread unless
+//            another loop already is, so that tasks created before run()
+//            is called already take their frames from this loop's pool.
+//
+EventLoop::EventLoop()
+    : hPoll_(-1)
+    , hWakeRead_(-1)
+    , hWakeWrite_(-1)
+    , stop_(false)
+    , numTasks_(0) {
+#if CONFIG_HAS_EPOLL
+    hPoll_ = ::epoll_create1(EPOLL_CLOEXEC);
+    VERIFY(hPoll_ >= 0);
+    hWakeRead_ = hWakeWrite_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    VERIFY(hWakeRead_ >= 0);
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = hWakeRead_;
+    ::epoll_ctl(hPoll_, EPOLL_CTL_ADD, hWakeRead_, &ev);
+#else
+    int fds[2];
+    VERIFY(::pipe(fds) == 0);
+    hWakeRead_ = fds[0];
+    hWakeWrite_ = fds[1];
+    ::fcntl(hWakeRead_, F_SETFL, O_NONBLOCK);
+    ::fcntl(hWakeWrite_, F_SETFL, O_NONBLOCK);
+#endif
+    if (currentLoop_ == nullptr) {
+        currentLoop_ = this;
+        currentPool_ = &framePool_;
+    }
+}
+
+EventLoop::~EventLoop() {
+    if (currentLoop_ == this) {
+        currentLoop_ = nullptr;
+    }
+    if (hWakeWrite_ != hWakeRead_) {
+        ::close(hWakeWrite_);
+    }
+    ::close(hWakeRead_);
+    if (hPoll_ >= 0) {
+        ::close(hPoll_);
+    }
+}
+
+EventLoop* EventLoop::current() {
+    return currentLoop_;
+}
+
+void EventLoop::spawn(Task<void> task) {
+    auto handle = task.release();
+    if (handle) {
+        handle.promise().pLiveCount_ = &numTasks_;
+        ++numTasks_;
+        ready_.push_back(handle);
+    }
+}
+
+void EventLoop::post(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard<std::mutex> lock(postLock_);
+        posted_.push_back(handle);
+    }
+    wakeup();
+}
+
+void EventLoop::stop() {
+    stop_ = true;
+    wakeup();
+}
+
+// Abstract : Run the loop
+//
+// Post     : Ready coroutines are resumed and the loop waits for I/O
+//            readiness until either stop() is called or every task that
+//            was spawned on this loop has completed.
+//
+void EventLoop::run() {
+    EventLoop* pOldLoop = currentLoop_;
+    FramePool* pOldPool = currentPool_;
+    currentLoop_ = this;
+    currentPool_ = &framePool_;
+
+    stop_ = false;
+    while (!stop_) {
+        drainPosted();
+        timers_.advance(TimerWheel::monotonicMs());
+        while (!ready_.empty()) {
+            running_.swap(ready_);
+            for (auto handle : running_) {
+                handle.resume();
+            }
+            running_.clear();
+        }
+        if (numTasks_ == 0 || stop_) {
+            break;
+        }
+        wait(timers_.nextTimeout(TimerWheel::monotonicMs()));
+    }
+
+    currentLoop_ = pOldLoop;
+    currentPool_ = pOldPool;
+}
+
+void EventLoop::forget(SOCKET hFile) {
+    if (hFile < 0 || static_cast<std::size_t>(hFile) >= watches_.size()) {
+        return;
+    }
+    Watch& w = watches_[hFile];
+    if (w.registered) {
+#if CONFIG_HAS_EPOLL
+        ::epoll_ctl(hPoll_, EPOLL_CTL_DEL, hFile, nullptr);
+#endif
+        w.registered = false;
+    }
+    if (w.reader) {
+        ready_.push_back(w.reader);
+        w.reader = nullptr;
+    }
+    if (w.writer) {
+        ready_.push_back(w.writer);
+        w.writer = nullptr;
+    }
+}
+
+// Abstract : Timer callback of a readiness wait that timed out
+//
+// Post     : The coroutine no longer waits on the handle and is queued to
+//            run; co_await on the awaiter yields false.
+//
+// Remarks  : If the handle became ready in the same loop iteration the
+//            coroutine is already queued and the timeout is ignored.
+//
+void EventLoop::FdAwaiter::expired(Timer* /*pTimer*/, void* ptr) {
+    FdAwaiter* pAwaiter = static_cast<FdAwaiter*>(ptr);
+    if (pAwaiter->loop_.unwatch(pAwaiter->hFile_, pAwaiter->bWrite_, pAwaiter->handle_)) {
+        pAwaiter->bTimedOut_ = true;
+        pAwaiter->loop_.ready_.push_back(pAwaiter->handle_);
+    }
+}
+
+void EventLoop::SleepAwaiter::expired(Timer* /*pTimer*/, void* ptr) {
+    SleepAwaiter* pAwaiter = static_cast<SleepAwaiter*>(ptr);
+    pAwaiter->loop_.ready_.push_back(pAwaiter->handle_);
+}
+
+void EventLoop::watch(SOCKET hFile, bool bWrite, std::coroutine_handle<> handle) {
+    VERIFY(hFile >= 0);
+    if (static_cast<std::size_t>(hFile) >= watches_.size()) {
+        watches_.resize(hFile + 1);
+    }
+    Watch& w = watches_[hFile];
+    if (bWrite) {
+        w.writer = handle;
+    } else {
+        w.reader = handle;
+    }
+    rearm(hFile, w);
+}
+
+// Abstract : Stop a coroutine from waiting on a handle
+//
+// Returns  : true if the coroutine was still waiting
+//
+bool EventLoop::unwatch(SOCKET hFile, bool bWrite, std::coroutine_handle<> handle) {
+    if (hFile < 0 || static_cast<std::size_t>(hFile) >= watches_.size()) {
+        return false;
+    }
+    Watch& w = watches_[hFile];
+    std::coroutine_handle<>& rWaiter = bWrite ? w.writer : w.reader;
+    if (rWaiter != handle) {
+        return false;
+    }
+    rWaiter = nullptr;
+    // A one-shot registration that fires with nobody waiting is harmless,
+    // so the kernel only needs updating while the other direction waits.
+    if (w.registered && (w.reader || w.writer)) {
+        rearm(hFile, w);
+    }
+    return true;
+}
+
+// Abstract : Tell the kernel which events the coroutines waiting on hFile
+//            are interested in.
+//
+// Remarks  : The handle may have been closed and its number reused since it
+//            was last registered (the kernel then drops it from the epoll
+//            set on its own), so a failed modify falls back to an add.
+//
+void EventLoop::rearm(SOCKET hFile, Watch& w) {
+#if CONFIG_HAS_EPOLL
+    epoll_event ev = {};
+    ev.events = EPOLLONESHOT | EPOLLRDHUP;
+    if (w.reader) ev.events |= EPOLLIN;
+    if (w.writer) ev.events |= EPOLLOUT;
+    ev.data.fd = hFile;
+    if (w.registered) {
+        if (::epoll_ctl(hPoll_, EPOLL_CTL_MOD, hFile, &ev) == 0) {
+            return;
+        }
+    }
+    if (::epoll_ctl(hPoll_, EPOLL_CTL_ADD, hFile, &ev) == 0 ||
+        (errno == EEXIST && ::epoll_ctl(hPoll_, EPOLL_CTL_MOD, hFile, &ev) == 0)) {
+        w.registered = true;
+    } else {
+        // Handle cannot be watched (e.g. already closed): let the
+        // waiting coroutines run into the error themselves.
+        w.registered = false;
+        dispatch(hFile, true, true);
+    }
+#else
+    w.registered = true;
+#endif
+}
+
+void EventLoop::dispatch(SOCKET hFile, bool bReadable, bool bWritable) {
+    Watch& w = watches_[hFile];
+    if (bReadable && w.reader) {
+        ready_.push_back(w.reader);
+        w.reader = nullptr;
+    }
+    if (bWritable && w.writer) {
+        ready_.push_back(w.writer);
+        w.writer = nullptr;
+    }
+    if (w.registered && (w.reader || w.writer)) {
+        // One-shot watch fired for one direction; keep waiting for the other
+        rearm(hFile, w);
+    }
+}
+
+void EventLoop::drainPosted() {
+    std::lock_guard<std::mutex> lock(postLock_);
+    if (!posted_.empty()) {
+        ready_.insert(ready_.end(), posted_.begin(), posted_.end());
+        posted_.clear();
+    }
+}
+
+// Abstract : Wait for I/O readiness and queue the coroutines that can
+//            now proceed.
+//
+// Params   :
+//   nTimeoutMs                Maximum time to wait, or -1 to wait forever
+//
+void EventLoop::wait(int nTimeoutMs) {
+#if CONFIG_HAS_EPOLL
+    epoll_event events[128];
+    int nEvents = ::epoll_wait(hPoll_, events, 128, nTimeoutMs);
+    for (int i = 0; i < nEvents; i++) {
+        int hFile = events[i].data.fd;
+        if (hFile == hWakeRead_) {
+            uint64_t count;
+            while (::read(hWakeRead_, &count, sizeof(count)) > 0) { }
+            continue;
+        }
+        UINT uEvents = events[i].events;
+        bool bError = (uEvents & (EPOLLERR | EPOLLHUP)) != 0;
+        dispatch(hFile,
+                 bError || (uEvents & (EPOLLIN | EPOLLRDHUP)),
+                 bError || (uEvents & EPOLLOUT));
+    }
+#else
+    std::vector<pollfd> fds;
+    fds.push_back({ hWakeRead_, POLLIN, 0 });
+    for (std::size_t i = 0; i < watches_.size(); i++) {
+        const Watch& w = watches_[i];
+        if (w.reader || w.writer) {
+            short events = (w.reader ? POLLIN : 0) | (w.writer ? POLLOUT : 0);
+            fds.push_back({ static_cast<int>(i), events, 0 });
+        }
+    }
+    int nEvents = ::poll(fds.data(), fds.size(), nTimeoutMs);
+    if (nEvents <= 0) {
+        return;
+    }
+    if (fds[0].revents) {
+        char buf[64];
+        while (::read(hWakeRead_, buf, sizeof(buf)) > 0) { }
+    }
+    for (std::size_t i = 1; i < fds.size(); i++) {
+        short revents = fds[i].revents;
+        if (revents) {
+            bool bError = (revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+            dispatch(fds[i].fd, bError || (revents & POLLIN),
+                     bError || (revents & POLLOUT));
+        }
+    }
+#endif
+}
+
+void EventLoop::wakeup() {
+#if CONFIG_HAS_EPOLL
+    uint64_t one = 1;
+    ssize_t ret = ::write(hWakeWrite_, &one, sizeof(one));
+#else
+    char one = 1;
+    ssize_t ret = ::write(hWakeWrite_, &one, sizeof(one));
+#endif
+    (void) ret;
+}
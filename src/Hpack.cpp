@@ -0,0 +1,650 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : Hpack.cpp
+//
+// Class      : HpackTable, HpackEncoder, HpackDecoder
+//
+// Description: Header compression for HTTP/2 (RFC 7541).
+//
+// Decisions  : The static table is looked up by name in a hash table
+//              built on first use; entries with the same name are next to
+//              each other in it, so an exact match is found by comparing
+//              the few values that follow.  The dynamic table is small
+//              (4 KB by default) and searched in order, newest first.
+//              Huffman decoding follows a state machine with one state per
+//              inner node of the code tree, taking four bits a step: no
+//              code is shorter than five bits, so a step completes at most
+//              one symbol.  The machine is built from the code table the
+//              first time it is needed.
+//
+
+#include "config.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include <sockstr/Hpack.h>
+
+using namespace sockstr;
+
+// Number of entries of the static table
+static const std::size_t STATIC_COUNT = 61;
+// Sent in place of a table size when none is to be signalled
+static const std::size_t NO_UPDATE = SIZE_MAX;
+// Longest string accepted by default
+static const std::size_t MAX_STRING = 65536;
+
+namespace {
+
+struct StaticEntry {
+    std::string_view name;
+    std::string_view value;
+};
+
+// RFC 7541 Appendix A; index 1 is the first entry
+const StaticEntry staticTable[STATIC_COUNT] = {
+    { ":authority", "" },
+    { ":method", "GET" },
+    { ":method", "POST" },
+    { ":path", "/" },
+    { ":path", "/index.html" },
+    { ":scheme", "http" },
+    { ":scheme", "https" },
+    { ":status", "200" },
+    { ":status", "204" },
+    { ":status", "206" },
+    { ":status", "304" },
+    { ":status", "400" },
+    { ":status", "404" },
+    { ":status", "500" },
+    { "accept-charset", "" },
+    { "accept-encoding", "gzip, deflate" },
+    { "accept-language", "" },
+    { "accept-ranges", "" },
+    { "accept", "" },
+    { "access-control-allow-origin", "" },
+    { "age", "" },
+    { "allow", "" },
+    { "authorization", "" },
+    { "cache-control", "" },
+    { "content-disposition", "" },
+    { "content-encoding", "" },
+    { "content-language", "" },
+    { "content-length", "" },
+    { "content-location", "" },
+    { "content-range", "" },
+    { "content-type", "" },
+    { "cookie", "" },
+    { "date", "" },
+    { "etag", "" },
+    { "expect", "" },
+    { "expires", "" },
+    { "from", "" },
+    { "host", "" },
+    { "if-match", "" },
+    { "if-modified-since", "" },
+    { "if-none-match", "" },
+    { "if-range", "" },
+    { "if-unmodified-since", "" },
+    { "last-modified", "" },
+    { "link", "" },
+    { "location", "" },
+    { "max-forwards", "" },
+    { "proxy-authenticate", "" },
+    { "proxy-authorization", "" },
+    { "range", "" },
+    { "referer", "" },
+    { "refresh", "" },
+    { "retry-after", "" },
+    { "server", "" },
+    { "set-cookie", "" },
+    { "strict-transport-security", "" },
+    { "transfer-encoding", "" },
+    { "user-agent", "" },
+    { "vary", "" },
+    { "via", "" },
+    { "www-authenticate", "" },
+};
+
+struct HuffmanCode {
+    uint32_t code;
+    uint8_t bits;
+};
+
+// RFC 7541 Appendix B, by symbol; EOS is 256
+const HuffmanCode huffmanCodes[257] = {
+    { 0x1ff8, 13 }, { 0x7fffd8, 23 }, { 0xfffffe2, 28 }, { 0xfffffe3, 28 },
+    { 0xfffffe4, 28 }, { 0xfffffe5, 28 }, { 0xfffffe6, 28 }, { 0xfffffe7, 28 },
+    { 0xfffffe8, 28 }, { 0xffffea, 24 }, { 0x3ffffffc, 30 }, { 0xfffffe9, 28 },
+    { 0xfffffea, 28 }, { 0x3ffffffd, 30 }, { 0xfffffeb, 28 }, { 0xfffffec, 28 },
+    { 0xfffffed, 28 }, { 0xfffffee, 28 }, { 0xfffffef, 28 }, { 0xffffff0, 28 },
+    { 0xffffff1, 28 }, { 0xffffff2, 28 }, { 0x3ffffffe, 30 }, { 0xffffff3, 28 },
+    { 0xffffff4, 28 }, { 0xffffff5, 28 }, { 0xffffff6, 28 }, { 0xffffff7, 28 },
+    { 0xffffff8, 28 }, { 0xffffff9, 28 }, { 0xffffffa, 28 }, { 0xffffffb, 28 },
+    { 0x14, 6 }, { 0x3f8, 10 }, { 0x3f9, 10 }, { 0xffa, 12 },
+    { 0x1ff9, 13 }, { 0x15, 6 }, { 0xf8, 8 }, { 0x7fa, 11 },
+    { 0x3fa, 10 }, { 0x3fb, 10 }, { 0xf9, 8 }, { 0x7fb, 11 },
+    { 0xfa, 8 }, { 0x16, 6 }, { 0x17, 6 }, { 0x18, 6 },
+    { 0x0, 5 }, { 0x1, 5 }, { 0x2, 5 }, { 0x19, 6 },
+    { 0x1a, 6 }, { 0x1b, 6 }, { 0x1c, 6 }, { 0x1d, 6 },
+    { 0x1e, 6 }, { 0x1f, 6 }, { 0x5c, 7 }, { 0xfb, 8 },
+    { 0x7ffc, 15 }, { 0x20, 6 }, { 0xffb, 12 }, { 0x3fc, 10 },
+    { 0x1ffa, 13 }, { 0x21, 6 }, { 0x5d, 7 }, { 0x5e, 7 },
+    { 0x5f, 7 }, { 0x60, 7 }, { 0x61, 7 }, { 0x62, 7 },
+    { 0x63, 7 }, { 0x64, 7 }, { 0x65, 7 }, { 0x66, 7 },
+    { 0x67, 7 }, { 0x68, 7 }, { 0x69, 7 }, { 0x6a, 7 },
+    { 0x6b, 7 }, { 0x6c, 7 }, { 0x6d, 7 }, { 0x6e, 7 },
+    { 0x6f, 7 }, { 0x70, 7 }, { 0x71, 7 }, { 0x72, 7 },
+    { 0xfc, 8 }, { 0x73, 7 }, { 0xfd, 8 }, { 0x1ffb, 13 },
+    { 0x7fff0, 19 }, { 0x1ffc, 13 }, { 0x3ffc, 14 }, { 0x22, 6 },
+    { 0x7ffd, 15 }, { 0x3, 5 }, { 0x23, 6 }, { 0x4, 5 },
+    { 0x24, 6 }, { 0x5, 5 }, { 0x25, 6 }, { 0x26, 6 },
+    { 0x27, 6 }, { 0x6, 5 }, { 0x74, 7 }, { 0x75, 7 },
+    { 0x28, 6 }, { 0x29, 6 }, { 0x2a, 6 }, { 0x7, 5 },
+    { 0x2b, 6 }, { 0x76, 7 }, { 0x2c, 6 }, { 0x8, 5 },
+    { 0x9, 5 }, { 0x2d, 6 }, { 0x77, 7 }, { 0x78, 7 },
+    { 0x79, 7 }, { 0x7a, 7 }, { 0x7b, 7 }, { 0x7ffe, 15 },
+    { 0x7fc, 11 }, { 0x3ffd, 14 }, { 0x1ffd, 13 }, { 0xffffffc, 28 },
+    { 0xfffe6, 20 }, { 0x3fffd2, 22 }, { 0xfffe7, 20 }, { 0xfffe8, 20 },
+    { 0x3fffd3, 22 }, { 0x3fffd4, 22 }, { 0x3fffd5, 22 }, { 0x7fffd9, 23 },
+    { 0x3fffd6, 22 }, { 0x7fffda, 23 }, { 0x7fffdb, 23 }, { 0x7fffdc, 23 },
+    { 0x7fffdd, 23 }, { 0x7fffde, 23 }, { 0xffffeb, 24 }, { 0x7fffdf, 23 },
+    { 0xffffec, 24 }, { 0xffffed, 24 }, { 0x3fffd7, 22 }, { 0x7fffe0, 23 },
+    { 0xffffee, 24 }, { 0x7fffe1, 23 }, { 0x7fffe2, 23 }, { 0x7fffe3, 23 },
+    { 0x7fffe4, 23 }, { 0x1fffdc, 21 }, { 0x3fffd8, 22 }, { 0x7fffe5, 23 },
+    { 0x3fffd9, 22 }, { 0x7fffe6, 23 }, { 0x7fffe7, 23 }, { 0xffffef, 24 },
+    { 0x3fffda, 22 }, { 0x1fffdd, 21 }, { 0xfffe9, 20 }, { 0x3fffdb, 22 },
+    { 0x3fffdc, 22 }, { 0x7fffe8, 23 }, { 0x7fffe9, 23 }, { 0x1fffde, 21 },
+    { 0x7fffea, 23 }, { 0x3fffdd, 22 }, { 0x3fffde, 22 }, { 0xfffff0, 24 },
+    { 0x1fffdf, 21 }, { 0x3fffdf, 22 }, { 0x7fffeb, 23 }, { 0x7fffec, 23 },
+    { 0x1fffe0, 21 }, { 0x1fffe1, 21 }, { 0x3fffe0, 22 }, { 0x1fffe2, 21 },
+    { 0x7fffed, 23 }, { 0x3fffe1, 22 }, { 0x7fffee, 23 }, { 0x7fffef, 23 },
+    { 0xfffea, 20 }, { 0x3fffe2, 22 }, { 0x3fffe3, 22 }, { 0x3fffe4, 22 },
+    { 0x7ffff0, 23 }, { 0x3fffe5, 22 }, { 0x3fffe6, 22 }, { 0x7ffff1, 23 },
+    { 0x3ffffe0, 26 }, { 0x3ffffe1, 26 }, { 0xfffeb, 20 }, { 0x7fff1, 19 },
+    { 0x3fffe7, 22 }, { 0x7ffff2, 23 }, { 0x3fffe8, 22 }, { 0x1ffffec, 25 },
+    { 0x3ffffe2, 26 }, { 0x3ffffe3, 26 }, { 0x3ffffe4, 26 }, { 0x7ffffde, 27 },
+    { 0x7ffffdf, 27 }, { 0x3ffffe5, 26 }, { 0xfffff1, 24 }, { 0x1ffffed, 25 },
+    { 0x7fff2, 19 }, { 0x1fffe3, 21 }, { 0x3ffffe6, 26 }, { 0x7ffffe0, 27 },
+    { 0x7ffffe1, 27 }, { 0x3ffffe7, 26 }, { 0x7ffffe2, 27 }, { 0xfffff2, 24 },
+    { 0x1fffe4, 21 }, { 0x1fffe5, 21 }, { 0x3ffffe8, 26 }, { 0x3ffffe9, 26 },
+    { 0xffffffd, 28 }, { 0x7ffffe3, 27 }, { 0x7ffffe4, 27 }, { 0x7ffffe5, 27 },
+    { 0xfffec, 20 }, { 0xfffff3, 24 }, { 0xfffed, 20 }, { 0x1fffe6, 21 },
+    { 0x3fffe9, 22 }, { 0x1fffe7, 21 }, { 0x1fffe8, 21 }, { 0x7ffff3, 23 },
+    { 0x3fffea, 22 }, { 0x3fffeb, 22 }, { 0x1ffffee, 25 }, { 0x1ffffef, 25 },
+    { 0xfffff4, 24 }, { 0xfffff5, 24 }, { 0x3ffffea, 26 }, { 0x7ffff4, 23 },
+    { 0x3ffffeb, 26 }, { 0x7ffffe6, 27 }, { 0x3ffffec, 26 }, { 0x3ffffed, 26 },
+    { 0x7ffffe7, 27 }, { 0x7ffffe8, 27 }, { 0x7ffffe9, 27 }, { 0x7ffffea, 27 },
+    { 0x7ffffeb, 27 }, { 0xffffffe, 28 }, { 0x7ffffec, 27 }, { 0x7ffffed, 27 },
+    { 0x7ffffee, 27 }, { 0x7ffffef, 27 }, { 0x7fffff0, 27 }, { 0x3ffffee, 26 },
+    { 0x3fffffff, 30 }
+};
+
+// A step of the Huffman decoder
+struct HuffmanStep {
+    uint8_t next;               // State after the four bits
+    uint8_t flags;
+    uint8_t symbol;             // Completed by the step, with stepEmit
+};
+enum {
+    stepEmit = 1,               // A symbol was completed
+    stepFail = 2,               // EOS was decoded, which is an error
+    stepAccept = 4              // The string may end in the next state
+};
+
+// The state machine of the Huffman decoder, one row per inner node
+struct HuffmanDecoder {
+    HuffmanStep steps[256][16];
+
+    HuffmanDecoder();
+};
+
+// Build the code tree, then follow every nibble from every inner node
+HuffmanDecoder::HuffmanDecoder() {
+    struct Node {
+        int child[2] = { -1, -1 };
+        int symbol = -1;
+        int state = -1;         // Row of an inner node
+        int depth = 0;
+        bool bAllOnes = true;   // Reached from the root by 1 bits only
+    };
+    std::vector<Node> nodes(1);
+    nodes[0].state = 0;
+    int nStates = 1;
+    for (int sym = 0; sym <= 256; sym++) {
+        int node = 0;
+        for (int bit = huffmanCodes[sym].bits - 1; bit >= 0; bit--) {
+            int b = (huffmanCodes[sym].code >> bit) & 1;
+            if (nodes[node].child[b] < 0) {
+                nodes[node].child[b] = static_cast<int>(nodes.size());
+                Node child;
+                child.depth = nodes[node].depth + 1;
+                child.bAllOnes = nodes[node].bAllOnes && b == 1;
+                nodes.push_back(child);
+            }
+            node = nodes[node].child[b];
+        }
+        nodes[node].symbol = sym;
+    }
+    for (Node& node : nodes) {
+        if (node.symbol < 0 && node.state < 0) {
+            node.state = nStates++;
+        }
+    }
+    VERIFY(nStates == 256);
+
+    for (const Node& from : nodes) {
+        if (from.symbol >= 0) {
+            continue;
+        }
+        for (int nibble = 0; nibble < 16; nibble++) {
+            HuffmanStep& step = steps[from.state][nibble];
+            step.flags = 0;
+            step.symbol = 0;
+            int node = static_cast<int>(&from - nodes.data());
+            for (int bit = 3; bit >= 0; bit--) {
+                node = nodes[node].child[(nibble >> bit) & 1];
+                if (nodes[node].symbol == 256) {
+                    step.flags |= stepFail;
+                    node = 0;
+                    break;
+                }
+                if (nodes[node].symbol >= 0) {
+                    step.flags |= stepEmit;
+                    step.symbol = static_cast<uint8_t>(nodes[node].symbol);
+                    node = 0;
+                }
+            }
+            step.next = static_cast<uint8_t>(nodes[node].state);
+            // Padding is up to 7 bits of the start of EOS
+            if (nodes[node].bAllOnes && nodes[node].depth <= 7) {
+                step.flags |= stepAccept;
+            }
+        }
+    }
+}
+
+const HuffmanDecoder& huffmanDecoder() {
+    static const HuffmanDecoder decoder;
+    return decoder;
+}
+
+// Index of the first static entry of each name
+const std::unordered_map<std::string_view, uint8_t>& staticNames() {
+    static const std::unordered_map<std::string_view, uint8_t> names = [] {
+        std::unordered_map<std::string_view, uint8_t> map;
+        for (std::size_t idx = STATIC_COUNT; idx-- > 0;) {
+            map[staticTable[idx].name] = static_cast<uint8_t>(idx + 1);
+        }
+        return map;
+    }();
+    return names;
+}
+
+// Fields never put in a table, as their values are secrets (RFC 7541
+// section 7.1.3)
+bool sensitiveName(std::string_view name) {
+    return name == "authorization" || name == "proxy-authorization" || name == "cookie"
+        || name == "set-cookie";
+}
+
+// Fields whose values seldom repeat, so indexing them only pushes out
+// entries that would
+bool volatileName(std::string_view name) {
+    return name == ":path" || name == "content-length" || name == "etag"
+        || name == "last-modified" || name == "if-none-match";
+}
+
+}
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+void HpackTable::add(std::string_view name, std::string_view value) {
+    std::size_t uEntry = name.size() + value.size() + ENTRY_OVERHEAD;
+    if (uEntry > uMaxSize_) {
+        entries_.clear();
+        uSize_ = 0;
+        return;
+    }
+    evict(uEntry);
+    entries_.push_front(Entry{ std::string(name), std::string(value) });
+    uSize_ += uEntry;
+}
+
+void HpackTable::setMaxSize(std::size_t uMax) {
+    uMaxSize_ = uMax;
+    evict(0);
+}
+
+void HpackTable::evict(std::size_t uRoom) {
+    while (!entries_.empty() && uSize_ + uRoom > uMaxSize_) {
+        const Entry& oldest = entries_.back();
+        uSize_ -= oldest.name.size() + oldest.value.size() + ENTRY_OVERHEAD;
+        entries_.pop_back();
+    }
+}
+
+
+HpackEncoder::HpackEncoder()
+    : uPendingSize_(NO_UPDATE)
+    , uLowestSize_(NO_UPDATE) {
+}
+
+void HpackEncoder::setMaxTableSize(std::size_t uMax) {
+    if (uMax == table_.maxSize() && uPendingSize_ == NO_UPDATE) {
+        return;
+    }
+    uLowestSize_ = std::min(uLowestSize_, uMax);
+    uPendingSize_ = uMax;
+    table_.setMaxSize(uMax);
+}
+
+// Abstract : Start a header block
+//
+// Remarks  : A limit lowered and raised again between two blocks is
+//            signalled twice, the lowest first, so that the decoder
+//            evicts what the encoder evicted (RFC 7541 section 4.2).
+//
+void HpackEncoder::beginBlock(std::string& out) {
+    if (uPendingSize_ == NO_UPDATE) {
+        return;
+    }
+    if (uLowestSize_ < uPendingSize_) {
+        encodeInteger(out, uLowestSize_, 5, 0x20);
+    }
+    encodeInteger(out, uPendingSize_, 5, 0x20);
+    uPendingSize_ = uLowestSize_ = NO_UPDATE;
+}
+
+// Abstract : Append a field to a header block
+//
+// Params   :
+//   out                       The header block
+//   name                      Name of the field, in lower case
+//   value                     Value of the field
+//   bSensitive                Never index the field
+//
+// Remarks  : A field is indexed unless it is sensitive, its value seldom
+//            repeats or it would take most of the table.
+//
+void HpackEncoder::encode(std::string& out, std::string_view name, std::string_view value,
+                          bool bSensitive) {
+    bSensitive = bSensitive || sensitiveName(name);
+    std::size_t uNameIndex = 0;
+    const auto& names = staticNames();
+    auto it = names.find(name);
+    if (it != names.end()) {
+        uNameIndex = it->second;
+        for (std::size_t idx = uNameIndex; idx <= STATIC_COUNT && staticTable[idx - 1].name == name;
+             idx++) {
+            if (staticTable[idx - 1].value == value) {
+                encodeInteger(out, idx, 7, 0x80);
+                return;
+            }
+        }
+    }
+    if (!bSensitive) {
+        for (std::size_t idx = 0; idx < table_.count(); idx++) {
+            if (table_.name(idx) == name) {
+                if (table_.value(idx) == value) {
+                    encodeInteger(out, STATIC_COUNT + 1 + idx, 7, 0x80);
+                    return;
+                }
+                if (uNameIndex == 0) {
+                    uNameIndex = STATIC_COUNT + 1 + idx;
+                }
+            }
+        }
+    }
+
+    std::size_t uEntry = name.size() + value.size() + HpackTable::ENTRY_OVERHEAD;
+    bool bIndex = !bSensitive && !volatileName(name) && uEntry <= table_.maxSize() * 3 / 4;
+    if (bIndex) {
+        encodeInteger(out, uNameIndex, 6, 0x40);
+    } else {
+        encodeInteger(out, uNameIndex, 4, bSensitive ? 0x10 : 0x00);
+    }
+    if (uNameIndex == 0) {
+        encodeString(out, name);
+    }
+    encodeString(out, value);
+    if (bIndex) {
+        table_.add(name, value);
+    }
+}
+
+void HpackEncoder::encodeInteger(std::string& out, uint64_t uValue, int nPrefix,
+                                 unsigned char uFlags) {
+    uint64_t uMax = (1u << nPrefix) - 1;
+    if (uValue < uMax) {
+        out += static_cast<char>(uFlags | uValue);
+        return;
+    }
+    out += static_cast<char>(uFlags | uMax);
+    uValue -= uMax;
+    while (uValue >= 128) {
+        out += static_cast<char>(0x80 | (uValue & 0x7f));
+        uValue >>= 7;
+    }
+    out += static_cast<char>(uValue);
+}
+
+std::size_t HpackEncoder::huffmanLength(std::string_view text) {
+    uint64_t uBits = 0;
+    for (unsigned char c : text) {
+        uBits += huffmanCodes[c].bits;
+    }
+    return (uBits + 7) / 8;
+}
+
+void HpackEncoder::encodeString(std::string& out, std::string_view text) {
+    std::size_t uCoded = huffmanLength(text);
+    if (uCoded >= text.size()) {
+        encodeInteger(out, text.size(), 7, 0x00);
+        out.append(text);
+        return;
+    }
+    encodeInteger(out, uCoded, 7, 0x80);
+    std::size_t uStart = out.size();
+    out.resize(uStart + uCoded);
+    char* p = out.data() + uStart;
+    uint64_t uAccum = 0;
+    int nBits = 0;
+    for (unsigned char c : text) {
+        uAccum = (uAccum << huffmanCodes[c].bits) | huffmanCodes[c].code;
+        nBits += huffmanCodes[c].bits;
+        while (nBits >= 8) {
+            nBits -= 8;
+            *p++ = static_cast<char>(uAccum >> nBits);
+        }
+    }
+    // The last byte is padded with the start of EOS
+    if (nBits > 0) {
+        *p++ = static_cast<char>((uAccum << (8 - nBits)) | (0xff >> nBits));
+    }
+}
+
+
+HpackDecoder::HpackDecoder()
+    : uAllowedSize_(HpackTable::DEFAULT_SIZE)
+    , uMaxString_(MAX_STRING) {
+}
+
+// Abstract : Decode a header block
+//
+// Returns  : bool (false if the block is malformed or pField stopped it)
+// Params   :
+//   pData                     The block, its fragments joined
+//   uLength                   Size of the block
+//   pField                    Given each field
+//   ptr                       Passed on to pField
+//
+// Remarks  : A change of table size may only come before the first
+//            field of a block.
+//
+bool HpackDecoder::decode(const char* pData, std::size_t uLength, HpackField pField, void* ptr) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(pData);
+    const unsigned char* pEnd = p + uLength;
+    bool bFields = false;
+    while (p < pEnd) {
+        unsigned char c = *p;
+        uint64_t uIndex;
+        if (c & 0x80) {
+            std::string_view name;
+            std::string_view value;
+            if (!decodeInteger(p, pEnd, 7, uIndex) || !field(uIndex, name, value)
+                || !pField(name, value, ptr)) {
+                return false;
+            }
+            bFields = true;
+            continue;
+        }
+        if ((c & 0xe0) == 0x20) {
+            if (bFields || !decodeInteger(p, pEnd, 5, uIndex) || uIndex > uAllowedSize_) {
+                return false;
+            }
+            table_.setMaxSize(uIndex);
+            continue;
+        }
+
+        bool bIndex = (c & 0x40) != 0;
+        if (!decodeInteger(p, pEnd, bIndex ? 6 : 4, uIndex)) {
+            return false;
+        }
+        if (uIndex == 0) {
+            name_.clear();
+            if (!decodeString(p, pEnd, name_)) {
+                return false;
+            }
+        } else {
+            // Copied, as adding the field may evict the entry
+            std::string_view name;
+            std::string_view value;
+            if (!field(uIndex, name, value)) {
+                return false;
+            }
+            name_.assign(name);
+        }
+        value_.clear();
+        if (!decodeString(p, pEnd, value_)) {
+            return false;
+        }
+        if (bIndex) {
+            table_.add(name_, value_);
+        }
+        if (!pField(name_, value_, ptr)) {
+            return false;
+        }
+        bFields = true;
+    }
+    return true;
+}
+
+bool HpackDecoder::decodeInteger(const unsigned char*& p, const unsigned char* pEnd, int nPrefix,
+                                 uint64_t& uValue) {
+    uint64_t uMax = (1u << nPrefix) - 1;
+    uValue = *p++ & uMax;
+    if (uValue < uMax) {
+        return true;
+    }
+    // Seven bits a byte; more than 56 bits is not a size anyone sends
+    for (int nShift = 0; nShift <= 56; nShift += 7) {
+        if (p == pEnd) {
+            return false;
+        }
+        unsigned char c = *p++;
+        uValue += static_cast<uint64_t>(c & 0x7f) << nShift;
+        if ((c & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HpackDecoder::decodeString(const unsigned char*& p, const unsigned char* pEnd,
+                                std::string& out) {
+    if (p == pEnd) {
+        return false;
+    }
+    bool bHuffman = (*p & 0x80) != 0;
+    uint64_t uLength;
+    if (!decodeInteger(p, pEnd, 7, uLength) || uLength > static_cast<uint64_t>(pEnd - p)
+        || uLength > uMaxString_) {
+        return false;
+    }
+    const unsigned char* pString = p;
+    p += uLength;
+    if (bHuffman) {
+        return decodeHuffman(pString, uLength, out) && out.size() <= uMaxString_;
+    }
+    out.append(reinterpret_cast<const char*>(pString), uLength);
+    return true;
+}
+
+bool HpackDecoder::field(uint64_t uIndex, std::string_view& name, std::string_view& value) const {
+    if (uIndex == 0) {
+        return false;
+    }
+    if (uIndex <= STATIC_COUNT) {
+        name = staticTable[uIndex - 1].name;
+        value = staticTable[uIndex - 1].value;
+        return true;
+    }
+    uIndex -= STATIC_COUNT + 1;
+    if (uIndex >= table_.count()) {
+        return false;
+    }
+    name = table_.name(uIndex);
+    value = table_.value(uIndex);
+    return true;
+}
+
+bool HpackDecoder::decodeHuffman(const unsigned char* pData, std::size_t uLength,
+                                 std::string& out) {
+    const HuffmanDecoder& decoder = huffmanDecoder();
+    uint8_t state = 0;
+    bool bAccept = true;
+    // At most 8 symbols for 5 bytes, the shortest code being 5 bits
+    out.reserve(out.size() + uLength * 8 / 5);
+    for (std::size_t idx = 0; idx < uLength; idx++) {
+        unsigned char c = pData[idx];
+        const HuffmanStep& high = decoder.steps[state][c >> 4];
+        const HuffmanStep& low = decoder.steps[high.next][c & 0x0f];
+        if ((high.flags | low.flags) & stepFail) {
+            return false;
+        }
+        if (high.flags & stepEmit) {
+            out += static_cast<char>(high.symbol);
+        }
+        if (low.flags & stepEmit) {
+            out += static_cast<char>(low.symbol);
+        }
+        state = low.next;
+        bAccept = (low.flags & stepAccept) != 0;
+    }
+    return bAccept;
+}
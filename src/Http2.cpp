@@ -0,0 +1,1790 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : Http2.cpp
+//
+// Class      : Http2Connection
+//
+// Description: HTTP/2 framing, streams and flow control (RFC 9113) over a
+//              Socket, for servers and clients.
+//
+// Decisions  : The connection is a state machine fed from a receive
+//              buffer, like WebSocket: step() takes the whole frames
+//              received and queues the frames to send in outBuf_, and the
+//              blocking and awaitable loops only move bytes.  Frames are
+//              never larger than the 16 KB default, so one always fits in
+//              the buffer.
+//              A request is rebuilt as an HTTP/1.1 head from its decoded
+//              fields and parsed by HttpParser, which gives the handler
+//              the same view of it as on HTTP/1.1, checks the same limits
+//              and leaves one place that parses Content-Length and such.
+//              Handlers reply synchronously, so a request is handled as
+//              soon as its last frame is in; the body of the response is
+//              then sent a frame per stream in turn, so a large body does
+//              not hold back the small ones behind it.
+//
+
+#include "config.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <sockstr/Http2.h>
+#include <sockstr/EventLoop.h>
+#include <sockstr/HttpBody.h>
+#include <sockstr/HttpEncoding.h>
+#include <sockstr/HttpFileCache.h>
+#include <sockstr/HttpStream.h>
+#include <sockstr/Socket.h>
+
+using namespace sockstr;
+
+// Sent by a client before anything else
+static const char PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+static const std::size_t PREFACE_SIZE = sizeof(PREFACE) - 1;
+// Size of a frame header
+static const std::size_t FRAME_HEADER = 9;
+// Largest frame payload received, the default SETTINGS_MAX_FRAME_SIZE
+static const std::size_t MAX_FRAME = 16384;
+// Initial window of a connection and of its streams
+static const int64_t DEFAULT_WINDOW = 65535;
+// Largest flow control window
+static const int64_t MAX_WINDOW = 0x7fffffff;
+// Default window advertised for a stream
+static const UINT STREAM_WINDOW = 1024 * 1024;
+// The window of the connection is this many stream windows
+static const int64_t CONNECTION_WINDOWS = 16;
+// Default SETTINGS_MAX_CONCURRENT_STREAMS of a server
+static const UINT MAX_STREAMS = 100;
+// Size of the receive buffer
+static const std::size_t RECV_BUFFER_SIZE = 65536;
+// Frames are written once this much is queued
+static const std::size_t MAX_PENDING_OUTPUT = 256 * 1024;
+// Awaited reads before the loop lets other connections run
+static const UINT READS_PER_TURN = 16;
+// First block of the arena of a stream, which holds the stream itself
+static const std::size_t STREAM_ARENA = 4096;
+// Largest arena kept for another stream once its stream is done
+static const std::size_t MAX_SPARE_ARENA = 65536;
+
+// Frame types
+enum {
+    frameData = 0x0,
+    frameHeaders = 0x1,
+    framePriority = 0x2,
+    frameRstStream = 0x3,
+    frameSettings = 0x4,
+    framePushPromise = 0x5,
+    framePing = 0x6,
+    frameGoAway = 0x7,
+    frameWindowUpdate = 0x8,
+    frameContinuation = 0x9
+};
+// Frame flags
+enum {
+    flagEndStream = 0x1,
+    flagAck = 0x1,
+    flagEndHeaders = 0x4,
+    flagPadded = 0x8,
+    flagPriority = 0x20,
+    // Not sent: a HEADERS frame that made its stream depend on itself
+    flagSelfDependent = 0x100
+};
+// Settings
+enum {
+    settingHeaderTableSize = 0x1,
+    settingEnablePush = 0x2,
+    settingMaxConcurrentStreams = 0x3,
+    settingInitialWindowSize = 0x4,
+    settingMaxFrameSize = 0x5,
+    settingMaxHeaderListSize = 0x6
+};
+
+namespace {
+
+uint32_t get32(const char* p) {
+    const unsigned char* q = reinterpret_cast<const unsigned char*>(p);
+    return (uint32_t(q[0]) << 24) | (uint32_t(q[1]) << 16) | (uint32_t(q[2]) << 8) | q[3];
+}
+
+void put32(std::string& out, uint32_t uValue) {
+    out += char(uValue >> 24);
+    out += char(uValue >> 16);
+    out += char(uValue >> 8);
+    out += char(uValue);
+}
+
+void appendSetting(std::string& out, int nId, uint32_t uValue) {
+    out += char(nId >> 8);
+    out += char(nId);
+    put32(out, uValue);
+}
+
+// Headers that describe an HTTP/1.1 connection, which HTTP/2 forbids
+bool connectionSpecific(std::string_view name) {
+    return HttpParser::equalNames(name, "connection")
+        || HttpParser::equalNames(name, "keep-alive")
+        || HttpParser::equalNames(name, "proxy-connection")
+        || HttpParser::equalNames(name, "transfer-encoding")
+        || HttpParser::equalNames(name, "upgrade");
+}
+
+const char BASE64URL[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// Encode in base64url without padding, as HTTP2-Settings is
+std::string encodeBase64Url(std::string_view data) {
+    std::string out;
+    uint32_t uBits = 0;
+    int nBits = 0;
+    for (unsigned char c : data) {
+        uBits = (uBits << 8) | c;
+        nBits += 8;
+        while (nBits >= 6) {
+            nBits -= 6;
+            out += BASE64URL[(uBits >> nBits) & 0x3f];
+        }
+    }
+    if (nBits > 0) {
+        out += BASE64URL[(uBits << (6 - nBits)) & 0x3f];
+    }
+    return out;
+}
+
+bool decodeBase64Url(std::string_view text, std::string& out) {
+    uint32_t uBits = 0;
+    int nBits = 0;
+    for (char c : text) {
+        const char* p = c != 0 ? strchr(BASE64URL, c) : nullptr;
+        if (p == nullptr) {
+            // Padding may end it, though it should not be there
+            if (c == '=') {
+                break;
+            }
+            return false;
+        }
+        uBits = (uBits << 6) | uint32_t(p - BASE64URL);
+        nBits += 6;
+        if (nBits >= 8) {
+            nBits -= 8;
+            out += char(uBits >> nBits);
+        }
+    }
+    return true;
+}
+
+}   // namespace
+
+
+// One stream of the connection
+// A stream lives in an arena of its own, with everything it allocates
+struct Http2Connection::Stream {
+    Stream(UINT uId, HttpParser::Kind eKind, Arena& rArena)
+        : arena(rArena), id(uId), parser(eKind, &rArena), head(&rArena), method(&rArena)
+        , scheme(&rArena), authority(&rArena), path(&rArena), status(&rArena)
+        , fields(&rArena), cookie(&rArena), body(&rArena), out(&rArena) { }
+
+    //! Return the size of the body left to send.
+    uint64_t remaining() const {
+        return (pFile && !pFile->loaded()) ? uFileEnd - uFileAt : outData.size() - outAt;
+    }
+
+    Arena& arena;
+    UINT id;
+    // Head received: the request on a server, the response on a client
+    HttpParser parser;
+    std::pmr::string head;          // HTTP/1.1 head that parser refers to
+    std::pmr::string method;        // Pseudo-header fields
+    std::pmr::string scheme;
+    std::pmr::string authority;
+    std::pmr::string path;
+    std::pmr::string status;
+    std::pmr::string fields;        // Other fields as header lines
+    std::pmr::string cookie;        // Cookie fields joined
+    std::size_t uHeadBytes = 0;     // Size of the fields as the RFC counts it
+    bool bRegular = false;          // A regular field has been decoded
+    bool bMalformed = false;
+    bool bTooLarge = false;
+    bool bHeadDone = false;         // The head has come
+    bool bHeadRequest = false;
+    int64_t nDeclared = -1;         // Content-Length of the body received
+    uint64_t uReceived = 0;
+    std::pmr::string body;          // Request body, on a server
+    HttpBodySink* pSink = nullptr;  // Response body, on a client
+    bool bDiscard = false;          // Drop the rest of the body received
+    int64_t nSendWindow = 0;
+    int64_t nRecvWindow = 0;
+    uint64_t uRecvConsumed = 0;     // Not yet given back with WINDOW_UPDATE
+
+    // Body to send, from outData or from the descriptor of pFile
+    std::pmr::string out;
+    std::string_view outData;
+    std::size_t outAt = 0;
+    std::shared_ptr<const HttpFile> pFile;
+    uint64_t uFileAt = 0;
+    uint64_t uFileEnd = 0;
+
+    bool bRemoteDone = false;       // END_STREAM received
+    bool bLocalDone = false;        // END_STREAM sent
+    bool bReset = false;
+    bool bResetAfter = false;       // RST_STREAM once the response is sent
+    bool bReady = false;            // In ready_
+    bool bCounted = false;          // Counted in uActive_
+};
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+Http2Connection::Http2Connection()
+    : pSocket_(0)
+    , pServer_(0)
+    , pHandler_(0)
+    , pData_(0)
+    , bServer_(false)
+    , uMaxStreams_(MAX_STREAMS)
+    , uWindow_(STREAM_WINDOW)
+    , streams_(&nodes_)
+    , uReadyHead_(0)
+    , uActive_(0)
+    , uLastStream_(0)
+    , uNextStream_(1)
+    , uPeerMaxStreams_(MAX_STREAMS)
+    , uPeerMaxFrame_(MAX_FRAME)
+    , nPeerWindow_(DEFAULT_WINDOW)
+    , nSendWindow_(DEFAULT_WINDOW)
+    , nRecvWindow_(DEFAULT_WINDOW)
+    , uRecvConsumed_(0)
+    , recvBegin_(0)
+    , recvEnd_(0)
+    , bPreface_(false)
+    , uBlockStream_(0)
+    , nBlockFlags_(0)
+    , pDecoding_(0)
+    , bFailed_(false)
+    , bGoingAway_(false)
+    , uPeerLastStream_(0)
+    , error_(errNone) {
+}
+
+Http2Connection::~Http2Connection() {
+    for (auto& entry : streams_) {
+        destroy(entry.second);
+    }
+}
+
+bool Http2Connection::isUpgrade(const HttpParser& request) {
+    return HttpParser::hasToken(request.header(hdrUpgrade), "h2c")
+        && HttpParser::hasToken(request.header(hdrConnection), "HTTP2-Settings")
+        && request.header("HTTP2-Settings").data() != nullptr;
+}
+
+void Http2Connection::start(Socket& rSocket, bool bServer) {
+    pSocket_ = &rSocket;
+    bServer_ = bServer;
+    uNextStream_ = bServer ? 2 : 1;
+    recvBuf_.resize(RECV_BUFFER_SIZE);
+    recvBegin_ = recvEnd_ = 0;
+    // A client sends its preface, a server expects it
+    bPreface_ = !bServer;
+    decoder_.setMaxString(limits_.uMaxHeaderBytes);
+    // Frames are gathered and written together, so Nagle would only hold
+    // back the small ones that open streams and give back window
+    int nNoDelay = 1;
+    rSocket.setSockOpt(TCP_NODELAY, &nNoDelay, sizeof(nNoDelay), IPPROTO_TCP);
+}
+
+// Abstract : Serve a connection as HTTP/2
+//
+// Returns  : False if the connection ended with an error
+// Params   :
+//   conn                      Connection, on an upgrade request or after
+//                             the preface
+//   pHandler                  Routine that handles the requests
+//   ptr                       Passed to pHandler
+//
+// Remarks  : The request that asked for the upgrade is answered on stream
+//            1 once the server's settings have gone out.  The loop ends
+//            when the client closes the connection, or goes away and its
+//            last streams are done.
+//
+Task<bool> Http2Connection::async_serve(HttpServerStream& conn, HttpHandler pHandler, void* ptr) {
+    start(conn, true);
+    pServer_ = &conn;
+    pHandler_ = pHandler;
+    pData_ = ptr;
+
+    std::string rest;
+    Stream* pUpgraded = nullptr;
+    if (isUpgrade(conn.getParser())) {
+        const HttpParser& request = conn.getParser();
+        std::string settings;
+        if (!decodeBase64Url(HttpParser::trim(request.header("HTTP2-Settings")), settings)
+            || settings.size() % 6 != 0) {
+            conn.closeAfterResponse();
+            conn.appendResponse("Invalid HTTP2-Settings\n", "text/plain", 400);
+            co_await conn.async_flushResponses();
+            co_return false;
+        }
+        // The request becomes stream 1; its head is copied before the
+        // receive buffer is handed over
+        pUpgraded = open(1);
+        uLastStream_ = 1;
+        pUpgraded->head.append(request.method());
+        pUpgraded->head += ' ';
+        pUpgraded->head.append(request.uri());
+        pUpgraded->head += " HTTP/1.1\r\n";
+        for (UINT idx = 0; idx < request.headerCount(); idx++) {
+            HttpParser::Header header = request.headerAt(idx);
+            if (!connectionSpecific(header.name)
+                    && !HttpParser::equalNames(header.name, "HTTP2-Settings")) {
+                pUpgraded->head.append(header.name);
+                pUpgraded->head += ": ";
+                pUpgraded->head.append(header.value);
+                pUpgraded->head += "\r\n";
+            }
+        }
+        pUpgraded->head += "\r\n";
+        pUpgraded->body.assign(conn.requestBody());
+        pUpgraded->parser.setLimits(limits_);
+        pUpgraded->parser.parse(pUpgraded->head.data(), pUpgraded->head.size());
+        pUpgraded->bHeadDone = true;
+        pUpgraded->bHeadRequest = request.method() == "HEAD";
+        if (!co_await conn.async_upgrade("Connection: Upgrade\r\nUpgrade: h2c\r\n", rest)
+            || !applySettings(settings.data(), settings.size())) {
+            co_return false;
+        }
+    } else {
+        conn.handOver(rest);
+    }
+    if (rest.size() > recvBuf_.size()) {
+        recvBuf_.resize(rest.size());
+    }
+    memcpy(recvBuf_.data(), rest.data(), rest.size());
+    recvEnd_ = rest.size();
+
+    queueSettings();
+    if (pUpgraded) {
+        received(*pUpgraded);
+    }
+
+    UINT uReads = 0;
+    for (;;) {
+        int nResult = step();
+        bool bMore;
+        do {
+            bMore = pump();
+            if (!co_await async_flush()) {
+                bFailed_ = true;
+                break;
+            }
+        } while (bMore);
+        if (nResult < 0 || bFailed_ || (bGoingAway_ && uActive_ == 0)) {
+            break;
+        }
+        makeRoom();
+        // Data that keeps arriving would hold the loop
+        if (++uReads % READS_PER_TURN == 0) {
+            co_await EventLoop::current()->yield();
+        }
+        int nRead = co_await conn.async_read(recvBuf_.data() + recvEnd_,
+                                             recvBuf_.size() - recvEnd_);
+        if (nRead <= 0) {
+            break;
+        }
+        recvEnd_ += nRead;
+    }
+    co_return error_ == errNone;
+}
+
+bool Http2Connection::connect(Socket& rSocket, std::string_view authority,
+                              std::string_view scheme) {
+    start(rSocket, false);
+    authority_ = authority;
+    scheme_ = scheme;
+    outBuf_.assign(PREFACE, PREFACE_SIZE);
+    queueSettings();
+    return flush();
+}
+
+// Abstract : Upgrade an HTTP/1.1 connection to HTTP/2
+//
+// Returns  : Status of the HTTP/1.1 response, 101 if switched
+//
+// Remarks  : The request is complete once sent, so stream 1 is half
+//            closed from the start; the settings that went in
+//            HTTP2-Settings are those of the preface too.
+//
+UINT Http2Connection::upgrade(HttpStream& http, const std::string& uri,
+                              std::string_view authority, HttpBodySink& sink,
+                              std::string_view headers) {
+    std::string request(headers);
+    if (request.find("Host:") == std::string::npos) {
+        request += "Host: ";
+        request += authority;
+        request += "\r\n";
+    }
+    std::string settings;
+    appendSetting(settings, settingEnablePush, 0);
+    appendSetting(settings, settingInitialWindowSize, uWindow_);
+    request += "Connection: Upgrade, HTTP2-Settings\r\nUpgrade: h2c\r\nHTTP2-Settings: ";
+    request += encodeBase64Url(settings);
+    request += "\r\n";
+
+    std::string rest;
+    UINT uStatus = http.upgrade(uri, request, rest, &sink);
+    if (uStatus != 101) {
+        return uStatus;
+    }
+    start(http, false);
+    authority_ = authority;
+    scheme_ = "http";
+    if (rest.size() > recvBuf_.size()) {
+        recvBuf_.resize(rest.size());
+    }
+    memcpy(recvBuf_.data(), rest.data(), rest.size());
+    recvEnd_ = rest.size();
+
+    Stream* pStream = open(1);
+    uNextStream_ = 3;
+    pStream->pSink = &sink;
+    pStream->bLocalDone = true;
+    pStream->bCounted = true;
+    uActive_++;
+    stats_.streams++;
+
+    outBuf_.assign(PREFACE, PREFACE_SIZE);
+    queueSettings();
+    flush();
+    return uStatus;
+}
+
+UINT Http2Connection::submit(const char* method, std::string_view path, HttpBodySink& sink,
+                             std::string_view body, std::string_view headers) {
+    if (!isOpen() || bServer_) {
+        return 0;
+    }
+    UINT uStream = uNextStream_;
+    uNextStream_ += 2;
+    Stream* pStream = open(uStream);
+    pStream->method = method;
+    pStream->path = path;
+    pStream->fields = headers;
+    pStream->outData = body;
+    pStream->pSink = &sink;
+    pStream->bHeadRequest = pStream->method == "HEAD";
+    waiting_.push_back(pStream);
+    openWaiting();
+    return uStream;
+}
+
+bool Http2Connection::wait(UINT uStream) {
+    Stream* pStream = find(uStream);
+    if (pStream == nullptr) {
+        return false;
+    }
+    while (!pStream->bRemoteDone && !pStream->bReset) {
+        if (!exchange()) {
+            return false;
+        }
+    }
+    return !pStream->bReset;
+}
+
+bool Http2Connection::waitAll() {
+    while (uActive_ > 0 || !waiting_.empty()) {
+        if (!exchange()) {
+            return false;
+        }
+    }
+    // What is left, such as window updates, goes out now
+    return flush();
+}
+
+UINT Http2Connection::status(UINT uStream) const {
+    Stream* pStream = find(uStream);
+    return (pStream && pStream->bHeadDone && !pStream->bReset) ? pStream->parser.statusCode() : 0;
+}
+
+const HttpParser* Http2Connection::response(UINT uStream) const {
+    Stream* pStream = find(uStream);
+    return (pStream && pStream->bHeadDone) ? &pStream->parser : nullptr;
+}
+
+void Http2Connection::release(UINT uStream) {
+    Stream* pStream = find(uStream);
+    if (pStream == nullptr) {
+        return;
+    }
+    if (!pStream->bReset && !(pStream->bRemoteDone && pStream->bLocalDone)) {
+        // Opened and not done: the server is told to stop
+        if (pStream->bCounted) {
+            queueReset(uStream, errCancel);
+        }
+        pStream->bReset = true;
+        if (pStream->bCounted) {
+            pStream->bCounted = false;
+            uActive_--;
+        }
+    }
+    forget(pStream);
+}
+
+void Http2Connection::close() {
+    if (pSocket_ == 0) {
+        return;
+    }
+    if (!bFailed_) {
+        std::string payload;
+        put32(payload, uLastStream_);
+        put32(payload, errNone);
+        queueFrame(frameGoAway, 0, 0, payload);
+        flush();
+    }
+    pSocket_->close();
+    pSocket_ = 0;
+    bGoingAway_ = true;
+}
+
+const HttpParser& Http2Connection::request(UINT uStream) const {
+    static const HttpParser none;
+    Stream* pStream = find(uStream);
+    return pStream ? pStream->parser : none;
+}
+
+std::string_view Http2Connection::requestBody(UINT uStream) const {
+    Stream* pStream = find(uStream);
+    return pStream ? std::string_view(pStream->body) : std::string_view();
+}
+
+// Abstract : Send the response of a handler
+//
+// Remarks  : The body is compressed as HttpServerStream::appendResponse()
+//            would, and copied, as the handler's buffer does not outlive
+//            the call.
+//
+void Http2Connection::reply(UINT uStream, UINT uStatus, std::string_view body,
+                            const char* contentType, std::string_view headers) {
+    Stream* pStream = find(uStream);
+    if (pStream == nullptr || pStream->bReset || pStream->bLocalDone) {
+        return;
+    }
+    const char* pEncoding = nullptr;
+    int nLevel = pServer_->getCompression();
+    if (nLevel > 0 && body.size() >= HttpEncoding::MIN_COMPRESSED
+        && HttpEncoding::compressible(contentType)
+        && headers.find("Content-Encoding:") == std::string_view::npos) {
+        pEncoding = "Vary: Accept-Encoding\r\n";
+        if (HttpEncoding::accepts(pStream->parser.header(hdrAcceptEncoding), "gzip")) {
+            std::string_view packed = HttpEncoding::gzip(body, nLevel);
+            if (!packed.empty()) {
+                body = packed;
+                pEncoding = "Content-Encoding: gzip\r\nVary: Accept-Encoding\r\n";
+            }
+        }
+    }
+    bool bEnd = pStream->bHeadRequest || body.empty();
+    respond(*pStream, uStatus, body.size(), contentType, headers, pEncoding, bEnd);
+    if (bEnd) {
+        sent(*pStream);
+        return;
+    }
+    pStream->out.assign(body);
+    pStream->outData = pStream->out;
+    ready(*pStream);
+}
+
+void Http2Connection::replyFile(UINT uStream, HttpFileCache& rCache, std::string_view path) {
+    Stream* pStream = find(uStream);
+    if (pStream == nullptr || pStream->bReset || pStream->bLocalDone) {
+        return;
+    }
+    const HttpParser& request = pStream->parser;
+    if (request.method() != "GET" && request.method() != "HEAD") {
+        reply(uStream, 405, std::string_view(), 0, "Allow: GET, HEAD\r\n");
+        return;
+    }
+    std::shared_ptr<const HttpFile> pFile = rCache.find(path);
+    if (!pFile) {
+        reply(uStream, 404, std::string_view(), 0, std::string_view());
+        return;
+    }
+    if (pFile->gzip() && HttpEncoding::accepts(request.header(hdrAcceptEncoding), "gzip")) {
+        pFile = pFile->gzip();
+    }
+    if (HttpServerStream::notModified(request, *pFile)) {
+        respond(*pStream, 304, pFile->size(), 0, pFile->headers(), nullptr, true);
+        sent(*pStream);
+        return;
+    }
+    bool bEnd = pStream->bHeadRequest || pFile->size() == 0;
+    respond(*pStream, 200, pFile->size(), pFile->contentType(), pFile->headers(), nullptr, bEnd);
+    if (bEnd) {
+        sent(*pStream);
+        return;
+    }
+    if (pFile->loaded()) {
+        pStream->outData = pFile->contents();
+    } else {
+        pStream->uFileEnd = pFile->size();
+    }
+    pStream->pFile = std::move(pFile);
+    ready(*pStream);
+}
+
+// Abstract : Queue the HEADERS of a response
+//
+// Params   :
+//   uLength                   Length of the body, for Content-Length
+//   headers                   Further header lines, each ending with CRLF
+//   pEncoding                 Content-Encoding and Vary lines, or null
+//   bEnd                      The response has no body to follow
+//
+void Http2Connection::respond(Stream& rStream, UINT uStatus, uint64_t uLength,
+                              const char* contentType, std::string_view headers,
+                              const char* pEncoding, bool bEnd) {
+    std::string& lines = sendLines_;
+    lines.clear();
+    if (contentType) {
+        lines += "content-type: ";
+        lines += contentType;
+        lines += "\r\n";
+    }
+    if (uStatus >= 200 && uStatus != 204) {
+        lines += "content-length: ";
+        lines += std::to_string(uLength);
+        lines += "\r\n";
+    }
+    lines += headers;
+    if (pEncoding) {
+        lines += pEncoding;
+    }
+    // The Date and any other default headers of the server
+    pServer_->expandHeaders(lines);
+
+    std::string& block = sendBlock_;
+    block.clear();
+    encoder_.beginBlock(block);
+    char status[8];
+    snprintf(status, sizeof(status), "%03u", uStatus % 1000);
+    encoder_.encode(block, ":status", status);
+    stats_.fieldBytes += 17;        // "HTTP/1.1 200 OK\r\n", give or take the reason
+    encodeLines(block, lines);
+    queueHeaders(rStream, block, bEnd);
+}
+
+void Http2Connection::queueSettings() {
+    queueFrame(frameSettings, 0, 0, settingsPayload());
+    // The window of the connection is raised at once; it cannot be set
+    int64_t nWindow = std::min<int64_t>(int64_t(uWindow_) * CONNECTION_WINDOWS, MAX_WINDOW);
+    if (nWindow > nRecvWindow_) {
+        std::string increment;
+        put32(increment, uint32_t(nWindow - nRecvWindow_));
+        queueFrame(frameWindowUpdate, 0, 0, increment);
+        nRecvWindow_ = nWindow;
+    }
+}
+
+std::string Http2Connection::settingsPayload() const {
+    std::string payload;
+    if (bServer_) {
+        appendSetting(payload, settingMaxConcurrentStreams, uMaxStreams_);
+        appendSetting(payload, settingMaxHeaderListSize, limits_.uMaxHeaderBytes);
+    } else {
+        appendSetting(payload, settingEnablePush, 0);
+    }
+    appendSetting(payload, settingInitialWindowSize, uWindow_);
+    return payload;
+}
+
+// Abstract : Apply the settings of the peer
+//
+// Returns  : False on a connection error
+//
+bool Http2Connection::applySettings(const char* pData, std::size_t uLength) {
+    for (std::size_t pos = 0; pos + 6 <= uLength; pos += 6) {
+        int nId = (static_cast<unsigned char>(pData[pos]) << 8)
+                  | static_cast<unsigned char>(pData[pos + 1]);
+        uint32_t uValue = get32(pData + pos + 2);
+        switch (nId) {
+        case settingHeaderTableSize:
+            encoder_.setMaxTableSize(uValue);
+            break;
+        case settingEnablePush:
+            // Push is never used; a server may only turn it off
+            if (uValue > 1 || (!bServer_ && uValue != 0)) {
+                return fail(errProtocol);
+            }
+            break;
+        case settingMaxConcurrentStreams:
+            uPeerMaxStreams_ = uValue;
+            break;
+        case settingInitialWindowSize: {
+            if (uValue > MAX_WINDOW) {
+                return fail(errFlowControl);
+            }
+            // The change applies to every stream, open or not yet
+            int64_t nDelta = int64_t(uValue) - nPeerWindow_;
+            nPeerWindow_ = uValue;
+            for (auto& entry : streams_) {
+                Stream& rStream = *entry.second;
+                rStream.nSendWindow += nDelta;
+                if (rStream.nSendWindow > MAX_WINDOW) {
+                    return fail(errFlowControl);
+                }
+                // A stream still waiting for its HEADERS sends nothing yet
+                if (nDelta > 0 && rStream.bCounted && rStream.remaining() > 0) {
+                    ready(rStream);
+                }
+            }
+            break;
+        }
+        case settingMaxFrameSize:
+            if (uValue < MAX_FRAME || uValue > 0xffffff) {
+                return fail(errProtocol);
+            }
+            uPeerMaxFrame_ = uValue;
+            break;
+        default:
+            // Unknown settings, and the limit on header lists, are ignored
+            break;
+        }
+    }
+    return true;
+}
+
+Http2Connection::Stream* Http2Connection::find(UINT uStream) const {
+    auto it = streams_.find(uStream);
+    return it == streams_.end() ? nullptr : it->second;
+}
+
+// Abstract : Create a stream, in an arena left by another if there is one
+//
+Http2Connection::Stream* Http2Connection::open(UINT uStream) {
+    Arena* pArena;
+    if (spare_.empty()) {
+        pArena = new Arena(STREAM_ARENA);
+    } else {
+        pArena = spare_.back().release();
+        spare_.pop_back();
+    }
+    void* pMemory = pArena->allocate(sizeof(Stream), alignof(Stream));
+    Stream* pStream = new (pMemory) Stream(uStream, bServer_ ? HttpParser::messageRequest
+                                                              : HttpParser::messageResponse,
+                                           *pArena);
+    pStream->nSendWindow = nPeerWindow_;
+    pStream->nRecvWindow = uWindow_;
+    streams_[uStream] = pStream;
+    return pStream;
+}
+
+// Abstract : Destroy a stream and free its arena at once
+//
+// Remarks  : The arena is kept for the next stream unless it grew large,
+//            with a big body, or there are already enough of them.
+//
+void Http2Connection::destroy(Stream* pStream) {
+    Arena* pArena = &pStream->arena;
+    pStream->~Stream();
+    if (pArena->capacity() > MAX_SPARE_ARENA || spare_.size() >= uMaxStreams_) {
+        delete pArena;
+        return;
+    }
+    pArena->reset();
+    spare_.emplace_back(pArena);
+}
+
+void Http2Connection::forget(Stream* pStream) {
+    if (pStream->bReady) {
+        ready_.erase(std::find(ready_.begin() + uReadyHead_, ready_.end(), pStream));
+    }
+    auto it = std::find(waiting_.begin(), waiting_.end(), pStream);
+    if (it != waiting_.end()) {
+        waiting_.erase(it);
+    }
+    streams_.erase(pStream->id);
+    destroy(pStream);
+}
+
+// Abstract : Account for a stream that may have closed
+//
+// Remarks  : A server forgets a stream once closed, so rStream must not be
+//            used after this; a client keeps it for response() until it
+//            is released.
+//
+void Http2Connection::checkClosed(Stream& rStream) {
+    if (!rStream.bReset && !(rStream.bRemoteDone && rStream.bLocalDone)) {
+        return;
+    }
+    if (rStream.bCounted) {
+        rStream.bCounted = false;
+        uActive_--;
+    }
+    if (bServer_) {
+        forget(&rStream);
+    } else {
+        openWaiting();
+    }
+}
+
+// Indicate if a stream has not been opened yet
+bool Http2Connection::idle(UINT uStream) const {
+    bool bPeers = (uStream & 1) == (bServer_ ? 1u : 0u);
+    return bPeers ? uStream > uLastStream_ : uStream >= uNextStream_;
+}
+
+// Abstract : Take the frames in the receive buffer
+//
+// Returns  : 0 when more data is needed; -1 once the connection failed
+//
+int Http2Connection::step() {
+    if (!bPreface_) {
+        std::size_t uAvail = recvEnd_ - recvBegin_;
+        std::size_t uCheck = std::min(uAvail, PREFACE_SIZE);
+        if (memcmp(recvBuf_.data() + recvBegin_, PREFACE, uCheck) != 0) {
+            fail(errProtocol);
+            return -1;
+        }
+        if (uAvail < PREFACE_SIZE) {
+            return 0;
+        }
+        recvBegin_ += PREFACE_SIZE;
+        bPreface_ = true;
+    }
+    while (!bFailed_) {
+        std::size_t uAvail = recvEnd_ - recvBegin_;
+        if (uAvail < FRAME_HEADER) {
+            return 0;
+        }
+        const char* p = recvBuf_.data() + recvBegin_;
+        std::size_t uLength = (std::size_t(static_cast<unsigned char>(p[0])) << 16)
+                              | (std::size_t(static_cast<unsigned char>(p[1])) << 8)
+                              | static_cast<unsigned char>(p[2]);
+        if (uLength > MAX_FRAME) {
+            fail(errFrameSize);
+            return -1;
+        }
+        if (uAvail < FRAME_HEADER + uLength) {
+            return 0;
+        }
+        int nType = static_cast<unsigned char>(p[3]);
+        int nFlags = static_cast<unsigned char>(p[4]);
+        UINT uStream = get32(p + 5) & 0x7fffffff;
+        recvBegin_ += FRAME_HEADER + uLength;
+        if (!frame(nType, nFlags, uStream, p + FRAME_HEADER, uLength)) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+// Abstract : Act on one frame
+//
+// Returns  : False on a connection error
+//
+bool Http2Connection::frame(int nType, int nFlags, UINT uStream,
+                            const char* pData, std::size_t uLength) {
+    stats_.framesReceived++;
+    // A header block is not interleaved with anything
+    if (uBlockStream_ != 0 && (nType != frameContinuation || uStream != uBlockStream_)) {
+        return fail(errProtocol);
+    }
+    switch (nType) {
+    case frameData:
+        if (uStream == 0) {
+            return fail(errProtocol);
+        }
+        return onData(find(uStream), nFlags, uStream, pData, uLength);
+
+    case frameHeaders:
+        return onHeaders(nFlags, uStream, pData, uLength);
+
+    case framePriority:
+        // Priorities are not followed, only checked
+        if (uStream == 0) {
+            return fail(errProtocol);
+        }
+        if (uLength != 5) {
+            return streamError(find(uStream), uStream, errFrameSize);
+        }
+        if ((get32(pData) & 0x7fffffff) == uStream) {
+            return streamError(find(uStream), uStream, errProtocol);
+        }
+        return true;
+
+    case frameRstStream: {
+        if (uStream == 0 || idle(uStream)) {
+            return fail(errProtocol);
+        }
+        if (uLength != 4) {
+            return fail(errFrameSize);
+        }
+        Stream* pStream = find(uStream);
+        if (pStream == nullptr || pStream->bReset) {
+            return true;
+        }
+        if (!bServer_ && pStream->bRemoteDone && get32(pData) == errNone) {
+            // A complete response, such as 413, only stops the rest of the
+            // request body (RFC 9113 section 8.1); it is not discarded
+            pStream->bLocalDone = true;
+        } else {
+            pStream->bReset = true;
+        }
+        checkClosed(*pStream);
+        return true;
+    }
+
+    case frameSettings:
+        if (uStream != 0) {
+            return fail(errProtocol);
+        }
+        return onSettings(nFlags, pData, uLength);
+
+    case framePushPromise:
+        // Clients do not push, and this client disabled push
+        return fail(errProtocol);
+
+    case framePing:
+        if (uStream != 0) {
+            return fail(errProtocol);
+        }
+        if (uLength != 8) {
+            return fail(errFrameSize);
+        }
+        if ((nFlags & flagAck) == 0) {
+            queueFrame(framePing, flagAck, 0, std::string_view(pData, uLength));
+        }
+        return true;
+
+    case frameGoAway:
+        if (uStream != 0) {
+            return fail(errProtocol);
+        }
+        if (uLength < 8) {
+            return fail(errFrameSize);
+        }
+        bGoingAway_ = true;
+        uPeerLastStream_ = get32(pData) & 0x7fffffff;
+        if (!bServer_) {
+            // Streams the server did not get to are not processed
+            for (auto& entry : streams_) {
+                Stream& rStream = *entry.second;
+                if (rStream.id > uPeerLastStream_ && !rStream.bReset) {
+                    rStream.bReset = true;
+                    checkClosed(rStream);
+                }
+            }
+            for (Stream* pStream : waiting_) {
+                pStream->bReset = true;
+            }
+            waiting_.clear();
+        }
+        return true;
+
+    case frameWindowUpdate:
+        return onWindowUpdate(uStream, pData, uLength);
+
+    case frameContinuation:
+        if (uBlockStream_ == 0) {
+            return fail(errProtocol);
+        }
+        block_.append(pData, uLength);
+        if (block_.size() > limits_.uMaxHeaderBytes) {
+            return fail(errEnhanceYourCalm);
+        }
+        nBlockFlags_ |= nFlags & flagEndHeaders;
+        return (nFlags & flagEndHeaders) ? endHeaders() : true;
+
+    default:
+        // Unknown frames are ignored
+        return true;
+    }
+}
+
+bool Http2Connection::onData(Stream* pStream, int nFlags, UINT uStream,
+                             const char* pData, std::size_t uLength) {
+    if (idle(uStream)) {
+        return fail(errProtocol);
+    }
+    // Padding counts against the windows like the data
+    std::size_t uFlowed = uLength;
+    if (nFlags & flagPadded) {
+        std::size_t uPad = uLength > 0 ? static_cast<unsigned char>(pData[0]) : 0;
+        if (uLength == 0 || uPad >= uLength) {
+            return fail(errProtocol);
+        }
+        pData++;
+        uLength -= 1 + uPad;
+    }
+    nRecvWindow_ -= uFlowed;
+    if (nRecvWindow_ < 0) {
+        return fail(errFlowControl);
+    }
+    if (pStream == nullptr || pStream->bReset || pStream->bRemoteDone) {
+        consume(nullptr, uFlowed);
+        if (pStream && !pStream->bReset) {
+            return streamError(pStream, uStream, errStreamClosed);
+        }
+        return true;
+    }
+    if (!pStream->bHeadDone) {
+        consume(nullptr, uFlowed);
+        return streamError(pStream, uStream, errProtocol);
+    }
+    pStream->nRecvWindow -= uFlowed;
+    if (pStream->nRecvWindow < 0) {
+        consume(nullptr, uFlowed);
+        return streamError(pStream, uStream, errFlowControl);
+    }
+    pStream->uReceived += uLength;
+    if (!pStream->bDiscard) {
+        if (bServer_) {
+            pStream->body.append(pData, uLength);
+            if (pStream->body.size() > limits_.uMaxBody) {
+                replyError(*pStream, 413);
+                // The stream may have been forgotten
+                consume(nullptr, uFlowed);
+                return true;
+            }
+        } else if (!pStream->pSink->write(pData, uLength)) {
+            consume(nullptr, uFlowed);
+            return streamError(pStream, uStream, errCancel);
+        }
+    }
+    bool bEnd = (nFlags & flagEndStream) != 0;
+    // The window of a stream that is ending is not worth updating
+    consume(bEnd ? nullptr : pStream, uFlowed);
+    if (bEnd) {
+        pStream->bRemoteDone = true;
+        if (pStream->nDeclared >= 0 && pStream->uReceived != uint64_t(pStream->nDeclared)
+            && !pStream->bDiscard) {
+            return streamError(pStream, uStream, errProtocol);
+        }
+        received(*pStream);
+    }
+    return true;
+}
+
+bool Http2Connection::onHeaders(int nFlags, UINT uStream, const char* pData,
+                                std::size_t uLength) {
+    if (uStream == 0) {
+        return fail(errProtocol);
+    }
+    std::size_t uBegin = 0;
+    std::size_t uPad = 0;
+    if (nFlags & flagPadded) {
+        if (uLength < 1) {
+            return fail(errFrameSize);
+        }
+        uPad = static_cast<unsigned char>(pData[0]);
+        uBegin = 1;
+    }
+    if (nFlags & flagPriority) {
+        if (uLength < uBegin + 5) {
+            return fail(errFrameSize);
+        }
+        uBegin += 5;
+    }
+    if (uBegin + uPad > uLength) {
+        return fail(errProtocol);
+    }
+    block_.assign(pData + uBegin, uLength - uBegin - uPad);
+    uBlockStream_ = uStream;
+    nBlockFlags_ = nFlags;
+    if ((nFlags & flagPriority) && (get32(pData + uBegin - 5) & 0x7fffffff) == uStream) {
+        // Depending on itself; the block is still decoded, for the table
+        nBlockFlags_ |= flagSelfDependent;
+    }
+    return (nFlags & flagEndHeaders) ? endHeaders() : true;
+}
+
+bool Http2Connection::onSettings(int nFlags, const char* pData, std::size_t uLength) {
+    if (nFlags & flagAck) {
+        return uLength == 0 ? true : fail(errFrameSize);
+    }
+    if (uLength % 6 != 0) {
+        return fail(errFrameSize);
+    }
+    if (!applySettings(pData, uLength)) {
+        return false;
+    }
+    queueFrame(frameSettings, flagAck, 0, std::string_view());
+    openWaiting();
+    return true;
+}
+
+bool Http2Connection::onWindowUpdate(UINT uStream, const char* pData, std::size_t uLength) {
+    if (uLength != 4) {
+        return fail(errFrameSize);
+    }
+    int64_t nIncrement = get32(pData) & 0x7fffffff;
+    if (uStream == 0) {
+        if (nIncrement == 0) {
+            return fail(errProtocol);
+        }
+        nSendWindow_ += nIncrement;
+        return nSendWindow_ > MAX_WINDOW ? fail(errFlowControl) : true;
+    }
+    if (idle(uStream)) {
+        return fail(errProtocol);
+    }
+    Stream* pStream = find(uStream);
+    if (nIncrement == 0) {
+        return streamError(pStream, uStream, errProtocol);
+    }
+    if (pStream == nullptr || pStream->bReset) {
+        return true;
+    }
+    pStream->nSendWindow += nIncrement;
+    if (pStream->nSendWindow > MAX_WINDOW) {
+        return streamError(pStream, uStream, errFlowControl);
+    }
+    if (pStream->remaining() > 0) {
+        ready(*pStream);
+    }
+    return true;
+}
+
+// Abstract : Decode a complete header block and act on it
+//
+// Returns  : False on a connection error
+//
+// Remarks  : Every block is decoded, even on a stream that is refused or
+//            reset, as the dynamic table has to follow the encoder's.
+//
+bool Http2Connection::endHeaders() {
+    UINT uStream = uBlockStream_;
+    uBlockStream_ = 0;
+    bool bEnd = (nBlockFlags_ & flagEndStream) != 0;
+    Stream* pStream = find(uStream);
+    bool bRefused = false;
+    if (pStream == nullptr) {
+        if (!bServer_ || (uStream & 1) == 0) {
+            return fail(errProtocol);
+        }
+        if (uStream <= uLastStream_) {
+            return fail(errStreamClosed);
+        }
+        uLastStream_ = uStream;
+        pStream = open(uStream);
+        bRefused = bGoingAway_ || uActive_ >= uMaxStreams_;
+        if (!bRefused) {
+            pStream->bCounted = true;
+            uActive_++;
+            stats_.streams++;
+        }
+    } else if (pStream->bReset || pStream->bRemoteDone) {
+        // Decoded for the table, then dropped
+        pStream = nullptr;
+    }
+
+    bool bTrailers = pStream && pStream->bHeadDone;
+    if (pStream) {
+        pStream->method.clear();
+        pStream->scheme.clear();
+        pStream->authority.clear();
+        pStream->path.clear();
+        pStream->status.clear();
+        pStream->fields.clear();
+        pStream->cookie.clear();
+        pStream->uHeadBytes = 0;
+        pStream->bRegular = false;
+        pStream->bMalformed = false;
+        pStream->bTooLarge = false;
+    }
+    pDecoding_ = pStream;
+    bool bDecoded = decoder_.decode(block_.data(), block_.size(), onField, this);
+    pDecoding_ = nullptr;
+    block_.clear();
+    if (!bDecoded) {
+        return fail(errCompression);
+    }
+    if (pStream == nullptr) {
+        Stream* pClosed = find(uStream);
+        return (pClosed && !pClosed->bReset) ? streamError(pClosed, uStream, errStreamClosed)
+                                             : true;
+    }
+    if (bRefused) {
+        queueReset(uStream, errRefusedStream);
+        forget(pStream);
+        return true;
+    }
+    if (nBlockFlags_ & flagSelfDependent) {
+        return streamError(pStream, uStream, errProtocol);
+    }
+    if (bTrailers) {
+        // Trailers end the stream, and their fields are dropped
+        if (!bEnd || pStream->bMalformed) {
+            return streamError(pStream, uStream, errProtocol);
+        }
+    } else {
+        // A request answered with an error is then complete
+        pStream->bRemoteDone = bEnd;
+        if (!finishHead(*pStream)) {
+            return true;
+        }
+        if (!pStream->bHeadDone) {
+            // An interim response; the final one follows
+            pStream->bRemoteDone = false;
+            return bEnd ? streamError(pStream, uStream, errProtocol) : true;
+        }
+    }
+    if (bEnd) {
+        pStream->bRemoteDone = true;
+        if (pStream->nDeclared > 0 && !bTrailers) {
+            return streamError(pStream, uStream, errProtocol);
+        }
+        if (pStream->nDeclared >= 0 && bTrailers
+            && pStream->uReceived != uint64_t(pStream->nDeclared)) {
+            return streamError(pStream, uStream, errProtocol);
+        }
+        received(*pStream);
+    }
+    return true;
+}
+
+bool Http2Connection::onField(std::string_view name, std::string_view value, void* ptr) {
+    Http2Connection* pThis = static_cast<Http2Connection*>(ptr);
+    return pThis->pDecoding_ == nullptr || pThis->field(*pThis->pDecoding_, name, value);
+}
+
+// Abstract : Take one decoded field of a header block
+//
+// Remarks  : A malformed field is remembered rather than failed at once,
+//            as the rest of the block still has to be decoded.
+//
+bool Http2Connection::field(Stream& rStream, std::string_view name, std::string_view value) {
+    rStream.uHeadBytes += name.size() + value.size() + HpackTable::ENTRY_OVERHEAD;
+    if (rStream.uHeadBytes > limits_.uMaxHeaderBytes) {
+        rStream.bTooLarge = true;
+        return true;
+    }
+    if (name.empty()) {
+        rStream.bMalformed = true;
+        return true;
+    }
+    for (std::size_t i = 0; i < name.size(); i++) {
+        unsigned char c = name[i];
+        if ((c >= 'A' && c <= 'Z') || c <= ' ' || c >= 0x7f || (c == ':' && i > 0)) {
+            rStream.bMalformed = true;
+            return true;
+        }
+    }
+    if (value.find_first_of(std::string_view("\0\r\n", 3)) != std::string_view::npos
+        || (!value.empty() && (value.front() == ' ' || value.front() == '\t'
+                               || value.back() == ' ' || value.back() == '\t'))) {
+        rStream.bMalformed = true;
+        return true;
+    }
+
+    if (name[0] == ':') {
+        std::pmr::string* pTarget = nullptr;
+        if (bServer_) {
+            if (name == ":method") {
+                pTarget = &rStream.method;
+            } else if (name == ":scheme") {
+                pTarget = &rStream.scheme;
+            } else if (name == ":authority") {
+                pTarget = &rStream.authority;
+            } else if (name == ":path") {
+                pTarget = &rStream.path;
+            }
+        } else if (name == ":status") {
+            pTarget = &rStream.status;
+        }
+        // Pseudo-headers come first, once each, and not in trailers
+        if (pTarget == nullptr || !pTarget->empty() || rStream.bRegular || rStream.bHeadDone
+            || value.empty()) {
+            rStream.bMalformed = true;
+            return true;
+        }
+        pTarget->assign(value);
+        return true;
+    }
+
+    rStream.bRegular = true;
+    if (rStream.bHeadDone) {
+        return true;
+    }
+    if (connectionSpecific(name) || (name == "te" && value != "trailers")) {
+        rStream.bMalformed = true;
+        return true;
+    }
+    if (name == "cookie") {
+        // Split cookies are joined, as HTTP/1.1 expects one field
+        if (!rStream.cookie.empty()) {
+            rStream.cookie += "; ";
+        }
+        rStream.cookie.append(value);
+        return true;
+    }
+    if (name == "host" && !rStream.authority.empty()) {
+        return true;
+    }
+    rStream.fields.append(name);
+    rStream.fields += ": ";
+    rStream.fields.append(value);
+    rStream.fields += "\r\n";
+    return true;
+}
+
+// Abstract : Rebuild the head of a request or response and parse it
+//
+// Returns  : False if the stream was reset or answered with an error
+//
+bool Http2Connection::finishHead(Stream& rStream) {
+    if (rStream.bMalformed) {
+        streamError(&rStream, rStream.id, errProtocol);
+        return false;
+    }
+    std::pmr::string& head = rStream.head;
+    head.clear();
+    if (bServer_) {
+        if (rStream.method.empty() || rStream.scheme.empty() || rStream.path.empty()) {
+            streamError(&rStream, rStream.id, errProtocol);
+            return false;
+        }
+        head += rStream.method;
+        head += ' ';
+        head += rStream.path;
+        head += " HTTP/1.1\r\n";
+        if (!rStream.authority.empty()) {
+            head += "host: ";
+            head += rStream.authority;
+            head += "\r\n";
+        }
+        rStream.bHeadRequest = rStream.method == "HEAD";
+    } else {
+        if (rStream.status.size() != 3) {
+            streamError(&rStream, rStream.id, errProtocol);
+            return false;
+        }
+        // An interim response is skipped
+        if (rStream.status[0] == '1') {
+            return true;
+        }
+        head += "HTTP/1.1 ";
+        head += rStream.status;
+        head += " \r\n";
+    }
+    head += rStream.fields;
+    if (!rStream.cookie.empty()) {
+        head += "cookie: ";
+        head += rStream.cookie;
+        head += "\r\n";
+    }
+    head += "\r\n";
+    rStream.fields.clear();
+
+    if (bServer_) {
+        rStream.parser.setLimits(limits_);
+    }
+    rStream.parser.reset();
+    HttpParser::Result eResult = rStream.parser.parse(head.data(), head.size());
+    rStream.bHeadDone = true;
+    if (bServer_ && (rStream.bTooLarge || eResult != HttpParser::parseComplete)) {
+        replyError(rStream, rStream.bTooLarge ? 431 : rStream.parser.errorStatus());
+        return false;
+    }
+    if (eResult != HttpParser::parseComplete || rStream.bTooLarge) {
+        streamError(&rStream, rStream.id, errProtocol);
+        return false;
+    }
+    if (rStream.parser.bodyKind() == HttpParser::bodyLength) {
+        rStream.nDeclared = int64_t(rStream.parser.contentLength());
+    }
+    if (!bServer_) {
+        // The response to HEAD tells the length of a body it does not have
+        if (rStream.bHeadRequest) {
+            rStream.nDeclared = -1;
+        } else if (rStream.nDeclared >= 0) {
+            rStream.pSink->expect(rStream.nDeclared);
+        }
+    }
+    return true;
+}
+
+// Abstract : Answer a request that will not reach the handler
+//
+// Remarks  : If the client is still sending, the stream is reset once the
+//            response is out, so it stops (RFC 9113 section 8.1).
+//
+void Http2Connection::replyError(Stream& rStream, UINT uStatus) {
+    rStream.bDiscard = true;
+    rStream.bResetAfter = !rStream.bRemoteDone;
+    reply(rStream.id, uStatus ? uStatus : 400, std::string_view(), 0, std::string_view());
+}
+
+// Abstract : The peer has ended a stream
+//
+// Remarks  : On a server the request is complete and handled now.
+//
+void Http2Connection::received(Stream& rStream) {
+    if (bServer_ && !rStream.bDiscard && !rStream.bLocalDone) {
+        handle(rStream);
+        return;
+    }
+    checkClosed(rStream);
+}
+
+// Abstract : Pass a request to the handler
+//
+// Remarks  : The stream is gone once its response has gone out whole,
+//            which may be before the handler returns, so what the call
+//            allocates is kept in an arena of the connection, reset when
+//            the call is over.
+//
+void Http2Connection::handle(Stream& rStream) {
+    UINT uStream = rStream.id;
+    {
+        HttpCall call(*pServer_, this, uStream, &callArena_);
+        if (pHandler_) {
+            pHandler_(call, pData_);
+        }
+        if (!call.replied()) {
+            call.reply(500);
+        }
+    }
+    callArena_.reset();
+}
+
+// Abstract : Give back the windows taken by data received
+//
+// Params   :
+//   pStream                   Stream to update too, or null for the
+//                             connection only
+//   uLength                   Bytes taken
+//
+// Remarks  : A window is updated once half of it is taken, so there are
+//            few updates and the peer never has to stop.
+//
+void Http2Connection::consume(Stream* pStream, std::size_t uLength) {
+    int64_t nWindow = std::min<int64_t>(int64_t(uWindow_) * CONNECTION_WINDOWS, MAX_WINDOW);
+    uRecvConsumed_ += uLength;
+    if (uRecvConsumed_ >= uint64_t(nWindow / 2)) {
+        std::string increment;
+        put32(increment, uint32_t(uRecvConsumed_));
+        queueFrame(frameWindowUpdate, 0, 0, increment);
+        nRecvWindow_ += uRecvConsumed_;
+        uRecvConsumed_ = 0;
+    }
+    if (pStream) {
+        pStream->uRecvConsumed += uLength;
+        if (pStream->uRecvConsumed >= uWindow_ / 2) {
+            std::string increment;
+            put32(increment, uint32_t(pStream->uRecvConsumed));
+            queueFrame(frameWindowUpdate, 0, pStream->id, increment);
+            pStream->nRecvWindow += pStream->uRecvConsumed;
+            pStream->uRecvConsumed = 0;
+        }
+    }
+}
+
+void Http2Connection::queueFrame(int nType, int nFlags, UINT uStream, std::string_view payload) {
+    std::size_t uLength = payload.size();
+    outBuf_ += char(uLength >> 16);
+    outBuf_ += char(uLength >> 8);
+    outBuf_ += char(uLength);
+    outBuf_ += char(nType);
+    outBuf_ += char(nFlags);
+    put32(outBuf_, uStream);
+    outBuf_.append(payload);
+    stats_.framesSent++;
+}
+
+// Abstract : Queue a header block, in as many frames as it takes
+//
+void Http2Connection::queueHeaders(Stream& rStream, std::string_view block, bool bEnd) {
+    stats_.blockBytes += block.size();
+    std::size_t uAt = 0;
+    bool bFirst = true;
+    do {
+        std::size_t uLength = std::min<std::size_t>(block.size() - uAt, uPeerMaxFrame_);
+        int nFlags = (uAt + uLength == block.size()) ? flagEndHeaders : 0;
+        if (bFirst && bEnd) {
+            nFlags |= flagEndStream;
+        }
+        queueFrame(bFirst ? frameHeaders : frameContinuation, nFlags, rStream.id,
+                   block.substr(uAt, uLength));
+        uAt += uLength;
+        bFirst = false;
+    } while (uAt < block.size());
+}
+
+void Http2Connection::queueReset(UINT uStream, ErrorCode eCode) {
+    std::string payload;
+    put32(payload, eCode);
+    queueFrame(frameRstStream, 0, uStream, payload);
+}
+
+// Abstract : Encode header lines into a block
+//
+// Params   :
+//   lines                     "Name: value" lines, each ending with CRLF,
+//                             up to an empty line or the end
+//
+// Remarks  : Names are sent in lower case, and the headers that only make
+//            sense on an HTTP/1.1 connection are left out.
+//
+void Http2Connection::encodeLines(std::string& block, std::string_view lines) {
+    std::string& name = sendName_;
+    std::size_t pos = 0;
+    while (pos < lines.size()) {
+        std::size_t end = lines.find("\r\n", pos);
+        if (end == std::string_view::npos) {
+            end = lines.size();
+        }
+        std::string_view line = lines.substr(pos, end - pos);
+        pos = end + 2;
+        if (line.empty()) {
+            break;
+        }
+        std::size_t colon = line.find(':');
+        if (colon == std::string_view::npos || colon == 0) {
+            continue;
+        }
+        name.assign(line.substr(0, colon));
+        std::transform(name.begin(), name.end(), name.begin(),
+                       [](unsigned char c) { return char(tolower(c)); });
+        if (connectionSpecific(name) || name == "host") {
+            continue;
+        }
+        encoder_.encode(block, name, HttpParser::trim(line.substr(colon + 1)));
+        stats_.fieldBytes += line.size() + 2;
+    }
+}
+
+void Http2Connection::ready(Stream& rStream) {
+    if (!rStream.bReady && !rStream.bLocalDone && !rStream.bReset) {
+        rStream.bReady = true;
+        ready_.push_back(&rStream);
+    }
+}
+
+// Abstract : Queue DATA frames for the streams with a body to send
+//
+// Returns  : True if more could be queued once the output is written
+//
+// Remarks  : Each stream sends one frame in turn, as its window, the
+//            window of the connection and the peer's frame size allow.  A
+//            stream whose window is spent leaves the list until a
+//            WINDOW_UPDATE brings it back.  The list is a vector taken
+//            from the front, so that going round it does not allocate.
+//
+bool Http2Connection::pump() {
+    while (uReadyHead_ < ready_.size() && nSendWindow_ > 0) {
+        if (outBuf_.size() >= MAX_PENDING_OUTPUT) {
+            return true;
+        }
+        Stream* pStream = ready_[uReadyHead_++];
+        if (uReadyHead_ == ready_.size()) {
+            ready_.clear();
+            uReadyHead_ = 0;
+        } else if (uReadyHead_ > ready_.size() / 2) {
+            ready_.erase(ready_.begin(), ready_.begin() + uReadyHead_);
+            uReadyHead_ = 0;
+        }
+        pStream->bReady = false;
+        if (pStream->bReset || pStream->bLocalDone) {
+            continue;
+        }
+        uint64_t uLeft = pStream->remaining();
+        if (pStream->nSendWindow <= 0 && uLeft > 0) {
+            continue;
+        }
+        std::size_t uLength = std::min<uint64_t>({ uLeft, uint64_t(pStream->nSendWindow),
+                                                   uint64_t(nSendWindow_), uPeerMaxFrame_ });
+        bool bEnd = uLength == uLeft;
+        std::size_t uAt = outBuf_.size();
+        queueFrame(frameData, bEnd ? flagEndStream : 0, pStream->id, std::string_view());
+        if (pStream->pFile && !pStream->pFile->loaded()) {
+            outBuf_.resize(uAt + FRAME_HEADER + uLength);
+            ssize_t nRead = ::pread(pStream->pFile->fd(), outBuf_.data() + uAt + FRAME_HEADER,
+                                    uLength, pStream->uFileAt);
+            if (nRead != ssize_t(uLength)) {
+                // The file shrank under us; the stream cannot be finished
+                outBuf_.resize(uAt);
+                stats_.framesSent--;
+                streamError(pStream, pStream->id, errInternal);
+                continue;
+            }
+            pStream->uFileAt += uLength;
+        } else {
+            outBuf_.append(pStream->outData.substr(pStream->outAt, uLength));
+            pStream->outAt += uLength;
+        }
+        outBuf_[uAt] = char(uLength >> 16);
+        outBuf_[uAt + 1] = char(uLength >> 8);
+        outBuf_[uAt + 2] = char(uLength);
+        pStream->nSendWindow -= uLength;
+        nSendWindow_ -= uLength;
+        if (bEnd) {
+            sent(*pStream);
+        } else {
+            ready(*pStream);
+        }
+    }
+    return false;
+}
+
+// Abstract : This side has ended a stream
+//
+void Http2Connection::sent(Stream& rStream) {
+    rStream.bLocalDone = true;
+    rStream.pFile.reset();
+    if (rStream.bResetAfter && !rStream.bReset) {
+        queueReset(rStream.id, errNone);
+        rStream.bReset = true;
+    }
+    checkClosed(rStream);
+}
+
+// Abstract : Fail the connection
+//
+// Returns  : False, to be returned by the caller
+//
+bool Http2Connection::fail(ErrorCode eCode) {
+    if (!bFailed_) {
+        std::string payload;
+        put32(payload, uLastStream_);
+        put32(payload, eCode);
+        queueFrame(frameGoAway, 0, 0, payload);
+        error_ = eCode;
+        bFailed_ = true;
+        bGoingAway_ = true;
+    }
+    return false;
+}
+
+// Abstract : Reset a stream, leaving the connection open
+//
+// Returns  : True, to be returned by the caller
+//
+bool Http2Connection::streamError(Stream* pStream, UINT uStream, ErrorCode eCode) {
+    queueReset(uStream, eCode);
+    if (pStream && !pStream->bReset) {
+        pStream->bReset = true;
+        checkClosed(*pStream);
+    }
+    return true;
+}
+
+// Abstract : Open the client streams waiting for the server's limit
+//
+void Http2Connection::openWaiting() {
+    while (!waiting_.empty() && uActive_ < uPeerMaxStreams_ && !bGoingAway_) {
+        Stream* pStream = waiting_.front();
+        waiting_.pop_front();
+        std::string& block = sendBlock_;
+        block.clear();
+        encoder_.beginBlock(block);
+        encoder_.encode(block, ":method", pStream->method);
+        encoder_.encode(block, ":scheme", scheme_);
+        encoder_.encode(block, ":authority", authority_);
+        encoder_.encode(block, ":path", pStream->path);
+        stats_.fieldBytes += pStream->method.size() + pStream->path.size() + 11
+                             + authority_.size() + 8;   // Request line and Host
+        encodeLines(block, pStream->fields);
+        pStream->fields.clear();
+        bool bEnd = pStream->outData.empty();
+        if (!bEnd) {
+            std::string length = std::to_string(pStream->outData.size());
+            encoder_.encode(block, "content-length", length);
+            stats_.fieldBytes += 18 + length.size();
+        }
+        pStream->bCounted = true;
+        uActive_++;
+        stats_.streams++;
+        queueHeaders(*pStream, block, bEnd);
+        if (bEnd) {
+            pStream->bLocalDone = true;
+        } else {
+            ready(*pStream);
+        }
+    }
+}
+
+// Abstract : Make room in the receive buffer for a whole frame
+//
+void Http2Connection::makeRoom() {
+    std::size_t uAvail = recvEnd_ - recvBegin_;
+    if (recvBegin_ > 0 && recvBuf_.size() - recvEnd_ < FRAME_HEADER + MAX_FRAME) {
+        memmove(recvBuf_.data(), recvBuf_.data() + recvBegin_, uAvail);
+        recvBegin_ = 0;
+        recvEnd_ = uAvail;
+    }
+}
+
+bool Http2Connection::flush() {
+    if (outBuf_.empty() || pSocket_ == 0) {
+        return pSocket_ != 0;
+    }
+    struct iovec vec = { outBuf_.data(), outBuf_.size() };
+    bool bWritten = pSocket_->writev(&vec, 1);
+    outBuf_.clear();
+    if (!bWritten) {
+        bFailed_ = true;
+    }
+    return bWritten;
+}
+
+Task<bool> Http2Connection::async_flush() {
+    if (outBuf_.empty()) {
+        co_return true;
+    }
+    int nSize = static_cast<int>(outBuf_.size());
+    bool bWritten = co_await pSocket_->async_write(outBuf_.data(), nSize) == nSize;
+    outBuf_.clear();
+    co_return bWritten;
+}
+
+// Abstract : Send what is queued, then receive and take what comes
+//
+// Returns  : False once the connection has failed or closed
+//
+bool Http2Connection::exchange() {
+    if (bFailed_ || pSocket_ == 0) {
+        return false;
+    }
+    bool bMore;
+    do {
+        bMore = pump();
+        if (!flush()) {
+            return false;
+        }
+    } while (bMore);
+    makeRoom();
+    UINT uRead = pSocket_->read(recvBuf_.data() + recvEnd_, recvBuf_.size() - recvEnd_);
+    if (uRead == 0) {
+        bFailed_ = true;
+        return false;
+    }
+    recvEnd_ += uRead;
+    if (step() < 0) {
+        flush();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,171 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : HttpBody.cpp
+//
+// Class      : HttpBodySink, HttpBodySource
+//
+// Description: Destinations and origins of HTTP message bodies.
+//
+// Decisions  : A sink or a source is a small value that the caller
+//              creates on the stack for one message, so the kinds of
+//              destination and origin are cases of one class rather than
+//              sub-classes.
+//
+
+#include "config.h"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+#include <sockstr/HttpBody.h>
+
+using namespace sockstr;
+
+// Bodies announced as bigger than this are not reserved for in a string
+static const uint64_t maxReserve = 16 * 1024 * 1024;
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+HttpBodySink::HttpBodySink()
+    : kind_(sinkDiscard)
+    , pBuffer_(nullptr)
+    , uCapacity_(0)
+    , pString_(nullptr)
+    , pCallback_(nullptr)
+    , pData_(nullptr)
+    , fd_(-1)
+    , uSize_(0)
+    , uStored_(0) {
+}
+
+HttpBodySink::HttpBodySink(char* pBuffer, UINT uSize)
+    : HttpBodySink() {
+    kind_ = sinkBuffer;
+    pBuffer_ = pBuffer;
+    uCapacity_ = uSize;
+}
+
+HttpBodySink::HttpBodySink(std::string& rString)
+    : HttpBodySink() {
+    kind_ = sinkString;
+    pString_ = &rString;
+}
+
+HttpBodySink::HttpBodySink(HttpBodyCallback pCallback, void* ptr)
+    : HttpBodySink() {
+    kind_ = sinkCallback;
+    pCallback_ = pCallback;
+    pData_ = ptr;
+}
+
+HttpBodySink::HttpBodySink(int fd)
+    : HttpBodySink() {
+    kind_ = sinkFile;
+    fd_ = fd;
+}
+
+void HttpBodySink::expect(uint64_t uLength) {
+    if (kind_ == sinkString && uLength <= maxReserve) {
+        pString_->reserve(pString_->size() + uLength);
+    }
+}
+
+bool HttpBodySink::write(const char* pData, std::size_t uLength) {
+    uSize_ += uLength;
+    switch (kind_) {
+    case sinkDiscard:
+        break;
+    case sinkBuffer: {
+        UINT uCopy = static_cast<UINT>(std::min<std::size_t>(uLength, uCapacity_ - uStored_));
+        memcpy(pBuffer_ + uStored_, pData, uCopy);
+        uStored_ += uCopy;
+        break;
+    }
+    case sinkString:
+        pString_->append(pData, uLength);
+        break;
+    case sinkCallback:
+        // Called in pieces a UINT can count
+        while (uLength > 0) {
+            UINT uPiece = static_cast<UINT>(std::min<std::size_t>(uLength, 1u << 30));
+            if (!pCallback_(pData, uPiece, pData_)) {
+                return false;
+            }
+            pData += uPiece;
+            uLength -= uPiece;
+        }
+        break;
+    case sinkFile:
+        while (uLength > 0) {
+            ssize_t iWritten = ::write(fd_, pData, uLength);
+            if (iWritten < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            pData += iWritten;
+            uLength -= iWritten;
+        }
+        break;
+    }
+    return true;
+}
+
+
+HttpBodySource::HttpBodySource()
+    : kind_(sourceNone)
+    , pData_(nullptr)
+    , pProducer_(nullptr)
+    , ptr_(nullptr)
+    , fd_(-1)
+    , uOffset_(0)
+    , uLength_(0) {
+}
+
+HttpBodySource::HttpBodySource(const char* pData, std::size_t uLength)
+    : HttpBodySource() {
+    kind_ = sourceBuffer;
+    pData_ = pData;
+    uLength_ = uLength;
+}
+
+HttpBodySource::HttpBodySource(HttpBodyProducer pProducer, void* ptr, uint64_t uLength)
+    : HttpBodySource() {
+    kind_ = sourceProducer;
+    pProducer_ = pProducer;
+    ptr_ = ptr;
+    uLength_ = uLength;
+}
+
+HttpBodySource::HttpBodySource(int fd, uint64_t uOffset, uint64_t uLength)
+    : HttpBodySource() {
+    kind_ = sourceFile;
+    fd_ = fd;
+    uOffset_ = uOffset;
+    uLength_ = uLength;
+}
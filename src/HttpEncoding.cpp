@@ -0,0 +1,276 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : HttpEncoding.cpp
+//
+// Class      : HttpEncoding, HttpInflater
+//
+// Description: gzip content coding of HTTP bodies.
+//
+// Decisions  : The deflate state is thread_local rather than owned by a
+//              connection: deflateInit allocates about 256 KB, which a
+//              server thread then shares among all of its connections,
+//              and a response is compressed whole, so the state is never
+//              held across a suspension.
+//              The compressed body must be smaller than the original,
+//              so the output buffer is limited to that and incompressible
+//              data costs no more than one failed attempt.
+//
+
+#include "config.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <zlib.h>
+
+#include <sockstr/HttpBody.h>
+#include <sockstr/HttpEncoding.h>
+#include <sockstr/HttpParser.h>
+
+using namespace sockstr;
+
+// Output of the decoder is passed on in pieces of this size
+static const std::size_t INFLATE_CHUNK = 16384;
+
+namespace {
+
+// The deflate state of a thread, with the buffer of its last output
+struct Deflater {
+    z_stream stream;
+    bool bInit = false;
+    int level = 0;
+    std::string output;
+
+    ~Deflater() {
+        if (bInit) {
+            deflateEnd(&stream);
+        }
+    }
+};
+
+bool startsNoCase(std::string_view text, std::string_view prefix) {
+    return text.size() >= prefix.size()
+        && HttpParser::equalNames(text.substr(0, prefix.size()), prefix);
+}
+
+bool endsNoCase(std::string_view text, std::string_view suffix) {
+    return text.size() >= suffix.size()
+        && HttpParser::equalNames(text.substr(text.size() - suffix.size()), suffix);
+}
+
+}
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+// Abstract : Find whether a content coding is acceptable to the client
+//
+// Returns  : bool (true if the coding may be used)
+// Params   :
+//   acceptEncoding            Value of the Accept-Encoding header
+//   coding                    Name of the coding, such as "gzip"
+//
+// Remarks  : A coding named in the list takes its own q-value, even if
+//            "*" is listed too (RFC 9110 section 12.5.3).  Only whether
+//            the q-value is 0 matters, as there is one coding to choose.
+//
+bool HttpEncoding::accepts(std::string_view acceptEncoding, std::string_view coding) {
+    int named = -1;             // q > 0 of the coding, -1 if not listed
+    int wildcard = -1;
+    std::size_t pos = 0;
+    while (pos < acceptEncoding.size()) {
+        std::size_t end = std::min(acceptEncoding.find(',', pos), acceptEncoding.size());
+        std::string_view element = acceptEncoding.substr(pos, end - pos);
+        pos = end + 1;
+
+        std::size_t semi = element.find(';');
+        std::string_view name = HttpParser::trim(element.substr(0, std::min(semi, element.size())));
+        bool bNonZero = true;
+        while (semi < element.size()) {
+            std::size_t next = std::min(element.find(';', semi + 1), element.size());
+            std::string_view param = HttpParser::trim(element.substr(semi + 1, next - semi - 1));
+            if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                bNonZero = param.substr(2).find_first_not_of("0.") != std::string_view::npos;
+            }
+            semi = next;
+        }
+
+        if (HttpParser::equalNames(name, coding)
+            || (HttpParser::equalNames(coding, "gzip") && HttpParser::equalNames(name, "x-gzip"))) {
+            named = bNonZero;
+        } else if (name == "*") {
+            wildcard = bNonZero;
+        }
+    }
+    return named >= 0 ? named > 0 : wildcard > 0;
+}
+
+bool HttpEncoding::compressible(const char* contentType) {
+    if (contentType == nullptr) {
+        return false;
+    }
+    std::string_view type(contentType);
+    type = HttpParser::trim(type.substr(0, std::min(type.find(';'), type.size())));
+    if (startsNoCase(type, "text/")) {
+        return true;
+    }
+    static const char* others[] = {
+        "application/json", "application/javascript", "application/x-javascript",
+        "application/ecmascript", "application/xml", "application/wasm",
+        "application/x-ndjson", "font/ttf", "font/otf",
+    };
+    for (const char* other : others) {
+        if (HttpParser::equalNames(type, other)) {
+            return true;
+        }
+    }
+    // Structured syntax suffixes: image/svg+xml, application/ld+json, ...
+    return endsNoCase(type, "+json") || endsNoCase(type, "+xml");
+}
+
+// Abstract : Compress data into gzip format
+//
+// Returns  : std::string_view (the gzip data, empty if not smaller)
+// Params   :
+//   data                      Data to compress
+//   nLevel                    zlib level, 1 to 9
+//
+// Post     : The result is in a buffer of the calling thread and valid
+//            until its next call.
+//
+std::string_view HttpEncoding::gzip(std::string_view data, int nLevel) {
+    thread_local Deflater deflater;
+    z_stream& rStream = deflater.stream;
+    if (data.empty() || data.size() > UINT32_MAX) {
+        return std::string_view();
+    }
+    if (!deflater.bInit) {
+        memset(&rStream, 0, sizeof(rStream));
+        // 16 added to the window bits asks for the gzip header and trailer
+        if (deflateInit2(&rStream, nLevel, Z_DEFLATED, MAX_WBITS + 16, 8,
+                         Z_DEFAULT_STRATEGY) != Z_OK) {
+            return std::string_view();
+        }
+        deflater.bInit = true;
+        deflater.level = nLevel;
+    } else {
+        deflateReset(&rStream);
+        if (deflater.level != nLevel
+            && deflateParams(&rStream, nLevel, Z_DEFAULT_STRATEGY) == Z_OK) {
+            deflater.level = nLevel;
+        }
+    }
+
+    std::size_t uRoom = data.size() - 1;
+    if (deflater.output.size() < uRoom) {
+        deflater.output.resize(uRoom);
+    }
+    rStream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    rStream.avail_in = data.size();
+    rStream.next_out = reinterpret_cast<Bytef*>(deflater.output.data());
+    rStream.avail_out = uRoom;
+    if (deflate(&rStream, Z_FINISH) != Z_STREAM_END) {
+        return std::string_view();      // Did not fit
+    }
+    return std::string_view(deflater.output.data(), uRoom - rStream.avail_out);
+}
+
+
+struct HttpInflater::Stream {
+    z_stream stream;
+    bool bInit = false;
+};
+
+HttpInflater::HttpInflater()
+    : pStream_(new Stream)
+    , bFinished_(true) {
+}
+
+HttpInflater::~HttpInflater() {
+    if (pStream_->bInit) {
+        inflateEnd(&pStream_->stream);
+    }
+}
+
+void HttpInflater::reset() {
+    if (pStream_->bInit) {
+        inflateReset(&pStream_->stream);
+    }
+    bFinished_ = true;
+}
+
+// Abstract : Decode the next piece of a gzip body
+//
+// Returns  : bool (false if the data is corrupt or the sink failed)
+// Params   :
+//   pData                     Next piece of the body
+//   uLength                   Size of the piece
+//   rSink                     Destination of the decoded body
+//
+// Remarks  : The input is consumed whole; what zlib holds back of a
+//            partial block is decoded with the next piece.
+//
+bool HttpInflater::write(const char* pData, std::size_t uLength, HttpBodySink& rSink) {
+    z_stream& rStream = pStream_->stream;
+    if (uLength == 0) {
+        return true;
+    }
+    if (!pStream_->bInit) {
+        memset(&rStream, 0, sizeof(rStream));
+        if (inflateInit2(&rStream, MAX_WBITS + 16) != Z_OK) {
+            return false;
+        }
+        pStream_->bInit = true;
+    } else if (bFinished_) {
+        inflateReset(&rStream);     // A further member follows
+    }
+    bFinished_ = false;
+
+    char output[INFLATE_CHUNK];
+    rStream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(pData));
+    rStream.avail_in = uLength;
+    for (;;) {
+        rStream.next_out = reinterpret_cast<Bytef*>(output);
+        rStream.avail_out = sizeof(output);
+        int nResult = inflate(&rStream, Z_NO_FLUSH);
+        std::size_t uProduced = sizeof(output) - rStream.avail_out;
+        if (uProduced > 0 && !rSink.write(output, uProduced)) {
+            return false;
+        }
+        if (nResult == Z_STREAM_END) {
+            bFinished_ = true;
+            if (rStream.avail_in == 0) {
+                return true;
+            }
+            inflateReset(&rStream);
+            bFinished_ = false;
+        } else if (nResult != Z_OK && nResult != Z_BUF_ERROR) {
+            return false;
+        } else if (rStream.avail_in == 0 && rStream.avail_out > 0) {
+            return true;            // All input used and all output out
+        } else if (nResult == Z_BUF_ERROR && uProduced == 0) {
+            return false;           // No progress possible
+        }
+    }
+}
@@ -0,0 +1,497 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : HttpFileCache.cpp
+//
+// Class      : HttpFileCache, HttpFile
+//
+// Description: Cache of open files for serving a directory tree.
+//
+// Decisions  : Files are keyed by their normalized request path and held
+//              by shared_ptr, so dropping one from the cache never closes
+//              a descriptor that a connection is still sending from.
+//              Every directory from the root down to a cached file is
+//              watched.  A change to a file drops the cached files of its
+//              directory; a change to a directory, or a lost event, drops
+//              everything, since what any path leads to may have changed.
+//              A file being loaded while a change is seen is returned but
+//              not cached: each change bumps a generation number, read
+//              once the watches are in place and checked at insertion.
+//
+
+#include "config.h"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <poll.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if CONFIG_HAS_INOTIFY
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
+
+#include <sockstr/HttpEncoding.h>
+#include <sockstr/HttpFileCache.h>
+#include <sockstr/HttpHelpers.h>
+#include <sockstr/HttpRouter.h>
+#include <sockstr/HttpServer.h>
+#include <sockstr/HttpStream.h>
+
+using namespace sockstr;
+
+// Compression level of the gzip variants made of small files, once each
+static const int GZIP_LEVEL = 9;
+
+#if CONFIG_HAS_INOTIFY
+// Changes that make a cached file stale
+static const uint32_t WATCH_MASK = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE
+                                 | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+                                 | IN_DELETE_SELF | IN_MOVE_SELF;
+#endif
+
+static const struct {
+    const char* extension;
+    const char* type;
+} contentTypes[] = {
+    { "html", "text/html; charset=utf-8" },
+    { "htm",  "text/html; charset=utf-8" },
+    { "css",  "text/css; charset=utf-8" },
+    { "js",   "text/javascript; charset=utf-8" },
+    { "mjs",  "text/javascript; charset=utf-8" },
+    { "json", "application/json" },
+    { "txt",  "text/plain; charset=utf-8" },
+    { "xml",  "application/xml" },
+    { "csv",  "text/csv" },
+    { "md",   "text/markdown; charset=utf-8" },
+    { "svg",  "image/svg+xml" },
+    { "png",  "image/png" },
+    { "jpg",  "image/jpeg" },
+    { "jpeg", "image/jpeg" },
+    { "gif",  "image/gif" },
+    { "webp", "image/webp" },
+    { "avif", "image/avif" },
+    { "ico",  "image/x-icon" },
+    { "woff", "font/woff" },
+    { "woff2", "font/woff2" },
+    { "ttf",  "font/ttf" },
+    { "otf",  "font/otf" },
+    { "wasm", "application/wasm" },
+    { "pdf",  "application/pdf" },
+    { "zip",  "application/zip" },
+    { "gz",   "application/gzip" },
+    { "tar",  "application/x-tar" },
+    { "mp3",  "audio/mpeg" },
+    { "ogg",  "audio/ogg" },
+    { "wav",  "audio/wav" },
+    { "mp4",  "video/mp4" },
+    { "webm", "video/webm" },
+};
+
+static int hexValue(char ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+// Abstract : Turn a request path into the key of a file
+//
+// Returns  : False if the path must not be served
+// Params   :
+//   path                      Request path, relative to the root
+//   rKey                      Receives the segments joined with '/', and a
+//                             final '/' if the path names a directory
+//
+static bool normalize(std::string_view path, std::string& rKey) {
+    rKey.clear();
+    std::string_view decoded = path;
+    if (path.find('%') != std::string_view::npos) {
+        thread_local std::string buffer;
+        buffer.clear();
+        for (std::size_t idx = 0; idx < path.size(); idx++) {
+            char ch = path[idx];
+            if (ch == '%') {
+                int hi = idx + 2 < path.size() ? hexValue(path[idx + 1]) : -1;
+                int lo = hi >= 0 ? hexValue(path[idx + 2]) : -1;
+                if (lo < 0) {
+                    return false;
+                }
+                ch = static_cast<char>(hi * 16 + lo);
+                idx += 2;
+            }
+            buffer.push_back(ch);
+        }
+        decoded = buffer;
+    }
+    if (decoded.find('\0') != std::string_view::npos) {
+        return false;
+    }
+
+    std::size_t uPos = 0;
+    while (uPos < decoded.size()) {
+        std::size_t uEnd = std::min(decoded.find('/', uPos), decoded.size());
+        std::string_view segment(decoded.data() + uPos, uEnd - uPos);
+        if (!segment.empty()) {
+            // Covers "." and "..", as well as hidden files
+            if (segment[0] == '.') {
+                return false;
+            }
+            if (!rKey.empty()) {
+                rKey.push_back('/');
+            }
+            rKey.append(segment);
+        }
+        uPos = uEnd + 1;
+    }
+    if (decoded.empty() || decoded.back() == '/') {
+        rKey.push_back('/');
+    }
+    return true;
+}
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+HttpFile::HttpFile()
+    : fd_(-1)
+    , uSize_(0)
+    , modified_(0)
+    , contentType_(nullptr)
+    , watch_(-1)
+    , device_(0)
+    , inode_(0)
+    , modifiedNanos_(0) {
+}
+
+HttpFile::~HttpFile() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+
+HttpFileCache::HttpFileCache(const std::string& root, UINT uMaxFiles)
+    : root_(root)
+    , rootFd_(::open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC))
+    , uMaxFiles_(std::max(uMaxFiles, 1u))
+    , uGeneration_(0)
+    , hits_(0)
+    , misses_(0)
+    , watchFd_(-1)
+    , wakeFd_(-1) {
+#if CONFIG_HAS_INOTIFY
+    if (rootFd_ >= 0) {
+        watchFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        wakeFd_ = eventfd(0, EFD_CLOEXEC);
+        if (watchFd_ >= 0 && wakeFd_ >= 0) {
+            watcher_ = std::thread(&HttpFileCache::watcher, this);
+        } else {
+            // Without notifications the files are checked with stat()
+            if (watchFd_ >= 0) ::close(watchFd_);
+            if (wakeFd_ >= 0) ::close(wakeFd_);
+            watchFd_ = wakeFd_ = -1;
+        }
+    }
+#endif
+}
+
+HttpFileCache::~HttpFileCache() {
+    if (watcher_.joinable()) {
+        uint64_t uOne = 1;
+        ssize_t iWritten = ::write(wakeFd_, &uOne, sizeof(uOne));
+        (void) iWritten;
+        watcher_.join();
+    }
+    if (watchFd_ >= 0) ::close(watchFd_);
+    if (wakeFd_ >= 0) ::close(wakeFd_);
+    if (rootFd_ >= 0) ::close(rootFd_);
+}
+
+// Abstract : Find the file for a request path
+//
+// Returns  : The file, or nullptr if there is none to serve
+// Params   :
+//   path                      Request path, relative to the root
+//
+// Remarks  : A cached file is found under a shared lock with no system
+//            call, unless changes cannot be watched.
+//
+std::shared_ptr<const HttpFile> HttpFileCache::find(std::string_view path) {
+    thread_local std::string key;
+    if (rootFd_ < 0 || !normalize(path, key)) {
+        return nullptr;
+    }
+    {
+        std::shared_lock<std::shared_mutex> guard(lock_);
+        auto it = files_.find(key);
+        if (it != files_.end() && (watching() || stillValid(*it->second))) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return it->second;
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t uGeneration;
+    int watch = -1;
+    {
+        std::unique_lock<std::shared_mutex> guard(lock_);
+        if (watching()) {
+            watch = watchDirectories(key);
+        }
+        uGeneration = uGeneration_;
+    }
+    std::shared_ptr<HttpFile> pFile = load(key);
+    if (!pFile) {
+        return nullptr;
+    }
+    pFile->watch_ = watch;
+
+    std::unique_lock<std::shared_mutex> guard(lock_);
+    if (uGeneration == uGeneration_ && (watch >= 0 || !watching())) {
+        if (files_.size() >= uMaxFiles_ && files_.find(key) == files_.end()) {
+            files_.erase(files_.begin());
+        }
+        files_[key] = pFile;
+    }
+    return pFile;
+}
+
+void HttpFileCache::clear() {
+    std::unique_lock<std::shared_mutex> guard(lock_);
+    files_.clear();
+    ++uGeneration_;
+}
+
+// Abstract : Open a file and work out what its responses need
+//
+// Returns  : The file, or nullptr if it is missing or not a regular file
+// Params   :
+//   key                       Normalized request path
+//
+// Remarks  : The gzip variant is a "<name>.gz" file next to the file, if
+//            it is at least as recent, or else the contents compressed
+//            once here when the file is loaded and its type compresses.
+//
+std::shared_ptr<HttpFile> HttpFileCache::load(const std::string& key) {
+    std::string path = key;
+    if (path.back() == '/') {
+        path.append("index.html");
+    }
+    if (path[0] == '/') {
+        path.erase(0, 1);
+    }
+    std::shared_ptr<HttpFile> pFile = openFile(path);
+    if (!pFile) {
+        return nullptr;
+    }
+    pFile->contentType_ = contentType(path);
+    describe(*pFile, "");
+
+    std::shared_ptr<HttpFile> pGzip = openFile(path + ".gz");
+    if (pGzip && pGzip->modifiedNanos_ < pFile->modifiedNanos_) {
+        pGzip.reset();          // Stale: the file changed since
+    }
+    if (!pGzip && pFile->loaded() && pFile->uSize_ >= HttpEncoding::MIN_COMPRESSED
+        && HttpEncoding::compressible(pFile->contentType_)) {
+        std::string_view packed = HttpEncoding::gzip(pFile->contents_, GZIP_LEVEL);
+        if (!packed.empty()) {
+            pGzip = std::make_shared<HttpFile>();
+            pGzip->contents_ = packed;
+            pGzip->uSize_ = packed.size();
+            pGzip->modified_ = pFile->modified_;
+            pGzip->modifiedNanos_ = pFile->modifiedNanos_;
+            pGzip->path_ = pFile->path_;
+        }
+    }
+    if (pGzip) {
+        pGzip->contentType_ = pFile->contentType_;
+        describe(*pGzip, "-gz");
+        pGzip->headers_.append("Content-Encoding: gzip\r\n");
+        pGzip->headers_.append("Vary: Accept-Encoding\r\n");
+        pFile->headers_.append("Vary: Accept-Encoding\r\n");
+        pFile->pGzip_ = std::move(pGzip);
+    }
+    return pFile;
+}
+
+// Abstract : Open a regular file, reading it if it is small
+//
+// Returns  : The file, or nullptr if it is missing or not a regular file
+// Params   :
+//   path                      Path relative to the root
+//
+std::shared_ptr<HttpFile> HttpFileCache::openFile(const std::string& path) const {
+    int fd = ::openat(rootFd_, path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    auto pFile = std::make_shared<HttpFile>();
+    pFile->fd_ = fd;
+    pFile->uSize_ = st.st_size;
+    pFile->modified_ = st.st_mtim.tv_sec;
+    pFile->modifiedNanos_ = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    pFile->device_ = st.st_dev;
+    pFile->inode_ = st.st_ino;
+    pFile->path_ = path;
+
+    if (pFile->uSize_ <= HttpFile::MAX_LOADED) {
+        pFile->contents_.resize(pFile->uSize_);
+        std::size_t uRead = 0;
+        while (uRead < pFile->uSize_) {
+            ssize_t iRead = ::pread(fd, &pFile->contents_[uRead], pFile->uSize_ - uRead, uRead);
+            if (iRead < 0 && errno == EINTR) {
+                continue;
+            }
+            if (iRead <= 0) {
+                return nullptr;
+            }
+            uRead += iRead;
+        }
+        ::close(fd);
+        pFile->fd_ = -1;
+    }
+    return pFile;
+}
+
+// Build the entity tag of a file and its ETag and Last-Modified lines
+void HttpFileCache::describe(HttpFile& rFile, const char* tagSuffix) {
+    char etag[64];
+    snprintf(etag, sizeof(etag), "\"%llx-%llx%s\"",
+             static_cast<unsigned long long>(rFile.uSize_),
+             static_cast<unsigned long long>(rFile.modifiedNanos_), tagSuffix);
+    rFile.etag_ = etag;
+    char lastModified[HttpDate::LENGTH + 1];
+    HttpDate::format(rFile.modified_, lastModified);
+    rFile.headers_.append("ETag: ").append(rFile.etag_).append("\r\n");
+    rFile.headers_.append("Last-Modified: ").append(lastModified).append("\r\n");
+}
+
+bool HttpFileCache::stillValid(const HttpFile& rFile) const {
+    struct stat st;
+    return ::fstatat(rootFd_, rFile.path_.c_str(), &st, 0) == 0
+        && st.st_ino == rFile.inode_ && st.st_dev == rFile.device_
+        && static_cast<uint64_t>(st.st_size) == rFile.uSize_
+        && int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec == rFile.modifiedNanos_;
+}
+
+// Abstract : Watch each directory leading to a file
+//
+// Returns  : The watch of the file's own directory, -1 on failure
+// Params   :
+//   key                       Normalized request path of the file
+//
+// Pre      : lock_ is held exclusively.
+//
+int HttpFileCache::watchDirectories(const std::string& key) {
+    int watch = -1;
+#if CONFIG_HAS_INOTIFY
+    std::size_t uEnd = 0;
+    do {
+        std::string dir = key.substr(0, uEnd);
+        auto it = watches_.find(dir);
+        if (it != watches_.end()) {
+            watch = it->second;
+        } else {
+            std::string full = root_ + "/" + dir;
+            watch = inotify_add_watch(watchFd_, full.c_str(), WATCH_MASK);
+            if (watch < 0) {
+                return -1;
+            }
+            watches_.emplace(dir, watch);
+        }
+        uEnd = key.find('/', uEnd + 1);
+    } while (uEnd != std::string::npos);
+#endif
+    return watch;
+}
+
+// Abstract : Body of the thread dropping the files that change
+//
+void HttpFileCache::watcher() {
+#if CONFIG_HAS_INOTIFY
+    alignas(inotify_event) char buffer[4096];
+    pollfd fds[2] = { { watchFd_, POLLIN, 0 }, { wakeFd_, POLLIN, 0 } };
+    for (;;) {
+        if (::poll(fds, 2, -1) < 0 && errno != EINTR) {
+            break;
+        }
+        if (fds[1].revents) {
+            break;
+        }
+        ssize_t iRead = ::read(watchFd_, buffer, sizeof(buffer));
+        if (iRead <= 0) {
+            continue;
+        }
+
+        std::unique_lock<std::shared_mutex> guard(lock_);
+        ++uGeneration_;
+        for (char* pEvent = buffer; pEvent < buffer + iRead; ) {
+            auto* pNotify = reinterpret_cast<inotify_event*>(pEvent);
+            if (pNotify->mask & (IN_ISDIR | IN_Q_OVERFLOW | IN_IGNORED
+                                 | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                files_.clear();
+                watches_.clear();
+            } else {
+                int watch = pNotify->wd;
+                std::erase_if(files_, [watch](const auto& entry) {
+                    return entry.second->watch_ == watch;
+                });
+            }
+            pEvent += sizeof(inotify_event) + pNotify->len;
+        }
+    }
+#endif
+}
+
+const char* HttpFileCache::contentType(std::string_view name) {
+    std::size_t uDot = name.rfind('.');
+    std::size_t uSlash = name.rfind('/');
+    if (uDot != std::string_view::npos && (uSlash == std::string_view::npos || uDot > uSlash)) {
+        std::string_view extension = name.substr(uDot + 1);
+        for (const auto& entry : contentTypes) {
+            if (extension.size() == strlen(entry.extension)
+                && strncasecmp(extension.data(), entry.extension, extension.size()) == 0) {
+                return entry.type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
+
+void HttpFileCache::handler(HttpCall& rCall, void* ptr) {
+    const HttpParams& params = rCall.params();
+    std::string_view path = params.size() ? params[params.size() - 1] : rCall.request().path();
+    rCall.replyFile(*static_cast<HttpFileCache*>(ptr), path);
+}
@@ -0,0 +1,351 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : HttpHeaders.cpp
+//
+// Class      : HttpHeaders
+//
+// Description: Header fields of an HTTP message, with common names
+//              interned.
+//
+// Decisions  : Interned names are found by length first: a table built at
+//              compile time lists the identifiers of each length, of which
+//              there are at most four, so a lookup compares at most four
+//              names, most of them only as far as their first letter.
+//              Fields refer to their text by offset rather than by pointer,
+//              so the buffer can grow without them being fixed up.  Fields
+//              are few, and are searched in order; a map would cost more to
+//              build than it saves.
+//
+
+#include "config.h"
+#include <cassert>
+#include <cstring>
+
+#include <sockstr/HttpHeaders.h>
+#include <sockstr/HttpParser.h>
+
+using namespace sockstr;
+
+namespace {
+
+// Usual spelling of each interned name, in the order of HeaderId
+constexpr std::string_view headerNames[hdrCount] = {
+    "",
+    "Accept",
+    "Accept-Encoding",
+    "Accept-Language",
+    "Authorization",
+    "Cache-Control",
+    "Connection",
+    "Content-Encoding",
+    "Content-Length",
+    "Content-Type",
+    "Cookie",
+    "Date",
+    "ETag",
+    "Expect",
+    "Host",
+    "If-Modified-Since",
+    "If-None-Match",
+    "Last-Modified",
+    "Location",
+    "Server",
+    "Set-Cookie",
+    "Transfer-Encoding",
+    "Upgrade",
+    "User-Agent",
+    "Vary"
+};
+
+// Longest interned name
+constexpr std::size_t MAX_NAME = 17;
+// Most interned names of one length
+constexpr std::size_t MAX_SAME_LENGTH = 4;
+
+// Identifiers of the interned names, by length
+struct NameIndex {
+    uint8_t count[MAX_NAME + 1];
+    HeaderId ids[MAX_NAME + 1][MAX_SAME_LENGTH];
+
+    constexpr NameIndex() : count(), ids() {
+        for (int id = hdrOther + 1; id < hdrCount; id++) {
+            std::size_t uLength = headerNames[id].size();
+            ids[uLength][count[uLength]++] = static_cast<HeaderId>(id);
+        }
+    }
+};
+
+constexpr NameIndex nameIndex;
+
+}  // namespace
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+HeaderId HttpHeaders::lookup(std::string_view name) {
+    if (name.size() > MAX_NAME) {
+        return hdrOther;
+    }
+    for (std::size_t idx = 0; idx < nameIndex.count[name.size()]; idx++) {
+        HeaderId id = nameIndex.ids[name.size()][idx];
+        if (HttpParser::equalNames(name, headerNames[id])) {
+            return id;
+        }
+    }
+    return hdrOther;
+}
+
+std::string_view HttpHeaders::nameOf(HeaderId id) {
+    return id < hdrCount ? headerNames[id] : std::string_view();
+}
+
+void HttpHeaders::add(std::string_view name, std::string_view value) {
+    append(lookup(name), name, value);
+}
+
+void HttpHeaders::add(HeaderId id, std::string_view value) {
+    append(id, headerNames[id], value);
+}
+
+// Abstract : Replace the fields of a name with one field
+//
+// Remarks  : The first field of the name keeps its place.  Its value is
+//            overwritten where it is if the new one fits, and the others
+//            of the name are removed.
+//
+void HttpHeaders::set(std::string_view name, std::string_view value) {
+    HeaderId id = lookup(name);
+    for (std::size_t idx = 0; idx < uCount_; idx++) {
+        Entry& rEntry = entry(idx);
+        if (!matches(rEntry, id, name)) {
+            continue;
+        }
+        if (value.size() <= rEntry.uValueLength) {
+            memcpy(&text_[rEntry.uValue], value.data(), value.size());
+            uWaste_ += rEntry.uValueLength - value.size();
+        } else {
+            uWaste_ += rEntry.uValueLength;
+            rEntry.uValue = static_cast<uint32_t>(text_.size());
+            text_.append(value);
+        }
+        rEntry.uValueLength = static_cast<uint32_t>(value.size());
+        // Only the fields after this one can have the same name
+        for (std::size_t later = idx + 1; later < uCount_; ) {
+            const Entry& rLater = entry(later);
+            if (matches(rLater, id, name)) {
+                uWaste_ += rLater.uNameLength + rLater.uValueLength;
+                for (std::size_t move = later + 1; move < uCount_; move++) {
+                    entry(move - 1) = entry(move);
+                }
+                uCount_--;
+            } else {
+                later++;
+            }
+        }
+        if (uCount_ < INLINE_FIELDS) {
+            overflow_.clear();
+        } else {
+            overflow_.resize(uCount_ - INLINE_FIELDS);
+        }
+        if (uWaste_ > text_.size() / 2) {
+            compact();
+        }
+        return;
+    }
+    append(id, name, value);
+}
+
+void HttpHeaders::set(HeaderId id, std::string_view value) {
+    set(headerNames[id], value);
+}
+
+bool HttpHeaders::remove(std::string_view name) {
+    return removeAll(lookup(name), name);
+}
+
+bool HttpHeaders::remove(HeaderId id) {
+    return removeAll(id, headerNames[id]);
+}
+
+std::string_view HttpHeaders::get(std::string_view name) const {
+    HeaderId id = lookup(name);
+    for (std::size_t idx = 0; idx < uCount_; idx++) {
+        const Entry& rEntry = entry(idx);
+        if (matches(rEntry, id, name)) {
+            return text(rEntry.uValue, rEntry.uValueLength);
+        }
+    }
+    return std::string_view();
+}
+
+std::string_view HttpHeaders::get(HeaderId id) const {
+    if (id == hdrOther) {
+        return std::string_view();
+    }
+    for (std::size_t idx = 0; idx < uCount_; idx++) {
+        const Entry& rEntry = entry(idx);
+        if (rEntry.id == id) {
+            return text(rEntry.uValue, rEntry.uValueLength);
+        }
+    }
+    return std::string_view();
+}
+
+HttpHeaders::Field HttpHeaders::at(std::size_t uIndex) const {
+    VERIFY(uIndex < uCount_);
+    const Entry& rEntry = entry(uIndex);
+    return Field{ rEntry.id, nameOf(rEntry), text(rEntry.uValue, rEntry.uValueLength) };
+}
+
+void HttpHeaders::clear() {
+    uCount_ = 0;
+    overflow_.clear();
+    text_.clear();
+    uWaste_ = 0;
+}
+
+// Abstract : Replace the fields with those of header lines
+//
+// Returns  : Number of fields parsed
+//
+// Remarks  : White space around the value is removed.  This is the loose
+//            reading that headers built by a program need; messages from
+//            the network go through HttpParser, which checks the grammar.
+//
+std::size_t HttpHeaders::parse(const char* pData, std::size_t uSize) {
+    clear();
+    std::string_view lines(pData, uSize);
+    while (!lines.empty()) {
+        std::size_t uEnd = lines.find('\n');
+        std::string_view line = lines.substr(0, uEnd);
+        lines = (uEnd == lines.npos) ? std::string_view() : lines.substr(uEnd + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        std::size_t uColon = line.find(':');
+        if (uColon == line.npos || uColon == 0) {
+            continue;
+        }
+        std::string_view value = line.substr(uColon + 1);
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+            value.remove_prefix(1);
+        }
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+            value.remove_suffix(1);
+        }
+        add(line.substr(0, uColon), value);
+    }
+    return uCount_;
+}
+
+void HttpHeaders::appendTo(std::string& str) const {
+    for (std::size_t idx = 0; idx < uCount_; idx++) {
+        const Entry& rEntry = entry(idx);
+        str.append(nameOf(rEntry));
+        str.append(": ");
+        str.append(text(rEntry.uValue, rEntry.uValueLength));
+        str.append("\r\n");
+    }
+}
+
+std::string_view HttpHeaders::nameOf(const Entry& rEntry) const {
+    return rEntry.id == hdrOther ? text(rEntry.uName, rEntry.uNameLength) : headerNames[rEntry.id];
+}
+
+bool HttpHeaders::matches(const Entry& rEntry, HeaderId id, std::string_view name) const {
+    if (id != hdrOther || rEntry.id != hdrOther) {
+        return rEntry.id == id;
+    }
+    return rEntry.uNameLength == name.size()
+           && HttpParser::equalNames(text(rEntry.uName, rEntry.uNameLength), name);
+}
+
+void HttpHeaders::append(HeaderId id, std::string_view name, std::string_view value) {
+    Entry newEntry;
+    newEntry.id = id;
+    newEntry.uName = static_cast<uint32_t>(text_.size());
+    newEntry.uNameLength = 0;
+    if (id == hdrOther) {
+        text_.append(name);
+        newEntry.uNameLength = static_cast<uint32_t>(name.size());
+    }
+    newEntry.uValue = static_cast<uint32_t>(text_.size());
+    newEntry.uValueLength = static_cast<uint32_t>(value.size());
+    text_.append(value);
+    if (uCount_ < INLINE_FIELDS) {
+        inline_[uCount_] = newEntry;
+    } else {
+        overflow_.push_back(newEntry);
+    }
+    uCount_++;
+}
+
+bool HttpHeaders::removeAll(HeaderId id, std::string_view name) {
+    std::size_t uKept = 0;
+    for (std::size_t idx = 0; idx < uCount_; idx++) {
+        const Entry& rEntry = entry(idx);
+        if (matches(rEntry, id, name)) {
+            uWaste_ += rEntry.uNameLength + rEntry.uValueLength;
+        } else {
+            if (uKept != idx) {
+                entry(uKept) = rEntry;
+            }
+            uKept++;
+        }
+    }
+    if (uKept == uCount_) {
+        return false;
+    }
+    uCount_ = uKept;
+    if (uCount_ < INLINE_FIELDS) {
+        overflow_.clear();
+    } else {
+        overflow_.resize(uCount_ - INLINE_FIELDS);
+    }
+    if (uWaste_ > text_.size() / 2) {
+        compact();
+    }
+    return true;
+}
+
+// Abstract : Rebuild the buffer with only the text still referred to
+//
+// Remarks  : Only called once more than half of the buffer is waste, which
+//            takes repeated set() or remove() on the same message.
+//
+void HttpHeaders::compact() {
+    std::pmr::string packed(text_.get_allocator());
+    packed.reserve(text_.size() - uWaste_);
+    for (std::size_t idx = 0; idx < uCount_; idx++) {
+        Entry& rEntry = entry(idx);
+        uint32_t uName = static_cast<uint32_t>(packed.size());
+        packed.append(text(rEntry.uName, rEntry.uNameLength));
+        uint32_t uValue = static_cast<uint32_t>(packed.size());
+        packed.append(text(rEntry.uValue, rEntry.uValueLength));
+        rEntry.uName = uName;
+        rEntry.uValue = uValue;
+    }
+    text_.swap(packed);
+    uWaste_ = 0;
+}
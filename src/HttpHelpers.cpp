@@ -24,12 +24,89 @@
 
 #include <sockstr/HttpHelpers.h>
 #include <sockstr/Socket.h>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
 #include <sstream>
 #include <stdio.h>
 using namespace sockstr;
 
 const std::string HttpStatus::HTTP_HEADER = HTTP_VERSION " ";
-std::map<int, std::string> HttpStatus::statusNames_;
+
+namespace {
+
+struct StatusEntry
+{
+    int status;
+    std::string_view line;
+};
+
+#define STATUS_LINE(code, reason) { code, HTTP_VERSION " " #code " " reason "\r\n" }
+
+// Sorted by status code (RFC 9110 section 15)
+constexpr StatusEntry statusLines[] =
+{
+    STATUS_LINE(100, "Continue"),
+    STATUS_LINE(101, "Switching Protocols"),
+    STATUS_LINE(200, "OK"),
+    STATUS_LINE(201, "Created"),
+    STATUS_LINE(202, "Accepted"),
+    STATUS_LINE(203, "Non-Authoritative Information"),
+    STATUS_LINE(204, "No Content"),
+    STATUS_LINE(205, "Reset Content"),
+    STATUS_LINE(206, "Partial Content"),
+    STATUS_LINE(300, "Multiple Choices"),
+    STATUS_LINE(301, "Moved Permanently"),
+    STATUS_LINE(302, "Found"),
+    STATUS_LINE(303, "See Other"),
+    STATUS_LINE(304, "Not Modified"),
+    STATUS_LINE(307, "Temporary Redirect"),
+    STATUS_LINE(308, "Permanent Redirect"),
+    STATUS_LINE(400, "Bad Request"),
+    STATUS_LINE(401, "Unauthorized"),
+    STATUS_LINE(402, "Payment Required"),
+    STATUS_LINE(403, "Forbidden"),
+    STATUS_LINE(404, "Not Found"),
+    STATUS_LINE(405, "Method Not Allowed"),
+    STATUS_LINE(406, "Not Acceptable"),
+    STATUS_LINE(408, "Request Timeout"),
+    STATUS_LINE(409, "Conflict"),
+    STATUS_LINE(410, "Gone"),
+    STATUS_LINE(411, "Length Required"),
+    STATUS_LINE(412, "Precondition Failed"),
+    STATUS_LINE(413, "Content Too Large"),
+    STATUS_LINE(414, "URI Too Long"),
+    STATUS_LINE(415, "Unsupported Media Type"),
+    STATUS_LINE(416, "Range Not Satisfiable"),
+    STATUS_LINE(417, "Expectation Failed"),
+    STATUS_LINE(421, "Misdirected Request"),
+    STATUS_LINE(422, "Unprocessable Content"),
+    STATUS_LINE(426, "Upgrade Required"),
+    STATUS_LINE(428, "Precondition Required"),
+    STATUS_LINE(429, "Too Many Requests"),
+    STATUS_LINE(431, "Request Header Fields Too Large"),
+    STATUS_LINE(500, "Internal Server Error"),
+    STATUS_LINE(501, "Not Implemented"),
+    STATUS_LINE(502, "Bad Gateway"),
+    STATUS_LINE(503, "Service Unavailable"),
+    STATUS_LINE(504, "Gateway Timeout"),
+    STATUS_LINE(505, "HTTP Version Not Supported"),
+};
+
+#undef STATUS_LINE
+
+constexpr bool sortedByStatus()
+{
+    for (std::size_t idx = 1; idx < std::size(statusLines); idx++) {
+        if (statusLines[idx - 1].status >= statusLines[idx].status) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(sortedByStatus(), "statusLines must be sorted for the binary search");
+
+}  // namespace
 
 CompoundEncoder::CompoundEncoder(const char* separator)
     : separator_(separator)
@@ -109,20 +186,83 @@ TimestampEncoder::TimestampEncoder(bool refresh, DateTimeFormat format)
 }
 
 std::string TimestampEncoder::toString() {
-    char outstr[200];
-    struct tm* tmp;
+    char outstr[32];
     if (refresh_)
         timeSecs_ = time(0);
-    tmp = localtime(&timeSecs_);
 
     if (format_ == DateTimeRfc822)
-        strftime(outstr, sizeof(outstr), "%a, %d %b %Y %T %Z", tmp);
+        HttpDate::format(timeSecs_, outstr);
     else
         snprintf(outstr, sizeof(outstr), "%ld", timeSecs_);
 
     return std::string(outstr);
 }
 
+void TimestampEncoder::appendTo(std::string& str) {
+    // The Date header of every response comes from the per-second cache
+    if (refresh_ && format_ == DateTimeRfc822)
+        str += HttpDate::now();
+    else
+        str += toString();
+}
+
+
+void HttpDate::format(time_t timeSecs, char* buffer) {
+    static const char days[] = "SunMonTueWedThuFriSat";
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    struct tm tms;
+    gmtime_r(&timeSecs, &tms);
+    // Written by hand rather than with strftime, whose names depend on the locale
+    auto put2 = [](char* p, int value) {
+        p[0] = static_cast<char>('0' + value / 10 % 10);
+        p[1] = static_cast<char>('0' + value % 10);
+    };
+    int year = tms.tm_year + 1900;
+    memcpy(buffer, "Sun, 00 Jan 0000 00:00:00 GMT", LENGTH + 1);
+    memcpy(buffer, days + 3 * tms.tm_wday, 3);
+    put2(buffer + 5, tms.tm_mday);
+    memcpy(buffer + 8, months + 3 * tms.tm_mon, 3);
+    put2(buffer + 12, year / 100);
+    put2(buffer + 14, year % 100);
+    put2(buffer + 17, tms.tm_hour);
+    put2(buffer + 20, tms.tm_min);
+    put2(buffer + 23, tms.tm_sec);
+}
+
+bool HttpDate::parse(std::string_view text, time_t& rTimeSecs) {
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    if (text.size() != LENGTH || text.substr(3, 2) != ", " || text.substr(LENGTH - 4) != " GMT")
+        return false;
+    auto get = [&text](std::size_t pos, std::size_t len, int& value) {
+        const char* begin = text.data() + pos;
+        auto result = std::from_chars(begin, begin + len, value);
+        return result.ec == std::errc() && result.ptr == begin + len;
+    };
+    struct tm tms = {};
+    std::string_view month = text.substr(8, 3);
+    while (tms.tm_mon < 12 && month != std::string_view(months + 3 * tms.tm_mon, 3))
+        ++tms.tm_mon;
+    if (tms.tm_mon == 12 || !get(5, 2, tms.tm_mday)
+        || !get(12, 4, tms.tm_year) || !get(17, 2, tms.tm_hour)
+        || !get(20, 2, tms.tm_min) || !get(23, 2, tms.tm_sec))
+        return false;
+    tms.tm_year -= 1900;
+    rTimeSecs = timegm(&tms);
+    return rTimeSecs != -1;
+}
+
+std::string_view HttpDate::now() {
+    // Each thread keeps its own copy, so no lock is taken per message
+    thread_local time_t cachedSecs = -1;
+    thread_local char cachedDate[LENGTH + 1];
+    time_t timeSecs = time(0);
+    if (timeSecs != cachedSecs) {
+        format(timeSecs, cachedDate);
+        cachedSecs = timeSecs;
+    }
+    return std::string_view(cachedDate, LENGTH);
+}
+
 
 std::string UrlParameterEncoder::toString() {
     std::string outstr(urlEncode(getName()) + "=" + urlEncode(HttpParamEncoder::toString()));
@@ -164,17 +304,6 @@ HttpStatus::HttpStatus(const std::string& statusLine)
     }
 }
 
-void HttpStatus::init_() {
-    if (statusNames_.empty()) {
-        statusNames_[100] = " Continue";
-        statusNames_[200] = " OK";
-        statusNames_[400] = " Bad Request";
-        statusNames_[401] = " Unauthorized";
-        statusNames_[403] = " Forbidden";
-        statusNames_[404] = " Not Found";
-    }
-}
-
 int HttpStatus::getStatus() const {
     return status_;
 }
@@ -184,14 +313,31 @@ void HttpStatus::setStatus(int status) {
 }
 
 std::string HttpStatus::statusLine() const {
-    std::ostringstream oss;
-    oss << HTTP_HEADER << status_ << statusName() << "\r" << std::endl;
-    return oss.str();
+    std::string_view line = knownStatusLine(status_);
+    if (!line.empty()) {
+        return std::string(line);
+    }
+    char code[16];
+    char* end = std::to_chars(code, code + sizeof(code), status_).ptr;
+    return HTTP_HEADER + std::string(code, end) + " \r\n";
 }
 
 std::string HttpStatus::statusName() const {
-    if (statusNames_.find(status_) != statusNames_.end()) {
-        return statusNames_[status_];
+    std::string_view line = knownStatusLine(status_);
+    if (line.empty()) {
+        return " ";
+    }
+    // Skip "HTTP/1.1 200", drop the CRLF
+    std::size_t start = HTTP_HEADER.size() + 3;
+    return std::string(line.substr(start, line.size() - start - 2));
+}
+
+std::string_view HttpStatus::knownStatusLine(int status) {
+    const StatusEntry* entry =
+        std::lower_bound(std::begin(statusLines), std::end(statusLines), status,
+                         [](const StatusEntry& ent, int st) { return ent.status < st; });
+    if (entry == std::end(statusLines) || entry->status != status) {
+        return std::string_view();
     }
-    return " ";
+    return entry->line;
 }
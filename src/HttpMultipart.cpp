@@ -0,0 +1,349 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : HttpMultipart.cpp
+//
+// Class      : HttpMultipartParser
+//
+// Description: Incremental parsing of multipart/form-data bodies.
+//
+// Decisions  : The body is treated as if it started with CRLF, so that a
+//              delimiter at the very start is found like any other.
+//              Content is passed on as far as it cannot be the start of a
+//              delimiter; the possible start, shorter than the delimiter,
+//              is kept in carry_ and checked against the next piece.  A
+//              part is never held whole, and content is copied only when a
+//              delimiter may straddle two pieces.
+//
+
+#include "config.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include <sockstr/HttpBody.h>
+#include <sockstr/HttpMultipart.h>
+#include <sockstr/HttpParser.h>
+
+using namespace sockstr;
+
+// Longest line after a delimiter, which may hold transport padding
+static const std::size_t MAX_DELIMITER_LINE = 1024;
+
+namespace {
+
+// Find the next parameter of a header value, after the ';' at or after
+// pos.  A quoted value is returned without its quotes, escapes kept.
+bool nextParam(std::string_view text, std::size_t& pos, std::string_view& key,
+               std::string_view& value) {
+    pos = std::min(text.find(';', pos), text.size());
+    if (pos == text.size()) {
+        return false;
+    }
+    ++pos;
+    std::size_t end = std::min(text.find_first_of("=;", pos), text.size());
+    key = HttpParser::trim(text.substr(pos, end - pos));
+    value = std::string_view();
+    pos = end;
+    if (pos == text.size() || text[pos] == ';') {
+        return true;
+    }
+    ++pos;
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t')) {
+        ++pos;
+    }
+    if (pos < text.size() && text[pos] == '"') {
+        end = ++pos;
+        while (end < text.size() && text[end] != '"') {
+            end += text[end] == '\\' ? 2 : 1;
+        }
+        end = std::min(end, text.size());
+        value = text.substr(pos, end - pos);
+        pos = std::min(end + 1, text.size());
+    } else {
+        end = std::min(text.find(';', pos), text.size());
+        value = HttpParser::trim(text.substr(pos, end - pos));
+        pos = end;
+    }
+    return true;
+}
+
+std::string unquote(std::string_view value) {
+    std::string result;
+    result.reserve(value.size());
+    for (std::size_t i = 0; i < value.size(); i++) {
+        if (value[i] == '\\' && i + 1 < value.size()) {
+            ++i;
+        }
+        result += value[i];
+    }
+    return result;
+}
+
+}
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+HttpMultipartParser::HttpMultipartParser(std::string_view boundary, HttpPartHandler pHandler,
+                                         void* ptr)
+    : delimiter_("\r\n--")
+    , pHandler_(pHandler)
+    , ptr_(ptr)
+    , state_(boundary.empty() ? stateError : statePreamble)
+    , carry_("\r\n")
+    , pSink_(0) {
+    delimiter_.append(boundary);
+}
+
+// Abstract : Find the boundary of a multipart body
+//
+// Returns  : std::string_view (the boundary, empty if there is none)
+// Params   :
+//   contentType               Value of the Content-Type header
+//
+// Remarks  : A boundary is 1 to 70 characters and does not end with a
+//            space (RFC 2046 section 5.1.1).
+//
+std::string_view HttpMultipartParser::boundaryOf(std::string_view contentType) {
+    static const std::string_view multipart("multipart/");
+    if (contentType.size() < multipart.size()
+        || !HttpParser::equalNames(contentType.substr(0, multipart.size()), multipart)) {
+        return std::string_view();
+    }
+    std::size_t pos = 0;
+    std::string_view key;
+    std::string_view value;
+    while (nextParam(contentType, pos, key, value)) {
+        if (HttpParser::equalNames(key, "boundary")) {
+            if (value.empty() || value.size() > 70 || value.back() == ' ') {
+                break;
+            }
+            return value;
+        }
+    }
+    return std::string_view();
+}
+
+// Abstract : Parse the next piece of a multipart body
+//
+// Returns  : bool (false if the body is malformed or a sink failed)
+// Params   :
+//   pData                     Next piece of the body
+//   uLength                   Size of the piece
+//
+// Remarks  : Whatever follows the closing delimiter is ignored.
+//
+bool HttpMultipartParser::write(const char* pData, std::size_t uLength) {
+    while (uLength > 0 && state_ != stateError && state_ != stateEpilogue) {
+        std::size_t uUsed;
+        switch (state_) {
+        case stateDelimiter:
+            uUsed = scanLine(pData, uLength);
+            break;
+        case stateHeaders:
+            uUsed = scanHeaders(pData, uLength);
+            break;
+        default:
+            uUsed = scanContent(pData, uLength);
+            break;
+        }
+        pData += uUsed;
+        uLength -= uUsed;
+    }
+    return state_ != stateError;
+}
+
+// Abstract : Pass on preamble or part content up to the next delimiter
+//
+// Returns  : std::size_t (number of bytes of pData used)
+//
+// Remarks  : With a possible delimiter start in carry_, enough of pData
+//            is added to it to tell.  If there is no delimiter in carry_,
+//            carry_ is passed on and nothing is used, so that pData is
+//            then scanned where it is.
+//
+std::size_t HttpMultipartParser::scanContent(const char* pData, std::size_t uLength) {
+    std::size_t uDelimiter = delimiter_.size();
+    if (!carry_.empty()) {
+        std::size_t uCarried = carry_.size();
+        std::size_t uAdded = std::min(uLength, uDelimiter);
+        carry_.append(pData, uAdded);
+        std::size_t pos = carry_.find(delimiter_);
+        if (pos != std::string::npos) {
+            if (content(carry_.data(), pos)) {
+                foundDelimiter();
+            }
+            carry_.clear();
+            return pos + uDelimiter - uCarried;
+        }
+        if (uAdded == uLength) {
+            std::size_t keep = partialDelimiter(carry_);
+            content(carry_.data(), keep);
+            carry_.erase(0, keep);
+            return uLength;
+        }
+        content(carry_.data(), uCarried);
+        carry_.clear();
+        return 0;
+    }
+
+    std::string_view data(pData, uLength);
+    std::size_t pos = data.find(delimiter_);
+    if (pos != std::string_view::npos) {
+        if (content(pData, pos)) {
+            foundDelimiter();
+        }
+        return pos + uDelimiter;
+    }
+    std::size_t keep = partialDelimiter(data);
+    if (content(pData, keep)) {
+        carry_.assign(pData + keep, uLength - keep);
+    }
+    return uLength;
+}
+
+// Abstract : Read the rest of a delimiter line
+//
+// Remarks  : "--" after the boundary closes the body.  Otherwise only
+//            spaces and tabs may come before the CRLF that starts the
+//            header block of the next part.
+//
+std::size_t HttpMultipartParser::scanLine(const char* pData, std::size_t uLength) {
+    const char* pEnd = static_cast<const char*>(memchr(pData, '\n', uLength));
+    std::size_t uUsed = pEnd ? pEnd - pData + 1 : uLength;
+    line_.append(pData, uUsed);
+    if (line_[0] == '-') {
+        if (line_.size() >= 2) {
+            state_ = line_[1] == '-' ? stateEpilogue : stateError;
+        }
+        return uLength;
+    }
+    if (line_.size() > MAX_DELIMITER_LINE) {
+        state_ = stateError;
+    } else if (pEnd) {
+        std::size_t uPadding = line_.size() - 2;
+        if (line_.size() < 2 || line_[uPadding] != '\r'
+            || line_.find_first_not_of(" \t") != uPadding) {
+            state_ = stateError;
+        } else {
+            // The CRLF starts the header block, so an empty one is found too
+            line_.assign("\r\n");
+            state_ = stateHeaders;
+        }
+    }
+    return uUsed;
+}
+
+// Abstract : Collect the header block of a part
+//
+// Remarks  : When the blank line that ends it is found, the handler is
+//            asked where the content of the part goes.
+//
+std::size_t HttpMultipartParser::scanHeaders(const char* pData, std::size_t uLength) {
+    std::size_t uHad = line_.size();
+    std::size_t uAdded = std::min(uLength, maxHeaderBytes + 4 - uHad);
+    line_.append(pData, uAdded);
+    std::size_t pos = line_.find("\r\n\r\n", uHad >= 3 ? uHad - 3 : 0);
+    if (pos == std::string::npos) {
+        if (line_.size() >= maxHeaderBytes + 4) {
+            state_ = stateError;
+        }
+        return uAdded;
+    }
+    line_.resize(pos + 2);
+    parseHeaders();
+    pSink_ = pHandler_(part_, false, ptr_);
+    state_ = stateBody;
+    return pos + 4 - uHad;
+}
+
+bool HttpMultipartParser::content(const char* pData, std::size_t uLength) {
+    if (state_ == stateBody && pSink_ && uLength > 0 && !pSink_->write(pData, uLength)) {
+        state_ = stateError;
+        return false;
+    }
+    return true;
+}
+
+void HttpMultipartParser::foundDelimiter() {
+    if (state_ == stateBody) {
+        pHandler_(part_, true, ptr_);
+        pSink_ = 0;
+    }
+    line_.clear();
+    state_ = stateDelimiter;
+}
+
+// Abstract : Find where a possible start of the delimiter begins at the
+//            end of text
+//
+// Returns  : std::size_t (its offset, or the size of text if none)
+//
+std::size_t HttpMultipartParser::partialDelimiter(std::string_view text) const {
+    std::size_t pos = text.size() >= delimiter_.size() ? text.size() - delimiter_.size() + 1 : 0;
+    while ((pos = text.find('\r', pos)) != std::string_view::npos) {
+        std::size_t uRest = text.size() - pos;
+        if (delimiter_.compare(0, uRest, text.data() + pos, uRest) == 0) {
+            return pos;
+        }
+        ++pos;
+    }
+    return text.size();
+}
+
+// Abstract : Take the name, file name and type of a part from its headers
+//
+// Remarks  : line_ holds CRLF and then the header lines, each ending with
+//            CRLF.
+//
+void HttpMultipartParser::parseHeaders() {
+    part_ = HttpPart();
+    std::string_view block(line_);
+    std::size_t pos = 2;
+    while (pos < block.size()) {
+        std::size_t end = block.find("\r\n", pos);
+        std::string_view field = block.substr(pos, end - pos);
+        pos = end + 2;
+        std::size_t colon = field.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+        std::string_view name = HttpParser::trim(field.substr(0, colon));
+        std::string_view value = HttpParser::trim(field.substr(colon + 1));
+        if (HttpParser::equalNames(name, "Content-Type")) {
+            part_.contentType.assign(value);
+        } else if (HttpParser::equalNames(name, "Content-Disposition")) {
+            std::size_t at = 0;
+            std::string_view key;
+            std::string_view param;
+            while (nextParam(value, at, key, param)) {
+                if (HttpParser::equalNames(key, "name")) {
+                    part_.name = unquote(param);
+                } else if (HttpParser::equalNames(key, "filename")) {
+                    part_.filename = unquote(param);
+                }
+            }
+        }
+    }
+}
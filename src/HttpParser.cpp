@@ -0,0 +1,618 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : HttpParser.cpp
+//
+// Class      : HttpParser, HttpChunkDecoder
+//
+// Description: Incremental parsing of the head of HTTP/1.x requests and
+//              responses, and of chunked bodies.
+//
+// Decisions  : The parser works line by line.  The end of a line is found
+//              with memchr, and a line is only parsed once it is complete,
+//              so a message that arrives in many pieces costs no more than
+//              one that arrives whole.
+//              Characters are classified with tables rather than the
+//              <cctype> functions, which depend on the locale.
+//              The grammar is that of RFC 9112, applied strictly where a
+//              lenient reading lets a message mean different things to
+//              different servers: white space before the colon of a header,
+//              folded header lines, and a request with both Content-Length
+//              and Transfer-Encoding are rejected.  A bare LF is accepted as
+//              the end of a line.
+//              Header names are interned as they are parsed (see
+//              HttpHeaders), so the fields that frame the body, and those a
+//              server looks for, are found without comparing letters.
+//
+
+#include "config.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include <sockstr/HttpParser.h>
+
+using namespace sockstr;
+
+namespace {
+
+enum CharClass : unsigned char {
+    classToken = 1,         // tchar: may appear in a method or header name
+    classTarget = 2,        // may appear in a request target
+    classValue = 4          // may appear in a header value or reason phrase
+};
+
+struct CharTable {
+    unsigned char klass[256];
+    unsigned char lower[256];
+
+    constexpr CharTable() : klass(), lower() {
+        for (int ch = 0; ch < 256; ch++) {
+            lower[ch] = static_cast<unsigned char>((ch >= 'A' && ch <= 'Z') ? ch + 32 : ch);
+            bool bAlnum = (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z')
+                          || (ch >= '0' && ch <= '9');
+            bool bToken = bAlnum;
+            for (const char* p = "!#$%&'*+-.^_`|~"; *p; p++) {
+                bToken = bToken || ch == *p;
+            }
+            if (bToken) {
+                klass[ch] |= classToken;
+            }
+            // Visible ASCII; octets above 0x7f are let through as opaque data
+            if ((ch > 0x20 && ch < 0x7f) || ch >= 0x80) {
+                klass[ch] |= classTarget | classValue;
+            }
+            if (ch == ' ' || ch == '\t') {
+                klass[ch] |= classValue;
+            }
+        }
+    }
+};
+
+constexpr CharTable chars;
+
+inline bool is(char ch, CharClass eClass) {
+    return (chars.klass[static_cast<unsigned char>(ch)] & eClass) != 0;
+}
+
+inline bool isSpace(char ch) {
+    return ch == ' ' || ch == '\t';
+}
+
+}  // namespace
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+HttpParser::HttpParser(Kind eKind, std::pmr::memory_resource* pMemory)
+    : kind_(eKind)
+    , fields_(pMemory) {
+    reset();
+}
+
+void HttpParser::reset() {
+    state_ = stateStart;
+    error_ = errorNone;
+    pBase_ = nullptr;
+    line_ = 0;
+    scan_ = 0;
+    method_ = uri_ = reason_ = Span();
+    uStatus_ = 0;
+    nMinor_ = 1;
+    fields_.clear();
+    headEnd_ = 0;
+    bodyKind_ = bodyNone;
+    uLength_ = 0;
+    bKeepAlive_ = false;
+}
+
+HttpParser::Result HttpParser::fail(Error eError) {
+    state_ = stateError;
+    error_ = eError;
+    return parseError;
+}
+
+// Abstract : Parse what has been received of the head of a message
+//
+// Returns  : Result (parseIncomplete until the empty line is seen)
+// Params   :
+//   pData                     Start of the message
+//   uSize                     Number of bytes received so far
+//
+// Pre      : pData holds the same message as in the previous call, with
+//            at least as many bytes.
+// Post     : On parseComplete, the start line, headers and body framing
+//            are available and headerSize() is the offset of the body.
+//
+HttpParser::Result HttpParser::parse(const char* pData, std::size_t uSize) {
+    // Even a complete head must follow the buffer when it moves
+    pBase_ = pData;
+    if (state_ == stateDone) {
+        return parseComplete;
+    }
+    if (state_ == stateError) {
+        return parseError;
+    }
+    for (;;) {
+        const char* pEol = (scan_ < uSize)
+            ? static_cast<const char*>(memchr(pData + scan_, '\n', uSize - scan_))
+            : nullptr;
+        if (pEol == nullptr) {
+            scan_ = uSize;
+            if (state_ == stateStart && uSize - line_ > limits_.uMaxLine) {
+                return fail(errorLineTooLong);
+            }
+            if (uSize > limits_.uMaxHeaderBytes) {
+                return fail(errorHeadersTooLarge);
+            }
+            return parseIncomplete;
+        }
+        std::size_t uNext = pEol - pData + 1;
+        std::size_t uEnd = uNext - 1;
+        if (uEnd > line_ && pData[uEnd - 1] == '\r') {
+            uEnd--;
+        }
+        if (uNext > limits_.uMaxHeaderBytes) {
+            return fail(errorHeadersTooLarge);
+        }
+
+        if (state_ == stateStart) {
+            // Empty lines before a message are skipped (RFC 9112 2.2)
+            if (uEnd > line_) {
+                if (uEnd - line_ > limits_.uMaxLine) {
+                    return fail(errorLineTooLong);
+                }
+                bool bValid = (kind_ == messageRequest) ? parseRequestLine(line_, uEnd)
+                                                        : parseStatusLine(line_, uEnd);
+                if (!bValid) {
+                    return fail(error_ != errorNone ? error_ : errorSyntax);
+                }
+                state_ = stateHeaders;
+            }
+        } else if (uEnd == line_) {
+            headEnd_ = uNext;
+            return finish();
+        } else {
+            if (fields_.size() >= limits_.uMaxHeaders) {
+                return fail(errorTooManyHeaders);
+            }
+            if (!parseHeader(line_, uEnd)) {
+                return fail(errorSyntax);
+            }
+        }
+        line_ = scan_ = uNext;
+    }
+}
+
+// request-line = method SP request-target SP HTTP-version
+bool HttpParser::parseRequestLine(std::size_t uBegin, std::size_t uEnd) {
+    const char* p = pBase_ + uBegin;
+    const char* pEnd = pBase_ + uEnd;
+    const char* pMethod = p;
+    while (p < pEnd && is(*p, classToken)) {
+        p++;
+    }
+    if (p == pMethod || p == pEnd || *p != ' ') {
+        return false;
+    }
+    method_ = { static_cast<uint32_t>(pMethod - pBase_), static_cast<uint32_t>(p - pMethod) };
+
+    const char* pUri = ++p;
+    while (p < pEnd && is(*p, classTarget)) {
+        p++;
+    }
+    if (p == pUri || p == pEnd || *p != ' ') {
+        return false;
+    }
+    uri_ = { static_cast<uint32_t>(pUri - pBase_), static_cast<uint32_t>(p - pUri) };
+    p++;
+    return parseVersion(p, pEnd - p);
+}
+
+// status-line = HTTP-version SP status-code SP [ reason-phrase ]
+bool HttpParser::parseStatusLine(std::size_t uBegin, std::size_t uEnd) {
+    const char* p = pBase_ + uBegin;
+    const char* pEnd = pBase_ + uEnd;
+    if (pEnd - p < 12 || !parseVersion(p, 8) || p[8] != ' ') {
+        return false;
+    }
+    p += 9;
+    uStatus_ = 0;
+    for (int idx = 0; idx < 3; idx++, p++) {
+        if (*p < '0' || *p > '9') {
+            return false;
+        }
+        uStatus_ = uStatus_ * 10 + (*p - '0');
+    }
+    if (uStatus_ < 100) {
+        return false;
+    }
+    // Some servers leave out the space when there is no reason phrase
+    if (p < pEnd) {
+        if (*p++ != ' ') {
+            return false;
+        }
+        for (const char* pReason = p; pReason < pEnd; pReason++) {
+            if (!is(*pReason, classValue)) {
+                return false;
+            }
+        }
+    }
+    reason_ = { static_cast<uint32_t>(p - pBase_), static_cast<uint32_t>(pEnd - p) };
+    return true;
+}
+
+bool HttpParser::parseVersion(const char* pVersion, std::size_t uLength) {
+    if (uLength != 8 || memcmp(pVersion, "HTTP/", 5) != 0 || pVersion[6] != '.'
+        || pVersion[5] < '0' || pVersion[5] > '9' || pVersion[7] < '0' || pVersion[7] > '9') {
+        return false;
+    }
+    if (pVersion[5] != '1') {
+        error_ = errorVersion;
+        return false;
+    }
+    // A later 1.x version is understood as 1.1 (RFC 9110 2.5)
+    nMinor_ = (pVersion[7] == '0') ? 0 : 1;
+    return true;
+}
+
+// field-line = field-name ":" OWS field-value OWS
+bool HttpParser::parseHeader(std::size_t uBegin, std::size_t uEnd) {
+    const char* p = pBase_ + uBegin;
+    const char* pEnd = pBase_ + uEnd;
+    const char* pName = p;
+    while (p < pEnd && is(*p, classToken)) {
+        p++;
+    }
+    // This also rejects folded lines, which start with white space
+    if (p == pName || p == pEnd || *p != ':') {
+        return false;
+    }
+    Field field;
+    field.name = { static_cast<uint32_t>(pName - pBase_), static_cast<uint32_t>(p - pName) };
+    field.id = HttpHeaders::lookup(std::string_view(pName, p - pName));
+    p++;
+    while (p < pEnd && isSpace(*p)) {
+        p++;
+    }
+    const char* pValue = p;
+    for (; p < pEnd; p++) {
+        if (!is(*p, classValue)) {
+            return false;
+        }
+    }
+    while (pEnd > pValue && isSpace(pEnd[-1])) {
+        pEnd--;
+    }
+    field.value = { static_cast<uint32_t>(pValue - pBase_), static_cast<uint32_t>(pEnd - pValue) };
+    fields_.push_back(field);
+    return true;
+}
+
+// Abstract : Work out the framing of the body once the head is complete
+//
+// Returns  : Result (parseComplete, or parseError if the framing is invalid)
+//
+// Remarks  : RFC 9112 section 6.3.  A request without Content-Length or
+//            Transfer-Encoding has no body; a response without them runs
+//            until the connection is closed.  The caller of a HEAD request
+//            must know by itself that the response has no body.
+//
+HttpParser::Result HttpParser::finish() {
+    bool bLength = false;
+    bool bEncoded = false;
+    bool bChunked = false;
+    uint64_t uLength = 0;
+    bKeepAlive_ = (nMinor_ >= 1);
+
+    for (const Field& field : fields_) {
+        std::string_view value = view(field.value);
+        if (field.id == hdrContentLength) {
+            if (value.empty() || value.size() > 18) {
+                return fail(errorBadLength);
+            }
+            uint64_t uValue = 0;
+            for (char ch : value) {
+                if (ch < '0' || ch > '9') {
+                    return fail(errorBadLength);
+                }
+                uValue = uValue * 10 + (ch - '0');
+            }
+            if (bLength && uValue != uLength) {
+                return fail(errorBadLength);
+            }
+            bLength = true;
+            uLength = uValue;
+        } else if (field.id == hdrTransferEncoding) {
+            // Only the last coding matters for the framing
+            std::size_t uComma = value.rfind(',');
+            std::string_view coding = trim(uComma == value.npos ? value : value.substr(uComma + 1));
+            bEncoded = true;
+            bChunked = equalNames(coding, "chunked");
+        } else if (field.id == hdrConnection) {
+            while (!value.empty()) {
+                std::size_t uComma = value.find(',');
+                std::string_view option = trim(value.substr(0, uComma));
+                if (equalNames(option, "close")) {
+                    bKeepAlive_ = false;
+                } else if (equalNames(option, "keep-alive")) {
+                    bKeepAlive_ = true;
+                }
+                value = (uComma == value.npos) ? std::string_view() : value.substr(uComma + 1);
+            }
+        }
+    }
+
+    if (kind_ == messageRequest) {
+        if (bEncoded) {
+            // Both framings at once is how requests are smuggled past proxies
+            if (bLength) {
+                return fail(errorBadLength);
+            }
+            if (!bChunked) {
+                return fail(errorBadEncoding);
+            }
+            bodyKind_ = bodyChunked;
+        } else {
+            bodyKind_ = (uLength > 0) ? bodyLength : bodyNone;
+        }
+    } else if (uStatus_ < 200 || uStatus_ == 204 || uStatus_ == 304) {
+        bodyKind_ = bodyNone;
+    } else if (bEncoded) {
+        bodyKind_ = bChunked ? bodyChunked : bodyUntilClose;
+    } else if (bLength) {
+        bodyKind_ = (uLength > 0) ? bodyLength : bodyNone;
+    } else {
+        bodyKind_ = bodyUntilClose;
+    }
+    if (bodyKind_ == bodyUntilClose) {
+        bKeepAlive_ = false;
+    }
+    if (bodyKind_ == bodyLength) {
+        if (uLength > limits_.uMaxBody) {
+            return fail(errorBodyTooLarge);
+        }
+        uLength_ = uLength;
+    }
+    state_ = stateDone;
+    return parseComplete;
+}
+
+UINT HttpParser::errorStatus() const {
+    switch (error_) {
+    case errorNone:             return 0;
+    case errorVersion:          return 505;
+    case errorLineTooLong:      return 414;
+    case errorHeadersTooLarge:
+    case errorTooManyHeaders:   return 431;
+    case errorBodyTooLarge:     return 413;
+    case errorBadEncoding:      return 501;
+    default:                    return 400;
+    }
+}
+
+std::string_view HttpParser::path() const {
+    std::string_view target = uri();
+    return target.substr(0, target.find('?'));
+}
+
+std::string_view HttpParser::query() const {
+    std::string_view target = uri();
+    std::size_t uMark = target.find('?');
+    return (uMark == target.npos) ? std::string_view() : target.substr(uMark + 1);
+}
+
+HttpParser::Header HttpParser::headerAt(UINT uIndex) const {
+    VERIFY(uIndex < fields_.size());
+    return Header{ view(fields_[uIndex].name), view(fields_[uIndex].value), fields_[uIndex].id };
+}
+
+std::string_view HttpParser::header(std::string_view name) const {
+    HeaderId id = HttpHeaders::lookup(name);
+    if (id != hdrOther) {
+        return header(id);
+    }
+    for (const Field& field : fields_) {
+        if (field.id == hdrOther && field.name.uLength == name.size()
+            && equalNames(view(field.name), name)) {
+            return view(field.value);
+        }
+    }
+    return std::string_view();
+}
+
+std::string_view HttpParser::header(HeaderId id) const {
+    if (id == hdrOther) {
+        return std::string_view();
+    }
+    for (const Field& field : fields_) {
+        if (field.id == id) {
+            return view(field.value);
+        }
+    }
+    return std::string_view();
+}
+
+bool HttpParser::equalNames(std::string_view name1, std::string_view name2) {
+    if (name1.size() != name2.size()) {
+        return false;
+    }
+    for (std::size_t idx = 0; idx < name1.size(); idx++) {
+        if (chars.lower[static_cast<unsigned char>(name1[idx])]
+            != chars.lower[static_cast<unsigned char>(name2[idx])]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string_view HttpParser::trim(std::string_view text) {
+    while (!text.empty() && isSpace(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && isSpace(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+bool HttpParser::hasToken(std::string_view list, std::string_view token) {
+    std::size_t pos = 0;
+    while (pos <= list.size()) {
+        std::size_t end = std::min(list.find(',', pos), list.size());
+        if (equalNames(trim(list.substr(pos, end - pos)), token)) {
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+
+HttpChunkDecoder::HttpChunkDecoder() {
+    reset();
+}
+
+void HttpChunkDecoder::reset() {
+    state_ = stateSize;
+    uRemaining_ = 0;
+    uTotal_ = 0;
+    uDigits_ = 0;
+    uLineBytes_ = 0;
+    bLineEmpty_ = true;
+}
+
+void HttpChunkDecoder::endSizeLine() {
+    // A chunk of size zero is the last one; the trailer follows
+    state_ = (uRemaining_ == 0) ? stateTrailer : stateData;
+    uDigits_ = 0;
+    uLineBytes_ = 0;
+    bLineEmpty_ = true;
+}
+
+// Abstract : Decode the next part of a chunked body
+//
+// Returns  : Result
+// Params   :
+//   pData                     Bytes received
+//   uSize                     Number of bytes at pData
+//   rUsed                     Set to the number of bytes consumed
+//   rPayload                  Set to the payload found, empty if none
+//
+// Remarks  : RFC 9112 section 7.1.  The framing is consumed a byte at a
+//            time, but the data of a chunk is returned in one piece, as
+//            much of it as there is in the input.
+//
+HttpChunkDecoder::Result HttpChunkDecoder::decode(const char* pData, std::size_t uSize,
+                                                  std::size_t& rUsed,
+                                                  std::string_view& rPayload) {
+    rPayload = std::string_view();
+    std::size_t uPos = 0;
+    while (uPos < uSize && state_ != stateDone && state_ != stateError) {
+        char ch = pData[uPos];
+        switch (state_) {
+        case stateSize:
+            if ((ch >= '0' && ch <= '9') || ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'f')) {
+                // 15 hex digits keep the size within 60 bits
+                if (++uDigits_ > 15) {
+                    state_ = stateError;
+                    break;
+                }
+                int nDigit = (ch <= '9') ? ch - '0' : (ch | 0x20) - 'a' + 10;
+                uRemaining_ = uRemaining_ * 16 + nDigit;
+            } else if (uDigits_ == 0) {
+                state_ = stateError;
+            } else if (ch == ';' || ch == ' ' || ch == '\t') {
+                state_ = stateExtension;
+            } else if (ch == '\r') {
+                state_ = stateSizeLf;
+            } else if (ch == '\n') {
+                endSizeLine();
+            } else {
+                state_ = stateError;
+            }
+            break;
+        case stateExtension:
+            if (ch == '\n') {
+                endSizeLine();
+            } else if (++uLineBytes_ > maxLineBytes) {
+                state_ = stateError;
+            }
+            break;
+        case stateSizeLf:
+            if (ch == '\n') {
+                endSizeLine();
+            } else {
+                state_ = stateError;
+            }
+            break;
+        case stateData: {
+            std::size_t uTake = static_cast<std::size_t>(
+                std::min<uint64_t>(uRemaining_, uSize - uPos));
+            rPayload = std::string_view(pData + uPos, uTake);
+            uRemaining_ -= uTake;
+            uTotal_ += uTake;
+            if (uRemaining_ == 0) {
+                state_ = stateDataCr;
+            }
+            rUsed = uPos + uTake;
+            return chunkMore;
+        }
+        case stateDataCr:
+            if (ch == '\r') {
+                state_ = stateDataLf;
+            } else if (ch == '\n') {
+                state_ = stateSize;
+            } else {
+                state_ = stateError;
+            }
+            break;
+        case stateDataLf:
+            state_ = (ch == '\n') ? stateSize : stateError;
+            break;
+        case stateTrailer:
+            if (ch == '\n') {
+                if (bLineEmpty_) {
+                    state_ = stateDone;
+                }
+                bLineEmpty_ = true;
+            } else if (ch != '\r') {
+                bLineEmpty_ = false;
+                if (++uLineBytes_ > maxLineBytes) {
+                    state_ = stateError;
+                }
+            }
+            break;
+        default:
+            break;
+        }
+        if (state_ != stateError) {
+            uPos++;
+        }
+    }
+    rUsed = uPos;
+    if (state_ == stateError) {
+        return chunkError;
+    }
+    return (state_ == stateDone) ? chunkDone : chunkMore;
+}
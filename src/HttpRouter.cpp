@@ -0,0 +1,426 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : HttpRouter.cpp
+//
+// Class      : HttpRouter, HttpParams, HttpLatencyHistogram
+//
+// Description: Radix tree dispatch of HTTP requests.
+//
+// Decisions  : A node of the tree is reached by an edge of static text, its
+//              prefix, which is split when a pattern diverges inside it.
+//              Besides static children, keyed by their first byte, a node
+//              has at most one parameter child and one wildcard child, so
+//              parameters at the same place in different patterns share a
+//              node and their names are kept with the routes instead.
+//              Matching tries static text first and backs up to the
+//              parameter, then the wildcard, when the rest of the path does
+//              not match below it, or only matches patterns routed for
+//              other methods.
+//
+
+#include "config.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <ostream>
+
+#include <sockstr/HttpRouter.h>
+#include <sockstr/HttpParser.h>
+
+using namespace sockstr;
+
+// Node of the tree of patterns
+struct HttpRouter::Node {
+    std::string prefix;                         // Static text leading here
+    std::string indices;                        // First byte of each child
+    std::vector<std::unique_ptr<Node> > children;
+    std::unique_ptr<Node> param;                // ":name" child
+    std::unique_ptr<Node> wildcard;             // "*name" child
+    std::vector<HttpRoute*> routes;             // Patterns ending here
+};
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+std::string_view HttpParams::name(UINT uIndex) const {
+    if (!pNames_ || uIndex >= pNames_->size()) {
+        return std::string_view();
+    }
+    return (*pNames_)[uIndex];
+}
+
+std::string_view HttpParams::get(std::string_view name) const {
+    for (UINT idx = 0; idx < uCount_; idx++) {
+        if (this->name(idx) == name) {
+            return values_[idx];
+        }
+    }
+    return std::string_view();
+}
+
+
+HttpLatencyHistogram::HttpLatencyHistogram() {
+    reset();
+}
+
+void HttpLatencyHistogram::record(uint64_t uNanos) {
+    UINT uIndex = std::min<UINT>(std::bit_width(uNanos | 1) - 1, BUCKETS - 1);
+    buckets_[uIndex].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_.fetch_add(uNanos, std::memory_order_relaxed);
+}
+
+void HttpLatencyHistogram::reset() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    total_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t HttpLatencyHistogram::percentile(double dPercent) const {
+    uint64_t uCount = count();
+    if (uCount == 0) {
+        return 0;
+    }
+    uint64_t uRank = std::max<uint64_t>(1, static_cast<uint64_t>(uCount * dPercent / 100.0 + 0.5));
+    uint64_t uSeen = 0;
+    for (UINT idx = 0; idx < BUCKETS; idx++) {
+        uSeen += bucket(idx);
+        if (uSeen >= uRank) {
+            return uint64_t(2) << idx;
+        }
+    }
+    return uint64_t(2) << (BUCKETS - 1);
+}
+
+
+HttpRouter::HttpRouter()
+    : root_(std::make_unique<Node>())
+    , pNotFound_(nullptr)
+    , pNotFoundData_(nullptr) {
+}
+
+HttpRouter::~HttpRouter() {
+}
+
+// Abstract : Add a route
+//
+// Returns  : False if the pattern is rejected
+// Params   :
+//   method                    Method, "*" for any
+//   pattern                   Path pattern
+//   pHandler                  Routine handling the requests
+//   ptr                       User data for pHandler
+//
+// Remarks  : A parameter or wildcard must take a whole segment, and a
+//            wildcard must be the last.  Nothing is added to the tree for
+//            a rejected pattern but the static nodes leading to it.
+//
+bool HttpRouter::addRoute(std::string_view method, std::string_view pattern,
+                          HttpHandler pHandler, void* ptr) {
+    if (method.empty() || pattern.empty() || pattern[0] != '/' || !pHandler) {
+        return false;
+    }
+    auto pRoute = std::make_unique<HttpRoute>();
+    Node* pNode = root_.get();
+    std::size_t uPos = 0;
+    while (uPos < pattern.size()) {
+        char ch = pattern[uPos];
+        if (ch == ':' || ch == '*') {
+            std::size_t uEnd = std::min(pattern.find('/', uPos), pattern.size());
+            if (pattern[uPos - 1] != '/' || uEnd == uPos + 1
+                || (ch == '*' && uEnd != pattern.size())
+                || pRoute->names_.size() == HttpParams::MAX_PARAMS) {
+                return false;
+            }
+            std::string_view name = pattern.substr(uPos + 1, uEnd - uPos - 1);
+            if (name.find_first_of(":*") != std::string_view::npos) {
+                return false;
+            }
+            pRoute->names_.emplace_back(name);
+            std::unique_ptr<Node>& rChild = (ch == ':') ? pNode->param : pNode->wildcard;
+            if (!rChild) {
+                rChild = std::make_unique<Node>();
+            }
+            pNode = rChild.get();
+            uPos = uEnd;
+        } else {
+            std::size_t uEnd = std::min(pattern.find_first_of(":*", uPos), pattern.size());
+            pNode = insertStatic(pNode, pattern.substr(uPos, uEnd - uPos));
+            uPos = uEnd;
+        }
+    }
+
+    for (HttpRoute* pOther : pNode->routes) {
+        if (pOther->method_ == method) {
+            return false;
+        }
+    }
+    pRoute->method_ = method;
+    pRoute->pattern_ = pattern;
+    pRoute->pHandler_ = pHandler;
+    pRoute->pData_ = ptr;
+    pNode->routes.push_back(pRoute.get());
+    routes_.push_back(std::move(pRoute));
+    return true;
+}
+
+// Abstract : Follow or make the static path for text below a node
+//
+// Returns  : The node at the end of text
+//
+HttpRouter::Node* HttpRouter::insertStatic(Node* pNode, std::string_view text) {
+    while (!text.empty()) {
+        std::size_t uIndex = pNode->indices.find(text[0]);
+        if (uIndex == std::string::npos) {
+            auto pChild = std::make_unique<Node>();
+            pChild->prefix = text;
+            pNode->indices.push_back(text[0]);
+            pNode->children.push_back(std::move(pChild));
+            return pNode->children.back().get();
+        }
+
+        std::unique_ptr<Node>& rChild = pNode->children[uIndex];
+        const std::string& prefix = rChild->prefix;
+        std::size_t uCommon = std::mismatch(prefix.begin(), prefix.end(),
+                                            text.begin(), text.end()).first - prefix.begin();
+        if (uCommon < prefix.size()) {
+            // Split the edge where the text leaves it
+            auto pSplit = std::make_unique<Node>();
+            pSplit->prefix = prefix.substr(0, uCommon);
+            rChild->prefix.erase(0, uCommon);
+            pSplit->indices.push_back(rChild->prefix[0]);
+            pSplit->children.push_back(std::move(rChild));
+            rChild = std::move(pSplit);
+        }
+        pNode = rChild.get();
+        text.remove_prefix(uCommon);
+    }
+    return pNode;
+}
+
+void HttpRouter::setNotFound(HttpHandler pHandler, void* ptr) {
+    pNotFound_ = pHandler;
+    pNotFoundData_ = ptr;
+}
+
+// Abstract : Find the node of the pattern matching a path and a method
+//
+// Returns  : The node, or nullptr
+// Params   :
+//   pNode                     Node whose prefix has been matched
+//   path                      The rest of the path
+//   method                    Method of the request
+//   rParams                   Receives the captured values
+//
+// Remarks  : A node whose routes are all for other methods is no match,
+//            so a static pattern of another method does not hide a
+//            parameter or wildcard pattern of this one.  Recursion is as
+//            deep as the nodes on the path.
+//
+const HttpRouter::Node* HttpRouter::find(const Node* pNode, std::string_view path,
+                                         std::string_view method, HttpParams& rParams) const {
+    if (path.empty()) {
+        if (methodRoute(pNode, method)) {
+            return pNode;
+        }
+        if (pNode->wildcard && methodRoute(pNode->wildcard.get(), method)) {
+            rParams.values_[rParams.uCount_++] = path;
+            return pNode->wildcard.get();
+        }
+        return nullptr;
+    }
+
+    UINT uCount = rParams.uCount_;
+    std::size_t uIndex = pNode->indices.find(path[0]);
+    if (uIndex != std::string::npos) {
+        const Node* pChild = pNode->children[uIndex].get();
+        if (path.starts_with(pChild->prefix)) {
+            const Node* pFound = find(pChild, path.substr(pChild->prefix.size()), method,
+                                      rParams);
+            if (pFound) {
+                return pFound;
+            }
+            rParams.uCount_ = uCount;
+        }
+    }
+    if (pNode->param) {
+        std::size_t uEnd = std::min(path.find('/'), path.size());
+        if (uEnd > 0) {
+            rParams.values_[rParams.uCount_++] = path.substr(0, uEnd);
+            const Node* pFound = find(pNode->param.get(), path.substr(uEnd), method, rParams);
+            if (pFound) {
+                return pFound;
+            }
+            rParams.uCount_ = uCount;
+        }
+    }
+    if (pNode->wildcard && methodRoute(pNode->wildcard.get(), method)) {
+        rParams.values_[rParams.uCount_++] = path;
+        return pNode->wildcard.get();
+    }
+    return nullptr;
+}
+
+// Abstract : Gather the methods of every pattern matching a path
+//
+// Params   :
+//   pNode                     Node whose prefix has been matched
+//   path                      The rest of the path
+//   rMethods                  Receives the methods, each once
+//
+// Remarks  : Walks the same branches as find(), all of them, and is only
+//            used to answer a request with 405.
+//
+void HttpRouter::findMethods(const Node* pNode, std::string_view path,
+                             std::vector<std::string_view>& rMethods) {
+    if (path.empty()) {
+        addMethods(pNode, rMethods);
+    } else {
+        std::size_t uIndex = pNode->indices.find(path[0]);
+        if (uIndex != std::string::npos) {
+            const Node* pChild = pNode->children[uIndex].get();
+            if (path.starts_with(pChild->prefix)) {
+                findMethods(pChild, path.substr(pChild->prefix.size()), rMethods);
+            }
+        }
+        std::size_t uEnd = std::min(path.find('/'), path.size());
+        if (pNode->param && uEnd > 0) {
+            findMethods(pNode->param.get(), path.substr(uEnd), rMethods);
+        }
+    }
+    if (pNode->wildcard) {
+        addMethods(pNode->wildcard.get(), rMethods);
+    }
+}
+
+void HttpRouter::addMethods(const Node* pNode, std::vector<std::string_view>& rMethods) {
+    for (HttpRoute* pRoute : pNode->routes) {
+        if (std::find(rMethods.begin(), rMethods.end(), pRoute->method_) == rMethods.end()) {
+            rMethods.push_back(pRoute->method_);
+        }
+    }
+}
+
+HttpRoute* HttpRouter::methodRoute(const Node* pNode, std::string_view method) {
+    HttpRoute* pAny = nullptr;
+    HttpRoute* pGet = nullptr;
+    for (HttpRoute* pRoute : pNode->routes) {
+        if (pRoute->method_ == method) {
+            return pRoute;
+        }
+        if (pRoute->method_ == "*") {
+            pAny = pRoute;
+        } else if (pRoute->method_ == "GET") {
+            pGet = pRoute;
+        }
+    }
+    if (pGet && method == "HEAD") {
+        return pGet;
+    }
+    return pAny;
+}
+
+HttpRoute* HttpRouter::match(std::string_view method, std::string_view path,
+                             HttpParams& rParams, std::string* pAllow) const {
+    rParams.uCount_ = 0;
+    rParams.pNames_ = nullptr;
+    const Node* pNode = find(root_.get(), path, method, rParams);
+    if (!pNode) {
+        rParams.uCount_ = 0;
+        if (pAllow) {
+            pAllow->clear();
+            std::vector<std::string_view> methods;
+            findMethods(root_.get(), path, methods);
+            bool bGet = false;
+            bool bHead = false;
+            for (std::string_view other : methods) {
+                bGet = bGet || other == "GET";
+                bHead = bHead || other == "HEAD";
+                pAllow->append(pAllow->empty() ? "" : ", ").append(other);
+            }
+            if (bGet && !bHead) {
+                pAllow->append(", HEAD");
+            }
+        }
+        return nullptr;
+    }
+    HttpRoute* pRoute = methodRoute(pNode, method);
+    rParams.pNames_ = &pRoute->names_;
+    return pRoute;
+}
+
+// Abstract : Handle a request with the handler of its route
+//
+// Remarks  : The handler's time is measured with the steady clock and
+//            added to its route's histogram.
+//
+void HttpRouter::dispatch(HttpCall& rCall) {
+    const HttpParser& request = rCall.request();
+    HttpParams params;
+    std::string allow;
+    HttpRoute* pRoute = match(request.method(), request.path(), params, &allow);
+    if (!pRoute) {
+        if (!allow.empty()) {
+            rCall.addHeader("Allow", allow);
+            rCall.reply(405);
+        } else if (pNotFound_) {
+            pNotFound_(rCall, pNotFoundData_);
+        } else {
+            rCall.reply(404);
+        }
+        return;
+    }
+
+    rCall.pParams_ = &params;
+    auto start = std::chrono::steady_clock::now();
+    pRoute->pHandler_(rCall, pRoute->pData_);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    rCall.pParams_ = nullptr;
+    pRoute->latency_.record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+void HttpRouter::handler(HttpCall& rCall, void* ptr) {
+    static_cast<HttpRouter*>(ptr)->dispatch(rCall);
+}
+
+void HttpRouter::writeStats(std::ostream& os) const {
+    for (auto& pRoute : routes_) {
+        const HttpLatencyHistogram& latency = pRoute->latency_;
+        uint64_t uCount = latency.count();
+        if (uCount == 0) {
+            continue;
+        }
+        char szLine[256];
+        snprintf(szLine, sizeof(szLine),
+                 "%-7s %-32s %10llu requests  mean %.1f us  p50 < %.1f us  p99 < %.1f us",
+                 pRoute->method_.c_str(), pRoute->pattern_.c_str(),
+                 static_cast<unsigned long long>(uCount), latency.total() / 1e3 / uCount,
+                 latency.percentile(50) / 1e3, latency.percentile(99) / 1e3);
+        os << szLine << '\n';
+    }
+}
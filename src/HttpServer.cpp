@@ -0,0 +1,375 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : HttpServer.cpp
+//
+// Class      : HttpServer, HttpCall
+//
+// Description: HTTP/1.1 server running one EventLoop per thread.
+//
+// Decisions  : Each thread accepts on a listening socket of its own, bound
+//              with SO_REUSEPORT, rather than taking connections from one
+//              acceptor: the kernel balances them and a connection never
+//              changes thread, so nothing on the path of a request is
+//              shared between threads but two relaxed counters.
+//              A connection is served by one coroutine, whose suspension
+//              points are the states of the connection: waiting for more
+//              of a request, and waiting for the socket to take the held
+//              responses.  HttpServerStream does the parsing, keep-alive
+//              and pipelining; the connections are pooled per thread so
+//              their buffers and header blocks are reused.
+//              On stop() each loop is stopped, its listener closed and its
+//              connections shut down, and the loop is then run until every
+//              connection coroutine has seen the end of its socket, so no
+//              coroutine frame or descriptor is left behind.
+//
+
+#include "config.h"
+#include <algorithm>
+#include <cassert>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unordered_set>
+
+#include <sockstr/HttpServer.h>
+#include <sockstr/EventLoop.h>
+#include <sockstr/Http2.h>
+#include <sockstr/HttpRouter.h>
+#include <sockstr/HttpStream.h>
+#include <sockstr/Socket.h>
+#include <sockstr/SocketAddr.h>
+
+using namespace sockstr;
+
+// Default limit on the body of a request
+static const uint64_t MAX_BODY = 1024 * 1024;
+// Default number of requests served on a connection
+static const UINT MAX_REQUESTS = 10000;
+// Default time a connection may stay idle
+static const UINT IDLE_TIMEOUT = 60000;
+
+
+// A pooled connection, with the call object its requests reuse
+struct HttpServer::Connection : public HttpServerStream {
+    Connection() : call(*this) {
+        loadDefaultHeaders();
+    }
+
+    HttpCall call;
+};
+
+// One thread of the server
+struct HttpServer::Worker {
+    HttpServer* pServer = nullptr;
+    Socket listener;
+    std::thread thread;
+    EventLoop* pLoop = nullptr;                 // Guarded by HttpServer::lock_
+    std::unordered_set<Connection*> live;       // Used on the loop's thread only
+    std::atomic<std::size_t> connections{0};
+    std::atomic<uint64_t> requests{0};
+};
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+HttpCall::HttpCall(HttpServerStream& rStream)
+    : stream_(rStream)
+    , pHttp2_(nullptr)
+    , uStream_(0)
+    , pParams_(nullptr)
+    , bReplied_(false) {
+}
+
+HttpCall::HttpCall(HttpServerStream& rStream, Http2Connection* pHttp2, UINT uStream,
+                   std::pmr::memory_resource* pMemory)
+    : stream_(rStream)
+    , pHttp2_(pHttp2)
+    , uStream_(uStream)
+    , headers_(pMemory)
+    , pParams_(nullptr)
+    , bReplied_(false) {
+}
+
+const HttpParser& HttpCall::request() const {
+    return pHttp2_ ? pHttp2_->request(uStream_) : stream_.getParser();
+}
+
+std::string_view HttpCall::body() const {
+    return pHttp2_ ? pHttp2_->requestBody(uStream_) : stream_.requestBody();
+}
+
+const HttpParams& HttpCall::params() const {
+    static const HttpParams noParams;
+    return pParams_ ? *pParams_ : noParams;
+}
+
+void HttpCall::addHeader(std::string_view name, std::string_view value) {
+    headers_.append(name);
+    headers_.append(": ");
+    headers_.append(value);
+    headers_.append("\r\n");
+}
+
+void HttpCall::reply(UINT uStatus, std::string_view body, const char* contentType) {
+    VERIFY(!bReplied_);
+    if (pHttp2_) {
+        pHttp2_->reply(uStream_, uStatus, body, contentType, headers_);
+    } else {
+        stream_.appendResponse(body, contentType, uStatus, headers_);
+    }
+    bReplied_ = true;
+}
+
+void HttpCall::replyFile(HttpFileCache& rCache, std::string_view path) {
+    VERIFY(!bReplied_);
+    if (pHttp2_) {
+        pHttp2_->replyFile(uStream_, rCache, path);
+    } else {
+        stream_.serveFile(rCache, path);
+    }
+    bReplied_ = true;
+}
+
+void HttpCall::reset() {
+    headers_.clear();
+    pParams_ = nullptr;
+    bReplied_ = false;
+}
+
+
+HttpServer::HttpServer(UINT uThreads)
+    : uThreads_(std::max(uThreads, 1u))
+    , pHandler_(nullptr)
+    , pData_(nullptr)
+    , uMaxRequests_(MAX_REQUESTS)
+    , uIdleTimeout_(IDLE_TIMEOUT)
+    , compression_(0)
+    , bHttp2_(true)
+    , uStarted_(0)
+    , uRequests_(0) {
+    limits_.uMaxBody = MAX_BODY;
+}
+
+HttpServer::~HttpServer() {
+    stop();
+}
+
+void HttpServer::setHandler(HttpHandler pHandler, void* ptr) {
+    pHandler_ = pHandler;
+    pData_ = ptr;
+}
+
+// Abstract : Open the listening sockets and start the threads
+//
+// Returns  : True if the server is running
+// Params   :
+//   rSockAddr                 Address to listen on
+//
+// Post     : Each thread is running its loop when this returns, so stop()
+//            may be called right away.
+//
+bool HttpServer::start(SocketAddr& rSockAddr) {
+    VERIFY(workers_.empty());
+    UINT uFlags = Socket::modeReadWrite | Socket::modeCreate;
+    if (uThreads_ > 1) {
+        uFlags |= Socket::modeReusePort;
+    }
+    for (UINT idx = 0; idx < uThreads_; idx++) {
+        auto pWorker = std::make_unique<Worker>();
+        pWorker->pServer = this;
+        if (!pWorker->listener.open(rSockAddr, uFlags)) {
+            workers_.clear();
+            return false;
+        }
+        workers_.push_back(std::move(pWorker));
+    }
+
+    uStarted_ = 0;
+    for (auto& pWorker : workers_) {
+        pWorker->thread = std::thread(&HttpServer::run, this, pWorker.get());
+    }
+    std::unique_lock<std::mutex> guard(lock_);
+    started_.wait(guard, [this] { return uStarted_ == workers_.size(); });
+    return true;
+}
+
+void HttpServer::stop() {
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        for (auto& pWorker : workers_) {
+            if (pWorker->pLoop) {
+                pWorker->pLoop->stop();
+            }
+        }
+    }
+    for (auto& pWorker : workers_) {
+        if (pWorker->thread.joinable()) {
+            pWorker->thread.join();
+        }
+        uRequests_ += pWorker->requests.load(std::memory_order_relaxed);
+    }
+    workers_.clear();
+}
+
+std::size_t HttpServer::connections() const {
+    std::size_t uTotal = 0;
+    for (auto& pWorker : workers_) {
+        uTotal += pWorker->connections.load(std::memory_order_relaxed);
+    }
+    return uTotal;
+}
+
+uint64_t HttpServer::requests() const {
+    uint64_t uTotal = uRequests_;
+    for (auto& pWorker : workers_) {
+        uTotal += pWorker->requests.load(std::memory_order_relaxed);
+    }
+    return uTotal;
+}
+
+// Abstract : Body of a server thread
+//
+// Params   :
+//   pWorker                   The thread's listener and connections
+//
+// Post     : The listener and every connection of the thread are closed.
+//
+void HttpServer::run(Worker* pWorker) {
+    // Declared first: the connections go back to it until the loop is gone
+    SocketPool<Connection> pool;
+    EventLoop loop;
+    loop.spawn(acceptor(*pWorker, pool));
+    loop.run();
+
+    // Stopped: end the connections, then let their coroutines finish
+    pWorker->listener.close();
+    for (Connection* pConnection : pWorker->live) {
+        ::shutdown(pConnection->getHandle(), SHUT_RDWR);
+    }
+    do {
+        loop.run();
+    } while (!pWorker->live.empty());
+
+    std::lock_guard<std::mutex> guard(lock_);
+    pWorker->pLoop = nullptr;
+}
+
+// Abstract : Accept the connections of one thread
+//
+// Post     : Returns when the listening socket has been closed.
+//
+Task<void> HttpServer::acceptor(Worker& rWorker, SocketPool<Connection>& rPool) {
+    EventLoop* pLoop = EventLoop::current();
+    {
+        // The loop is running: from now on stop() can reach it
+        std::lock_guard<std::mutex> guard(lock_);
+        rWorker.pLoop = pLoop;
+        ++uStarted_;
+    }
+    started_.notify_all();
+
+    for (;;) {
+        auto pConnection = rPool.acquire();
+        if (!co_await rWorker.listener.async_accept(*pConnection)) {
+            if (!rWorker.listener.is_open()) {
+                break;
+            }
+            // Out of descriptors or such; do not spin on it
+            co_await pLoop->sleep(10);
+            continue;
+        }
+        pLoop->spawn(serve(rWorker, std::move(pConnection)));
+    }
+}
+
+// Abstract : Serve the requests of one connection
+//
+// Remarks  : The handler replies into the connection's queue of held
+//            responses.  async_receive() writes the queue whenever it has
+//            to wait for the peer, so the responses to a burst of
+//            pipelined requests go out in one write.
+//
+Task<void> HttpServer::serve(Worker& rWorker, SocketPool<Connection>::Handle pConnection) {
+    Connection& rConnection = *pConnection;
+    rWorker.live.insert(&rConnection);
+    rWorker.connections.fetch_add(1, std::memory_order_relaxed);
+
+    rConnection.setLimits(limits_);
+    rConnection.setMaxRequests(uMaxRequests_);
+    rConnection.setIdleTimeout(uIdleTimeout_);
+    rConnection.setCompression(compression_);
+    // Responses are written whole, so there is nothing for Nagle to merge
+    int nNoDelay = 1;
+    rConnection.setSockOpt(TCP_NODELAY, &nNoDelay, sizeof(nNoDelay), IPPROTO_TCP);
+
+    HttpCall& rCall = rConnection.call;
+    bool bHttp2 = false;
+    while (co_await rConnection.async_receive()) {
+        if (bHttp2_ && Http2Connection::isUpgrade(rConnection.getParser())) {
+            bHttp2 = true;
+            break;
+        }
+        rCall.reset();
+        if (pHandler_) {
+            pHandler_(rCall, pData_);
+        }
+        if (!rCall.replied()) {
+            rCall.reply(500);
+        }
+        rWorker.requests.fetch_add(1, std::memory_order_relaxed);
+    }
+    bHttp2 = bHttp2 || (bHttp2_ && rConnection.http2Preface());
+    if (bHttp2) {
+        // The rest of the connection is HTTP/2, with requests counted as
+        // they reach the handler
+        Http2Connection http2;
+        http2.setLimits(limits_);
+        co_await http2.async_serve(rConnection, handleHttp2, &rWorker);
+    } else {
+        UINT uStatus = rConnection.errorStatus();
+        if (uStatus != 0) {
+            rCall.reset();
+            rCall.reply(uStatus);
+        }
+        co_await rConnection.async_flushResponses();
+    }
+
+    rWorker.live.erase(&rConnection);
+    rWorker.connections.fetch_sub(1, std::memory_order_relaxed);
+}   // The connection is closed and goes back to the pool
+
+// Abstract : Pass a request of an HTTP/2 connection to the handler
+//
+// Params   :
+//   rCall                     The request
+//   ptr                       Worker of the connection
+//
+void HttpServer::handleHttp2(HttpCall& rCall, void* ptr) {
+    Worker* pWorker = static_cast<Worker*>(ptr);
+    HttpServer* pServer = pWorker->pServer;
+    if (pServer->pHandler_) {
+        pServer->pHandler_(rCall, pServer->pData_);
+    }
+    pWorker->requests.fetch_add(1, std::memory_order_relaxed);
+}
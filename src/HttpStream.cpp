@@ -22,16 +22,59 @@
 // HttpStream.cpp
 //
 
+#include <sockstr/EventLoop.h>
+#include <sockstr/HttpFileCache.h>
 #include <sockstr/HttpHelpers.h>
 #include <sockstr/HttpStream.h>
+#include <algorithm>
+#include <charconv>
 #include <cstdlib>
 #include <string.h>
-#include <sstream>
+#include <sys/uio.h>
+#include <strings.h>
 using namespace sockstr;
 using namespace std;
 
 #define HTTP_VERSION_LINE " " HTTP_VERSION "\r\n"
 
+// Initial size of the receive buffer
+static const size_t RECV_BUFFER_SIZE = 4096;
+// Largest receive buffer kept by a closed stream
+static const size_t MAX_IDLE_BUFFER = 65536;
+// Bodies up to this size are sent in the same write as the head
+static const size_t MAX_COALESCED_BODY = 16384;
+// Responses to pipelined requests are held back up to this size
+static const size_t MAX_PENDING_RESPONSES = 65536;
+// Pieces of a body made by a callback are sent in this size
+static const size_t PRODUCED_PIECE = 16384;
+// Receive buffer while a request body is streamed through it
+static const size_t BODY_BUFFER_SIZE = MAX_IDLE_BUFFER;
+// Buffers of a streamed body read before other tasks of the loop run
+static const UINT BODY_READS_PER_TURN = 16;
+// Rest of a streamed body that is read and dropped rather than closing
+static const uint64_t MAX_SKIPPED_BODY = 1024 * 1024;
+// Bodies are not streamed unless setBodyStreaming() says so
+static const uint64_t NO_STREAMING = UINT64_MAX;
+// Interim response to "Expect: 100-continue"
+static const char CONTINUE_RESPONSE[] = "HTTP/1.1 100 Continue\r\n\r\n";
+// Default number of requests served on a connection
+static const UINT MAX_REQUESTS = 1000;
+
+// A response body is passed on as it arrives, so its size is not limited
+static HttpParser::Limits responseLimits()
+{
+    HttpParser::Limits limits;
+    limits.uMaxBody = UINT64_MAX;
+    return limits;
+}
+
+// Indicate if a Content-Encoding value is gzip alone
+static bool isGzip(std::string_view encoding)
+{
+    return (encoding.size() == 4 && strncasecmp(encoding.data(), "gzip", 4) == 0)
+        || (encoding.size() == 6 && strncasecmp(encoding.data(), "x-gzip", 6) == 0);
+}
+
 const char* HttpStream::defaultHeaderFields_[] =
 {
     "Accept", "*/*",
@@ -41,26 +84,43 @@ const char* HttpStream::defaultHeaderFields_[] =
 const char* HttpServerStream::defaultSrvHeaderFields_[] =
 {
     "Date", "*",
-    "Host", "*",
     0, 0
 };
 
 
 HttpStream::HttpStream()
     : Socket()
+    , headerBlockValid_(false)
+    , recvBegin_(0)
+    , recvEnd_(0)
+    , response_(HttpParser::messageResponse)
+    , decompress_(false)
 {
+    response_.setLimits(responseLimits());
 //    loadDefaultHeaders();
 }
 
 HttpStream::HttpStream(const char* lpszFileName, UINT uOpenFlags)
     : Socket(lpszFileName, uOpenFlags)
+    , headerBlockValid_(false)
+    , recvBegin_(0)
+    , recvEnd_(0)
+    , response_(HttpParser::messageResponse)
+    , decompress_(false)
 {
+    response_.setLimits(responseLimits());
     loadDefaultHeaders();
 }
 
 HttpStream::HttpStream(SocketAddr& rSockAddr, UINT uOpenFlags)
     : Socket(rSockAddr, uOpenFlags)
+    , headerBlockValid_(false)
+    , recvBegin_(0)
+    , recvEnd_(0)
+    , response_(HttpParser::messageResponse)
+    , decompress_(false)
 {
+    response_.setLimits(responseLimits());
     loadDefaultHeaders();
 }
 
@@ -69,105 +129,462 @@ HttpStream::~HttpStream()
 
 }
 
+void HttpStream::close()
+{
+    Socket::close();
+    recvBegin_ = recvEnd_ = 0;
+    if (recvBuf_.size() > MAX_IDLE_BUFFER)
+        std::vector<char>().swap(recvBuf_);
+}
+
+UINT HttpStream::get(const std::string& uri, HttpBodySink& sink)
+{
+    sendRequest("GET", uri);
+    return readResponse(sink);
+}
+
 UINT HttpStream::get(const std::string& uri, std::string& content, std::string& headers)
 {
-    std::string httpreq = "GET " + uri + HTTP_VERSION_LINE;
-    expandHeaders(httpreq);
-    write(httpreq);
-    UINT ret = read(headers, HTTP_DELIMITER HTTP_DELIMITER);
-    //TODO check Content-Length and/or type (json, html, etc.)
-    ret += read(content, HTTP_DELIMITER);
+    content.clear();
+    headers.clear();
+    HttpBodySink sink(content);
+    sendRequest("GET", uri);
+    if (readResponse(sink) == 0)
+        return 0;
 
-    return ret;
+    headers = responseHead_;
+    return headers.size() + content.size();
 }
 
 UINT HttpStream::get(const std::string& uri, char* buffer, UINT uCount)
 {
-    std::string httpreq = "GET " + uri + HTTP_VERSION_LINE;
-    expandHeaders(httpreq);
-    write(httpreq);
-    UINT ret = read(buffer, uCount);	//TODO loop for 1024 and fill string param
-
-    return ret;
+    HttpBodySink sink(buffer, uCount);
+    sendRequest("GET", uri);
+    return readResponse(sink) ? sink.stored() : 0;
 }
 
 UINT HttpStream::head(const std::string& uri)
 {
-    return 0;
+    HttpBodySink sink;
+    sendRequest("HEAD", uri);
+    return readResponse(sink, true);
 }
 
 UINT HttpStream::post(const std::string& uri, char* message, char* buffer, UINT uCount)
 {
-    std::string httpreq = "POST " + uri + HTTP_VERSION_LINE;
-    expandHeaders(httpreq);
-    write(httpreq);
-    if (message)
-        write(message, strlen(message));
+    HttpBodySink sink(buffer, uCount);
+    sendRequest("POST", uri, message ? message : "", message ? strlen(message) : 0);
+    return readResponse(sink) ? sink.stored() : 0;
+}
 
-    UINT ret = read(buffer, uCount);	//TODO loop for 1024 and fill string param
+UINT HttpStream::put(const std::string& uri, char* message, char* buffer, UINT uCount)
+{
+    HttpBodySink sink(buffer, uCount);
+    sendRequest("PUT", uri, message ? message : "", message ? strlen(message) : 0);
+    return readResponse(sink) ? sink.stored() : 0;
+}
 
-    return ret;
+UINT HttpStream::deleter(const std::string& uri)
+{
+    HttpBodySink sink;
+    sendRequest("DELETE", uri);
+    return readResponse(sink);
 }
 
-UINT HttpStream::put(const std::string& uri, char* message, char* buffer, UINT uCount)
+UINT HttpStream::send(const char* method, const std::string& uri,
+                      HttpBodySource& source, HttpBodySink& sink)
 {
-    std::string httpreq = "PUT " + uri + HTTP_VERSION_LINE;
+    if (!sendRequest(method, uri, source))
+    {
+        // The server would take the rest of the connection for the body
+        close();
+        return 0;
+    }
+    return readResponse(sink, strcmp(method, "HEAD") == 0);
+}
+
+UINT HttpStream::post(const std::string& uri, HttpBodySource& source, HttpBodySink& sink)
+{
+    return send("POST", uri, source, sink);
+}
+
+UINT HttpStream::put(const std::string& uri, HttpBodySource& source, HttpBodySink& sink)
+{
+    return send("PUT", uri, source, sink);
+}
+
+// Abstract : Ask the server to switch to another protocol
+//
+// Returns  : Status code of the response; 0 if there was none
+// Params   :
+//   uri                       Target of the request
+//   headers                   Header lines, such as Upgrade and Connection
+//   rest                      Set to the data of the new protocol received
+//                             with the response
+//
+// Post     : With 101, the connection belongs to the new protocol, and
+//            nothing more is read from it as HTTP.
+//
+UINT HttpStream::upgrade(const std::string& uri, std::string_view headers, std::string& rest,
+                         HttpBodySink* pSink)
+{
+    std::string httpreq = "GET ";
+    httpreq += uri;
+    httpreq += HTTP_VERSION_LINE;
+    httpreq += headers;
     expandHeaders(httpreq);
     write(httpreq);
-    if (message)
-        write(message, strlen(message));
+    if (m_Status != SC_OK)
+        return 0;
 
-    UINT ret = read(buffer, uCount);	//TODO loop for 1024 and fill string param
+    HttpBodySink discard;
+    UINT status = readResponse(pSink ? *pSink : discard);
+    rest.clear();
+    if (status == 101)
+    {
+        rest.assign(recvBuf_.data() + recvBegin_, recvEnd_ - recvBegin_);
+        recvBegin_ = recvEnd_ = 0;
+    }
+    return status;
+}
 
-    return ret;
+bool HttpStream::sendRequest(const char* method, const std::string& uri,
+                             const char* body, size_t uLength)
+{
+    HttpBodySource source;
+    if (body)
+        source = HttpBodySource(body, uLength);
+    return sendRequest(method, uri, source);
 }
 
-UINT HttpStream::deleter(const std::string& uri)
+// Abstract : Send a request and its body
+//
+// Returns  : bool (false if the request could not all be sent)
+// Params   :
+//   method                    Method of the request
+//   uri                       Target of the request
+//   source                    Origin of the body
+//
+// Remarks  : The head goes out in the same system call as a buffer, or
+//            the first piece made by a callback; a file follows the head
+//            with sendfile(2).
+//
+bool HttpStream::sendRequest(const char* method, const std::string& uri,
+                             HttpBodySource& source)
 {
-    std::string httpreq = "DELETE " + uri + HTTP_VERSION_LINE;
+    std::string httpreq = method;
+    httpreq += ' ';
+    httpreq += uri;
+    httpreq += HTTP_VERSION_LINE;
+    bool chunked = source.present() && source.length() == HttpBodySource::UNKNOWN;
+    if (chunked)
+        httpreq += "Transfer-Encoding: chunked\r\n";
+    else if (source.present())
+        httpreq += "Content-Length: " + std::to_string(source.length()) + "\r\n";
     expandHeaders(httpreq);
+
+    switch (source.kind_)
+    {
+    case HttpBodySource::sourceBuffer:
+        // A small body is copied to go out with the head, in one segment
+        if (source.uLength_ <= MAX_COALESCED_BODY)
+            httpreq.append(source.pData_, source.uLength_);
+        else
+        {
+            struct iovec vec[2] = {
+                { httpreq.data(), httpreq.size() },
+                { const_cast<char*>(source.pData_), source.uLength_ }
+            };
+            return writev(vec, 2);
+        }
+        break;
+    case HttpBodySource::sourceFile:
+        write(httpreq);
+        return m_Status == SC_OK && sendFile(source.fd_, source.uOffset_, source.uLength_);
+    case HttpBodySource::sourceProducer:
+        return sendProduced(httpreq, source, chunked);
+    case HttpBodySource::sourceNone:
+        break;
+    }
     write(httpreq);
-    char buffer[1024];
-    UINT ret = read(buffer, sizeof(buffer));
+    return m_Status == SC_OK;
+}
+
+bool HttpStream::sendProduced(const std::string& head, HttpBodySource& source, bool bChunked)
+{
+    char piece[PRODUCED_PIECE];
+    char sizeLine[24];
+    uint64_t sent = 0;
+    bool first = true;
+    for (;;)
+    {
+        struct iovec vec[4];
+        int count = 0;
+        if (first)
+            vec[count++] = { const_cast<char*>(head.data()), head.size() };
+        first = false;
+        UINT size = 0;
+        if (bChunked || sent < source.uLength_)
+        {
+            uint64_t room = bChunked ? sizeof(piece)
+                                     : std::min<uint64_t>(sizeof(piece), source.uLength_ - sent);
+            size = source.pProducer_(piece, (UINT) room, source.ptr_);
+            // A body of known length must be made whole
+            if (size == 0 && !bChunked)
+                return false;
+        }
+        if (size == 0)
+        {
+            if (bChunked)
+                vec[count++] = { const_cast<char*>("0\r\n\r\n"), 5 };
+            return writev(vec, count);
+        }
+        if (bChunked)
+        {
+            char* sizeEnd = std::to_chars(sizeLine, sizeLine + sizeof(sizeLine) - 2, size, 16).ptr;
+            *sizeEnd++ = '\r';
+            *sizeEnd++ = '\n';
+            vec[count++] = { sizeLine, static_cast<size_t>(sizeEnd - sizeLine) };
+        }
+        vec[count++] = { piece, size };
+        if (bChunked)
+            vec[count++] = { const_cast<char*>("\r\n"), 2 };
+        if (!writev(vec, count))
+            return false;
+        sent += size;
+    }
+}
+
+void HttpStream::makeRoom(size_t uNeed)
+{
+    size_t avail = recvEnd_ - recvBegin_;
+    if (avail == 0)
+        recvBegin_ = recvEnd_ = 0;
 
+    // Move the message to the front, then grow
+    if (recvBuf_.size() - recvBegin_ < uNeed || recvEnd_ == recvBuf_.size()) {
+        if (recvBegin_ > 0) {
+            memmove(recvBuf_.data(), recvBuf_.data() + recvBegin_, avail);
+            recvBegin_ = 0;
+            recvEnd_ = avail;
+        }
+        if (recvBuf_.size() < uNeed || recvEnd_ == recvBuf_.size()) {
+            recvBuf_.resize(std::max({ uNeed, recvBuf_.size() * 2, RECV_BUFFER_SIZE }));
+        }
+    }
+}
+
+UINT HttpStream::receiveMore()
+{
+    makeRoom(recvEnd_ - recvBegin_ + 1);
+    UINT ret = read(recvBuf_.data() + recvEnd_, recvBuf_.size() - recvEnd_);
+    recvEnd_ += ret;
     return ret;
 }
 
+// Abstract : Read the response to a request
+//
+// Returns  : Status code; 0 on failure
+// Params   :
+//   sink                      Receives the body
+//   bHead                     Set if the request was HEAD
+//
+// Pre      : A request has been sent, and the responses to any requests
+//            sent before it have been read.
+// Post     : getResponse() holds the status line and headers.  Bytes
+//            received past the response are kept in the receive buffer.
+//
+// Remarks  : The body goes from the receive buffer to the sink; it is
+//            never collected in a string of its own.  A response that
+//            cannot be read to its end leaves the connection unusable,
+//            so it is closed.
+//
+UINT HttpStream::readResponse(HttpBodySink& sink, bool bHead)
+{
+    UINT status;
+    do
+    {
+        response_.reset();
+        HttpParser::Result result;
+        while ((result = response_.parse(recvBuf_.data() + recvBegin_, recvEnd_ - recvBegin_))
+               == HttpParser::parseIncomplete)
+        {
+            if (receiveMore() == 0)
+            {
+                close();
+                return 0;
+            }
+        }
+        if (result == HttpParser::parseError)
+        {
+            close();
+            return 0;
+        }
+        // The head is kept apart, so the views stay valid as the body arrives
+        responseHead_.assign(recvBuf_.data() + recvBegin_, response_.headerSize());
+        response_.parse(responseHead_.data(), responseHead_.size());
+        recvBegin_ += response_.headerSize();
+        status = response_.statusCode();
+    } while (status < 200 && status != 101);
+
+    HttpParser::BodyKind kind = bHead ? HttpParser::bodyNone : response_.bodyKind();
+    // A compressed body is decoded on its way to the sink
+    bool inflate = decompress_ && kind != HttpParser::bodyNone
+                   && isGzip(response_.header(hdrContentEncoding));
+    if (inflate)
+        inflater_.reset();
+    auto deliver = [&](const char* pData, size_t uLength) {
+        return inflate ? inflater_.write(pData, uLength, sink) : sink.write(pData, uLength);
+    };
+    bool ok = true;
+    if (kind == HttpParser::bodyLength)
+    {
+        uint64_t remaining = response_.contentLength();
+        if (!inflate)
+            sink.expect(remaining);
+        while (ok && remaining > 0)
+        {
+            if (recvBegin_ == recvEnd_ && receiveMore() == 0)
+            {
+                ok = false;
+                break;
+            }
+            size_t take = std::min<uint64_t>(remaining, recvEnd_ - recvBegin_);
+            ok = deliver(recvBuf_.data() + recvBegin_, take);
+            recvBegin_ += take;
+            remaining -= take;
+        }
+    }
+    else if (kind == HttpParser::bodyChunked)
+    {
+        chunks_.reset();
+        HttpChunkDecoder::Result result = HttpChunkDecoder::chunkMore;
+        while (ok && result == HttpChunkDecoder::chunkMore)
+        {
+            if (recvBegin_ == recvEnd_ && receiveMore() == 0)
+            {
+                ok = false;
+                break;
+            }
+            size_t used;
+            std::string_view payload;
+            result = chunks_.decode(recvBuf_.data() + recvBegin_, recvEnd_ - recvBegin_,
+                                    used, payload);
+            recvBegin_ += used;
+            ok = result != HttpChunkDecoder::chunkError
+                 && (payload.empty() || deliver(payload.data(), payload.size()));
+        }
+    }
+    else if (kind == HttpParser::bodyUntilClose)
+    {
+        do
+        {
+            ok = deliver(recvBuf_.data() + recvBegin_, recvEnd_ - recvBegin_);
+            recvBegin_ = recvEnd_;
+        } while (ok && receiveMore() > 0);
+    }
+    // A body cut short within a gzip member is not whole
+    if (inflate && !inflater_.finished())
+        ok = false;
+
+    if (!ok)
+    {
+        close();
+        return 0;
+    }
+    // The server closes its end after a response it cannot keep alive
+    if (!response_.keepAlive())
+        close();
+
+    return status;
+}
+
+void HttpStream::acceptCompressed(bool bAccept)
+{
+    decompress_ = bAccept;
+    if (bAccept)
+        addHeader("Accept-Encoding", "gzip");
+    else if (headers_.remove(hdrAcceptEncoding))
+        headerBlockValid_ = false;
+}
+
 void HttpStream::addHeader(const std::string& header, int value)
 {
-    std::ostringstream oss;
-    oss << value;
-    addHeader(header, oss.str());
+    char digits[16];
+    char* digitsEnd = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    addHeader(header, std::string(digits, digitsEnd));
 }
 
 void HttpStream::addHeader(const std::string& header, const std::string& value)
 {
-    std::string hdrstr = header;
-    HttpParamEncoder* encoder = new FixedStringEncoder(value);
-    headers_[hdrstr] = encoder;
+    removeComputed(header);
+    headers_.set(header, value);
+    headerBlockValid_ = false;
 }
 
 void HttpStream::addHeader(const std::string& header, HttpParamEncoder* encoder,
                            const std::string& value)
 {
-    std::string hdrstr = header;
-    headers_[hdrstr] = encoder;
+    if (encoder->isFixed())
+    {
+        // Nothing to compute: keep the value alone
+        addHeader(header, encoder->toString());
+        delete encoder;
+        return;
+    }
+    headers_.remove(header);
+    headerBlockValid_ = false;
+    for (auto& computed : computedHeaders_)
+    {
+        std::string_view name(computed.first.data(), computed.first.size() - 2);
+        if (HttpParser::equalNames(name, header))
+        {
+            computed.second.reset(encoder);
+            return;
+        }
+    }
+    computedHeaders_.emplace_back(header + ": ", encoder);
 }
 
+bool HttpStream::removeComputed(std::string_view header)
+{
+    for (auto it = computedHeaders_.begin(); it != computedHeaders_.end(); ++it)
+    {
+        std::string_view name(it->first.data(), it->first.size() - 2);
+        if (HttpParser::equalNames(name, header))
+        {
+            computedHeaders_.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
 
 void HttpStream::clearHeaders(void)
 {
     headers_.clear();
+    computedHeaders_.clear();
+    headerBlockValid_ = false;
+}
+
+void HttpStream::compileHeaders()
+{
+    headerBlock_.clear();
+    headers_.appendTo(headerBlock_);
+    headerBlockValid_ = true;
 }
 
 void HttpStream::expandHeaders(std::string& str)
 {
-    HeaderMap::iterator it;
-    for (it = headers_.begin(); it != headers_.end(); ++it)
+    if (!headerBlockValid_)
+        compileHeaders();
+
+    str += headerBlock_;
+    for (auto& header : computedHeaders_)
     {
-        HttpParamEncoder* encoder = it->second;
-        std::string param = encoder->toString();
-        str += it->first + ": " + param + "\r\n";
+        str += header.first;
+        header.second->appendTo(str);
+        str += "\r\n";
     }
     str += "\r\n";
 }
@@ -186,7 +603,7 @@ void HttpStream::loadDefaultHeaders(void)
     }
 }
 
-void HttpStream::parseHeaders(const char* buffer, UINT uSize, HeaderMap& headers)
+void HttpStream::parseHeaders(const char* buffer, UINT uSize, HttpHeaders& headers)
 {
 /*
 Host: localhost:4321
@@ -197,41 +614,78 @@ Accept-Encoding: gzip,deflate,sdch
 Accept-Language: en-US,en;q=0.8
 Cookie: csrftoken=ei5sMYAzs3TskYTKrLocO8oi0BzRaHtg
 */
-    headers.clear();
-    if (buffer == 0 || uSize == 0) return;
-
-    string str(buffer, uSize);
-    size_t pt = 0;
-    do
-    {
-        pt = str.find_first_not_of("\r\n ", pt);
-        size_t col = str.find_first_of(':', pt);
-        size_t nl = str.find_first_of("\r\n", col);
-        if (pt == str.npos || col == str.npos || nl == str.npos) break;
-        string hkey(str.substr(pt, col - pt));
-        string kval(str.substr(col+1, nl - col - 1));
-        //cout << "reqHdr:" << hkey << "::" << kval << ";" << endl;
-        HttpParamEncoder* encoder = new FixedStringEncoder(kval);
-        headers[hkey] = encoder;
-        pt = nl;
-    } while (1);
+    if (buffer == 0)
+        headers.clear();
+    else
+        headers.parse(buffer, uSize);
 }
 
 HttpServerStream::HttpServerStream()
     : HttpStream()
     , status_(*new HttpStatus)
+    , reqHeadersValid_(false)
+    , requestSize_(0)
+    , uStreamAbove_(NO_STREAMING)
+    , bodyRemaining_(0)
+    , bodyStreamed_(false)
+    , bodyDone_(false)
+    , continueSent_(false)
+    , bodyReads_(0)
+    , chunkScan_(0)
+    , chunkBody_(0)
+    , bodyError_(0)
+    , requestCount_(0)
+    , maxRequests_(MAX_REQUESTS)
+    , compression_(0)
+    , streaming_(false)
+    , chunked_(false)
+    , closeAfter_(false)
 {
 }
 
 HttpServerStream::HttpServerStream(const char* lpszFileName, UINT uOpenFlags)
     : HttpStream(lpszFileName, uOpenFlags)
     , status_(*new HttpStatus)
+    , reqHeadersValid_(false)
+    , requestSize_(0)
+    , uStreamAbove_(NO_STREAMING)
+    , bodyRemaining_(0)
+    , bodyStreamed_(false)
+    , bodyDone_(false)
+    , continueSent_(false)
+    , bodyReads_(0)
+    , chunkScan_(0)
+    , chunkBody_(0)
+    , bodyError_(0)
+    , requestCount_(0)
+    , maxRequests_(MAX_REQUESTS)
+    , compression_(0)
+    , streaming_(false)
+    , chunked_(false)
+    , closeAfter_(false)
 {
 }
 
 HttpServerStream::HttpServerStream(SocketAddr& rSockAddr, UINT uOpenFlags)
     : HttpStream(rSockAddr, uOpenFlags)
     , status_(*new HttpStatus)
+    , reqHeadersValid_(false)
+    , requestSize_(0)
+    , uStreamAbove_(NO_STREAMING)
+    , bodyRemaining_(0)
+    , bodyStreamed_(false)
+    , bodyDone_(false)
+    , continueSent_(false)
+    , bodyReads_(0)
+    , chunkScan_(0)
+    , chunkBody_(0)
+    , bodyError_(0)
+    , requestCount_(0)
+    , maxRequests_(MAX_REQUESTS)
+    , compression_(0)
+    , streaming_(false)
+    , chunked_(false)
+    , closeAfter_(false)
 {
 }
 
@@ -240,6 +694,26 @@ HttpServerStream::~HttpServerStream()
     delete &status_;
 }
 
+void HttpServerStream::close()
+{
+    if (is_open())
+        flushResponses();
+    HttpStream::close();
+    // A recycled stream must not see requests of its previous connection
+    requestSize_ = 0;
+    parser_.reset();
+    bodyStreamed_ = false;
+    bodyError_ = 0;
+    sendBuf_.clear();
+    sendFiles_.clear();
+    requestCount_ = 0;
+    streaming_ = false;
+    closeAfter_ = false;
+    // A pooled stream does not keep the buffers of a large exchange
+    if (sendBuf_.capacity() > MAX_PENDING_RESPONSES)
+        std::string().swap(sendBuf_);
+}
+
 Stream *
 HttpServerStream::listen(const int nBacklog)
 {
@@ -270,92 +744,908 @@ const char* HttpServerStream::functionName(HttpFunction function) {
 }
 
 
-HttpStream::HeaderMap
+const HttpHeaders&
 HttpServerStream::getRequestHeaders() const
 {
+    if (!reqHeadersValid_ && parser_.isComplete()) {
+        reqHeaders_.clear();
+        for (UINT idx = 0; idx < parser_.headerCount(); idx++) {
+            HttpParser::Header header = parser_.headerAt(idx);
+            if (header.id != hdrOther)
+                reqHeaders_.add(header.id, header.value);
+            else
+                reqHeaders_.add(header.name, header.value);
+        }
+        reqHeadersValid_ = true;
+    }
     return reqHeaders_;
 }
 
+std::string_view HttpServerStream::requestBody() const
+{
+    if (requestSize_ == 0)
+        return std::string_view();
+    return std::string_view(recvBuf_.data() + recvBegin_ + parser_.headerSize(),
+                            requestSize_ - parser_.headerSize());
+}
+
 UINT HttpServerStream::response(const char* buffer, UINT uCount, const char* contentType,
     UINT statusCode)
 {
     // send status line, headers, <blanks>, payload
-    status_.setStatus(statusCode);
+    if (queueResponse(buffer, uCount, contentType, statusCode))
+    {
+        flushResponses();
+        if (buffer)
+            write(buffer, uCount);
+    }
 
-    if (contentType) addHeader("Content-Type", contentType);
-    addHeader("Content-Length", uCount);
+    return 0;
+}
 
-    std::string httpres = status_.statusLine();
+Task<UINT> HttpServerStream::async_response(const char* buffer, UINT uCount,
+                                            const char* contentType, UINT statusCode)
+{
+    if (queueResponse(buffer, uCount, contentType, statusCode))
+    {
+        co_await async_flushResponses();
+        if (buffer)
+            co_await async_write(buffer, uCount);
+    }
 
-    expandHeaders(httpres);
-    write(httpres);
+    co_return 0;
+}
+
+void HttpServerStream::appendResponse(std::string_view body, const char* contentType,
+                                      UINT statusCode, std::string_view headers)
+{
+    const char* pEncoding;
+    body = encodeBody(body, contentType, headers, pEncoding);
+    prepareResponse(sendBuf_, body.size(), contentType, statusCode, headers, pEncoding);
+    if (!headRequest())
+        sendBuf_.append(body);
+}
+
+bool HttpServerStream::flushResponses()
+{
+    // File bodies go out in their places between the held responses
+    std::size_t done = 0;
+    bool ok = true;
+    for (PendingFile& pending : sendFiles_)
+    {
+        if (pending.uAt > done)
+            write(sendBuf_.data() + done, pending.uAt - done);
+        ok = ok && m_Status == SC_OK
+             && sendFile(pending.pFile->fd(), 0, pending.pFile->size());
+        if (!ok)
+            break;
+        done = pending.uAt;
+    }
+    if (ok && sendBuf_.size() > done)
+    {
+        write(sendBuf_.data() + done, sendBuf_.size() - done);
+        ok = m_Status == SC_OK;
+    }
+    sendBuf_.clear();
+    sendFiles_.clear();
+    // The peer would take what follows for the rest of a body
+    if (!ok)
+        closeAfter_ = true;
+    return ok;
+}
+
+bool HttpServerStream::upgrade(std::string_view headers, std::string& rest)
+{
+    queueUpgrade(headers, rest);
+    return flushResponses();
+}
+
+Task<bool> HttpServerStream::async_upgrade(std::string_view headers, std::string& rest)
+{
+    queueUpgrade(headers, rest);
+    co_return co_await async_flushResponses();
+}
+
+// Abstract : Queue the response that switches to another protocol
+//
+// Remarks  : What follows the request in the receive buffer was sent in
+//            the new protocol, perhaps before the client saw the 101.
+//
+void HttpServerStream::queueUpgrade(std::string_view headers, std::string& rest)
+{
+    sendBuf_ += "HTTP/1.1 101 Switching Protocols\r\n";
+    sendBuf_ += headers;
+    expandHeaders(sendBuf_);
+
+    handOver(rest);
+}
+
+// Abstract : Give up the connection to another protocol
+//
+// Remarks  : After a request that failed, nothing of the receive buffer
+//            was taken, so rest starts where that request did.
+//
+void HttpServerStream::handOver(std::string& rest)
+{
+    std::size_t next = recvBegin_ + requestSize_;
+    rest.assign(recvBuf_.data() + next, recvEnd_ - next);
+    recvBegin_ = recvEnd_ = 0;
+    requestSize_ = 0;
+    closeAfter_ = true;
+}
+
+bool HttpServerStream::http2Preface() const
+{
+    static const char preface[] = "PRI * HTTP/2.0\r\n";
+    std::size_t size = sizeof(preface) - 1;
+    return parser_.error() == HttpParser::errorVersion && requestSize_ == 0
+        && recvEnd_ - recvBegin_ >= size
+        && memcmp(recvBuf_.data() + recvBegin_, preface, size) == 0;
+}
+
+Task<bool> HttpServerStream::async_flushResponses()
+{
+    std::size_t done = 0;
+    bool ok = true;
+    for (PendingFile& pending : sendFiles_)
+    {
+        std::size_t size = pending.uAt - done;
+        if (size > 0)
+            ok = co_await async_write(sendBuf_.data() + done, size) == static_cast<int>(size);
+        ok = ok && co_await async_sendFile(pending.pFile->fd(), 0, pending.pFile->size());
+        if (!ok)
+            break;
+        done = pending.uAt;
+    }
+    if (ok && sendBuf_.size() > done)
+    {
+        std::size_t size = sendBuf_.size() - done;
+        ok = co_await async_write(sendBuf_.data() + done, size) == static_cast<int>(size);
+    }
+    sendBuf_.clear();
+    sendFiles_.clear();
+    if (!ok)
+        closeAfter_ = true;
+    co_return ok;
+}
+
+void HttpServerStream::beginResponse(const char* contentType, UINT statusCode,
+                                     std::string_view headers)
+{
+    // Without chunks, the end of the connection ends the body
+    chunked_ = parser_.versionMinor() > 0;
+    if (!chunked_)
+        closeAfter_ = true;
+    prepareResponse(sendBuf_, STREAMED, contentType, statusCode, headers);
+    streaming_ = true;
+}
+
+bool HttpServerStream::writeChunk(std::string_view data)
+{
+    if (!streaming_)
+        return false;
+    if (!sendFiles_.empty() && !flushResponses())
+        return false;
+    char sizeLine[24];
+    struct iovec vec[4];
+    int nCount = chunkVector(data, sizeLine, vec);
+    bool ok = writev(vec, nCount);
+    sendBuf_.clear();
+    if (!ok)
+        closeAfter_ = true;
+    return ok;
+}
+
+Task<bool> HttpServerStream::async_writeChunk(std::string_view data)
+{
+    if (!streaming_)
+        co_return false;
+    if (!sendFiles_.empty() && !co_await async_flushResponses())
+        co_return false;
+    char sizeLine[24];
+    struct iovec vec[4];
+    int nCount = chunkVector(data, sizeLine, vec);
+    bool ok = co_await async_writev(vec, nCount);
+    sendBuf_.clear();
+    if (!ok)
+        closeAfter_ = true;
+    co_return ok;
+}
+
+bool HttpServerStream::endResponse(std::string_view trailers)
+{
+    if (!streaming_)
+        return false;
+    return !queueEndOfStream(trailers) || flushResponses();
+}
+
+Task<bool> HttpServerStream::async_endResponse(std::string_view trailers)
+{
+    if (!streaming_)
+        co_return false;
+    co_return !queueEndOfStream(trailers) || co_await async_flushResponses();
+}
+
+// Abstract : Describe the next write of a streamed body
+//
+// Returns  : int (number of buffers)
+// Params   :
+//   data                      Next piece of the body
+//   sizeLine                  Room for the size line of its chunk
+//   pVec                      Four buffers to fill in
+//
+// Remarks  : The held back responses and head go first, so the first
+//            piece leaves with the head in one write.  The response to
+//            HEAD has no body, so its pieces are dropped.
+//
+int HttpServerStream::chunkVector(std::string_view data, char (&sizeLine)[24],
+                                  struct iovec* pVec)
+{
+    int nCount = 0;
+    if (!sendBuf_.empty())
+        pVec[nCount++] = { sendBuf_.data(), sendBuf_.size() };
+    if (data.empty() || headRequest())
+        return nCount;
+    char* sizeEnd = sizeLine;
+    if (chunked_)
+    {
+        sizeEnd = std::to_chars(sizeLine, sizeLine + sizeof(sizeLine) - 2, data.size(), 16).ptr;
+        *sizeEnd++ = '\r';
+        *sizeEnd++ = '\n';
+        pVec[nCount++] = { sizeLine, static_cast<size_t>(sizeEnd - sizeLine) };
+    }
+    pVec[nCount++] = { const_cast<char*>(data.data()), data.size() };
+    if (chunked_)
+        pVec[nCount++] = { const_cast<char*>("\r\n"), 2 };
+    return nCount;
+}
+
+bool HttpServerStream::queueEndOfStream(std::string_view trailers)
+{
+    streaming_ = false;
+    if (chunked_ && !headRequest())
+    {
+        sendBuf_ += "0\r\n";
+        sendBuf_ += trailers;
+        sendBuf_ += "\r\n";
+    }
+    return !pipelined() || sendBuf_.size() >= MAX_PENDING_RESPONSES;
+}
+
+void HttpServerStream::appendFile(std::shared_ptr<const HttpFile> pFile)
+{
+    // The compressed variant is a version of its own, with its own ETag
+    if (pFile->gzip() && acceptsGzip())
+        pFile = pFile->gzip();
+    if (notModified(*pFile))
+    {
+        // The length is that of the body the client already has
+        prepareResponse(sendBuf_, pFile->size(), 0, 304, pFile->headers());
+        return;
+    }
+    prepareResponse(sendBuf_, pFile->size(), pFile->contentType(), 200, pFile->headers());
+    if (headRequest() || pFile->size() == 0)
+        return;
+    if (pFile->loaded())
+        sendBuf_.append(pFile->contents());
+    else
+        sendFiles_.push_back(PendingFile{ sendBuf_.size(), std::move(pFile) });
+}
+
+void HttpServerStream::serveFile(HttpFileCache& rCache, std::string_view path)
+{
+    std::string_view method = parser_.method();
+    if (method != "GET" && method != "HEAD")
+    {
+        appendResponse(std::string_view(), 0, 405, "Allow: GET, HEAD\r\n");
+        return;
+    }
+    std::shared_ptr<const HttpFile> pFile = rCache.find(path);
+    if (pFile)
+        appendFile(std::move(pFile));
+    else
+        appendResponse(std::string_view(), 0, 404);
+}
+
+// Abstract : Evaluate the conditions of a GET or HEAD request on a file
+//
+// Remarks  : If-None-Match, when present, decides on its own, as RFC 9110
+//            section 13.2.2 requires.  Entity tags are compared weakly.
+//
+bool HttpServerStream::notModified(const HttpParser& request, const HttpFile& rFile)
+{
+    std::string_view noneMatch = request.header(hdrIfNoneMatch);
+    if (!noneMatch.empty())
+    {
+        std::string_view etag = rFile.etag();
+        std::size_t pos = 0;
+        while (pos < noneMatch.size())
+        {
+            std::size_t end = std::min(noneMatch.find(',', pos), noneMatch.size());
+            std::string_view tag = noneMatch.substr(pos, end - pos);
+            while (!tag.empty() && (tag.front() == ' ' || tag.front() == '\t'))
+                tag.remove_prefix(1);
+            while (!tag.empty() && (tag.back() == ' ' || tag.back() == '\t'))
+                tag.remove_suffix(1);
+            if (tag.starts_with("W/"))
+                tag.remove_prefix(2);
+            if (tag == "*" || tag == etag)
+                return true;
+            pos = end + 1;
+        }
+        return false;
+    }
+    std::string_view modifiedSince = request.header(hdrIfModifiedSince);
+    time_t since;
+    return !modifiedSince.empty() && HttpDate::parse(modifiedSince, since)
+        && rFile.modified() <= since;
+}
+
+bool HttpServerStream::acceptsGzip() const
+{
+    return HttpEncoding::accepts(parser_.header(hdrAcceptEncoding), "gzip");
+}
+
+// Abstract : Compress a response body when it is worth it
+//
+// Returns  : std::string_view (the body to send)
+// Params   :
+//   body                      Body of the response
+//   contentType               Its media type, 0 if none
+//   headers                   Further header lines of the response
+//   pEncoding                 Set to the header lines telling the coding
+//
+// Remarks  : A body that could have been compressed carries Vary even
+//            when it is not, so that caches keep the two versions apart.
+//
+std::string_view HttpServerStream::encodeBody(std::string_view body, const char* contentType,
+                                              std::string_view headers, const char*& pEncoding)
+{
+    pEncoding = 0;
+    if (compression_ <= 0 || body.size() < HttpEncoding::MIN_COMPRESSED
+        || !HttpEncoding::compressible(contentType)
+        || headers.find("Content-Encoding:") != std::string_view::npos)
+        return body;
+    pEncoding = "Vary: Accept-Encoding\r\n";
+    if (!acceptsGzip())
+        return body;
+    std::string_view packed = HttpEncoding::gzip(body, compression_);
+    if (packed.empty())
+        return body;
+    pEncoding = "Content-Encoding: gzip\r\nVary: Accept-Encoding\r\n";
+    return packed;
+}
+
+bool HttpServerStream::pipelined() const
+{
+    // What follows the head of a streamed body is more of the body
+    if (bodyStreamed_ && !bodyDone_)
+        return false;
+    return !closeAfter_ && recvEnd_ > recvBegin_ + requestSize_;
+}
+
+bool HttpServerStream::headRequest() const
+{
+    return parser_.isComplete() && parser_.method() == "HEAD";
+}
+
+bool HttpServerStream::queueResponse(const char*& buffer, UINT& uCount,
+                                     const char* contentType, UINT statusCode)
+{
+    const char* pEncoding = 0;
+    bool compressed = false;
     if (buffer)
-        write(buffer, uCount);
+    {
+        std::string_view body = encodeBody(std::string_view(buffer, uCount), contentType,
+                                           std::string_view(), pEncoding);
+        compressed = body.data() != buffer;
+        buffer = body.data();
+        uCount = body.size();
+    }
+    prepareResponse(sendBuf_, uCount, contentType, statusCode, std::string_view(), pEncoding);
+    // The response to HEAD tells the length of a body it does not have
+    if (headRequest())
+        buffer = 0;
+    // A compressed body is in a buffer of the thread, which another
+    // response may reuse while this one is being written
+    if (buffer && (uCount <= MAX_COALESCED_BODY || compressed))
+    {
+        sendBuf_.append(buffer, uCount);
+        buffer = 0;
+    }
+    // Responses to pipelined requests go out together after the last one
+    return buffer != 0 || !pipelined() || sendBuf_.size() >= MAX_PENDING_RESPONSES;
+}
 
-    return 0;
+void HttpServerStream::prepareResponse(std::string& httpres, uint64_t uCount,
+                                       const char* contentType, UINT statusCode,
+                                       std::string_view headers, const char* pEncoding)
+{
+    status_.setStatus(statusCode);
+
+    std::string_view statusLine = HttpStatus::knownStatusLine(statusCode);
+    if (statusLine.empty())
+        httpres += status_.statusLine();
+    else
+        httpres += statusLine;
+    // HTTP/1.1 connections persist unless told otherwise, HTTP/1.0 the reverse
+    if (closeAfter_)
+        httpres += "Connection: close\r\n";
+    else if (parser_.versionMinor() == 0)
+        httpres += "Connection: keep-alive\r\n";
+    if (contentType)
+    {
+        httpres += "Content-Type: ";
+        httpres += contentType;
+        httpres += "\r\n";
+    }
+    if (uCount != STREAMED)
+    {
+        char length[24];
+        char* lengthEnd = std::to_chars(length, length + sizeof(length), uCount).ptr;
+        httpres += "Content-Length: ";
+        httpres.append(length, lengthEnd);
+        httpres += "\r\n";
+    }
+    else if (chunked_)
+        httpres += "Transfer-Encoding: chunked\r\n";
+    httpres += headers;
+    if (pEncoding)
+        httpres += pEncoding;
+    expandHeaders(httpres);
 }
 
 UINT
 HttpServerStream::request(char* buffer, UINT uCount,
                           HttpServerStream::HttpFunction& funct, std::string& url) {
-    UINT ret = 0;
     funct = INVALID;
-    if (buffer == 0 || uCount < 17) return ret;
-    ret = read(buffer, uCount);
-    if (ret <= 0) return ret;
-
-    /* Find first line and parse for GET /url HTTP/1.1 */
-    const char* nl = buffer;
-    while (static_cast<UINT>(nl - buffer) < uCount && *nl) {
-        if (*nl == '\n' || *nl == '\r') {
+    if (buffer == 0 || uCount < 17) return 0;
+    if (!receive()) {
+        flushResponses();
+        return 0;
+    }
+
+    return finishRequest(buffer, uCount, funct, url);
+}
+
+Task<UINT>
+HttpServerStream::async_request(char* buffer, UINT uCount,
+                                HttpServerStream::HttpFunction& funct, std::string& url) {
+    funct = INVALID;
+    if (buffer == 0 || uCount < 17) co_return 0;
+    if (!co_await async_receive()) {
+        co_await async_flushResponses();
+        co_return 0;
+    }
+
+    co_return finishRequest(buffer, uCount, funct, url);
+}
+
+bool HttpServerStream::receive() {
+    // The rest of a streamed body comes before the next request
+    if (bodyStreamed_ && !bodyDone_ && !closeAfter_)
+        skipBody();
+    beginRequest();
+    if (sendBuf_.size() >= MAX_PENDING_RESPONSES || !sendFiles_.empty()) {
+        flushResponses();
+    }
+
+    int step = closeAfter_ ? -1 : 0;
+    while (step == 0 && (step = receiveStep()) == 0) {
+        flushResponses();
+        UINT ret = read(recvBuf_.data() + recvEnd_, recvBuf_.size() - recvEnd_);
+        if (ret == 0) {
+            step = -1;
             break;
         }
-        nl++;
+        recvEnd_ += ret;
+    }
+    if (step < 0) {
+        closeAfter_ = true;
+        return false;
     }
-    int sz1 = nl - buffer;
-    if (sz1 <= 0) return ret;
-    string cmd(buffer, sz1);
-    vector<string> cmdline = split(cmd, ' ');
-    if (cmdline.size() != 3) return ret;
-    
-    if (cmdline[0] == "GET")          funct = GET;
-    else if (cmdline[0] == "POST")    funct = POST;
-    else if (cmdline[0] == "HEAD")    funct = HEAD;
-    else if (cmdline[0] == "DELETE")  funct = DELETE;
-    else if (cmdline[0] == "PUT")     funct = PUT;
-    else if (cmdline[0] == "OPTIONS") funct = OPTIONS;
 
-    url = cmdline[1];
-    if (cmdline[2] != "HTTP/1.1")
-    {
-        std::cerr << "Warning, NOT HTTP 1.1" << std::endl;
+    completeRequest();
+    return true;
+}
+
+Task<bool> HttpServerStream::async_receive() {
+    if (bodyStreamed_ && !bodyDone_ && !closeAfter_)
+        co_await async_skipBody();
+    beginRequest();
+    // A file body is not worth holding back for more responses
+    if (sendBuf_.size() >= MAX_PENDING_RESPONSES || !sendFiles_.empty()) {
+        co_await async_flushResponses();
     }
 
-    nl++;
-    sz1 = ret - (nl - buffer);
-    parseHeaders(nl, sz1, reqHeaders_);
+    int step = closeAfter_ ? -1 : 0;
+    while (step == 0 && (step = receiveStep()) == 0) {
+        // Nothing more is pipelined: the held responses go out first
+        if (!co_await async_flushResponses()) {
+            step = -1;
+            break;
+        }
+        int ret = co_await async_read(recvBuf_.data() + recvEnd_, recvBuf_.size() - recvEnd_);
+        if (ret <= 0) {
+            step = -1;
+            break;
+        }
+        recvEnd_ += ret;
+    }
+    if (step < 0) {
+        closeAfter_ = true;
+        co_return false;
+    }
+
+    completeRequest();
+    co_return true;
+}
 
+void HttpServerStream::beginRequest() {
+    // Whatever follows the previous request is the start of this one
+    recvBegin_ += requestSize_;
+    requestSize_ = 0;
+    if (recvBegin_ == recvEnd_) {
+        recvBegin_ = recvEnd_ = 0;
+    }
+    parser_.reset();
+    reqHeadersValid_ = false;
+    streaming_ = false;
+    bodyStreamed_ = false;
+    bodyDone_ = false;
+    continueSent_ = false;
+    chunkScan_ = 0;
+    bodyError_ = 0;
+}
+
+int HttpServerStream::receiveStep() {
+    const char* request = recvBuf_.data() + recvBegin_;
+    size_t avail = recvEnd_ - recvBegin_;
+    size_t need;
+    HttpParser::Result result = parser_.parse(request, avail);
+    if (result == HttpParser::parseError) return -1;
+    if (result == HttpParser::parseComplete) {
+        HttpParser::BodyKind kind = parser_.bodyKind();
+        if (uStreamAbove_ != NO_STREAMING
+            && (kind == HttpParser::bodyChunked
+                || (kind == HttpParser::bodyLength && parser_.contentLength() > uStreamAbove_))) {
+            startBody();
+            return 1;
+        }
+        need = parser_.headerSize();
+        if (kind == HttpParser::bodyChunked) {
+            int step = chunkStep();
+            if (step != 0)
+                return step;
+            need = recvEnd_ - recvBegin_ + 1;
+        } else {
+            if (kind == HttpParser::bodyLength)
+                need += parser_.contentLength();
+            if (avail >= need) {
+                requestSize_ = need;
+                return 1;
+            }
+        }
+        // Told to go on before the body is waited for
+        if (!continueSent_ && expectsContinue())
+            sendBuf_ += CONTINUE_RESPONSE;
+        continueSent_ = true;
+    } else {
+        need = avail + 1;
+    }
+
+    // The parser limits how far the buffer can grow
+    makeRoom(need);
+    return 0;
+}
+
+// Abstract : De-chunk what has been received of a chunked body that is
+//            not streamed
+//
+// Returns  : 1 when the body is complete, 0 when more data is needed;
+//            -1 if the encoding is invalid or the body is larger than
+//            Limits::uMaxBody, with errorStatus() set
+//
+// Remarks  : The payload is moved down to follow the head as it is
+//            decoded, and the chunk framing it came in is dropped, so the
+//            receive buffer holds the head and the body as if it had a
+//            Content-Length.  Bytes received after the body are moved
+//            down behind it.
+//
+int HttpServerStream::chunkStep() {
+    char* request = recvBuf_.data() + recvBegin_;
+    size_t avail = recvEnd_ - recvBegin_;
+    if (chunkScan_ == 0) {
+        chunks_.reset();
+        chunkScan_ = chunkBody_ = parser_.headerSize();
+    }
+    while (chunkScan_ < avail) {
+        size_t used;
+        std::string_view piece;
+        HttpChunkDecoder::Result result = chunks_.decode(request + chunkScan_, avail - chunkScan_,
+                                                         used, piece);
+        chunkScan_ += used;
+        if (result == HttpChunkDecoder::chunkError) {
+            bodyError_ = 400;
+            return -1;
+        }
+        if (chunks_.bodySize() > parser_.getLimits().uMaxBody) {
+            bodyError_ = 413;
+            return -1;
+        }
+        memmove(request + chunkBody_, piece.data(), piece.size());
+        chunkBody_ += piece.size();
+        if (result == HttpChunkDecoder::chunkDone) {
+            size_t rest = avail - chunkScan_;
+            memmove(request + chunkBody_, request + chunkScan_, rest);
+            recvEnd_ = recvBegin_ + chunkBody_ + rest;
+            requestSize_ = chunkBody_;
+            return 1;
+        }
+    }
+    // All of it is decoded: the framing is not kept
+    recvEnd_ = recvBegin_ + chunkBody_;
+    chunkScan_ = chunkBody_;
+    return 0;
+}
+
+UINT HttpServerStream::errorStatus() const {
+    return bodyError_ ? bodyError_ : parser_.errorStatus();
+}
+
+void HttpServerStream::completeRequest() {
+    ++requestCount_;
+    if (!parser_.keepAlive()
+        || (maxRequests_ != 0 && requestCount_ >= maxRequests_)) {
+        closeAfter_ = true;
+    }
+}
+
+UINT HttpServerStream::finishRequest(char* buffer, UINT uCount,
+                                     HttpServerStream::HttpFunction& funct,
+                                     std::string& url) {
+    std::string_view method = parser_.method();
+    if (method == "GET")          funct = GET;
+    else if (method == "POST")    funct = POST;
+    else if (method == "HEAD")    funct = HEAD;
+    else if (method == "DELETE")  funct = DELETE;
+    else if (method == "PUT")     funct = PUT;
+    else if (method == "OPTIONS") funct = OPTIONS;
+    url.assign(parser_.uri());
+
+    if (bodyStreamed_)
+    {
+        UINT ret = std::min<size_t>(requestHead_.size(), uCount);
+        memcpy(buffer, requestHead_.data(), ret);
+        return ret;
+    }
+    UINT ret = std::min<size_t>(requestSize_, uCount);
+    memcpy(buffer, recvBuf_.data() + recvBegin_, ret);
     return ret;
 }
 
+bool HttpServerStream::readBody(std::string_view& piece)
+{
+    int step;
+    while ((step = bodyStep(piece)) == 0)
+    {
+        // The client may be waiting to be told to go on, or for responses
+        if (!continueSent_)
+        {
+            sendBuf_ += CONTINUE_RESPONSE;
+            continueSent_ = true;
+        }
+        if (!flushResponses())
+        {
+            step = -1;
+            break;
+        }
+        UINT ret = read(recvBuf_.data() + recvEnd_, recvBuf_.size() - recvEnd_);
+        if (ret == 0)
+        {
+            step = -1;
+            break;
+        }
+        recvEnd_ += ret;
+    }
+    if (step < 0)
+    {
+        closeAfter_ = true;
+        return false;
+    }
+    return true;
+}
+
+Task<bool> HttpServerStream::async_readBody(std::string_view& piece)
+{
+    int step;
+    while ((step = bodyStep(piece)) == 0)
+    {
+        if (!continueSent_)
+        {
+            sendBuf_ += CONTINUE_RESPONSE;
+            continueSent_ = true;
+        }
+        if (!sendBuf_.empty() && !co_await async_flushResponses())
+        {
+            step = -1;
+            break;
+        }
+        // Data that keeps arriving would hold the loop, and the stack of
+        // awaits that complete at once would keep growing
+        if (++bodyReads_ % BODY_READS_PER_TURN == 0)
+            co_await EventLoop::current()->yield();
+        int ret = co_await async_read(recvBuf_.data() + recvEnd_, recvBuf_.size() - recvEnd_);
+        if (ret <= 0)
+        {
+            step = -1;
+            break;
+        }
+        recvEnd_ += ret;
+    }
+    if (step < 0)
+    {
+        closeAfter_ = true;
+        co_return false;
+    }
+    co_return true;
+}
+
+bool HttpServerStream::readBody(HttpBodySink& sink)
+{
+    if (bodyStreamed_ && parser_.bodyKind() == HttpParser::bodyLength)
+        sink.expect(bodyRemaining_);
+    std::string_view piece;
+    do
+    {
+        if (!readBody(piece))
+            return false;
+        if (!piece.empty() && !sink.write(piece.data(), piece.size()))
+            return false;
+    } while (!piece.empty());
+    return true;
+}
 
-std::vector<std::string>&
-HttpServerStream::split(const std::string &s, char delim,
-                                std::vector<std::string> &elems)
+Task<bool> HttpServerStream::async_readBody(HttpBodySink& sink)
+{
+    if (bodyStreamed_ && parser_.bodyKind() == HttpParser::bodyLength)
+        sink.expect(bodyRemaining_);
+    std::string_view piece;
+    do
+    {
+        if (!co_await async_readBody(piece))
+            co_return false;
+        if (!piece.empty() && !sink.write(piece.data(), piece.size()))
+            co_return false;
+    } while (!piece.empty());
+    co_return true;
+}
+
+// Abstract : Get ready to stream the body of the request just parsed
+//
+// Remarks  : The head is copied out, and the parser pointed at the copy,
+//            so that the receive buffer can be reused for the body while
+//            the request is being handled.
+//
+void HttpServerStream::startBody()
+{
+    requestHead_.assign(recvBuf_.data() + recvBegin_, parser_.headerSize());
+    parser_.reset();
+    parser_.parse(requestHead_.data(), requestHead_.size());
+    recvBegin_ += requestHead_.size();
+    requestSize_ = 0;
+    if (recvBuf_.size() < BODY_BUFFER_SIZE)
+        recvBuf_.resize(BODY_BUFFER_SIZE);
+    bodyStreamed_ = true;
+    bodyRemaining_ = parser_.bodyKind() == HttpParser::bodyLength ? parser_.contentLength() : 0;
+    chunks_.reset();
+    // Sent when the body is first read, so a handler that refuses the
+    // request spares the client from sending it
+    continueSent_ = !expectsContinue();
+}
+
+// Abstract : Take the next piece of the body from the receive buffer
+//
+// Returns  : 1 with a piece, empty at the end of the body; 0 when more
+//            data is needed; -1 if the chunked encoding is invalid
+// Params   :
+//   piece                     Set to the piece, a view into the buffer
+//
+// Remarks  : Once the buffer is used up it is filled again from its
+//            start, so a body of any size goes through the same memory
+//            and the client is held back by TCP until it is consumed.
+//
+int HttpServerStream::bodyStep(std::string_view& piece)
 {
-    std::stringstream ss(s);
-    std::string item;
-    while (std::getline(ss, item, delim)) {
-        elems.push_back(item);
+    piece = std::string_view();
+    if (bodyDone_)
+        return 1;
+    if (!bodyStreamed_)
+    {
+        piece = requestBody();
+        bodyDone_ = true;
+        return 1;
+    }
+
+    size_t avail = recvEnd_ - recvBegin_;
+    if (parser_.bodyKind() == HttpParser::bodyLength)
+    {
+        if (bodyRemaining_ == 0)
+        {
+            bodyDone_ = true;
+            return 1;
+        }
+        if (avail > 0)
+        {
+            size_t take = std::min<uint64_t>(avail, bodyRemaining_);
+            piece = std::string_view(recvBuf_.data() + recvBegin_, take);
+            recvBegin_ += take;
+            bodyRemaining_ -= take;
+            return 1;
+        }
+    }
+    else
+    {
+        while (avail > 0)
+        {
+            size_t used;
+            HttpChunkDecoder::Result result = chunks_.decode(recvBuf_.data() + recvBegin_, avail,
+                                                             used, piece);
+            recvBegin_ += used;
+            avail -= used;
+            if (result == HttpChunkDecoder::chunkError)
+                return -1;
+            if (result == HttpChunkDecoder::chunkDone)
+                bodyDone_ = true;
+            if (bodyDone_ || !piece.empty())
+                return 1;
+        }
     }
-    return elems;
+    makeRoom(1);
+    return 0;
 }
 
+bool HttpServerStream::expectsContinue() const
+{
+    std::string_view expect = parser_.header(hdrExpect);
+    return parser_.versionMinor() > 0 && expect.size() == 12
+        && strncasecmp(expect.data(), "100-continue", 12) == 0;
+}
 
-std::vector<std::string>
-HttpServerStream::split(const std::string &s, char delim)
+// Abstract : Drop the rest of a streamed body that was not read
+//
+// Remarks  : A client still waiting for "100 Continue" has not sent the
+//            body, and a large body is not worth receiving for nothing:
+//            in both cases the connection is closed instead.
+//
+bool HttpServerStream::skipBody()
 {
-    std::vector<std::string> elems;
-    split(s, delim, elems);
-    return elems;
+    bool ok = continueSent_
+        && !(parser_.bodyKind() == HttpParser::bodyLength && bodyRemaining_ > MAX_SKIPPED_BODY);
+    uint64_t skipped = 0;
+    std::string_view piece;
+    while (ok && !bodyDone_)
+    {
+        ok = skipped <= MAX_SKIPPED_BODY && readBody(piece);
+        skipped += piece.size();
+    }
+    if (!ok)
+        closeAfter_ = true;
+    return ok;
+}
+
+Task<bool> HttpServerStream::async_skipBody()
+{
+    bool ok = continueSent_
+        && !(parser_.bodyKind() == HttpParser::bodyLength && bodyRemaining_ > MAX_SKIPPED_BODY);
+    uint64_t skipped = 0;
+    std::string_view piece;
+    while (ok && !bodyDone_)
+    {
+        ok = skipped <= MAX_SKIPPED_BODY && co_await async_readBody(piece);
+        skipped += piece.size();
+    }
+    if (!ok)
+        closeAfter_ = true;
+    co_return ok;
 }
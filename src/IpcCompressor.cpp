@@ -0,0 +1,208 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : IpcCompressor.cpp
+//
+// Class      : IpcCompressor, ZlibCompressor
+//
+// Description: Per-message compression of IPC messages.
+//
+// Decisions  : The compressed form keeps the IpcStruct header so that the
+//              framing (IpcFrameReader) and the sequence matching of
+//              replies work on it unchanged; only a flag in wFunction_
+//              tells the two forms apart.
+//              A message is only sent compressed when that saves at least
+//              the extra size field, so the output buffer handed to the
+//              algorithm is limited accordingly and incompressible data
+//              costs no more than one failed attempt.
+//              The zlib states are reset rather than re-created for each
+//              message: deflateInit allocates about 256 KB.
+//
+
+#include "config.h"
+#include <cassert>
+#include <cstring>
+#include <zlib.h>
+
+#include <sockstr/IpcCompressor.h>
+#include <sockstr/IPC.h>
+
+using namespace sockstr;
+
+namespace {
+constexpr UINT headerSize = sizeof(IpcStruct);
+constexpr UINT prefixSize = headerSize + sizeof(UINT);
+}
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+IpcCompressor::IpcCompressor(UINT uThreshold)
+    : threshold_(uThreshold)
+    , maxExpanded_(defaultMaxExpanded) {
+}
+
+IpcCompressor::~IpcCompressor() {
+}
+
+bool IpcCompressor::isCompressed(const IpcStruct* pFrame) {
+    return (pFrame->wFunction_ & compressedFlag) != 0;
+}
+
+// Abstract : Compress a message for sending
+//
+// Returns  : const IpcStruct* (the message to send)
+// Params   :
+//   pFrame                    Message, with its header filled in
+//
+// Post     : If the message was compressed, the result is in the buffer
+//            of this object and valid until the next call.
+//
+const IpcStruct* IpcCompressor::compress(const IpcStruct* pFrame) {
+    UINT uSize = pFrame->wPacketSize_;
+    if (uSize < threshold_ || uSize <= prefixSize) {
+        return pFrame;
+    }
+    VERIFY(!isCompressed(pFrame));
+    // Anything that does not save space is not worth compressing
+    UINT uRoom = uSize - prefixSize - 1;
+    if (compressed_.size() < prefixSize + uRoom) {
+        compressed_.resize(prefixSize + uRoom);
+    }
+    const char* pBody = reinterpret_cast<const char*>(pFrame) + headerSize;
+    UINT uPacked = compressBytes(pBody, uSize - headerSize,
+                                 compressed_.data() + prefixSize, uRoom);
+    if (uPacked == 0) {
+        return pFrame;
+    }
+
+    IpcStruct* pHeader = reinterpret_cast<IpcStruct*>(compressed_.data());
+    memcpy(pHeader, pFrame, headerSize);
+    pHeader->wFunction_ |= compressedFlag;
+    pHeader->wPacketSize_ = prefixSize + uPacked;
+    memcpy(compressed_.data() + headerSize, &uSize, sizeof(UINT));
+    return pHeader;
+}
+
+// Abstract : Restore a received message
+//
+// Returns  : const IpcStruct* (nullptr if the message is corrupt)
+// Params   :
+//   pFrame                    Message as received
+//
+// Post     : If the message was compressed, the result is in the buffer
+//            of this object and valid until the next call.
+//
+const IpcStruct* IpcCompressor::expand(const IpcStruct* pFrame) {
+    if (!isCompressed(pFrame)) {
+        return pFrame;
+    }
+    UINT uSize = pFrame->wPacketSize_;
+    if (uSize < prefixSize) {
+        return nullptr;
+    }
+    const char* pBytes = reinterpret_cast<const char*>(pFrame);
+    UINT uOriginal;
+    memcpy(&uOriginal, pBytes + headerSize, sizeof(UINT));
+    if (uOriginal < headerSize || uOriginal > maxExpanded_) {
+        return nullptr;
+    }
+    if (expanded_.size() < uOriginal) {
+        expanded_.resize(uOriginal);
+    }
+    if (!expandBytes(pBytes + prefixSize, uSize - prefixSize,
+                     expanded_.data() + headerSize, uOriginal - headerSize)) {
+        return nullptr;
+    }
+
+    IpcStruct* pHeader = reinterpret_cast<IpcStruct*>(expanded_.data());
+    memcpy(pHeader, pFrame, headerSize);
+    pHeader->wFunction_ &= ~compressedFlag;
+    pHeader->wPacketSize_ = uOriginal;
+    return pHeader;
+}
+
+
+struct ZlibCompressor::Streams {
+    z_stream deflater;
+    z_stream inflater;
+    bool bDeflater = false;     // deflater has been initialized
+    bool bInflater = false;
+};
+
+ZlibCompressor::ZlibCompressor(UINT uThreshold, int nLevel)
+    : IpcCompressor(uThreshold)
+    , pStreams_(new Streams)
+    , level_(nLevel) {
+}
+
+ZlibCompressor::~ZlibCompressor() {
+    if (pStreams_->bDeflater) {
+        deflateEnd(&pStreams_->deflater);
+    }
+    if (pStreams_->bInflater) {
+        inflateEnd(&pStreams_->inflater);
+    }
+}
+
+UINT ZlibCompressor::compressBytes(const char* pInput, UINT uInput,
+                                   char* pOutput, UINT uOutput) {
+    z_stream& rStream = pStreams_->deflater;
+    if (!pStreams_->bDeflater) {
+        memset(&rStream, 0, sizeof(rStream));
+        if (deflateInit2(&rStream, level_, Z_DEFLATED, -MAX_WBITS, 8,
+                         Z_DEFAULT_STRATEGY) != Z_OK) {
+            return 0;
+        }
+        pStreams_->bDeflater = true;
+    } else {
+        deflateReset(&rStream);
+    }
+    rStream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(pInput));
+    rStream.avail_in = uInput;
+    rStream.next_out = reinterpret_cast<Bytef*>(pOutput);
+    rStream.avail_out = uOutput;
+    if (deflate(&rStream, Z_FINISH) != Z_STREAM_END) {
+        return 0;           // Did not fit
+    }
+    return uOutput - rStream.avail_out;
+}
+
+bool ZlibCompressor::expandBytes(const char* pInput, UINT uInput,
+                                 char* pOutput, UINT uOutput) {
+    z_stream& rStream = pStreams_->inflater;
+    if (!pStreams_->bInflater) {
+        memset(&rStream, 0, sizeof(rStream));
+        if (inflateInit2(&rStream, -MAX_WBITS) != Z_OK) {
+            return false;
+        }
+        pStreams_->bInflater = true;
+    } else {
+        inflateReset(&rStream);
+    }
+    rStream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(pInput));
+    rStream.avail_in = uInput;
+    rStream.next_out = reinterpret_cast<Bytef*>(pOutput);
+    rStream.avail_out = uOutput;
+    return inflate(&rStream, Z_FINISH) == Z_STREAM_END && rStream.avail_out == 0;
+}
@@ -0,0 +1,187 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : IpcFrameReader.cpp
+//
+// Class      : IpcFrameReader
+//
+// Description: Read-ahead buffer that splits a stream into IpcStruct
+//              frames.
+//
+// Decisions  : The buffer is linear rather than a ring so that every frame
+//              is contiguous and can be returned in place.  The unparsed
+//              tail is moved to the front only when the frame being
+//              assembled would not fit, or when little room is left for
+//              the next read; that tail is at most one partial frame.
+//              Frames are handed out at even offsets, which is all the
+//              alignment the packed IPC structures need.
+//
+
+#include "config.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include <sockstr/IpcFrameReader.h>
+#include <sockstr/IPC.h>
+#include <sockstr/Stream.h>
+
+using namespace sockstr;
+
+namespace {
+constexpr UINT minBufferSize = 8192;
+}
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+IpcFrameReader::IpcFrameReader(UINT uMaxFrame)
+    : begin_(0)
+    , end_(0)
+    , skip_(0)
+    , maxFrame_(std::max<UINT>(uMaxFrame, sizeof(IpcStruct)))
+    , skipped_(0)
+    , error_(false) {
+}
+
+// Abstract : Return the next complete frame in the buffer
+//
+// Returns  : const IpcStruct* (nullptr if there is none)
+//
+// Post     : The frame is consumed.  Oversize frames in the buffer are
+//            dropped on the way.
+//
+// Remarks  : The frame is not copied; it stays valid until the next
+//            call that can change the buffer.
+//
+const IpcStruct* IpcFrameReader::parse() {
+    while (!error_) {
+        if (skip_ > 0) {
+            UINT uDrop = std::min(skip_, end_ - begin_);
+            begin_ += uDrop;
+            skip_ -= uDrop;
+            if (skip_ > 0) {
+                return nullptr;
+            }
+        }
+        UINT uAvail = end_ - begin_;
+        if (uAvail < sizeof(IpcStruct)) {
+            return nullptr;
+        }
+        if (begin_ & 1) {
+            compact(0);
+        }
+        const IpcStruct* pFrame = reinterpret_cast<const IpcStruct*>(&buf_[begin_]);
+        UINT uSize = pFrame->wPacketSize_;
+        if (uSize < sizeof(IpcStruct)) {
+            error_ = true;
+            return nullptr;
+        }
+        if (uSize > maxFrame_) {
+            ++skipped_;
+            skip_ = uSize;
+            continue;
+        }
+        if (uAvail < uSize) {
+            return nullptr;
+        }
+        begin_ += uSize;
+        return pFrame;
+    }
+    return nullptr;
+}
+
+const IpcStruct* IpcFrameReader::read(Stream& rStream) {
+    for (;;) {
+        if (const IpcStruct* pFrame = parse()) {
+            return pFrame;
+        }
+        if (error_ || fill(rStream) == 0) {
+            return nullptr;
+        }
+    }
+}
+
+UINT IpcFrameReader::fill(Stream& rStream) {
+    std::pair<char*, UINT> space = prepare();
+    if (space.second == 0) {
+        return 0;
+    }
+    UINT uActual = rStream.read(space.first, space.second);
+    if (uActual > 0 && uActual <= space.second) {
+        commit(uActual);
+        return uActual;
+    }
+    return 0;
+}
+
+// Abstract : Return the free space at the end of the buffer
+//
+// Returns  : Pointer and size of the space
+//
+// Pre      : parse() has returned nullptr, so at most one partial frame is
+//            buffered.
+// Post     : The buffer is allocated, and compacted if needed so that the
+//            partial frame can be completed.
+//
+std::pair<char*, UINT> IpcFrameReader::prepare() {
+    if (buf_.empty()) {
+        buf_.resize(std::max(maxFrame_, minBufferSize));
+    }
+    UINT uNeeded = sizeof(IpcStruct);
+    if (skip_ == 0 && end_ - begin_ >= sizeof(IpcStruct)) {
+        UINT uSize = reinterpret_cast<const IpcStruct*>(&buf_[begin_])->wPacketSize_;
+        uNeeded = std::min(std::max<UINT>(uSize, sizeof(IpcStruct)), maxFrame_);
+    }
+    compact(uNeeded);
+    return std::make_pair(&buf_[end_], static_cast<UINT>(buf_.size()) - end_);
+}
+
+void IpcFrameReader::commit(UINT uCount) {
+    VERIFY(end_ + uCount <= buf_.size());
+    end_ += uCount;
+}
+
+void IpcFrameReader::reset() {
+    begin_ = end_ = skip_ = 0;
+    error_ = false;
+}
+
+// Abstract : Move the unparsed data to the front of the buffer
+//
+// Params   :
+//   uNeeded                   Size of the frame being assembled.  0 always
+//                             moves the data.
+//
+void IpcFrameReader::compact(UINT uNeeded) {
+    if (begin_ == end_) {
+        begin_ = end_ = 0;
+        return;
+    }
+    UINT uSize = static_cast<UINT>(buf_.size());
+    if (uNeeded == 0 || begin_ + uNeeded > uSize || uSize - end_ < uSize / 4) {
+        std::memmove(&buf_[0], &buf_[begin_], end_ - begin_);
+        end_ -= begin_;
+        begin_ = 0;
+    }
+}
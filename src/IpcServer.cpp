@@ -0,0 +1,411 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : IpcServer.cpp
+//
+// Class      : IpcServer, IpcCall
+//
+// Description: Dispatches IPC messages from many connections to handlers
+//              run by a pool of worker threads.
+//
+// Decisions  : All socket I/O stays on the EventLoop.  Each connection has
+//              a reader coroutine, which queues the messages of one read as
+//              a batch, and a writer coroutine.  Workers append their
+//              replies to the connection's outbox and wake the writer only
+//              if it is idle, so the replies that pile up while a write is
+//              in progress go out together in the next one.
+//              The writer is the only coroutine that closes the socket, and
+//              does so once the reader has finished and every message that
+//              was handed to the workers has been answered.
+//              Nothing is allocated per message once the server is warm:
+//              handlers reply into buffers of the reader or the worker, the
+//              buffers of the queued messages go back to the readers when
+//              handled, and the queue is a vector emptied from the front.
+//
+
+#include "config.h"
+#include <algorithm>
+#include <cassert>
+#include <coroutine>
+#include <iterator>
+
+#include <sockstr/IpcServer.h>
+#include <sockstr/EventLoop.h>
+#include <sockstr/IPC.h>
+#include <sockstr/IpcFrameReader.h>
+#include <sockstr/Socket.h>
+
+using namespace sockstr;
+
+
+// State of one client connection, shared by its coroutines and the
+// workers handling its messages.
+struct IpcServer::Connection {
+    explicit Connection(EventLoop& rLoop) : loop(rLoop) { }
+
+    Socket socket;
+    EventLoop& loop;
+    std::mutex lock;                    // Guards the members below
+    std::vector<char> outbox;           // Replies waiting to be written
+    std::coroutine_handle<> writer;     // Set while the writer is idle
+    std::size_t inflight = 0;           // Messages given to the workers
+    bool closed = false;                // The reader has finished
+    bool finished = false;              // The writer has finished
+};
+
+namespace {
+
+// Largest request buffer kept for reuse; a larger one is freed
+constexpr std::size_t MAX_SPARE_REQUEST = 65536;
+
+// Suspends the writer of a connection until there is something to do
+struct OutboxAwaiter {
+    std::mutex& lock;
+    std::vector<char>& outbox;
+    std::coroutine_handle<>& writer;
+    bool bIdle;                         // Closed with nothing in flight
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> handle) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!outbox.empty() || bIdle) {
+            return false;
+        }
+        writer = handle;
+        return true;
+    }
+    void await_resume() const noexcept { }
+};
+
+}  // namespace
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+void IpcCall::reply(IpcReplyStruct* pReply) {
+    pReply->dwSequence_ = pRequest_->dwSequence_;
+    const char* pBytes = reinterpret_cast<const char*>(pReply);
+    replies_.insert(replies_.end(), pBytes, pBytes + pReply->wPacketSize_);
+}
+
+
+IpcServer::IpcServer(UINT uWorkers)
+    : pCompressorFactory_(nullptr)
+    , pCompressorData_(nullptr)
+    , uQueueHead_(0)
+    , stopping_(false)
+    , connections_(0) {
+    for (UINT idx = 0; idx < uWorkers; idx++) {
+        workers_.emplace_back(&IpcServer::worker, this);
+    }
+}
+
+IpcServer::~IpcServer() {
+    {
+        std::lock_guard<std::mutex> guard(queueLock_);
+        stopping_ = true;
+    }
+    queueReady_.notify_all();
+    for (auto& rThread : workers_) {
+        rThread.join();
+    }
+}
+
+bool IpcServer::registerHandler(WORD wFunction, IpcHandler pHandler, void* ptr) {
+    if (wFunction < 0 || wFunction > maxFunction) {
+        return false;
+    }
+    std::size_t uIndex = static_cast<std::size_t>(wFunction);
+    if (uIndex >= handlers_.size()) {
+        handlers_.resize(uIndex + 1);
+    }
+    handlers_[uIndex].pHandler = pHandler;
+    handlers_[uIndex].pData = ptr;
+    return true;
+}
+
+void IpcServer::setCompressor(IpcCompressorFactory pFactory, void* ptr) {
+    pCompressorFactory_ = pFactory;
+    pCompressorData_ = ptr;
+}
+
+// Abstract : Accept connections and start serving each of them
+//
+// Params   :
+//   rListener                 Socket listening for clients
+//
+// Post     : Returns when the listening socket has been closed.
+//
+Task<void> IpcServer::serve(Socket& rListener) {
+    EventLoop* pLoop = EventLoop::current();
+    VERIFY(pLoop != nullptr);
+    for (;;) {
+        auto pConnection = std::make_shared<Connection>(*pLoop);
+        if (!co_await rListener.async_accept(pConnection->socket)) {
+            if (!rListener.is_open()) {
+                break;
+            }
+            // Out of descriptors or such; do not spin on it
+            co_await pLoop->sleep(10);
+            continue;
+        }
+        if (pCompressorFactory_) {
+            pConnection->socket.setCompressor(
+                std::unique_ptr<IpcCompressor>(pCompressorFactory_(pCompressorData_)));
+        }
+        ++connections_;
+        pLoop->spawn(reader(pConnection));
+        pLoop->spawn(writer(pConnection));
+    }
+}
+
+// Abstract : Read the messages of a connection and dispatch them
+//
+// Remarks  : The messages of one read are queued for the workers with a
+//            single lock.  Without workers they are handled right here
+//            and their replies are delivered as one batch.
+//
+Task<void> IpcServer::reader(std::shared_ptr<Connection> pConnection) {
+    IpcFrameReader frames;
+    IpcCompressor* pCompressor = pConnection->socket.getCompressor();
+    bool bCorrupt = false;
+    std::vector<Job> batch;
+    std::vector<char> replies;
+    std::vector<std::vector<char> > buffers;   // For the requests of the next batch
+    for (;;) {
+        std::size_t uHandled = 0;
+        while (const IpcStruct* pFrame = frames.parse()) {
+            if (pCompressor && (pFrame = pCompressor->expand(pFrame)) == nullptr) {
+                bCorrupt = true;
+                break;
+            }
+            // Numbers out of range are dropped, not truncated onto a handler
+            WORD wFunction = pFrame->wFunction_;
+            if (wFunction < 0 || wFunction > maxFunction) {
+                continue;
+            }
+            std::size_t uIndex = static_cast<std::size_t>(wFunction);
+            if (uIndex >= handlers_.size() || handlers_[uIndex].pHandler == nullptr) {
+                continue;
+            }
+            const Handler& rHandler = handlers_[uIndex];
+            if (workers_.empty()) {
+                IpcCall call(pFrame, replies);
+                rHandler.pHandler(call, rHandler.pData);
+                ++uHandled;
+            } else {
+                const char* pBytes = reinterpret_cast<const char*>(pFrame);
+                std::vector<char> request;
+                if (!buffers.empty()) {
+                    request.swap(buffers.back());
+                    buffers.pop_back();
+                }
+                request.assign(pBytes, pBytes + pFrame->wPacketSize_);
+                batch.push_back(Job{ pConnection, rHandler, std::move(request) });
+            }
+        }
+        if (uHandled > 0) {
+            deliver(*pConnection, replies, 0);
+            replies.clear();
+        }
+        if (!batch.empty()) {
+            {
+                std::lock_guard<std::mutex> guard(pConnection->lock);
+                pConnection->inflight += batch.size();
+            }
+            {
+                std::lock_guard<std::mutex> guard(queueLock_);
+                std::move(batch.begin(), batch.end(), std::back_inserter(queue_));
+                // Buffers for as many requests as this batch had
+                while (buffers.size() < batch.size() && !spareRequests_.empty()) {
+                    buffers.push_back(std::move(spareRequests_.back()));
+                    spareRequests_.pop_back();
+                }
+            }
+            if (batch.size() > 1) {
+                queueReady_.notify_all();
+            } else {
+                queueReady_.notify_one();
+            }
+            batch.clear();
+        }
+
+        if (bCorrupt || frames.error()) {
+            break;
+        }
+        std::pair<char*, UINT> space = frames.prepare();
+        int iResult = co_await pConnection->socket.async_read(space.first, space.second);
+        if (iResult <= 0) {
+            break;
+        }
+        frames.commit(iResult);
+    }
+
+    std::coroutine_handle<> hWriter;
+    {
+        std::lock_guard<std::mutex> guard(pConnection->lock);
+        pConnection->closed = true;
+        if (pConnection->inflight == 0) {
+            hWriter = std::exchange(pConnection->writer, nullptr);
+        }
+    }
+    if (hWriter) {
+        pConnection->loop.schedule(hWriter);
+    }
+    --connections_;
+}
+
+// Abstract : Write the replies of a connection
+//
+// Post     : The socket is closed when the writer returns.
+//
+Task<void> IpcServer::writer(std::shared_ptr<Connection> pConnection) {
+    Connection& rConn = *pConnection;
+    IpcCompressor* pCompressor = rConn.socket.getCompressor();
+    std::vector<char> sending;
+    std::vector<char> packed;           // sending, compressed
+    for (;;) {
+        bool bIdle;
+        {
+            std::lock_guard<std::mutex> guard(rConn.lock);
+            bIdle = rConn.closed && rConn.inflight == 0;
+        }
+        co_await OutboxAwaiter{ rConn.lock, rConn.outbox, rConn.writer, bIdle };
+        {
+            std::lock_guard<std::mutex> guard(rConn.lock);
+            sending.swap(rConn.outbox);
+            bIdle = rConn.closed && rConn.inflight == 0;
+        }
+        if (sending.empty()) {
+            if (bIdle) {
+                break;
+            }
+            continue;
+        }
+        std::vector<char>* pOut = &sending;
+        if (pCompressor) {
+            packed.clear();
+            for (std::size_t uPos = 0; uPos < sending.size(); ) {
+                const IpcStruct* pReply = reinterpret_cast<const IpcStruct*>(&sending[uPos]);
+                const IpcStruct* pSend = pCompressor->compress(pReply);
+                const char* pBytes = reinterpret_cast<const char*>(pSend);
+                packed.insert(packed.end(), pBytes, pBytes + pSend->wPacketSize_);
+                uPos += pReply->wPacketSize_;
+            }
+            pOut = &packed;
+        }
+        int iResult = co_await rConn.socket.async_write(pOut->data(), pOut->size());
+        if (iResult != static_cast<int>(pOut->size())) {
+            break;
+        }
+        sending.clear();
+    }
+    {
+        std::lock_guard<std::mutex> guard(rConn.lock);
+        rConn.finished = true;
+        rConn.outbox.clear();
+    }
+    rConn.socket.close();
+}
+
+void IpcServer::worker() {
+    std::vector<Job> batch;
+    std::vector<char> replies;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(queueLock_);
+            // The buffers of the last batch go back to the readers
+            for (Job& rJob : batch) {
+                if (rJob.request.capacity() <= MAX_SPARE_REQUEST) {
+                    spareRequests_.push_back(std::move(rJob.request));
+                }
+            }
+            batch.clear();
+            queueReady_.wait(guard, [this] { return stopping_ || uQueueHead_ < queue_.size(); });
+            if (stopping_) {
+                return;
+            }
+            // Take a share of the queue, so that one wake-up serves a
+            // burst of messages without starving the other workers
+            std::size_t uWaiting = queue_.size() - uQueueHead_;
+            std::size_t uCount = std::clamp<std::size_t>(uWaiting / workers_.size(), 1, 32);
+            for (std::size_t idx = 0; idx < uCount; idx++) {
+                batch.push_back(std::move(queue_[uQueueHead_++]));
+            }
+            // Move the waiting jobs down once the taken ones are the most
+            if (uQueueHead_ == queue_.size()) {
+                queue_.clear();
+                uQueueHead_ = 0;
+            } else if (uQueueHead_ > queue_.size() / 2) {
+                queue_.erase(queue_.begin(), queue_.begin() + uQueueHead_);
+                uQueueHead_ = 0;
+            }
+        }
+        for (Job& rJob : batch) {
+            IpcCall call(reinterpret_cast<const IpcStruct*>(rJob.request.data()), replies);
+            rJob.handler.pHandler(call, rJob.handler.pData);
+            deliver(*rJob.pConnection, replies, 1);
+            replies.clear();
+            rJob.pConnection.reset();
+        }
+    }
+}
+
+// Abstract : Hand replies to the writer of a connection
+//
+// Params   :
+//   rConnection               Connection the replies go to
+//   rReplies                  Replies (may be empty)
+//   uDone                     Number of worker messages this completes
+//
+// Remarks  : Called by the workers and, without workers, by the reader.
+//            The writer is only resumed if it is idle.
+//
+void IpcServer::deliver(Connection& rConnection, std::vector<char>& rReplies,
+                        std::size_t uDone) {
+    std::coroutine_handle<> hWriter;
+    {
+        std::lock_guard<std::mutex> guard(rConnection.lock);
+        rConnection.inflight -= uDone;
+        if (rConnection.finished) {
+            return;
+        }
+        if (rConnection.outbox.empty()) {
+            rConnection.outbox.swap(rReplies);
+        } else {
+            rConnection.outbox.insert(rConnection.outbox.end(),
+                                      rReplies.begin(), rReplies.end());
+        }
+        if (!rConnection.outbox.empty()
+            || (rConnection.closed && rConnection.inflight == 0)) {
+            hWriter = std::exchange(rConnection.writer, nullptr);
+        }
+    }
+    if (hWriter) {
+        if (EventLoop::current() == &rConnection.loop) {
+            rConnection.loop.schedule(hWriter);
+        } else {
+            rConnection.loop.post(hWriter);
+        }
+    }
+}
@@ -0,0 +1,238 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : RpcClient.cpp
+//
+// Class      : RpcClient
+//
+// Description: Pipelined remote procedure calls over an IPC connection,
+//              with replies matched to their calls by sequence number.
+//
+// Decisions  : The outstanding table is a ring indexed by the low bits of
+//              the sequence number, so finding the call of a reply is one
+//              array access and no allocation is made per call.  The price
+//              is that a call which stays outstanding for a full turn of
+//              sequence numbers blocks its slot; a new call that maps to it
+//              is refused rather than waiting.
+//              Requests are appended to a pending buffer and written by a
+//              flush task, so that all calls made in one pass of the loop
+//              share a single write.
+//              Completions are called from the reader or from timer
+//              expiry, never from call(), so a caller always has the chance
+//              to suspend before its completion runs.
+//
+
+#include "config.h"
+#include <cassert>
+#include <cstring>
+
+#include <sockstr/RpcClient.h>
+#include <sockstr/IPC.h>
+#include <sockstr/Socket.h>
+
+using namespace sockstr;
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+RpcClient::RpcClient(Socket& rSocket, UINT uMaxOutstanding)
+    : socket_(rSocket)
+    , loop_(*EventLoop::current())
+    , mask_(0)
+    , sequence_(0)
+    , outstanding_(0)
+    , flushing_(false)
+    , closed_(false) {
+    UINT uSize = 1;
+    while (uSize < uMaxOutstanding && uSize < 0x10000) {
+        uSize <<= 1;
+    }
+    slots_.reset(new Slot[uSize]);
+    mask_ = uSize - 1;
+    for (UINT idx = 0; idx < uSize; idx++) {
+        slots_[idx].pClient = this;
+        slots_[idx].timer.setCallback(&RpcClient::expired, &slots_[idx]);
+    }
+}
+
+RpcClient::~RpcClient() {
+    closed_ = true;
+    failAll();
+}
+
+// Abstract : Start a remote procedure call
+//
+// Returns  : bool (true if the call is outstanding)
+// Params   :
+//   pRequest                  Message to send
+//   pCompletion               Routine called with the reply
+//   ptr                       User data for pCompletion
+//   uTimeoutMs                Timeout of the call, 0 for none
+//
+// Pre      : Called on the thread of the EventLoop that was current when
+//            the client was constructed.
+// Post     : The request is queued for writing with the next sequence
+//            number of this client.
+//
+bool RpcClient::call(IpcStruct* pRequest, RpcCompletion pCompletion, void* ptr,
+                     UINT uTimeoutMs) {
+    VERIFY(pCompletion != nullptr);
+    if (closed_) {
+        return false;
+    }
+    UINT uSequence = sequence_ + 1;
+    if (uSequence == 0) {
+        uSequence = 1;
+    }
+    Slot& rSlot = slots_[uSequence & mask_];
+    if (rSlot.pCompletion != nullptr) {
+        return false;
+    }
+    sequence_ = uSequence;
+    DWORD dwSequence = static_cast<DWORD>(uSequence);
+    rSlot.dwSequence = dwSequence;
+    rSlot.pCompletion = pCompletion;
+    rSlot.pData = ptr;
+    ++outstanding_;
+    if (uTimeoutMs) {
+        loop_.timers().arm(rSlot.timer, uTimeoutMs);
+    }
+
+    pRequest->dwSequence_ = dwSequence;
+    const IpcStruct* pSend = pRequest;
+    if (IpcCompressor* pCompressor = socket_.getCompressor()) {
+        pSend = pCompressor->compress(pRequest);
+    }
+    const char* pBytes = reinterpret_cast<const char*>(pSend);
+    pending_.insert(pending_.end(), pBytes, pBytes + pSend->wPacketSize_);
+    if (!flushing_) {
+        flushing_ = true;
+        loop_.spawn(flush());
+    }
+    return true;
+}
+
+Task<void> RpcClient::flush() {
+    while (!pending_.empty() && !closed_) {
+        sending_.swap(pending_);
+        int iResult = co_await socket_.async_write(sending_.data(), sending_.size());
+        if (iResult != static_cast<int>(sending_.size())) {
+            closed_ = true;
+            failAll();
+        }
+        sending_.clear();
+    }
+    pending_.clear();
+    flushing_ = false;
+}
+
+// Abstract : Read replies and complete the calls they answer
+//
+// Post     : When the connection is closed or fails, every outstanding
+//            call is completed with a nullptr reply and no new calls are
+//            accepted.
+//
+// Remarks  : Messages whose sequence number matches no outstanding call,
+//            such as late replies to calls that timed out, are dropped.
+//            A compressed reply that cannot be expanded ends the
+//            connection like any other malformed message.
+//
+Task<void> RpcClient::run() {
+    IpcCompressor* pCompressor = socket_.getCompressor();
+    bool bCorrupt = false;
+    while (!closed_) {
+        while (const IpcStruct* pFrame = reader_.parse()) {
+            if (pCompressor && (pFrame = pCompressor->expand(pFrame)) == nullptr) {
+                bCorrupt = true;
+                break;
+            }
+            Slot& rSlot = slots_[static_cast<UINT>(pFrame->dwSequence_) & mask_];
+            if (rSlot.pCompletion != nullptr && rSlot.dwSequence == pFrame->dwSequence_
+                && pFrame->wPacketSize_ >= sizeof(IpcReplyStruct)) {
+                complete(rSlot, static_cast<const IpcReplyStruct*>(pFrame));
+            }
+        }
+        if (bCorrupt || reader_.error()) {
+            break;
+        }
+        std::pair<char*, UINT> space = reader_.prepare();
+        int iResult = co_await socket_.async_read(space.first, space.second);
+        if (iResult <= 0) {
+            break;
+        }
+        reader_.commit(iResult);
+    }
+    closed_ = true;
+    failAll();
+}
+
+void RpcClient::complete(Slot& rSlot, const IpcReplyStruct* pReply) {
+    RpcCompletion pCompletion = rSlot.pCompletion;
+    void* pData = rSlot.pData;
+    rSlot.pCompletion = nullptr;
+    rSlot.pData = nullptr;
+    rSlot.timer.cancel();
+    --outstanding_;
+    pCompletion(pReply, pData);
+}
+
+void RpcClient::failAll() {
+    for (UINT idx = 0; idx <= mask_ && outstanding_ > 0; idx++) {
+        if (slots_[idx].pCompletion != nullptr) {
+            complete(slots_[idx], nullptr);
+        }
+    }
+}
+
+void RpcClient::expired(Timer* /*pTimer*/, void* ptr) {
+    Slot* pSlot = static_cast<Slot*>(ptr);
+    if (pSlot->pCompletion != nullptr) {
+        pSlot->pClient->complete(*pSlot, nullptr);
+    }
+}
+
+
+RpcClient::CallAwaiter::CallAwaiter(RpcClient& rClient, IpcStruct* pRequest,
+                                    IpcReplyStruct* pReply, UINT uMaxReply,
+                                    UINT uTimeoutMs)
+    : client_(rClient)
+    , pRequest_(pRequest)
+    , pReply_(pReply)
+    , uMaxReply_(uMaxReply ? uMaxReply : pReply->wPacketSize_)
+    , uTimeoutMs_(uTimeoutMs)
+    , result_(0) {
+}
+
+bool RpcClient::CallAwaiter::await_ready() {
+    // Nothing to wait for if the call cannot even be made
+    return !client_.call(pRequest_, &CallAwaiter::completed, this, uTimeoutMs_);
+}
+
+void RpcClient::CallAwaiter::completed(const IpcReplyStruct* pReply, void* ptr) {
+    CallAwaiter* pAwaiter = static_cast<CallAwaiter*>(ptr);
+    if (pReply != nullptr && pReply->wPacketSize_ <= pAwaiter->uMaxReply_) {
+        memcpy(pAwaiter->pReply_, pReply, pReply->wPacketSize_);
+        pAwaiter->result_ = pReply->wPacketSize_;
+    }
+    pAwaiter->client_.loop_.schedule(pAwaiter->handle_);
+}
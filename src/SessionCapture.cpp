@@ -0,0 +1,311 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : SessionCapture.cpp
+//
+// Class      : SessionCapture, CaptureReader
+//
+// Description: Recording of socket traffic to a capture file, and reading
+//              it back for replay.
+//
+// Decisions  : Times are stored as deltas to the previous record and all
+//              numbers as varints, so a record of a small read costs a
+//              handful of bytes on top of the data.  The deltas come from
+//              the monotonic clock, which never makes them negative; the
+//              wall clock is only stored once, in the header.
+//              Records are formatted into a memory block under the lock
+//              and the block is written out when it is full, so the lock is
+//              held for a system call only once per block.
+//
+
+#include "config.h"
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+#include <sockstr/SessionCapture.h>
+
+using namespace sockstr;
+
+namespace {
+
+constexpr std::size_t blockSize = 64 * 1024;
+constexpr std::size_t headerSize = sizeof(SessionCapture::magic) + 8;
+
+uint64_t monotonicUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void putVarint(std::vector<char>& rBuffer, uint64_t uValue) {
+    while (uValue >= 0x80) {
+        rBuffer.push_back(static_cast<char>(uValue | 0x80));
+        uValue >>= 7;
+    }
+    rBuffer.push_back(static_cast<char>(uValue));
+}
+
+// Returns the number of bytes used, 0 if the varint is incomplete or too long
+std::size_t getVarint(const char* pData, std::size_t uSize, uint64_t& rValue) {
+    uint64_t uValue = 0;
+    for (std::size_t idx = 0; idx < uSize && idx < 10; idx++) {
+        unsigned char uByte = static_cast<unsigned char>(pData[idx]);
+        uValue |= uint64_t(uByte & 0x7f) << (7 * idx);
+        if (!(uByte & 0x80)) {
+            rValue = uValue;
+            return idx + 1;
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+SessionCapture::SessionCapture()
+    : pFile_(nullptr)
+    , start_(0)
+    , last_(0)
+    , sessions_(0) {
+}
+
+SessionCapture::~SessionCapture() {
+    close();
+}
+
+bool SessionCapture::open(const char* lpszFileName) {
+    close();
+    std::lock_guard<std::mutex> guard(lock_);
+    pFile_ = std::fopen(lpszFileName, "wb");
+    if (pFile_ == nullptr) {
+        return false;
+    }
+    uint64_t uWallClock = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    buffer_.reserve(blockSize + 256);
+    buffer_.assign(magic, magic + sizeof(magic));
+    for (int idx = 0; idx < 8; idx++, uWallClock >>= 8) {
+        buffer_.push_back(static_cast<char>(uWallClock));
+    }
+    start_ = monotonicUs();
+    last_ = 0;
+    sessions_ = 0;
+    return true;
+}
+
+void SessionCapture::close() {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (pFile_ != nullptr) {
+        flush();
+        std::fclose(pFile_);
+        pFile_ = nullptr;
+    }
+}
+
+// Abstract : Start a new session
+//
+// Returns  : UINT (session number, 0 if the capture is not open)
+// Params   :
+//   nProtocol                 SOCK_STREAM or SOCK_DGRAM
+//   bAccepted                 True for the server side of a connection
+//   pPeer                     Address of the peer
+//
+UINT SessionCapture::openSession(int nProtocol, bool bAccepted, const char* pPeer) {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (pFile_ == nullptr) {
+        return 0;
+    }
+    UINT uSession = ++sessions_;
+    char prefix[2] = { static_cast<char>(nProtocol), static_cast<char>(bAccepted ? 1 : 0) };
+    append(captureOpen, uSession, pPeer, static_cast<UINT>(strlen(pPeer)), prefix, sizeof(prefix));
+    return uSession;
+}
+
+void SessionCapture::record(UINT uSession, CaptureKind eKind, const void* pData, UINT uLength) {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (pFile_ != nullptr && uSession != 0) {
+        append(eKind, uSession, pData, uLength);
+    }
+}
+
+// Pre      : lock_ is held and the file is open.
+void SessionCapture::append(CaptureKind eKind, UINT uSession, const void* pData, UINT uLength,
+                            const void* pPrefix, UINT uPrefix) {
+    uint64_t uNow = monotonicUs() - start_;
+    if (uNow < last_) {
+        uNow = last_;
+    }
+    buffer_.push_back(static_cast<char>(eKind));
+    putVarint(buffer_, uSession);
+    putVarint(buffer_, uNow - last_);
+    putVarint(buffer_, uPrefix + uLength);
+    last_ = uNow;
+    if (uPrefix) {
+        const char* pBytes = static_cast<const char*>(pPrefix);
+        buffer_.insert(buffer_.end(), pBytes, pBytes + uPrefix);
+    }
+    if (uLength) {
+        const char* pBytes = static_cast<const char*>(pData);
+        buffer_.insert(buffer_.end(), pBytes, pBytes + uLength);
+    }
+    if (buffer_.size() >= blockSize) {
+        flush();
+    }
+}
+
+// Pre      : lock_ is held and the file is open.
+void SessionCapture::flush() {
+    if (!buffer_.empty()) {
+        std::fwrite(buffer_.data(), 1, buffer_.size(), pFile_);
+        buffer_.clear();
+    }
+}
+
+
+CaptureReader::CaptureReader()
+    : pFile_(nullptr)
+    , begin_(0)
+    , end_(0)
+    , startTime_(0)
+    , time_(0)
+    , error_(false) {
+}
+
+CaptureReader::~CaptureReader() {
+    close();
+}
+
+bool CaptureReader::open(const char* lpszFileName) {
+    close();
+    error_ = false;
+    pFile_ = std::fopen(lpszFileName, "rb");
+    if (pFile_ == nullptr) {
+        return false;
+    }
+    buffer_.resize(blockSize);
+    if (!fill(headerSize) || memcmp(&buffer_[begin_], SessionCapture::magic,
+                                    sizeof(SessionCapture::magic)) != 0) {
+        error_ = true;
+        close();
+        return false;
+    }
+    startTime_ = 0;
+    for (int idx = 7; idx >= 0; idx--) {
+        startTime_ = (startTime_ << 8)
+                   | static_cast<unsigned char>(buffer_[begin_ + sizeof(SessionCapture::magic) + idx]);
+    }
+    begin_ += headerSize;
+    return true;
+}
+
+void CaptureReader::close() {
+    if (pFile_ != nullptr) {
+        std::fclose(pFile_);
+        pFile_ = nullptr;
+    }
+    begin_ = end_ = 0;
+    time_ = 0;
+}
+
+// Abstract : Make at least uNeeded bytes available at begin_
+//
+// Returns  : bool (false if the file ends first)
+//
+bool CaptureReader::fill(std::size_t uNeeded) {
+    while (end_ - begin_ < uNeeded) {
+        if (begin_ > 0) {
+            memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+            end_ -= begin_;
+            begin_ = 0;
+        }
+        if (buffer_.size() < uNeeded) {
+            buffer_.resize(uNeeded);
+        }
+        std::size_t uRead = std::fread(buffer_.data() + end_, 1, buffer_.size() - end_, pFile_);
+        if (uRead == 0) {
+            return false;
+        }
+        end_ += uRead;
+    }
+    return true;
+}
+
+// Abstract : Read the next record
+//
+// Returns  : bool (false at the end of the file or on a damaged record)
+// Params   :
+//   rRecord                   Filled with the record
+//
+// Post     : rRecord.pData points into the reader's buffer and is valid
+//            until the next call.
+//
+bool CaptureReader::next(CaptureRecord& rRecord) {
+    if (pFile_ == nullptr || error_) {
+        return false;
+    }
+    // The record header is at most 1 + 3 * 10 bytes; a shorter one can end
+    // the file, so only ask for what is there
+    fill(31);
+    if (begin_ == end_) {
+        return false;       // Clean end of file
+    }
+    const char* pHeader = &buffer_[begin_];
+    std::size_t uAvail = end_ - begin_;
+    uint64_t uSession, uDelta, uLength;
+    std::size_t uPos = 1;
+    std::size_t uUsed;
+    int nKind = static_cast<unsigned char>(pHeader[0]);
+    if (nKind < captureOpen || nKind > captureClose
+        || (uUsed = getVarint(pHeader + uPos, uAvail - uPos, uSession)) == 0
+        || (uPos += uUsed, uUsed = getVarint(pHeader + uPos, uAvail - uPos, uDelta)) == 0
+        || (uPos += uUsed, uUsed = getVarint(pHeader + uPos, uAvail - uPos, uLength)) == 0
+        || uSession == 0 || uSession > 0xffffffffu || uLength > maxRecord) {
+        error_ = true;
+        return false;
+    }
+    uPos += uUsed;
+    if (!fill(uPos + uLength)) {
+        error_ = true;      // Truncated record
+        return false;
+    }
+
+    time_ += uDelta;
+    rRecord.eKind = static_cast<CaptureKind>(nKind);
+    rRecord.uSession = static_cast<UINT>(uSession);
+    rRecord.uTimestamp = time_;
+    rRecord.pData = &buffer_[begin_ + uPos];
+    rRecord.uLength = static_cast<UINT>(uLength);
+    if (rRecord.eKind == captureOpen) {
+        if (uLength < 2) {
+            error_ = true;
+            return false;
+        }
+        rRecord.nProtocol = rRecord.pData[0];
+        rRecord.bAccepted = rRecord.pData[1] != 0;
+        rRecord.peer.assign(rRecord.pData + 2, uLength - 2);
+    }
+    begin_ += uPos + uLength;
+    return true;
+}
@@ -0,0 +1,654 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : ShmStream.cpp
+//
+// Class      : ShmStream
+//
+// Description: Stream between two processes on the same host over a pair
+//              of single-producer single-consumer rings in shared memory.
+//
+// Decisions  : The region is a POSIX shared memory object so that an
+//              unrelated process can attach by name; no descriptor has to
+//              be passed.  Each ring has a free running head (bytes
+//              written) and tail (bytes read) on separate cache lines, so
+//              the two sides never write the same line while data flows.
+//              A side that has to wait spins first and then sleeps on a
+//              futex word.  It announces itself in a "waiting" flag before
+//              re-checking the ring, and the other side checks that flag
+//              after publishing its index (both sequentially consistent),
+//              so the wake-up system call is only made when a peer really
+//              sleeps.  Without futexes the waiting side just yields.
+//
+
+#include "config.h"
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef CONFIG_HAS_FUTEX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include <sockstr/ShmStream.h>
+#include <sockstr/IPC.h>
+
+using namespace sockstr;
+
+
+namespace sockstr {
+
+// One direction of the stream.  head and tail only ever increase; the
+// position in the data area is the index masked by the ring size.
+struct ShmRing {
+    alignas(64) std::atomic<uint64_t> head;     // Written by the producer
+    std::atomic<uint32_t> dataSeq;              // Futex word for readers
+    std::atomic<uint32_t> readerWaiting;
+    alignas(64) std::atomic<uint64_t> tail;     // Written by the consumer
+    std::atomic<uint32_t> spaceSeq;             // Futex word for writers
+    std::atomic<uint32_t> writerWaiting;
+    alignas(64) uint64_t mask;
+    uint64_t offset;                            // Of the data from the region
+};
+
+struct ShmRegion {
+    std::atomic<uint64_t> magic;                // Set last by the creator
+    uint32_t ringSize;
+    std::atomic<uint32_t> closed[2];            // Indexed by side
+    ShmRing ring[2];                            // Creator writes ring 0
+};
+
+}  // namespace sockstr
+
+
+namespace {
+
+constexpr uint64_t shmMagic = 0x314d485352545353ull;   // "SSTRSHM1"
+constexpr const char* shmPrefix = "shm:";
+constexpr std::size_t pageSize = 4096;
+
+// Spinning only helps when the peer runs on another CPU at the same time
+bool singleCpu() {
+    static const bool bSingle = ::sysconf(_SC_NPROCESSORS_ONLN) <= 1;
+    return bSingle;
+}
+
+inline void cpuRelax() {
+    if (singleCpu()) {
+        ::sched_yield();
+        return;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+inline void futexWait(std::atomic<uint32_t>* pWord, uint32_t uValue) {
+#ifdef CONFIG_HAS_FUTEX
+    // Not FUTEX_PRIVATE_FLAG: the word is shared between processes
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(pWord), FUTEX_WAIT,
+              uValue, nullptr, nullptr, 0);
+#else
+    (void) pWord;
+    (void) uValue;
+    ::sched_yield();
+#endif
+}
+
+inline void futexWake(std::atomic<uint32_t>* pWord) {
+    pWord->fetch_add(1, std::memory_order_seq_cst);
+#ifdef CONFIG_HAS_FUTEX
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(pWord), FUTEX_WAKE,
+              INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+// Name of the shared memory object for "shm:name"
+std::string objectName(const std::string& strName) {
+    return "/sockstr." + strName.substr(std::strlen(shmPrefix));
+}
+
+std::size_t mapSize(uint32_t uRingSize) {
+    std::size_t uHeader = (sizeof(ShmRegion) + pageSize - 1) & ~(pageSize - 1);
+    return uHeader + 2 * std::size_t(uRingSize);
+}
+
+}  // namespace
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+ShmStream::ShmStream()
+    : region_(nullptr)
+    , mapSize_(0)
+    , in_(nullptr)
+    , out_(nullptr)
+    , side_(0)
+    , asyncMode_(false)
+    , busyWait_(false)
+    , spinCount_(singleCpu() ? 0 : 2000)
+    , aborted_(false)
+    , sequence_(0) {
+}
+
+ShmStream::ShmStream(const char* lpszName, UINT uOpenFlags)
+    : ShmStream() {
+    open(lpszName, uOpenFlags);
+}
+
+ShmStream::~ShmStream() {
+    close();
+}
+
+// Abstract : Wake up a blocked reader or writer
+//
+// Post     : A read() or write() that is waiting on the rings returns as
+//            if no data (or no peer) were available.
+//
+// Remarks  : May be called from another thread.  An abort that finds
+//            nobody waiting cancels the next wait instead.
+//
+void ShmStream::abort() {
+    if (region_ != nullptr) {
+        aborted_.store(true, std::memory_order_seq_cst);
+        futexWake(&in_->dataSeq);
+        futexWake(&out_->spaceSeq);
+    }
+}
+
+// Abstract : Close the stream
+//
+// Post     : The peer is told that this side has gone and is woken up.
+//            Its reads return end of file once it has drained the ring.
+//            The creator removes the name of the shared memory object.
+//
+void ShmStream::close() {
+    if (region_ == nullptr) {
+        return;
+    }
+    flush();
+    region_->closed[side_].store(1, std::memory_order_seq_cst);
+    futexWake(&out_->dataSeq);
+    futexWake(&in_->spaceSeq);
+    if (side_ == 0) {
+        ::shm_unlink(objectName(name_).c_str());
+    }
+    unmap();
+    strbuf.reset();
+}
+
+void ShmStream::unmap() {
+    if (region_ != nullptr) {
+        ::munmap(region_, mapSize_);
+        region_ = nullptr;
+        in_ = out_ = nullptr;
+    }
+    if (m_hFile != INVALID_SOCKET) {
+        ::close(m_hFile);
+        m_hFile = INVALID_SOCKET;
+    }
+}
+
+Stream* ShmStream::listen(const int nBacklog) {
+    (void) nBacklog;
+    return nullptr;
+}
+
+bool ShmStream::open(const char* lpszName, UINT uOpenFlags) {
+    return open(lpszName, uOpenFlags, defaultRingSize);
+}
+
+// Abstract : Create or attach to a shared memory stream
+//
+// Returns  : bool (true on success)
+// Params   :
+//   lpszName                  Name of the stream, such as "shm:myapp".  The
+//                             prefix is optional.  The name must not
+//                             contain a slash.
+//   uOpenFlags                modeCreate to create the stream, otherwise
+//                             the stream is attached.  modeAsync and
+//                             modeBusyWait may be added.
+//   uRingSize                 Size of each ring when creating
+//
+// Pre      : To attach, another process must have created the stream.
+// Post     : On failure m_Status is SC_FAILED and the failbit is set.
+//
+// Remarks  : The creator removes a stale object of the same name left by
+//            a process that died, then publishes the header last so an
+//            attaching process never sees a half initialized region.
+//
+bool ShmStream::open(const char* lpszName, UINT uOpenFlags, UINT uRingSize) {
+    close();
+
+    const char* lpszBase = lpszName;
+    if (std::strncmp(lpszBase, shmPrefix, std::strlen(shmPrefix)) == 0) {
+        lpszBase += std::strlen(shmPrefix);
+    }
+    if (*lpszBase == '\0' || std::strchr(lpszBase, '/') != nullptr) {
+        m_Status = SC_FAILED;
+        setstate(std::ios::failbit);
+        return false;
+    }
+    name_ = std::string(shmPrefix) + lpszBase;
+    std::string strObject = objectName(name_);
+    const char* lpszObject = strObject.c_str();
+
+    bool bCreate = (uOpenFlags & modeCreate) != 0;
+    side_ = bCreate ? 0 : 1;
+    int fd;
+    if (bCreate) {
+        uint32_t uSize = pageSize;
+        while (uSize < uRingSize && uSize < 0x80000000u) {
+            uSize <<= 1;
+        }
+        ::shm_unlink(lpszObject);
+        fd = ::shm_open(lpszObject, O_RDWR | O_CREAT | O_EXCL, 0600);
+        mapSize_ = mapSize(uSize);
+        if (fd >= 0 && ::ftruncate(fd, mapSize_) != 0) {
+            ::close(fd);
+            ::shm_unlink(lpszObject);
+            fd = -1;
+        }
+        if (fd >= 0) {
+            void* pMem = ::mmap(nullptr, mapSize_, PROT_READ | PROT_WRITE,
+                                MAP_SHARED, fd, 0);
+            if (pMem != MAP_FAILED) {
+                region_ = new (pMem) ShmRegion();
+                region_->ringSize = uSize;
+                for (int i = 0; i < 2; i++) {
+                    region_->ring[i].mask = uSize - 1;
+                    region_->ring[i].offset = mapSize_ - (2 - i) * std::size_t(uSize);
+                }
+                region_->magic.store(shmMagic, std::memory_order_release);
+            } else {
+                ::shm_unlink(lpszObject);
+            }
+        }
+    } else {
+        fd = ::shm_open(lpszObject, O_RDWR, 0);
+        struct stat st;
+        if (fd >= 0 && ::fstat(fd, &st) == 0
+            && std::size_t(st.st_size) >= sizeof(ShmRegion)) {
+            mapSize_ = st.st_size;
+            void* pMem = ::mmap(nullptr, mapSize_, PROT_READ | PROT_WRITE,
+                                MAP_SHARED, fd, 0);
+            if (pMem != MAP_FAILED) {
+                region_ = static_cast<ShmRegion*>(pMem);
+                if (region_->magic.load(std::memory_order_acquire) != shmMagic
+                    || mapSize(region_->ringSize) != mapSize_) {
+                    ::munmap(pMem, mapSize_);
+                    region_ = nullptr;
+                } else {
+                    region_->closed[1].store(0, std::memory_order_release);
+                }
+            }
+        }
+    }
+    if (region_ == nullptr) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        m_Status = SC_FAILED;
+        setstate(std::ios::failbit);
+        return false;
+    }
+
+    m_hFile = fd;
+    out_ = &region_->ring[side_];
+    in_ = &region_->ring[1 - side_];
+    asyncMode_ = (uOpenFlags & modeAsync) != 0;
+    busyWait_ = (uOpenFlags & modeBusyWait) != 0;
+    aborted_.store(false);
+    m_Status = SC_OK;
+    clear();
+    return true;
+}
+
+// Abstract : Wait until a ring has data
+//
+// Returns  : bool (false if the peer closed with the ring empty, or on abort)
+//
+bool ShmStream::waitForData(ShmRing* pRing) {
+    uint64_t uTail = pRing->tail.load(std::memory_order_relaxed);
+    for (UINT uSpins = 0; ; ++uSpins) {
+        if (pRing->head.load(std::memory_order_acquire) != uTail) {
+            return true;
+        }
+        if (region_->closed[1 - side_].load(std::memory_order_acquire)) {
+            return pRing->head.load(std::memory_order_acquire) != uTail;
+        }
+        if (aborted_.exchange(false)) {
+            return false;
+        }
+        if (busyWait_ || uSpins < spinCount_) {
+            cpuRelax();
+            continue;
+        }
+        uint32_t uSeq = pRing->dataSeq.load(std::memory_order_acquire);
+        pRing->readerWaiting.store(1, std::memory_order_seq_cst);
+        if (pRing->head.load(std::memory_order_seq_cst) == uTail
+            && !region_->closed[1 - side_].load(std::memory_order_seq_cst)
+            && !aborted_.load(std::memory_order_seq_cst)) {
+            futexWait(&pRing->dataSeq, uSeq);
+        }
+        pRing->readerWaiting.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Abstract : Wait until a ring has room
+//
+// Returns  : bool (false if the peer closed, or on abort)
+//
+bool ShmStream::waitForSpace(ShmRing* pRing) {
+    uint64_t uFull = pRing->head.load(std::memory_order_relaxed) - (pRing->mask + 1);
+    for (UINT uSpins = 0; ; ++uSpins) {
+        if (pRing->tail.load(std::memory_order_acquire) != uFull) {
+            return true;
+        }
+        if (region_->closed[1 - side_].load(std::memory_order_acquire)
+            || aborted_.exchange(false)) {
+            return false;
+        }
+        if (busyWait_ || uSpins < spinCount_) {
+            cpuRelax();
+            continue;
+        }
+        uint32_t uSeq = pRing->spaceSeq.load(std::memory_order_acquire);
+        pRing->writerWaiting.store(1, std::memory_order_seq_cst);
+        if (pRing->tail.load(std::memory_order_seq_cst) == uFull
+            && !region_->closed[1 - side_].load(std::memory_order_seq_cst)
+            && !aborted_.load(std::memory_order_seq_cst)) {
+            futexWait(&pRing->spaceSeq, uSeq);
+        }
+        pRing->writerWaiting.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Abstract : Read data from the stream
+//
+// Returns  : UINT (number of bytes read)
+// Params   :
+//   pBuf                      Buffer to read into
+//   uCount                    Maximum number of bytes to read
+//
+// Post     : Whatever is in the ring, up to uCount bytes, is returned.  In
+//            synchronous mode the call waits for at least one byte.
+//            0 is returned with the eofbit set when the peer has closed
+//            the stream, or in asynchronous mode when no data is ready.
+//
+UINT ShmStream::read(void* pBuf, UINT uCount) {
+    if (uCount == 0) {
+        return 0;
+    }
+    if (region_ == nullptr) {
+        m_Status = SC_FAILED;
+        setstate(std::ios::failbit);
+        return 0;
+    }
+    ShmRing* pRing = in_;
+    uint64_t uTail = pRing->tail.load(std::memory_order_relaxed);
+    uint64_t uHead = pRing->head.load(std::memory_order_acquire);
+    if (uHead == uTail) {
+        if (asyncMode_ || !waitForData(pRing)) {
+            m_Status = SC_NODATA;
+            setstate(std::ios::eofbit);
+            return 0;
+        }
+        uHead = pRing->head.load(std::memory_order_acquire);
+    }
+
+    UINT uActual = static_cast<UINT>(std::min<uint64_t>(uHead - uTail, uCount));
+    const char* pData = reinterpret_cast<const char*>(region_) + pRing->offset;
+    std::size_t uPos = uTail & pRing->mask;
+    std::size_t uFirst = std::min<std::size_t>(uActual, pRing->mask + 1 - uPos);
+    std::memcpy(pBuf, pData + uPos, uFirst);
+    std::memcpy(static_cast<char*>(pBuf) + uFirst, pData, uActual - uFirst);
+
+    pRing->tail.store(uTail + uActual, std::memory_order_seq_cst);
+    if (pRing->writerWaiting.load(std::memory_order_seq_cst)) {
+        futexWake(&pRing->spaceSeq);
+    }
+    m_Status = SC_OK;
+    clear(rdstate() & ~std::ios::eofbit);
+    return uActual;
+}
+
+UINT ShmStream::read(std::string& str, int delimiter) {
+    char buf[2];
+    int ret = 0;
+    int sz;
+
+    str.clear();
+    while ((sz = read(buf, 1)) == 1) {
+        ++ret;
+        str.push_back(buf[0]);
+        if (buf[0] == delimiter) {
+            break;
+        }
+    }
+    return ret;
+}
+
+// Handle multiple character delimiter (i.e., \r\n)
+UINT ShmStream::read(std::string& str, const std::string& delimiter) {
+    int deliLen = delimiter.length();
+    if (deliLen == 0) return read(str, EOF);
+    if (deliLen == 1) return read(str, delimiter[0]);
+
+    char buf[2];
+    int ret = 0;
+    int sz;
+
+    str.clear();
+    while ((sz = read(buf, 1)) == 1) {
+        ret += sz;
+        str.push_back(buf[0]);
+        if (buf[0] == delimiter[0]) {
+            int di;
+            for (di = 1; di < deliLen; di++) {
+                sz = read(buf, 1);
+                if (sz <= 0) return ret;
+                ret += sz;
+                str.push_back(buf[0]);
+                if (buf[0] != delimiter[di]) break;
+            }
+            if (di == deliLen) return ret;
+        }
+    }
+    return ret;
+}
+
+// Abstract : Read exactly uCount bytes, waiting even in asynchronous mode
+//
+// Returns  : UINT (number of bytes read, less than uCount at end of file)
+//
+UINT ShmStream::readFully(void* pBuf, UINT uCount) {
+    bool bAsync = asyncMode_;
+    asyncMode_ = false;
+    UINT uTotal = 0;
+    while (uTotal < uCount) {
+        UINT uActual = read(static_cast<char*>(pBuf) + uTotal, uCount - uTotal);
+        if (uActual == 0) {
+            break;
+        }
+        uTotal += uActual;
+    }
+    asyncMode_ = bAsync;
+    return uTotal;
+}
+
+// Abstract : Send an IPC message
+//
+// Returns  : int (0)
+// Params   :
+//   pData                     Pointer to IPC structure (or sub-class)
+//   pCallback                 Unused; writes to the ring complete at once
+//
+// Post     : The sequence number of pData is set and the whole message is
+//            in the ring, or the failbit is set.
+//
+int ShmStream::remoteProcedure(IpcStruct* pData, Callback pCallback) {
+    (void) pCallback;
+    pData->dwSequence_ = ++sequence_;
+    write(pData, pData->wPacketSize_);
+    return 0;
+}
+
+// Abstract : Read an IPC message or reply from the stream
+//
+// Returns  : int (number of bytes read)
+// Params   :
+//   pData                     Pointer to IPC structure (or sub-class)
+//   uMaxLength                The maximum length that can be read into
+//                             the pData buffer.
+//
+// Pre      : The application must already have allocated the pData buffer.
+// Post     : pData holds the next message that fits.  Messages larger than
+//            the buffer are skipped.  0 is returned at end of file, or in
+//            asynchronous mode when no message is waiting.
+//
+// Remarks  : Once a header has arrived the rest of the message is waited
+//            for, since the writer puts it in the ring right behind.
+//
+int ShmStream::remoteReadData(IpcStruct* pData, UINT uMaxLength) {
+    UINT uLength = pData->wPacketSize_;
+    if (uMaxLength != 0 && uMaxLength < uLength) {
+        uLength = uMaxLength;
+    }
+    VERIFY(uLength >= sizeof(IpcStruct));
+
+    for (;;) {
+        if (asyncMode_ && region_ != nullptr
+            && in_->head.load(std::memory_order_acquire)
+               == in_->tail.load(std::memory_order_relaxed)) {
+            m_Status = SC_NODATA;
+            return 0;
+        }
+        if (readFully(pData, sizeof(IpcStruct)) != sizeof(IpcStruct)) {
+            return 0;
+        }
+        UINT uPacket = pData->wPacketSize_;
+        if (uPacket < sizeof(IpcStruct)) {
+            // Not a valid header; there is no way to resynchronize
+            m_Status = SC_FAILED;
+            setstate(std::ios::failbit);
+            return 0;
+        }
+        UINT uRest = uPacket - sizeof(IpcStruct);
+        if (uPacket <= uLength) {
+            if (readFully(pData + 1, uRest) != uRest) {
+                return 0;
+            }
+            return uPacket;
+        }
+        // Too large for the caller's buffer: skip it
+        char discard[512];
+        while (uRest > 0) {
+            UINT uActual = readFully(discard, std::min<UINT>(uRest, sizeof(discard)));
+            if (uActual == 0) {
+                return 0;
+            }
+            uRest -= uActual;
+        }
+    }
+}
+
+int ShmStream::remoteWriteReply(IpcReplyStruct* pData, DWORD dwSequence) {
+    // Fill-in the cookie, if caller specifies it separately
+    if (dwSequence) {
+        pData->dwSequence_ = dwSequence;
+    }
+    write(pData, pData->wPacketSize_);
+    return 0;
+}
+
+void ShmStream::setAsyncMode(const bool bMode) {
+    asyncMode_ = bMode;
+}
+
+// Abstract : Write data to the stream
+//
+// Params   :
+//   pBuf                      Data to write
+//   uCount                    Number of bytes
+//
+// Post     : All of the data is in the ring, or the failbit is set if the
+//            peer has closed the stream or the write was aborted.
+//
+// Remarks  : Data larger than the free space goes in as room is made by
+//            the reader.  Writes never complete asynchronously.
+//
+void ShmStream::write(const void* pBuf, UINT uCount) {
+    if (region_ == nullptr || region_->closed[1 - side_].load(std::memory_order_acquire)) {
+        m_Status = SC_FAILED;
+        setstate(std::ios::failbit);
+        return;
+    }
+    ShmRing* pRing = out_;
+    char* pData = reinterpret_cast<char*>(region_) + pRing->offset;
+    const char* pSrc = static_cast<const char*>(pBuf);
+    std::size_t uSize = pRing->mask + 1;
+    while (uCount > 0) {
+        uint64_t uHead = pRing->head.load(std::memory_order_relaxed);
+        uint64_t uFree = uSize - (uHead - pRing->tail.load(std::memory_order_acquire));
+        if (uFree == 0) {
+            if (!waitForSpace(pRing)) {
+                m_Status = SC_FAILED;
+                setstate(std::ios::failbit);
+                return;
+            }
+            continue;
+        }
+        UINT uChunk = static_cast<UINT>(std::min<uint64_t>(uFree, uCount));
+        std::size_t uPos = uHead & pRing->mask;
+        std::size_t uFirst = std::min<std::size_t>(uChunk, uSize - uPos);
+        std::memcpy(pData + uPos, pSrc, uFirst);
+        std::memcpy(pData, pSrc + uFirst, uChunk - uFirst);
+
+        pRing->head.store(uHead + uChunk, std::memory_order_seq_cst);
+        if (pRing->readerWaiting.load(std::memory_order_seq_cst)) {
+            futexWake(&pRing->dataSeq);
+        }
+        pSrc += uChunk;
+        uCount -= uChunk;
+    }
+    m_Status = SC_OK;
+    clear(rdstate() & ~std::ios::failbit);
+}
+
+void ShmStream::write(const std::string& str) {
+    write(str.c_str(), str.length());
+}
+
+ShmStream::operator const char* (void) const {
+    return name_.c_str();
+}
@@ -25,22 +25,34 @@
 //
 
 #include "config.h"
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <string>
+#include <vector>
 
 #ifdef WINDOWS
 #include <WinSock2.h>
 #include <WS2tcpip.h>
 #else
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #endif
+#if CONFIG_HAS_SENDFILE
+#include <sys/sendfile.h>
+#endif
+#include <sockstr/EventLoop.h>
 #include <sockstr/IPC.h>
 #include <sockstr/Socket.h>
 #include <sockstr/SocketState.h>
@@ -53,6 +65,9 @@ using namespace sockstr;
 #ifdef _WINDOWS
 #pragma warning(disable : 4244)  // Disable warning message for atoi()
 #endif
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
 
 //
 // FORWARD FUNCTION DECLARATIONS
@@ -100,20 +115,67 @@ Socket::~Socket() {
     close();	// Just in case connection is still open
 }
 
-Socket& Socket::operator=(const Socket& rSource) {
-//    Stream::operator=(rSource);
-    if (&rSource != this) {
-        m_hFile = rSource.m_hFile;
-        m_uOpenFlags = rSource.m_uOpenFlags;
-        m_bAsyncMode = rSource.m_bAsyncMode;
+// Abstract : Move a Socket object
+//
+// Params   :
+//   rSource                   Socket whose connection is taken over
+//
+// Post     : This object owns the connection, its state, open modes,
+//            timeouts and compressor.  rSource is left closed and can be
+//            re-opened.
+//
+// Remarks  : A socket must not be moved while it has worker threads or
+//            suspended awaitable operations; they refer to the old object.
+//            The idle timer is restarted on the new object.
+//
+Socket::Socket(Socket&& rSource) noexcept
+    : Stream(std::move(rSource)) {
+    m_IdleTimer.setCallback(&Socket::idleExpired, this);
+    takeOver(rSource);
+}
 
-        m_pState = rSource.m_pState;
-        m_Status = rSource.m_Status;
-        m_PeerAddr = rSource.m_PeerAddr;
+Socket& Socket::operator=(Socket&& rSource) noexcept {
+    if (&rSource != this) {
+        close();
+        Stream::operator=(std::move(rSource));
+        takeOver(rSource);
     }
     return *this;
 }
 
+void Socket::takeOver(Socket& rSource) {
+    m_PeerAddr = rSource.m_PeerAddr;
+    m_uOpenFlags = rSource.m_uOpenFlags;
+    m_bAsyncMode = rSource.m_bAsyncMode;
+    m_nProtocol = rSource.m_nProtocol;
+    m_nFamily = rSource.m_nFamily;
+#if USE_OPENSSL
+    m_pSsl = rSource.m_pSsl;
+    m_pSslCtx = rSource.m_pSslCtx;
+    rSource.m_pSsl = nullptr;
+    rSource.m_pSslCtx = nullptr;
+#endif
+    m_multicastGroup = rSource.m_multicastGroup;
+    m_interface = std::move(rSource.m_interface);
+    std::copy(rSource.m_uTimeouts, rSource.m_uTimeouts + numTimeouts, m_uTimeouts);
+    m_uIdleTimeout = rSource.m_uIdleTimeout;
+    m_FrameReader = std::move(rSource.m_FrameReader);
+    m_pCompressor = std::move(rSource.m_pCompressor);
+    m_pCapture = rSource.m_pCapture;
+    m_uCaptureSession = rSource.m_uCaptureSession;
+    m_alpn = std::move(rSource.m_alpn);
+    m_alpnSelected = std::move(rSource.m_alpnSelected);
+    m_pState = rSource.m_pState;
+
+    // The handle now belongs to this object (Stream moved it)
+    rSource.m_IdleTimer.cancel();
+    rSource.m_FrameReader.reset();
+    rSource.m_uCaptureSession = 0;
+    memset(&rSource.m_multicastGroup, 0, sizeof(rSource.m_multicastGroup));
+    rSource.m_pState = SSClosed::instance();
+    touch();
+}
+
 
 // Abstract : Perform common initialization for Socket object.
 //
@@ -137,6 +199,11 @@ void Socket::initialize() {
     // Set initial state to Closed
     m_pState = SSClosed::instance();
     memset(&m_multicastGroup, 0, sizeof(m_multicastGroup));
+#if USE_OPENSSL
+    m_pSsl = nullptr;
+    m_pSslCtx = nullptr;
+#endif
+    m_IdleTimer.setCallback(&Socket::idleExpired, this);
 }
 
 
@@ -157,6 +224,137 @@ void Socket::setAsyncMode(const bool bMode) {
     m_bAsyncMode = bMode;
 }
 
+
+// Abstract : Set the timeout of an operation
+//
+// Params   :
+//   eKind                     Operation that the timeout applies to
+//   uMillisec                 Timeout in milliseconds, or 0 for none
+//
+// Post     : Subsequent operations of that kind, blocking or awaitable,
+//            fail with status SC_TIMEOUT when the peer does not respond
+//            in time.
+//
+void Socket::setTimeout(TimeoutKind eKind, UINT uMillisec) {
+    VERIFY(eKind < numTimeouts);
+    m_uTimeouts[eKind] = uMillisec;
+}
+
+UINT Socket::getTimeout(TimeoutKind eKind) const {
+    VERIFY(eKind < numTimeouts);
+    return m_uTimeouts[eKind];
+}
+
+// Abstract : Set the idle timeout of the connection
+//
+// Params   :
+//   uMillisec                 Idle time in milliseconds, or 0 to disable
+//
+// Post     : If an EventLoop is current the idle timer is (re)started.
+//
+// Remarks  : The idle timer lives on the timer wheel of the current loop,
+//            so arming it costs the same for one connection as for 100k.
+//
+void Socket::setIdleTimeout(UINT uMillisec) {
+    m_uIdleTimeout = uMillisec;
+    if (uMillisec == 0) {
+        m_IdleTimer.cancel();
+    } else {
+        touch();
+    }
+}
+
+void Socket::setCompressor(std::unique_ptr<IpcCompressor> pCompressor) {
+    m_pCompressor = std::move(pCompressor);
+}
+
+// Abstract : Set the protocols to offer with ALPN
+//
+// Remarks  : They are kept as the TLS library takes them: each name
+//            preceded by its length.
+//
+void Socket::setAlpn(std::string_view protocols) {
+    m_alpn.clear();
+    std::size_t pos = 0;
+    while (pos < protocols.size()) {
+        std::size_t end = std::min(protocols.find(',', pos), protocols.size());
+        std::string_view name = protocols.substr(pos, end - pos);
+        if (!name.empty() && name.size() < 256) {
+            m_alpn += char(name.size());
+            m_alpn += name;
+        }
+        pos = end + 1;
+    }
+}
+
+void Socket::setCapture(SessionCapture* pCapture) {
+    if (m_pCapture != nullptr && m_uCaptureSession != 0) {
+        m_pCapture->closeSession(m_uCaptureSession);
+    }
+    m_pCapture = pCapture;
+    m_uCaptureSession = 0;
+}
+
+// Abstract : Start the capture session of the connection
+//
+// Pre      : A capture is set.
+// Post     : m_uCaptureSession is the new session, described by the
+//            protocol, the side of the connection and the numeric address
+//            of the peer.
+//
+void Socket::startCapture() {
+    char szPeer[NI_MAXHOST + NI_MAXSERV + 4] = "";
+    char szHost[NI_MAXHOST];
+    char szPort[NI_MAXSERV];
+    const sockaddr* sa = nullptr;
+    socklen_t slen = 0;
+    if (std::holds_alternative<sockaddr_in>(m_PeerAddr)) {
+        sa = (const sockaddr*) &std::get<sockaddr_in>(m_PeerAddr);
+        slen = sizeof(sockaddr_in);
+    } else if (std::holds_alternative<sockaddr_in6>(m_PeerAddr)) {
+        sa = (const sockaddr*) &std::get<sockaddr_in6>(m_PeerAddr);
+        slen = sizeof(sockaddr_in6);
+    } else if (std::holds_alternative<sockaddr_un>(m_PeerAddr)) {
+        snprintf(szPeer, sizeof(szPeer), "%s",
+                 SocketAddr::unixAddrName(std::get<sockaddr_un>(m_PeerAddr)).c_str());
+    }
+    if (sa != nullptr && ::getnameinfo(sa, slen, szHost, sizeof(szHost), szPort, sizeof(szPort),
+                                       NI_NUMERICHOST | NI_NUMERICSERV) == 0) {
+        snprintf(szPeer, sizeof(szPeer), (sa->sa_family == AF_INET6) ? "[%s]:%s" : "%s:%s",
+                 szHost, szPort);
+    }
+    m_uCaptureSession = m_pCapture->openSession(m_nProtocol, (m_uOpenFlags & modeCreate) != 0,
+                                                szPeer);
+}
+
+void Socket::recordCapture(CaptureKind eKind, const void* pData, UINT uCount) {
+    if (m_uCaptureSession == 0) {
+        startCapture();
+    }
+    m_pCapture->record(m_uCaptureSession, eKind, pData, uCount);
+}
+
+void Socket::touch() {
+    if (m_uIdleTimeout != 0 && m_hFile != INVALID_SOCKET) {
+        if (EventLoop* pLoop = EventLoop::current()) {
+            pLoop->timers().arm(m_IdleTimer, m_uIdleTimeout);
+        }
+    }
+}
+
+// Abstract : Idle timer callback
+//
+// Post     : The connection is shut down in both directions.  The handle
+//            stays open so that the coroutine owning the socket observes
+//            end of file and closes it in the normal way.
+//
+void Socket::idleExpired(Timer* /*pTimer*/, void* ptr) {
+    Socket* pSocket = static_cast<Socket*>(ptr);
+    if (pSocket->m_hFile != INVALID_SOCKET) {
+        ::shutdown(pSocket->m_hFile, SHUT_RDWR);
+    }
+}
+
 Socket::operator SOCKET (void) const {
     return m_hFile;
 }
@@ -177,7 +375,8 @@ int Socket::remoteProcedure(IpcStruct* pData, Callback pCallback) {
         pOldCallback = (Callback) registerCallback(pCallback);
     }
 
-    write(pData, pData->wPacketSize_);
+    const IpcStruct* pSend = m_pCompressor ? m_pCompressor->compress(pData) : pData;
+    write(pSend, pSend->wPacketSize_);
 
     if (pCallback) {
         registerCallback(pOldCallback);
@@ -204,76 +403,58 @@ int Socket::remoteProcedure(IpcStruct* pData, Callback pCallback) {
 //            check the member variables in the IpcStruct header to
 //            find out if the buffer contains an expected IPC packet.
 //
-// Remarks  : The application should not attempt to modify or free the
-//            buffer pointed to by pData until this routine completes.
-//            For a asynchronous call, completion means when the callback
-//            routine is called.
-//
-//            This routine has no way of knowing which IPC message or reply
-//            has been sent and therefore doesn't know how much to read.
-//            It is possible that 2 messages are in the buffer and a
-//            single read here would concatenate them into one buffer (which
-//            is not what we want).  Thus, this routine first reads only the
-//            header which contains the packet length.  Then the rest of the
-//            packet is appended with a second read.
+// Remarks  : Messages are taken from the read-ahead buffer of
+//            remoteReadFrame().  A message that does not fit in pData is
+//            skipped as a whole, so the one after it is still found.
 //
 int Socket::remoteReadData(IpcStruct* pData, UINT uMaxLength) {
-    // Warning: This routine does not work in overlapped I/O mode.  The
-    //          next statement (temporarily) goes to polling mode.
-    Callback pOldCallback = registerCallback();
     UINT uLength = pData->wPacketSize_;
     if (uMaxLength != 0 && uMaxLength < uLength) {
         uLength = uMaxLength;
     }
     VERIFY(uLength >= sizeof(IpcStruct));
 
-    bool bValidIPC = false;
-    UINT uActual;
-    while (! bValidIPC) {
-        // Read in just the header
-        uActual = read(pData, sizeof(IpcStruct));
-        if (uActual == 0) {		// No data, so just return.
-            registerCallback(pOldCallback);
+    for (;;) {
+        const IpcStruct* pFrame = remoteReadFrame();
+        if (pFrame == nullptr) {
             return 0;
         }
-#ifdef _DEBUG 
-        VERIFY(uActual == sizeof(IpcStruct));
-        // OK, got the header.  Now read the rest of the packet.
-        VERIFY(uLength >= pData->m_wPacketSize);
-#else
-        if (uActual != sizeof(IpcStruct)) {
-            continue;
-        }
-        if (uLength < pData->wPacketSize_) {
-            // flush buffer
-            DWORD dwBytes;
-            if (IOCTLSOCK(m_hFile, FIONREAD, &dwBytes) == SOCKET_ERROR) {
-                registerCallback(pOldCallback);
-                return 0;
-            }
-            if (dwBytes) {
-                char * pDiscardBuf = new char[dwBytes];
-                read(pDiscardBuf, dwBytes);
-                delete [] pDiscardBuf;
-            }
-            continue;
-        }
-#endif
-        uLength = pData->wPacketSize_ - uActual;
-        uActual = read((char *)pData + uActual, uLength);
-#ifdef _DEBUG
-        VERIFY(uActual == uLength);
-#else
-        if (uActual == uLength)
-#endif
-        {
-            bValidIPC = true;	// Finally, declare packet as valid
+        if (pFrame->wPacketSize_ <= uLength) {
+            memcpy(pData, pFrame, pFrame->wPacketSize_);
+            return pFrame->wPacketSize_;
         }
     }
+}
 
-    // Reset the user's callback to what it was
+// Abstract : Read an IPC message or reply in place
+//
+// Returns  : const IpcStruct* (nullptr if none)
+//
+// Post     : The message is consumed from the socket's read-ahead buffer.
+//            Messages larger than IpcFrameReader::defaultMaxFrame are
+//            skipped.  With a compressor, a compressed message is returned
+//            expanded; one that cannot be expanded fails the socket.
+//
+// Remarks  : Reading goes to polling mode while the message is assembled,
+//            as the callback of an asynchronous read could not return it.
+//            Do not mix with raw reads of the same socket, which would
+//            miss the data already read ahead.
+//
+const IpcStruct* Socket::remoteReadFrame() {
+    Callback pOldCallback = registerCallback();
+    const IpcStruct* pFrame = m_FrameReader.read(*this);
     registerCallback(pOldCallback);
-    return uActual + sizeof(IpcStruct);
+    if (pFrame != nullptr && m_pCompressor) {
+        pFrame = m_pCompressor->expand(pFrame);
+        if (pFrame == nullptr) {
+            m_Status = SC_FAILED;
+            setstate(std::ios::failbit);
+        }
+    } else if (pFrame == nullptr && m_FrameReader.error()) {
+        m_Status = SC_FAILED;
+        setstate(std::ios::failbit);
+    }
+    return pFrame;
 }
 
 
@@ -302,7 +483,8 @@ Socket::remoteWriteReply(IpcReplyStruct* pData, DWORD dwSequence)
 		pData->dwSequence_ = dwSequence;
 	}
 
-	write(pData, pData->wPacketSize_);
+	const IpcStruct* pSend = m_pCompressor ? m_pCompressor->compress(pData) : pData;
+	write(pSend, pSend->wPacketSize_);
 
 	return 0;
 }
@@ -345,8 +527,17 @@ void
 Socket::close()
 {
   if (m_hFile != INVALID_SOCKET) {
+    if (EventLoop* pLoop = EventLoop::current()) {
+        pLoop->forget(m_hFile);
+    }
+    m_IdleTimer.cancel();
     m_pState->close(this);
     m_hFile = INVALID_SOCKET;
+    m_FrameReader.reset();
+    if (m_uCaptureSession != 0) {
+        m_pCapture->closeSession(m_uCaptureSession);
+        m_uCaptureSession = 0;
+    }
   }
 }
 
@@ -394,36 +585,84 @@ Stream * Socket::listen(const int nBacklog) {
     return listenIntern(pClient, nBacklog);
 }
 
+// Abstract : Accept an incoming connection into an existing Socket object
+//
+// Returns  : true if rClient is connected to a new client
+// Params   :
+//   rClient                   Socket object that receives the connection
+//
+// Pre      : This socket is a listening server socket.
+// Post     : rClient is closed if it was open, then connected to the next
+//            incoming client.  Nothing is allocated.
+//
+bool Socket::accept(Socket& rClient) {
+    rClient.close();
+    return attachClient(&rClient, m_pState->listen(this, 0));
+}
+
 Stream * Socket::listenIntern(Socket* pClient, const int nBacklog) {
     SOCKET ClientSocket = m_pState->listen(this, nBacklog);
 
-    pClient->m_hFile = ClientSocket;
-    pClient->m_uOpenFlags = m_uOpenFlags;
-    pClient->m_bAsyncMode = m_bAsyncMode;
-
-    if (ClientSocket == INVALID_SOCKET) {
-        //pClient->m_pState = SSClosed::instance();
-        //pClient->m_Status  = SC_FAILED;
+    if (!attachClient(pClient, ClientSocket)) {
         delete pClient;
         pClient = nullptr;
-    } else {
-        pClient->m_pState = SSConnected::instance();
-
-        // Only AFTER the listen do we know who's calling
-        socklen_t iSizeAddr = sizeof(sockaddr);
-        sockaddr sa;
-        auto ret = ::getpeername(ClientSocket, &sa, &iSizeAddr);
-        if (!ret) {
-            if (iSizeAddr == sizeof(sockaddr_in)) {
-                pClient->m_PeerAddr = *(sockaddr_in*)&sa;
-            } else {
-                pClient->m_PeerAddr = *(sockaddr_in6*)&sa;
-            }
-        }
     }
     return pClient;
 }
 
+// Abstract : Connect a client Socket object to an accepted socket handle
+//
+// Returns  : true if pClient is now connected
+// Params   :
+//   pClient                   Socket object that takes over the connection
+//   hClient                   Handle returned by accept
+//
+// Post     : The client inherits the open modes of this server socket and
+//            is put in the connected state.  The peer address is filled in.
+//
+bool Socket::attachClient(Socket* pClient, SOCKET hClient) {
+    pClient->m_hFile = hClient;
+    pClient->m_uOpenFlags = m_uOpenFlags;
+    pClient->m_bAsyncMode = m_bAsyncMode;
+    pClient->m_nProtocol = m_nProtocol;
+    pClient->m_nFamily = m_nFamily;
+    std::copy(m_uTimeouts, m_uTimeouts + numTimeouts, pClient->m_uTimeouts);
+    pClient->m_uIdleTimeout = m_uIdleTimeout;
+    pClient->m_pCapture = m_pCapture;
+    pClient->m_uCaptureSession = 0;
+
+    if (hClient == INVALID_SOCKET) {
+        return false;
+    }
+    pClient->m_pState = SSConnected::instance();
+    pClient->m_Status = SC_OK;
+    pClient->clear();
+    // A recycled object must not hand out data of its previous connection
+    pClient->strbuf.reset();
+    pClient->m_FrameReader.reset();
+
+    // Only AFTER the listen do we know who's calling
+    sockaddr_storage sa;
+    socklen_t iSizeAddr = sizeof(sa);
+    auto ret = ::getpeername(hClient, (sockaddr *) &sa, &iSizeAddr);
+    if (!ret) {
+        if (sa.ss_family == AF_INET) {
+            pClient->m_PeerAddr = *(sockaddr_in*)&sa;
+        } else if (sa.ss_family == AF_UNIX) {
+            sockaddr_un sun;
+            memset(&sun, 0, sizeof(sun));
+            memcpy(&sun, &sa, std::min<size_t>(iSizeAddr, sizeof(sun)));
+            pClient->m_PeerAddr = sun;
+        } else {
+            pClient->m_PeerAddr = *(sockaddr_in6*)&sa;
+        }
+    }
+    if (m_pCapture != nullptr) {
+        pClient->startCapture();
+    }
+    return true;
+}
+
 
 // Abstract : Opens a socket connection for the Socket object
 //            (state-dependent)
@@ -463,6 +702,18 @@ Socket::open(const char* lpszFileName, UINT uOpenFlags) {
     std::string Name;
     std::string Host;
 
+    if (lpszFileName != 0 && strncmp(lpszFileName, "unix", 4) == 0) {
+        // Unix domain socket: "unix:/path" (stream) or "unixdg:/path"
+        // (datagram).  There is no port number to parse.
+        bool bDatagram = strncmp(lpszFileName, "unixdg:", 7) == 0;
+        if (bDatagram || strncmp(lpszFileName, SocketAddr::unixPrefix, 5) == 0) {
+            std::string Path(SocketAddr::unixPrefix);
+            Path += strchr(lpszFileName, ':') + 1;
+            SocketAddr SockAddr(Path, 0, bDatagram ? "udp" : "tcp");
+            return open(SockAddr, uOpenFlags);
+        }
+    }
+
     if (lpszFileName != 0 && strlen(lpszFileName) != 0) {
         // Parse the file name into a socket address object.  Then
         // call the common state-dependent Open().
@@ -557,6 +808,8 @@ bool Socket::open(SocketAddr& rSockAddr, UINT uOpenFlags) {
     }
     if (std::holds_alternative<sockaddr_in>(na)) {
         m_nFamily = AF_INET;
+    } else if (std::holds_alternative<sockaddr_un>(na)) {
+        m_nFamily = AF_UNIX;
     } else {
         m_nFamily = AF_INET6;
     }
@@ -715,6 +968,161 @@ void Socket::write(const std::string& str) {
     m_pState->write(this, str.c_str(), str.size());
 }
 
+// Size of the pieces a file is copied in when it cannot be sent directly
+static const std::size_t FILE_PIECE = 65536;
+
+bool Socket::canSendFile() const {
+#if CONFIG_HAS_SENDFILE
+    return canWriteDirect();
+#else
+    return false;
+#endif
+}
+
+bool Socket::canWriteDirect() const {
+#ifdef TARGET_WINDOWS
+    return false;
+#else
+#if USE_OPENSSL
+    if (m_pSsl != nullptr) {
+        return false;
+    }
+#endif
+    // A capture needs to see the bytes
+    return m_pCapture == nullptr && m_nProtocol == SOCK_STREAM;
+#endif
+}
+
+// Drop the first uSent bytes from an array of buffers
+static void consumeVector(struct iovec*& pVec, int& nCount, std::size_t uSent) {
+    while (nCount > 0 && uSent >= pVec->iov_len) {
+        uSent -= pVec->iov_len;
+        ++pVec;
+        --nCount;
+    }
+    if (nCount > 0) {
+        pVec->iov_base = static_cast<char*>(pVec->iov_base) + uSent;
+        pVec->iov_len -= uSent;
+    }
+}
+
+// Abstract : Write part of an open file to the socket
+//
+// Returns  : True if all uCount bytes were sent
+// Params   :
+//   fd                        Descriptor of the file
+//   uOffset                   Offset of the first byte
+//   uCount                    Number of bytes
+//
+// Remarks  : The file offset of fd is not used or changed, so several
+//            connections can send the same descriptor at once.
+//            sendfile() may be interrupted or, on a socket in
+//            asynchronous mode, stop short; it is then called again for
+//            the rest.
+//
+bool Socket::sendFile(int fd, uint64_t uOffset, uint64_t uCount) {
+    if (!canSendFile()) {
+        std::vector<char> piece(std::min<uint64_t>(uCount, FILE_PIECE));
+        while (uCount > 0) {
+            ssize_t iRead = ::pread(fd, piece.data(), std::min<uint64_t>(uCount, piece.size()), uOffset);
+            if (iRead <= 0) {
+                if (iRead < 0 && errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            write(piece.data(), (UINT) iRead);
+            if (m_Status != SC_OK) {
+                return false;
+            }
+            uOffset += iRead;
+            uCount -= iRead;
+        }
+        return true;
+    }
+
+#if CONFIG_HAS_SENDFILE
+    while (uCount > 0) {
+        off_t offset = uOffset;
+        ssize_t iSent = ::sendfile(m_hFile, fd, &offset, std::min<uint64_t>(uCount, 1 << 30));
+        if (iSent > 0) {
+            uOffset += iSent;
+            uCount -= iSent;
+        } else if (iSent < 0 && errno == EINTR) {
+            continue;
+        } else if (iSent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            pollfd pfd = { m_hFile, POLLOUT, 0 };
+            int nTimeout = m_uTimeouts[timeoutWrite] ? (int) m_uTimeouts[timeoutWrite] : -1;
+            if (::poll(&pfd, 1, nTimeout) <= 0) {
+                timedOut();
+                return false;
+            }
+        } else {
+            // An error, or the file is shorter than it was said to be
+            m_Status = SC_FAILED;
+            setstate(std::ios::failbit);
+            return false;
+        }
+    }
+    m_Status = SC_OK;
+#endif
+    return true;
+}
+
+// Abstract : Write several buffers to the socket
+//
+// Returns  : True if all the bytes were written
+// Params   :
+//   pVec                      Buffers, advanced past what is written
+//   nCount                    Number of buffers
+//
+// Remarks  : Gathering the pieces of a message in one call saves copying
+//            them together and the extra packets of separate writes.
+//            sendmsg() is used rather than writev() for MSG_NOSIGNAL.
+//
+bool Socket::writev(struct iovec* pVec, int nCount) {
+    if (!canWriteDirect()) {
+        for (int idx = 0; idx < nCount; idx++) {
+            if (pVec[idx].iov_len > 0) {
+                write(pVec[idx].iov_base, (UINT) pVec[idx].iov_len);
+                if (m_Status != SC_OK) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+#ifndef TARGET_WINDOWS
+    consumeVector(pVec, nCount, 0);
+    while (nCount > 0) {
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = pVec;
+        msg.msg_iovlen = std::min(nCount, IOV_MAX);
+        ssize_t iSent = ::sendmsg(m_hFile, &msg, MSG_NOSIGNAL);
+        if (iSent >= 0) {
+            consumeVector(pVec, nCount, iSent);
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            pollfd pfd = { m_hFile, POLLOUT, 0 };
+            int nTimeout = m_uTimeouts[timeoutWrite] ? (int) m_uTimeouts[timeoutWrite] : -1;
+            if (::poll(&pfd, 1, nTimeout) <= 0) {
+                timedOut();
+                return false;
+            }
+        } else {
+            m_Status = SC_FAILED;
+            setstate(std::ios::failbit);
+            return false;
+        }
+    }
+    m_Status = SC_OK;
+#endif
+    return true;
+}
+
 
 // Abstract : Returns a static, textual representation of an address
 //
@@ -751,6 +1159,10 @@ Socket::operator const char* () const {
         slen = sizeof(sockaddr_in6);
         portNum = sa6->sin6_port;
         sa = (const sockaddr*)sa6;
+    } else if (std::holds_alternative<sockaddr_un>(m_PeerAddr)) {
+        snprintf(szHostName, sizeof(szHostName), "%s",
+                 SocketAddr::unixAddrName(std::get<sockaddr_un>(m_PeerAddr)).c_str());
+        return szHostName;
     }
     if (sa != nullptr && ::getnameinfo(sa, slen, tmpName,
                                        sizeof(tmpName), 0, 0, 0) == 0) {
@@ -770,6 +1182,313 @@ Socket::operator const char* () const {
 }
 
 
+///////////////////////////////////////////////////////////
+//   AWAITABLE FUNCTIONS FOLLOW BELOW :
+///////////////////////////////////////////////////////////
+
+// Remarks  : The awaitable functions bypass the state machine and talk to
+//            the socket handle directly.  Each one first attempts the
+//            operation without blocking and only suspends on the current
+//            EventLoop when the operation would block, so a busy
+//            connection never waits for the loop.
+//
+//            Deadlines are absolute so that an operation which has to wait
+//            several times still completes within its timeout.
+//
+static bool wouldBlock() {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS;
+}
+
+// Deadline of an operation that starts now, 0 if it has no timeout
+static uint64_t deadline(UINT uTimeoutMs) {
+    return uTimeoutMs ? TimerWheel::monotonicMs() + uTimeoutMs : 0;
+}
+
+// Milliseconds that remain until uDeadline, 0 if there is no deadline
+static UINT timeLeft(uint64_t uDeadline) {
+    if (uDeadline == 0) {
+        return 0;
+    }
+    uint64_t uNow = TimerWheel::monotonicMs();
+    return (uDeadline > uNow) ? (UINT) (uDeadline - uNow) : 1;
+}
+
+void Socket::timedOut() {
+    m_Status = SC_TIMEOUT;
+    setstate(std::ios::failbit);
+    errno = ETIMEDOUT;
+}
+
+Task<int> Socket::async_read(void* pBuf, UINT uCount) {
+    EventLoop* pLoop = EventLoop::current();
+    VERIFY(pLoop != nullptr);
+    uint64_t uDeadline = deadline(m_uTimeouts[timeoutRead]);
+    for (;;) {
+        int iResult = ::recv(m_hFile, (char *)pBuf, uCount, MSG_DONTWAIT);
+        if (iResult > 0) {
+            m_Status = SC_OK;
+            clear(rdstate() & ~std::ios::eofbit);
+            captureData(captureReceived, pBuf, iResult);
+            touch();
+            co_return iResult;
+        }
+        if (iResult == 0) {
+            m_Status = SC_NODATA;
+            setstate(std::ios::eofbit);
+            co_return 0;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (!wouldBlock()) {
+            m_Status = SC_FAILED;
+            setstate(std::ios::badbit);
+            co_return SOCKET_ERROR;
+        }
+        if (!co_await pLoop->readable(m_hFile, timeLeft(uDeadline))) {
+            timedOut();
+            co_return SOCKET_ERROR;
+        }
+    }
+}
+
+Task<int> Socket::async_write(const void* pBuf, UINT uCount) {
+    EventLoop* pLoop = EventLoop::current();
+    VERIFY(pLoop != nullptr);
+    const char* pData = (const char *)pBuf;
+    UINT uSent = 0;
+    uint64_t uDeadline = deadline(m_uTimeouts[timeoutWrite]);
+    while (uSent < uCount) {
+        int iResult = ::send(m_hFile, pData + uSent, uCount - uSent,
+                             MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (iResult >= 0) {
+            captureData(captureSent, pData + uSent, iResult);
+            uSent += iResult;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (wouldBlock()) {
+            if (!co_await pLoop->writable(m_hFile, timeLeft(uDeadline))) {
+                timedOut();
+                co_return SOCKET_ERROR;
+            }
+        } else {
+            m_Status = SC_FAILED;
+            setstate(std::ios::failbit);
+            co_return SOCKET_ERROR;
+        }
+    }
+    touch();
+    co_return (int) uSent;
+}
+
+// Remarks  : sendfile() has no flag like MSG_DONTWAIT, so the socket is
+//            made non-blocking for the duration of the call.
+//
+Task<bool> Socket::async_sendFile(int fd, uint64_t uOffset, uint64_t uCount) {
+    EventLoop* pLoop = EventLoop::current();
+    VERIFY(pLoop != nullptr);
+    if (!canSendFile()) {
+        std::vector<char> piece(std::min<uint64_t>(uCount, FILE_PIECE));
+        while (uCount > 0) {
+            ssize_t iRead = ::pread(fd, piece.data(), std::min<uint64_t>(uCount, piece.size()), uOffset);
+            if (iRead <= 0) {
+                if (iRead < 0 && errno == EINTR) {
+                    continue;
+                }
+                co_return false;
+            }
+            if (co_await async_write(piece.data(), (UINT) iRead) != iRead) {
+                co_return false;
+            }
+            uOffset += iRead;
+            uCount -= iRead;
+        }
+        co_return true;
+    }
+
+    bool bOk = true;
+#if CONFIG_HAS_SENDFILE
+    int nFlags = ::fcntl(m_hFile, F_GETFL, 0);
+    if (!(nFlags & O_NONBLOCK)) {
+        ::fcntl(m_hFile, F_SETFL, nFlags | O_NONBLOCK);
+    }
+    uint64_t uDeadline = deadline(m_uTimeouts[timeoutWrite]);
+    while (uCount > 0) {
+        off_t offset = uOffset;
+        ssize_t iSent = ::sendfile(m_hFile, fd, &offset, std::min<uint64_t>(uCount, 1 << 30));
+        if (iSent > 0) {
+            uOffset += iSent;
+            uCount -= iSent;
+        } else if (iSent < 0 && errno == EINTR) {
+            continue;
+        } else if (iSent < 0 && wouldBlock()) {
+            if (!co_await pLoop->writable(m_hFile, timeLeft(uDeadline))) {
+                timedOut();
+                bOk = false;
+                break;
+            }
+        } else {
+            m_Status = SC_FAILED;
+            setstate(std::ios::failbit);
+            bOk = false;
+            break;
+        }
+    }
+    if (!(nFlags & O_NONBLOCK) && m_hFile != INVALID_SOCKET) {
+        ::fcntl(m_hFile, F_SETFL, nFlags);
+    }
+    if (bOk) {
+        touch();
+    }
+#endif
+    co_return bOk;
+}
+
+Task<bool> Socket::async_writev(struct iovec* pVec, int nCount) {
+    EventLoop* pLoop = EventLoop::current();
+    VERIFY(pLoop != nullptr);
+    if (!canWriteDirect()) {
+        for (int idx = 0; idx < nCount; idx++) {
+            int iLength = (int) pVec[idx].iov_len;
+            if (iLength > 0
+                && co_await async_write(pVec[idx].iov_base, (UINT) iLength) != iLength) {
+                co_return false;
+            }
+        }
+        co_return true;
+    }
+
+#ifndef TARGET_WINDOWS
+    uint64_t uDeadline = deadline(m_uTimeouts[timeoutWrite]);
+    consumeVector(pVec, nCount, 0);
+    while (nCount > 0) {
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = pVec;
+        msg.msg_iovlen = std::min(nCount, IOV_MAX);
+        ssize_t iSent = ::sendmsg(m_hFile, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (iSent >= 0) {
+            consumeVector(pVec, nCount, iSent);
+        } else if (errno == EINTR) {
+            continue;
+        } else if (wouldBlock()) {
+            if (!co_await pLoop->writable(m_hFile, timeLeft(uDeadline))) {
+                timedOut();
+                co_return false;
+            }
+        } else {
+            m_Status = SC_FAILED;
+            setstate(std::ios::failbit);
+            co_return false;
+        }
+    }
+    touch();
+#endif
+    co_return true;
+}
+
+Task<bool> Socket::async_accept(Socket& rClient) {
+    EventLoop* pLoop = EventLoop::current();
+    VERIFY(pLoop != nullptr);
+    VERIFY(m_pState == SSListening::instance());
+
+    // Only accept() is affected by the non-blocking flag on a server socket
+    int nFlags = ::fcntl(m_hFile, F_GETFL, 0);
+    if (!(nFlags & O_NONBLOCK)) {
+        ::fcntl(m_hFile, F_SETFL, nFlags | O_NONBLOCK);
+    }
+    rClient.close();
+    uint64_t uDeadline = deadline(m_uTimeouts[timeoutAccept]);
+    for (;;) {
+        SOCKET hClient = ::accept(m_hFile, nullptr, nullptr);
+        if (hClient != INVALID_SOCKET) {
+            // Accepted sockets do not inherit O_NONBLOCK on Linux, but they do on BSD
+            int nClientFlags = ::fcntl(hClient, F_GETFL, 0);
+            if (nClientFlags & O_NONBLOCK) {
+                ::fcntl(hClient, F_SETFL, nClientFlags & ~O_NONBLOCK);
+            }
+            bool bAttached = attachClient(&rClient, hClient);
+            if (bAttached) {
+                rClient.touch();
+            }
+            co_return bAttached;
+        }
+        if (errno == EINTR || errno == ECONNABORTED) {
+            continue;
+        }
+        if (!wouldBlock()) {
+            co_return false;
+        }
+        if (!co_await pLoop->readable(m_hFile, timeLeft(uDeadline))) {
+            timedOut();
+            co_return false;
+        }
+    }
+}
+
+Task<bool> Socket::async_connect(SocketAddr& rSockAddr, UINT uOpenFlags) {
+    EventLoop* pLoop = EventLoop::current();
+    VERIFY(pLoop != nullptr);
+
+    close();
+    initialize();
+    m_nProtocol = (rSockAddr.protocol() == "udp") ? SOCK_DGRAM : SOCK_STREAM;
+    m_uOpenFlags = uOpenFlags & ~modeAsyncSocket;
+    m_bAsyncMode = (uOpenFlags & modeAsyncSocket) ? true : false;
+    m_Status = SC_FAILED;
+
+    sockaddr_storage sa;
+    socklen_t len;
+    if (!rSockAddr.getSockAddr(sa, len)) {
+        co_return false;
+    }
+    m_nFamily = sa.ss_family;
+    m_hFile = ::socket(m_nFamily, m_nProtocol, 0);
+    if (m_hFile == INVALID_SOCKET) {
+        co_return false;
+    }
+    int nFlags = ::fcntl(m_hFile, F_GETFL, 0);
+    ::fcntl(m_hFile, F_SETFL, nFlags | O_NONBLOCK);
+
+    int iResult = ::connect(m_hFile, (const sockaddr*)&sa, len);
+    bool bTimedOut = false;
+    if (iResult == SOCKET_ERROR && wouldBlock()) {
+        if (co_await pLoop->writable(m_hFile, m_uTimeouts[timeoutConnect])) {
+            int nError = 0;
+            socklen_t nErrorLen = sizeof(nError);
+            ::getsockopt(m_hFile, SOL_SOCKET, SO_ERROR, &nError, &nErrorLen);
+            iResult = (nError == 0) ? 0 : SOCKET_ERROR;
+        } else {
+            bTimedOut = true;
+        }
+    }
+    if (iResult == SOCKET_ERROR) {
+        pLoop->forget(m_hFile);
+        ::close(m_hFile);
+        m_hFile = INVALID_SOCKET;
+        setstate(std::ios::failbit);
+        if (bTimedOut) {
+            timedOut();
+        }
+        co_return false;
+    }
+
+    // Back to blocking mode so that the synchronous functions keep working
+    ::fcntl(m_hFile, F_SETFL, nFlags);
+    if (m_nProtocol == SOCK_STREAM) {
+        int bSockOpt = 1;
+        ::setsockopt(m_hFile, SOL_SOCKET, SO_KEEPALIVE,
+                     (char *)&bSockOpt, sizeof(bSockOpt));
+    }
+    m_PeerAddr = rSockAddr.netAddress();
+    m_pState = SSConnected::instance();
+    m_Status = SC_OK;
+    clear();
+    touch();
+    co_return true;
+}
+
+
 // Abstract : Goes to the next specified state.
 //
 // Returns  : -
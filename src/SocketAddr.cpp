@@ -39,6 +39,7 @@
 #include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <cstddef>
 #include <cstring>
 #include <unistd.h>
 
@@ -151,6 +152,10 @@ bool SocketAddr::getSockAddr(sockaddr_storage& sa, socklen_t& len) {
             memcpy(sa_store_, &sin6, sizeof(sockaddr_in6));
             return sizeof(sockaddr_in6);
         }
+        socklen_t operator()(sockaddr_un& sun) {
+            memcpy(sa_store_, &sun, sizeof(sockaddr_un));
+            return unixAddrLength(sun);
+        }
         socklen_t operator()(SpecialIP& sip) {
             // TODO does not express INADDR_NONE (is it still needed?)
             //auto spec = std::get<SpecialIP>(address_);
@@ -188,7 +193,23 @@ bool SocketAddr::resolve(const std::string& host) {
     constexpr const char* validIpv6 = "0123456789abcdefABCDEF:";
     bool is_valid = false;
 
-    if (host.empty()) {
+    if (host.compare(0, strlen(unixPrefix), unixPrefix) == 0) {
+        // Unix domain socket: "unix:/path" or "unix:@abstract"
+        std::string path = host.substr(strlen(unixPrefix));
+        sockaddr_un sun;
+        memset(&sun, 0, sizeof(sun));
+        sun.sun_family = AF_UNIX;
+        if (!path.empty() && path.size() < sizeof(sun.sun_path)) {
+            memcpy(sun.sun_path, path.data(), path.size());
+            if (path[0] == '@') {
+                sun.sun_path[0] = '\0';
+            }
+            address_ = sun;
+            is_valid = true;
+        } else {
+            address_ = AddrNone;
+        }
+    } else if (host.empty()) {
         address_ = AddrAny;
     } else if (host.find_first_not_of(validIpv4) == std::string::npos) {
         // Looks like dot notation, so try IPv4 address
@@ -283,7 +304,9 @@ SocketAddr::operator const AddrType () const {
 std::string SocketAddr::hostname() {
     if (hostName_.empty()) {
         char hbuf[NI_MAXHOST];
-        if (std::holds_alternative<sockaddr_in>(address_)) {
+        if (std::holds_alternative<sockaddr_un>(address_)) {
+            hostName_ = unixAddrName(std::get<sockaddr_un>(address_));
+        } else if (std::holds_alternative<sockaddr_in>(address_)) {
             auto sa = (sockaddr *) &std::get<sockaddr_in>(address_);
             if (!getnameinfo(sa, sizeof(sockaddr_in), hbuf, sizeof(hbuf),
                              nullptr, 0, NI_NAMEREQD)) {
@@ -310,6 +333,42 @@ bool SocketAddr::isMulticast() const {
     return isMulticast_;
 }
 
+bool SocketAddr::isUnix() const {
+    return std::holds_alternative<sockaddr_un>(address_);
+}
+
+// Abstract : Length of a Unix domain socket address
+//
+// Returns  : Size of the family plus the used part of sun_path
+// Params   :
+//   sun                       A Unix domain socket address
+//
+// Remarks  : A path name includes its terminating zero.  An abstract name
+//            (leading zero byte) is significant up to the last character,
+//            so trailing zeros must not be counted.  An unnamed address
+//            (such as that of a client that did not bind) has no path.
+//
+socklen_t SocketAddr::unixAddrLength(const sockaddr_un& sun) {
+    constexpr std::size_t base = offsetof(sockaddr_un, sun_path);
+    constexpr std::size_t maxPath = sizeof(sun.sun_path);
+    if (sun.sun_path[0] != '\0') {
+        return base + strnlen(sun.sun_path, maxPath - 1) + 1;
+    }
+    std::size_t len = strnlen(sun.sun_path + 1, maxPath - 1);
+    return len ? base + 1 + len : sizeof(sun.sun_family);
+}
+
+std::string SocketAddr::unixAddrName(const sockaddr_un& sun) {
+    std::string name(unixPrefix);
+    if (sun.sun_path[0] != '\0') {
+        name.append(sun.sun_path, strnlen(sun.sun_path, sizeof(sun.sun_path)));
+    } else if (sun.sun_path[1] != '\0') {
+        name += '@';
+        name.append(sun.sun_path + 1, strnlen(sun.sun_path + 1, sizeof(sun.sun_path) - 1));
+    }
+    return name;
+}
+
 // Abstract : Returns a static, textual representation of an address
 //
 // Pre      :
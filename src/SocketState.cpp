@@ -50,8 +50,13 @@
 
 #include "config.h"
 #include <cassert>
+#include <cerrno>
+#include <cstring>
 #ifdef TARGET_LINUX
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -96,6 +101,26 @@ namespace {
 
 DWORD status_ = 0;   // TODO use a member of Socket
 
+// Remove a Unix domain socket file left behind by a server that did not
+// shut down cleanly.  The file is only removed if it is a socket and no
+// server answers on it, so a running server keeps its path; it sees the
+// probe as a connection that closes without sending anything.
+void unlinkStaleSocket(const sockaddr_un& sun) {
+    struct stat st;
+    if (sun.sun_path[0] == '\0' || ::stat(sun.sun_path, &st) != 0 || !S_ISSOCK(st.st_mode)) {
+        return;
+    }
+    int hProbe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (hProbe < 0) {
+        return;
+    }
+    if (::connect(hProbe, (const sockaddr*)&sun, SocketAddr::unixAddrLength(sun)) != 0 &&
+        errno == ECONNREFUSED) {
+        ::unlink(sun.sun_path);
+    }
+    ::close(hProbe);
+}
+
 #ifdef LOOKUP_ACTIVE_INTERFACE
 std::string get_active_interface(int addr_family, std::string* ipaddr_str = nullptr) {
     std::string interface("en0");  // Default name if lookup fails
@@ -529,6 +554,82 @@ IOPARAMS* SocketState::createIOParams(Socket* pSocket, const void* pBuf, UINT uC
 }
 
 
+// Abstract : Wait for a socket to become readable or writable
+//
+// Returns  : false if the timeout expired first
+// Params   :
+//   pSocket                   Pointer to socket object
+//   bWrite                    Wait for writability instead of readability
+//   uTimeoutMs                Maximum time to wait in milliseconds
+//
+// Post     : On timeout the socket status is SC_TIMEOUT, the failbit is set
+//            and errno is ETIMEDOUT.
+//
+// Remarks  : Errors on the handle make it "ready"; they are reported by the
+//            operation that follows.
+//
+bool SocketState::waitReady(Socket* pSocket, bool bWrite, UINT uTimeoutMs) {
+    if (uTimeoutMs == 0) {
+        return true;
+    }
+    pollfd pfd;
+    pfd.fd = pSocket->m_hFile;
+    pfd.events = bWrite ? POLLOUT : POLLIN;
+    pfd.revents = 0;
+    int iResult;
+    do {
+        iResult = ::poll(&pfd, 1, (int) uTimeoutMs);
+    } while (iResult < 0 && errno == EINTR);
+
+    if (iResult == 0) {
+        pSocket->m_Status = SC_TIMEOUT;
+        pSocket->setstate(std::ios::failbit);
+        errno = ETIMEDOUT;
+        return false;
+    }
+    return true;
+}
+
+// Abstract : Connect the socket handle to an address
+//
+// Returns  : true if the connection was established
+// Params   :
+//   pSocket                   Pointer to socket object with an open handle
+//   pAddr                     Address to connect to
+//   len                       Length of the address
+//   uTimeoutMs                Maximum time for the connection to complete,
+//                             or 0 to let the system decide
+//
+// Remarks  : With a timeout the connect is made non-blocking and completed
+//            with poll.  The handle is back in blocking mode afterwards.
+//
+bool SocketState::connectSocket(Socket* pSocket, const sockaddr* pAddr,
+                                socklen_t len, UINT uTimeoutMs) {
+    if (uTimeoutMs == 0) {
+        return ::connect(pSocket->m_hFile, pAddr, len) != SOCKET_ERROR;
+    }
+    int nFlags = ::fcntl(pSocket->m_hFile, F_GETFL, 0);
+    ::fcntl(pSocket->m_hFile, F_SETFL, nFlags | O_NONBLOCK);
+    int iResult = ::connect(pSocket->m_hFile, pAddr, len);
+    if (iResult == SOCKET_ERROR && errno == EINPROGRESS) {
+        if (waitReady(pSocket, true, uTimeoutMs)) {
+            int nError = 0;
+            socklen_t nErrorLen = sizeof(nError);
+            ::getsockopt(pSocket->m_hFile, SOL_SOCKET, SO_ERROR, &nError, &nErrorLen);
+            if (nError == 0) {
+                iResult = 0;
+            } else {
+                errno = nError;
+            }
+        }
+    }
+    int nSaveErrno = errno;
+    ::fcntl(pSocket->m_hFile, F_SETFL, nFlags);
+    errno = nSaveErrno;
+    return iResult != SOCKET_ERROR;
+}
+
+
 // Remarks  : All of the subclasses of SocketState follow here.
 //            The C++ Coding Standards states that each (sub)class
 //            should be in a separate file.  For state tree classes
@@ -594,6 +695,12 @@ bool SSOpenedServer::open(Socket* pSocket, SocketAddr& rSockAddr, UINT uOpenFlag
 #endif
     ::setsockopt(pSocket->m_hFile, SOL_SOCKET, SO_REUSEADDR,
                  (char *)&bSockOpt, sizeof(bSockOpt));
+#ifdef SO_REUSEPORT
+    if (uOpenFlags & Socket::modeReusePort) {
+        ::setsockopt(pSocket->m_hFile, SOL_SOCKET, SO_REUSEPORT,
+                     (char *)&bSockOpt, sizeof(bSockOpt));
+    }
+#endif
 
     if (pSocket->m_nProtocol == SOCK_STREAM) {
         ::setsockopt(pSocket->m_hFile, SOL_SOCKET, SO_KEEPALIVE,
@@ -615,6 +722,9 @@ bool SSOpenedServer::open(Socket* pSocket, SocketAddr& rSockAddr, UINT uOpenFlag
         }
     }
 
+    if (rSockAddr.isUnix()) {
+        unlinkStaleSocket(std::get<sockaddr_un>(rSockAddr.netAddress()));
+    }
     if (::bind(pSocket->m_hFile, (const sockaddr*)&sa, len) == SOCKET_ERROR) {
         close(pSocket);
         return false;
@@ -652,7 +762,7 @@ bool SSOpenedServer::open(Socket* pSocket, SocketAddr& rSockAddr, UINT uOpenFlag
                 mreq.imr_interface.s_addr = htonl(INADDR_ANY);
                 ::setsockopt(pSocket->m_hFile, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
             }
-        } else if (!std::holds_alternative<sockaddr_in6>(na)) {
+        } else if (std::holds_alternative<sockaddr_in>(na)) {
             // Not multicast Datagrams so setup for broadcast (but only for IPv4)
 #ifdef TARGET_WINDOWS
             bSockOpt = true;
@@ -710,7 +820,8 @@ bool SSOpenedClient::open(Socket* pSocket, SocketAddr& rSockAddr, UINT uOpenFlag
         return false;
     }
     if (pSocket->m_nProtocol == SOCK_STREAM) {
-        if (::connect(pSocket->m_hFile, (const sockaddr*)&sa, len) == SOCKET_ERROR) {
+        if (!connectSocket(pSocket, (const sockaddr*)&sa, len,
+                           pSocket->m_uTimeouts[Socket::timeoutConnect])) {
             return false;
         }
 #ifdef TARGET_WINDOWS
@@ -748,6 +859,13 @@ bool SSOpenedClient::open(Socket* pSocket, SocketAddr& rSockAddr, UINT uOpenFlag
 #endif
                 ::setsockopt(pSocket->m_hFile, IPPROTO_IPV6, IPV6_MULTICAST_IF, &out_if, sizeof(out_if));
             }
+        } else if (std::holds_alternative<sockaddr_un>(na)) {
+            // An unbound Unix datagram socket cannot receive replies, so
+            // let the kernel bind it to a unique abstract name (Linux).
+            sockaddr_un BindAddr;
+            memset(&BindAddr, 0, sizeof(BindAddr));
+            BindAddr.sun_family = AF_UNIX;
+            ::bind(pSocket->m_hFile, (sockaddr *)&BindAddr, sizeof(BindAddr.sun_family));
         } else {  // Broadcast
             if (std::holds_alternative<sockaddr_in>(na)) {
                 // For Ipv4 UDP, client needs to bind with port 0.
@@ -784,6 +902,21 @@ SocketState* SSListening::instance() {
     return m_pInstance;
 }
 
+// Abstract : Close a listening socket
+//
+// Post     : A Unix domain server removes its socket file, so that the
+//            path can be bound again.
+//
+void SSListening::close(Socket* pSocket) {
+    if (std::holds_alternative<sockaddr_un>(pSocket->m_PeerAddr)) {
+        const sockaddr_un& sun = std::get<sockaddr_un>(pSocket->m_PeerAddr);
+        if (sun.sun_path[0] != '\0') {
+            ::unlink(sun.sun_path);
+        }
+    }
+    SocketState::close(pSocket);
+}
+
 // Abstract : Listen on a server-side socket for incoming connection requests
 //
 // Returns  : Socket handle of incoming connection
@@ -799,6 +932,9 @@ SocketState* SSListening::instance() {
 //
 SOCKET SSListening::listen(Socket* pSocket, const int /*nBacklog*/) {
     SOCKET hSock;
+    if (!waitReady(pSocket, false, pSocket->m_uTimeouts[Socket::timeoutAccept])) {
+        return INVALID_SOCKET;
+    }
     if ((hSock = ::accept(pSocket->m_hFile, 0, 0)) == INVALID_SOCKET) {
         return INVALID_SOCKET;
     }
@@ -848,6 +984,9 @@ UINT SSConnected::read(Socket* pSocket, void* pBuf, UINT uCount) {
 
     if (! pSocket->m_bAsyncMode) {
         // Synchronous mode -- do a blocking read on socket
+        if (!waitReady(pSocket, false, pSocket->m_uTimeouts[Socket::timeoutRead])) {
+            return 0;
+        }
         iResult = readSocket(pSocket, pBuf, uCount);
         if (iResult == 0 || iResult == SOCKET_ERROR) {
             pSocket->m_Status = SC_NODATA;
@@ -932,6 +1071,12 @@ int SSConnected::readSocket(Socket* pSocket, void* pBuf, UINT uCount) {
             sockaddr_in6* sa6 = &std::get<sockaddr_in6>(na);
             iResult = ::recvfrom(pSocket->m_hFile, (char *)pBuf, uCount,
                                  0, (sockaddr *)sa6, &iSizeFrom);
+        } else if (std::holds_alternative<sockaddr_un>(na)) {
+            sockaddr_un* sun = &std::get<sockaddr_un>(na);
+            socklen_t iSizeFrom = sizeof(sockaddr_un);
+            memset(sun, 0, sizeof(sockaddr_un));
+            iResult = ::recvfrom(pSocket->m_hFile, (char *)pBuf, uCount,
+                                 0, (sockaddr *)sun, &iSizeFrom);
         } else {
             socklen_t iSizeFrom = sizeof(sockaddr_in);
             sockaddr_in* sa = &std::get<sockaddr_in>(na);
@@ -941,6 +1086,7 @@ int SSConnected::readSocket(Socket* pSocket, void* pBuf, UINT uCount) {
     } else {
         iResult = ::recv(pSocket->m_hFile, (char *)pBuf, uCount, 0);
     }
+    pSocket->captureData(captureReceived, pBuf, iResult);
     return iResult;
 }
 
@@ -1013,6 +1159,9 @@ void SSConnected::write(Socket* pSocket, const void* pBuf, UINT uCount) {
     if (! (pSocket->m_bAsyncMode && pSocket->m_pDefCallback != nullptr)) {
         int iResult = -1;
         // Synchronous mode -- do a blocking write on socket
+        if (!waitReady(pSocket, true, pSocket->m_uTimeouts[Socket::timeoutWrite])) {
+            return;
+        }
         if (pSocket->m_nProtocol == SOCK_DGRAM) {
             // Note that s_addr could have been overwritten by the call to recvfrom
             // pSocket->m_PeerAddr.sin_addr.s_addr = INADDR_BROADCAST;
@@ -1021,6 +1170,10 @@ void SSConnected::write(Socket* pSocket, const void* pBuf, UINT uCount) {
                 sockaddr_in6* sa6 = &std::get<sockaddr_in6>(na);
                 iResult = ::sendto(pSocket->m_hFile, (const char *)pBuf, uCount, 0,
                                    (sockaddr *)sa6, sizeof(sockaddr_in6));
+            } else if (std::holds_alternative<sockaddr_un>(na)) {
+                sockaddr_un* sun = &std::get<sockaddr_un>(na);
+                iResult = ::sendto(pSocket->m_hFile, (const char *)pBuf, uCount, 0,
+                                   (sockaddr *)sun, SocketAddr::unixAddrLength(*sun));
             } else {
                 sockaddr_in* sa = &std::get<sockaddr_in>(na);
                 iResult = ::sendto(pSocket->m_hFile, (const char *)pBuf, uCount, 0,
@@ -1035,6 +1188,7 @@ void SSConnected::write(Socket* pSocket, const void* pBuf, UINT uCount) {
             pSocket->setstate(std::ios::failbit);
         } else {
             pSocket->clear(pSocket->rdstate() & ~std::ios::failbit);
+            pSocket->captureData(captureSent, pBuf, iResult);
         }
     } else {
         auto writeThreadHandler = std::thread(&SocketState::write_thread_handler, this,
@@ -1080,6 +1234,7 @@ DWORD SSConnected::writerThread(IOPARAMS* pIOP) {
     if (iResult == SOCKET_ERROR) {
         return 1;			// Thread exit code 1 == failure
     }
+    pIOP->m_pSocket->captureData(captureSent, pIOP->m_pBuf, iResult);
     pIOP->m_pCallback(iResult, pIOP->m_pBuf);
     return 0;
 }
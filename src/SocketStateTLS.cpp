@@ -172,7 +172,8 @@ bool SSOpenedClientTLS::open(Socket* pSocket, SocketAddr& rSockAddr, UINT uOpenF
         sockaddr_storage sa;
         socklen_t len;
         if (!rSockAddr.getSockAddr(sa, len) ||
-            ::connect(pSocket->m_hFile, (const sockaddr*)&sa, len) == SOCKET_ERROR) {
+            !connectSocket(pSocket, (const sockaddr*)&sa, len,
+                           pSocket->m_uTimeouts[Socket::timeoutConnect])) {
             SSL_CTX_free(ctx);
             close(pSocket);
             return false;
@@ -197,12 +198,22 @@ bool SSOpenedClientTLS::open(Socket* pSocket, SocketAddr& rSockAddr, UINT uOpenF
     SSL* ssl = SSL_new(ctx);
     BIO* sbio = BIO_new_socket(pSocket->m_hFile, BIO_NOCLOSE);
     SSL_set_bio(ssl, sbio, sbio);
+    pSocket->m_alpnSelected.clear();
+    if (!pSocket->m_alpn.empty()) {
+        SSL_set_alpn_protos(ssl, reinterpret_cast<const unsigned char*>(pSocket->m_alpn.data()),
+                            pSocket->m_alpn.size());
+    }
 
     if (SSL_connect(ssl) <= 0) {
+        SSL_free(ssl);
         SSL_CTX_free(ctx);
         close(pSocket);
         return false;
     }
+    const unsigned char* pSelected = 0;
+    unsigned int uSelected = 0;
+    SSL_get0_alpn_selected(ssl, &pSelected, &uSelected);
+    pSocket->m_alpnSelected.assign(reinterpret_cast<const char*>(pSelected), uSelected);
 
     //TODO check cert here
 
@@ -316,7 +327,12 @@ UINT SSConnectedTLS::read(Socket* pSocket, void* pBuf, UINT uCount) {
     VERIFY(uCount != 0);
 
     if (! pSocket->m_bAsyncMode) {
-        // Synchronous mode -- do a blocking read on socket
+        // Synchronous mode -- do a blocking read on socket.  Records that
+        // are already decrypted do not show up as readable on the handle.
+        if (SSL_pending(pSocket->m_pSsl) == 0 &&
+            !waitReady(pSocket, false, pSocket->m_uTimeouts[Socket::timeoutRead])) {
+            return 0;
+        }
         iResult = readSocket(pSocket, pBuf, uCount);
         if (iResult == 0 || iResult == SOCKET_ERROR) {
             pSocket->m_Status = SC_NODATA;
@@ -467,6 +483,9 @@ void SSConnectedTLS::write(Socket* pSocket, const void* pBuf, UINT uCount) {
     if (! (pSocket->m_bAsyncMode && pSocket->m_pDefCallback != nullptr)) {
         int iResult;
         // Synchronous mode -- do a blocking write on socket
+        if (!waitReady(pSocket, true, pSocket->m_uTimeouts[Socket::timeoutWrite])) {
+            return;
+        }
         iResult = SSL_write(pSocket->m_pSsl, (const char *)pBuf, uCount);
 
         if (iResult == SOCKET_ERROR) {
@@ -42,6 +42,7 @@
 // INCLUDE FILES
 //
 #include "config.h"
+#include <utility>
 #include <sockstr/Stream.h>
 
 using namespace sockstr;
@@ -88,6 +89,48 @@ Stream::Stream(const UINT uFile)
 }
 
 
+// Abstract : Move a Stream object
+//
+// Params   :
+//   rSource                   Stream whose contents are taken over
+//
+// Post     : This stream owns the handle, status, callback and buffered
+//            data of rSource.  rSource has no handle and empty buffers.
+//
+// Remarks  : The iostream base only moves the format and state flags; the
+//            stream buffer is never moved, so our own StreamBuf is attached
+//            and takes over the buffered bytes.
+//
+Stream::Stream(Stream&& rSource) noexcept
+    :	std::iostream (std::move(rSource))
+    ,	m_hFile       (rSource.m_hFile)
+    ,	m_Status      (rSource.m_Status)
+    ,	m_pDefCallback(rSource.m_pDefCallback)
+    ,	strbuf(this) {
+    set_rdbuf(&strbuf);
+    strbuf.moveFrom(rSource.strbuf);
+    rSource.m_hFile = INVALID_SOCKET;
+    rSource.m_Status = SC_OK;
+    rSource.m_pDefCallback = nullptr;
+    rSource.clear();
+}
+
+Stream& Stream::operator=(Stream&& rSource) noexcept {
+    if (&rSource != this) {
+        std::iostream::operator=(std::move(rSource));
+        m_hFile = rSource.m_hFile;
+        m_Status = rSource.m_Status;
+        m_pDefCallback = rSource.m_pDefCallback;
+        strbuf.moveFrom(rSource.strbuf);
+        rSource.m_hFile = INVALID_SOCKET;
+        rSource.m_Status = SC_OK;
+        rSource.m_pDefCallback = nullptr;
+        rSource.clear();
+    }
+    return *this;
+}
+
+
 bool Stream::is_open(void) const {
     return m_hFile != INVALID_SOCKET;
 }
@@ -30,7 +30,9 @@
 // INCLUDE FILES
 //
 #include "config.h"
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
 
 #include <sockstr/StreamBuf.h>
 #include <sockstr/Stream.h>
@@ -76,6 +78,28 @@ StreamBuf* StreamBuf::open(Stream* strm)
     return this;
 }
 
+void StreamBuf::moveFrom(StreamBuf& rSource)
+{
+    // The get and put areas point into the arrays of rSource, so copy the
+    // pending bytes and rebase the pointers onto our own arrays.
+    std::ptrdiff_t nGet = rSource.gptr() - rSource.eback();
+    std::ptrdiff_t nGetEnd = rSource.egptr() - rSource.eback();
+    std::ptrdiff_t nPut = rSource.pptr() - rSource.pbase();
+    std::copy(rSource.inbuff, rSource.inbuff + sizeof(inbuff), inbuff);
+    std::copy(rSource.outbuff, rSource.outbuff + nPut, outbuff);
+    setg(inbuff, inbuff + nGet, inbuff + nGetEnd);
+    setp(outbuff, outbuff+sizeof(outbuff));
+    pbump(static_cast<int>(nPut));
+
+    rSource.reset();
+}
+
+void StreamBuf::reset()
+{
+    setg(inbuff, inbuff+sizeof(inbuff), inbuff+sizeof(inbuff));
+    setp(outbuff, outbuff+sizeof(outbuff));
+}
+
 // virtual protected members overridden from Standard C++ Library std::streambuf
 
 int StreamBuf::overflow(int ch)
@@ -0,0 +1,268 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : TimerWheel.cpp
+//
+// Class      : TimerWheel, Timer
+//
+// Description: Hierarchical timing wheel used by EventLoop for socket
+//              deadlines and idle timeouts.
+//
+// Decisions  : A timer expiring d ticks from now is hashed into the finest
+//              wheel whose span covers d, using the bits of its absolute
+//              expiry for the slot.  Whenever a wheel wraps, the slot of the
+//              next coarser wheel that has become current is cascaded down.
+//              A bitmap of occupied slots lets advance() skip straight to
+//              the next slot holding a timer, so an idle loop does not tick
+//              through empty milliseconds.
+//
+
+#include "config.h"
+#include <time.h>
+
+#include <sockstr/TimerWheel.h>
+
+using namespace sockstr;
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+Timer::Timer(TimerCallback pCallback, void* ptr)
+    : pPrev_(nullptr)
+    , pNext_(nullptr)
+    , pWheel_(nullptr)
+    , expiry_(0)
+    , level_(0)
+    , slot_(0)
+    , pCallback_(pCallback)
+    , pData_(ptr) {
+}
+
+Timer::~Timer() {
+    cancel();
+}
+
+void Timer::cancel() {
+    if (pWheel_ != nullptr) {
+        pWheel_->cancel(*this);
+    }
+}
+
+void Timer::setCallback(TimerCallback pCallback, void* ptr) {
+    pCallback_ = pCallback;
+    pData_ = ptr;
+}
+
+
+TimerWheel::TimerWheel()
+    : wheel_{}
+    , occupied_{}
+    , now_(monotonicMs())
+    , count_(0) {
+}
+
+TimerWheel::~TimerWheel() {
+    // Disarm whatever is left so the timers do not point at a dead wheel
+    for (unsigned level = 0; level < levels_; level++) {
+        for (unsigned slot = 0; slot < slots_; slot++) {
+            while (wheel_[level][slot] != nullptr) {
+                unlink(*wheel_[level][slot]);
+            }
+        }
+    }
+}
+
+uint64_t TimerWheel::monotonicMs() {
+    timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Abstract : Arm a timer
+//
+// Params   :
+//   rTimer                    Timer to arm.  If it is already armed (on this
+//                             or another wheel) it is moved.
+//   uDelayMs                  Milliseconds until the timer expires
+//
+// Remarks  : The delay is measured from the time the wheel was last
+//            advanced, which the EventLoop does once per iteration.
+//            A delay of zero expires on the next tick.
+//
+void TimerWheel::arm(Timer& rTimer, UINT uDelayMs) {
+    rTimer.cancel();
+    rTimer.expiry_ = now_ + (uDelayMs ? uDelayMs : 1);
+    place(rTimer);
+    ++count_;
+}
+
+void TimerWheel::cancel(Timer& rTimer) {
+    if (rTimer.pWheel_ == this) {
+        unlink(rTimer);
+        --count_;
+    }
+}
+
+// Abstract : Expire the timers that are due
+//
+// Returns  : Number of callbacks that were called
+// Params   :
+//   uNowMs                    Current time from monotonicMs()
+//
+// Remarks  : Callbacks may arm and cancel timers, including their own.
+//
+std::size_t TimerWheel::advance(uint64_t uNowMs) {
+    std::size_t uFired = 0;
+    while (now_ < uNowMs) {
+        if (count_ == 0) {
+            now_ = uNowMs;
+            break;
+        }
+        uint64_t uNext = nextEvent();
+        if (uNext > uNowMs) {
+            now_ = uNowMs;
+            break;
+        }
+        now_ = uNext - 1;
+        tick();
+
+        Timer** ppHead = &wheel_[0][now_ & slotMask_];
+        while (*ppHead != nullptr) {
+            Timer* pTimer = *ppHead;
+            unlink(*pTimer);
+            --count_;
+            ++uFired;
+            if (pTimer->pCallback_) {
+                pTimer->pCallback_(pTimer, pTimer->pData_);
+            }
+        }
+    }
+    return uFired;
+}
+
+int TimerWheel::nextTimeout(uint64_t uNowMs) const {
+    if (count_ == 0) {
+        return -1;
+    }
+    uint64_t uNext = nextEvent();
+    if (uNext <= uNowMs) {
+        return 0;
+    }
+    uint64_t uDelta = uNext - uNowMs;
+    return (uDelta > 0x7fffffff) ? 0x7fffffff : static_cast<int>(uDelta);
+}
+
+// Abstract : Return the next tick at which advance() has work to do
+//
+// Remarks  : That is either the next occupied slot of the finest wheel in
+//            its current rotation, or the end of the rotation when the
+//            coarser wheels have timers to cascade.
+//
+uint64_t TimerWheel::nextEvent() const {
+    uint64_t uBoundary = (now_ | slotMask_) + 1;
+    unsigned uStart = (now_ + 1) & slotMask_;
+    if (uStart != 0) {
+        for (unsigned slot = uStart; slot < slots_; ) {
+            uint64_t uBits = occupied_[0][slot / 64] >> (slot % 64);
+            if (uBits != 0) {
+                return now_ + 1 + (slot - uStart) + __builtin_ctzll(uBits);
+            }
+            slot = (slot | 63) + 1;
+        }
+    }
+    return uBoundary;
+}
+
+void TimerWheel::place(Timer& rTimer) {
+    // A timer cascaded on the tick it is due lands in the current slot,
+    // which advance() is about to expire.
+    uint64_t uExpiry = rTimer.expiry_;
+    if (uExpiry < now_) {
+        uExpiry = rTimer.expiry_ = now_;
+    }
+    uint64_t uDelta = uExpiry - now_;
+    unsigned level = 0;
+    while (level + 1 < levels_ && uDelta >= (uint64_t(1) << (slotBits_ * (level + 1)))) {
+        ++level;
+    }
+    if (uDelta >= (uint64_t(1) << (slotBits_ * levels_))) {
+        // Beyond the span of the wheels: park in the last slot reachable
+        uExpiry = now_ + (uint64_t(1) << (slotBits_ * levels_)) - 1;
+    }
+    unsigned slot = (uExpiry >> (slotBits_ * level)) & slotMask_;
+
+    Timer*& rHead = wheel_[level][slot];
+    rTimer.pPrev_ = nullptr;
+    rTimer.pNext_ = rHead;
+    if (rHead != nullptr) {
+        rHead->pPrev_ = &rTimer;
+    }
+    rHead = &rTimer;
+    occupied_[level][slot / 64] |= uint64_t(1) << (slot % 64);
+    rTimer.level_ = static_cast<unsigned short>(level);
+    rTimer.slot_ = static_cast<unsigned short>(slot);
+    rTimer.pWheel_ = this;
+}
+
+void TimerWheel::unlink(Timer& rTimer) {
+    unsigned level = rTimer.level_;
+    unsigned slot = rTimer.slot_;
+    if (rTimer.pPrev_ != nullptr) {
+        rTimer.pPrev_->pNext_ = rTimer.pNext_;
+    } else {
+        wheel_[level][slot] = rTimer.pNext_;
+        if (rTimer.pNext_ == nullptr) {
+            occupied_[level][slot / 64] &= ~(uint64_t(1) << (slot % 64));
+        }
+    }
+    if (rTimer.pNext_ != nullptr) {
+        rTimer.pNext_->pPrev_ = rTimer.pPrev_;
+    }
+    rTimer.pPrev_ = rTimer.pNext_ = nullptr;
+    rTimer.pWheel_ = nullptr;
+}
+
+// Abstract : Move the wheel forward by one tick, cascading coarser wheels
+//            that have come due.
+//
+void TimerWheel::tick() {
+    ++now_;
+    for (unsigned level = 1; level < levels_; level++) {
+        if ((now_ >> (slotBits_ * (level - 1))) & slotMask_) {
+            break;
+        }
+        cascade(level);
+    }
+}
+
+void TimerWheel::cascade(unsigned uLevel) {
+    unsigned slot = (now_ >> (slotBits_ * uLevel)) & slotMask_;
+    Timer* pTimer = wheel_[uLevel][slot];
+    wheel_[uLevel][slot] = nullptr;
+    occupied_[uLevel][slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    while (pTimer != nullptr) {
+        Timer* pNext = pTimer->pNext_;
+        place(*pTimer);
+        pTimer = pNext;
+    }
+}
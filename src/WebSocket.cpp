@@ -0,0 +1,1165 @@
+/*
+   Copyright (C) 2026
+   Andy Warner
+   This file is part of the sockstr class library.
+
+   The sockstr class library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The sockstr class library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the sockstr library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+//
+// File       : WebSocket.cpp
+//
+// Class      : WebSocket, WebSocketFrame
+//
+// Description: WebSocket protocol (RFC 6455) with permessage-deflate
+//              (RFC 7692) over an upgraded HTTP connection.
+//
+// Decisions  : A frame is unmasked as it is copied out of the receive
+//              buffer into the message, so a payload is touched once; the
+//              buffer itself never grows for a large frame.
+//              Messages sent are compressed each on its own, with the
+//              deflate state of the thread, and the server asks the same
+//              of itself with server_no_context_takeover: a compressed
+//              frame then does not depend on the connection, and one
+//              broadcast frame serves every subscriber.  Messages received
+//              are inflated with a state kept by the connection, which
+//              suits a peer that does take over its context.
+//              The masking kernel takes AVX2 when the processor has it
+//              and SSE2 or NEON otherwise; the key, rotated to the offset
+//              in the payload, repeats every 4 bytes, so it lines up with
+//              any vector width.
+//
+
+#include "config.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <sys/uio.h>
+#include <zlib.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define WEBSOCKET_AVX2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#if defined(__SSE2__) && !defined(WEBSOCKET_AVX2)
+#include <emmintrin.h>
+#endif
+
+#include <sockstr/HttpParser.h>
+#include <sockstr/HttpStream.h>
+#include <sockstr/Socket.h>
+#include <sockstr/WebSocket.h>
+
+using namespace sockstr;
+
+// Appended to the client's key to make Sec-WebSocket-Accept
+static const char HANDSHAKE_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+// Size of the receive buffer; frames larger than this pass through it
+static const std::size_t RECV_BUFFER_SIZE = 16384;
+// Default limit on the size of a message received
+static const std::size_t DEFAULT_MAX_MESSAGE = 16 * 1024 * 1024;
+// Longest frame header: 2 bytes, 8 of length and 4 of masking key
+static const std::size_t MAX_HEADER = 14;
+// Longest payload of a control frame
+static const std::size_t MAX_CONTROL = 125;
+// Messages shorter than this are not worth compressing
+static const std::size_t MIN_DEFLATED = 64;
+// Frames written to one system call
+static const int MAX_FRAMES_PER_WRITE = 64;
+// Default zlib level of the messages sent
+static const int DEFAULT_DEFLATE_LEVEL = 1;
+// A deflate block flushed with Z_SYNC_FLUSH ends with these bytes, which
+// are left out of a message and put back to inflate it
+static const char DEFLATE_TAIL[4] = { 0x00, 0x00, char(0xff), char(0xff) };
+
+namespace {
+
+// The deflate state of a thread, in raw format for permessage-deflate
+struct Deflater {
+    z_stream stream;
+    bool bInit = false;
+    int level = 0;
+
+    ~Deflater() {
+        if (bInit) {
+            deflateEnd(&stream);
+        }
+    }
+};
+
+std::string base64(const unsigned char* pData, int nLength) {
+    char encoded[64];
+    int n = EVP_EncodeBlock(reinterpret_cast<unsigned char*>(encoded), pData, nLength);
+    return std::string(encoded, n);
+}
+
+// Value of Sec-WebSocket-Accept for a Sec-WebSocket-Key
+std::string acceptKey(std::string_view key) {
+    std::string text(key);
+    text += HANDSHAKE_GUID;
+    unsigned char digest[SHA_DIGEST_LENGTH];
+    SHA1(reinterpret_cast<const unsigned char*>(text.data()), text.size(), digest);
+    return base64(digest, sizeof(digest));
+}
+
+// Write a frame header; return its size
+std::size_t encodeHeader(unsigned char* pHead, int opcode, bool bFinal, bool bCompressed,
+                         uint64_t uLength, const unsigned char* pKey) {
+    pHead[0] = (bFinal ? 0x80 : 0) | (bCompressed ? 0x40 : 0) | opcode;
+    unsigned char maskBit = pKey ? 0x80 : 0;
+    std::size_t n;
+    if (uLength < 126) {
+        pHead[1] = maskBit | static_cast<unsigned char>(uLength);
+        n = 2;
+    } else if (uLength <= 0xffff) {
+        pHead[1] = maskBit | 126;
+        pHead[2] = static_cast<unsigned char>(uLength >> 8);
+        pHead[3] = static_cast<unsigned char>(uLength);
+        n = 4;
+    } else {
+        pHead[1] = maskBit | 127;
+        for (int i = 0; i < 8; i++) {
+            pHead[2 + i] = static_cast<unsigned char>(uLength >> (56 - 8 * i));
+        }
+        n = 10;
+    }
+    if (pKey) {
+        memcpy(pHead + n, pKey, 4);
+        n += 4;
+    }
+    return n;
+}
+
+// Append data compressed for permessage-deflate, without the tail
+bool deflateMessage(std::string_view data, int nLevel, std::string& out) {
+    thread_local Deflater deflater;
+    z_stream& rStream = deflater.stream;
+    if (!deflater.bInit) {
+        memset(&rStream, 0, sizeof(rStream));
+        if (deflateInit2(&rStream, nLevel, Z_DEFLATED, -MAX_WBITS, 8,
+                         Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        deflater.bInit = true;
+        deflater.level = nLevel;
+    } else {
+        deflateReset(&rStream);
+        if (deflater.level != nLevel
+            && deflateParams(&rStream, nLevel, Z_DEFAULT_STRATEGY) == Z_OK) {
+            deflater.level = nLevel;
+        }
+    }
+
+    std::size_t uStart = out.size();
+    std::size_t uDone = 0;
+    rStream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    rStream.avail_in = data.size();
+    out.resize(uStart + deflateBound(&rStream, data.size()) + 8);
+    for (;;) {
+        rStream.next_out = reinterpret_cast<Bytef*>(out.data() + uStart + uDone);
+        rStream.avail_out = out.size() - uStart - uDone;
+        std::size_t uRoom = rStream.avail_out;
+        int nResult = deflate(&rStream, Z_SYNC_FLUSH);
+        uDone += uRoom - rStream.avail_out;
+        if (nResult != Z_OK && nResult != Z_BUF_ERROR) {
+            out.resize(uStart);
+            return false;
+        }
+        if (rStream.avail_out > 0) {
+            break;
+        }
+        out.resize(out.size() * 2);
+    }
+    if (uDone >= 4 && memcmp(out.data() + uStart + uDone - 4, DEFLATE_TAIL, 4) == 0) {
+        uDone -= 4;
+    }
+    out.resize(uStart + uDone);
+    return true;
+}
+
+// Check that text is well-formed UTF-8
+bool validUtf8(const unsigned char* p, std::size_t n) {
+    std::size_t i = 0;
+    while (i < n) {
+        uint64_t word;
+        if (i + 8 <= n && (memcpy(&word, p + i, 8), (word & 0x8080808080808080ULL) == 0)) {
+            i += 8;
+            continue;
+        }
+        unsigned char c = p[i];
+        if (c < 0x80) {
+            i++;
+            continue;
+        }
+        std::size_t len;
+        uint32_t cp;
+        if ((c & 0xe0) == 0xc0) {
+            len = 2;
+            cp = c & 0x1f;
+        } else if ((c & 0xf0) == 0xe0) {
+            len = 3;
+            cp = c & 0x0f;
+        } else if ((c & 0xf8) == 0xf0) {
+            len = 4;
+            cp = c & 0x07;
+        } else {
+            return false;
+        }
+        if (i + len > n) {
+            return false;
+        }
+        for (std::size_t k = 1; k < len; k++) {
+            if ((p[i + k] & 0xc0) != 0x80) {
+                return false;
+            }
+            cp = (cp << 6) | (p[i + k] & 0x3f);
+        }
+        // Overlong forms, surrogates and code points past U+10FFFF
+        if ((len == 2 && cp < 0x80) || (len == 3 && cp < 0x800)
+            || (len == 4 && (cp < 0x10000 || cp > 0x10ffff))
+            || (cp >= 0xd800 && cp <= 0xdfff)) {
+            return false;
+        }
+        i += len;
+    }
+    return true;
+}
+
+// Indicate if a close frame may carry a status code
+bool validCloseCode(UINT uCode) {
+    return (uCode >= 1000 && uCode <= 1003) || (uCode >= 1007 && uCode <= 1011)
+        || (uCode >= 3000 && uCode <= 4999);
+}
+
+#ifdef WEBSOCKET_AVX2
+__attribute__((target("avx2")))
+std::size_t maskAvx2(char* pDst, const char* pSrc, std::size_t uLength, uint32_t key) {
+    __m256i vKey = _mm256_set1_epi32(static_cast<int>(key));
+    std::size_t i = 0;
+    for (; i + 32 <= uLength; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst + i), _mm256_xor_si256(v, vKey));
+    }
+    return i;
+}
+
+__attribute__((target("sse2")))
+std::size_t maskSse2(char* pDst, const char* pSrc, std::size_t uLength, uint32_t key) {
+    __m128i vKey = _mm_set1_epi32(static_cast<int>(key));
+    std::size_t i = 0;
+    for (; i + 16 <= uLength; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), _mm_xor_si128(v, vKey));
+    }
+    return i;
+}
+#endif
+
+}
+
+
+//
+// CLASS MEMBER FUNCTION DEFINITIONS
+//
+
+WebSocketFrame::WebSocketFrame(std::string_view message, bool bBinary, int nDeflate) {
+    int opcode = bBinary ? WebSocket::opBinary : WebSocket::opText;
+    unsigned char head[MAX_HEADER];
+    std::size_t n = encodeHeader(head, opcode, true, false, message.size(), 0);
+    plain_.reserve(n + message.size());
+    plain_.append(reinterpret_cast<char*>(head), n);
+    plain_.append(message);
+
+    if (nDeflate > 0 && message.size() >= MIN_DEFLATED) {
+        std::string compressed;
+        if (deflateMessage(message, nDeflate, compressed) && compressed.size() < message.size()) {
+            n = encodeHeader(head, opcode, true, true, compressed.size(), 0);
+            deflated_.reserve(n + compressed.size());
+            deflated_.append(reinterpret_cast<char*>(head), n);
+            deflated_.append(compressed);
+        }
+    }
+}
+
+
+// The inflate state of a connection
+struct WebSocket::Inflater {
+    z_stream stream;
+    bool bInit = false;
+
+    ~Inflater() {
+        if (bInit) {
+            inflateEnd(&stream);
+        }
+    }
+
+    // Append a whole compressed message, inflated, to out
+    bool inflateMessage(const std::string& data, std::string& out, std::size_t uMax) {
+        if (!bInit) {
+            memset(&stream, 0, sizeof(stream));
+            if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+                return false;
+            }
+            bInit = true;
+        }
+        return inflatePart(data.data(), data.size(), out, uMax)
+            && inflatePart(DEFLATE_TAIL, sizeof(DEFLATE_TAIL), out, uMax);
+    }
+
+    bool inflatePart(const char* pData, std::size_t uLength, std::string& out, std::size_t uMax) {
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(pData));
+        stream.avail_in = uLength;
+        while (stream.avail_in > 0) {
+            std::size_t uStart = out.size();
+            std::size_t uRoom = std::max<std::size_t>(uLength * 2, 16384);
+            if (uStart + uRoom > uMax + 1) {
+                uRoom = uMax + 1 - uStart;
+            }
+            out.resize(uStart + uRoom);
+            stream.next_out = reinterpret_cast<Bytef*>(out.data() + uStart);
+            stream.avail_out = uRoom;
+            int nResult = inflate(&stream, Z_SYNC_FLUSH);
+            out.resize(uStart + uRoom - stream.avail_out);
+            if (out.size() > uMax) {
+                return false;
+            }
+            if (nResult == Z_STREAM_END) {
+                // A final block ends the stream; a later message starts anew
+                inflateReset(&stream);
+            } else if (nResult != Z_OK && !(nResult == Z_BUF_ERROR && stream.avail_in == 0)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+
+WebSocket::WebSocket()
+    : pSocket_(0)
+    , bClient_(false)
+    , deflateLevel_(DEFAULT_DEFLATE_LEVEL)
+    , bDeflate_(false)
+    , uMaxMessage_(DEFAULT_MAX_MESSAGE)
+    , recvBegin_(0)
+    , recvEnd_(0)
+    , bInFrame_(false)
+    , frameOpcode_(opContinuation)
+    , bFrameFinal_(false)
+    , bFrameMasked_(false)
+    , uFrameLeft_(0)
+    , uFrameDone_(0)
+    , messageOpcode_(opContinuation)
+    , bMessageCompressed_(false)
+    , bFragmenting_(false)
+    , uQueued_(0)
+    , bFlushing_(false)
+    , bFailed_(false)
+    , bCloseSent_(false)
+    , bClosed_(false)
+    , closeCode_(0)
+    , pongs_(0) {
+    memset(frameKey_, 0, sizeof(frameKey_));
+}
+
+WebSocket::~WebSocket() {
+}
+
+bool WebSocket::isUpgrade(const HttpParser& request) {
+    return request.method() == "GET"
+        && HttpParser::hasToken(request.header(hdrUpgrade), "websocket")
+        && HttpParser::hasToken(request.header(hdrConnection), "upgrade");
+}
+
+bool WebSocket::accept(HttpServerStream& conn, const char* protocol) {
+    std::string headers;
+    UINT status = handshake(conn.getParser(), protocol, headers);
+    if (status != 101) {
+        conn.appendResponse("Not a valid WebSocket handshake\n", "text/plain", status, headers);
+        conn.flushResponses();
+        return false;
+    }
+    std::string rest;
+    if (!conn.upgrade(headers, rest)) {
+        return false;
+    }
+    opened(conn, rest, false);
+    return true;
+}
+
+Task<bool> WebSocket::async_accept(HttpServerStream& conn, const char* protocol) {
+    std::string headers;
+    UINT status = handshake(conn.getParser(), protocol, headers);
+    if (status != 101) {
+        conn.appendResponse("Not a valid WebSocket handshake\n", "text/plain", status, headers);
+        co_await conn.async_flushResponses();
+        co_return false;
+    }
+    std::string rest;
+    if (!co_await conn.async_upgrade(headers, rest)) {
+        co_return false;
+    }
+    opened(conn, rest, false);
+    co_return true;
+}
+
+// Abstract : Check an upgrade request and make the headers of the answer
+//
+// Returns  : UINT (101 to accept; 400 or 426 to refuse)
+// Params   :
+//   request                   The request
+//   protocol                  Subprotocol to select, if offered
+//   headers                   Set to the header lines of the answer
+//
+UINT WebSocket::handshake(const HttpParser& request, const char* protocol,
+                          std::string& headers) {
+    headers.clear();
+    if (!isUpgrade(request) || request.versionMinor() < 1) {
+        return 400;
+    }
+    if (HttpParser::trim(request.header("Sec-WebSocket-Version")) != "13") {
+        headers = "Sec-WebSocket-Version: 13\r\n";
+        return 426;
+    }
+    // The key is 16 bytes in base64
+    std::string_view key = HttpParser::trim(request.header("Sec-WebSocket-Key"));
+    if (key.size() != 24) {
+        return 400;
+    }
+
+    headers = "Upgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: ";
+    headers += acceptKey(key);
+    headers += "\r\n";
+    protocol_.clear();
+    if (protocol && HttpParser::hasToken(request.header("Sec-WebSocket-Protocol"), protocol)) {
+        protocol_ = protocol;
+        headers += "Sec-WebSocket-Protocol: " + protocol_ + "\r\n";
+    }
+    std::string extension;
+    bDeflate_ = deflateLevel_ > 0
+        && negotiate(request.header("Sec-WebSocket-Extensions"), extension);
+    if (bDeflate_) {
+        headers += "Sec-WebSocket-Extensions: " + extension + "\r\n";
+    }
+    return 101;
+}
+
+// Abstract : Choose an offer of permessage-deflate that can be accepted
+//
+// Returns  : bool (true if one was accepted)
+// Params   :
+//   offers                    Value of Sec-WebSocket-Extensions
+//   response                  Set to the extension to answer with
+//
+// Remarks  : The server always takes server_no_context_takeover, which
+//            RFC 7692 allows even if it was not offered.  An offer that
+//            limits the server's window is declined, as messages are
+//            compressed with the full window.
+//
+bool WebSocket::negotiate(std::string_view offers, std::string& response) {
+    std::size_t pos = 0;
+    while (pos < offers.size()) {
+        std::size_t end = std::min(offers.find(',', pos), offers.size());
+        std::string_view offer = offers.substr(pos, end - pos);
+        pos = end + 1;
+
+        std::size_t semi = std::min(offer.find(';'), offer.size());
+        std::string_view token = HttpParser::trim(offer.substr(0, semi));
+        if (!HttpParser::equalNames(token, "permessage-deflate")) {
+            continue;
+        }
+        bool bAcceptable = true;
+        while (bAcceptable && semi < offer.size()) {
+            std::size_t next = std::min(offer.find(';', semi + 1), offer.size());
+            std::string_view param = HttpParser::trim(offer.substr(semi + 1, next - semi - 1));
+            semi = next;
+            std::size_t eq = std::min(param.find('='), param.size());
+            std::string_view name = HttpParser::trim(param.substr(0, eq));
+            std::string_view value = eq < param.size() ? HttpParser::trim(param.substr(eq + 1))
+                                                       : "";
+            if (!value.empty() && value.front() == '"' && value.size() >= 2) {
+                value = value.substr(1, value.size() - 2);
+            }
+            if (HttpParser::equalNames(name, "server_max_window_bits")) {
+                bAcceptable = value == "15";
+            } else if (!HttpParser::equalNames(name, "server_no_context_takeover")
+                       && !HttpParser::equalNames(name, "client_no_context_takeover")
+                       && !HttpParser::equalNames(name, "client_max_window_bits")) {
+                bAcceptable = false;
+            }
+        }
+        if (bAcceptable) {
+            response = "permessage-deflate; server_no_context_takeover";
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WebSocket::connect(HttpStream& http, const std::string& uri, std::string_view headers,
+                        const char* protocol) {
+    unsigned char nonce[16];
+    RAND_bytes(nonce, sizeof(nonce));
+    std::string key = base64(nonce, sizeof(nonce));
+
+    std::string request = "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Version: 13\r\nSec-WebSocket-Key: ";
+    request += key;
+    request += "\r\n";
+    if (protocol) {
+        request += "Sec-WebSocket-Protocol: ";
+        request += protocol;
+        request += "\r\n";
+    }
+    // Messages are compressed each on its own, so the client says so
+    if (deflateLevel_ > 0) {
+        request += "Sec-WebSocket-Extensions: permessage-deflate; client_no_context_takeover\r\n";
+    }
+    request += headers;
+
+    std::string rest;
+    if (http.upgrade(uri, request, rest) != 101) {
+        return false;
+    }
+    if (!agreed(http.getResponse(), key, protocol)) {
+        http.close();
+        return false;
+    }
+    opened(http, rest, true);
+    return true;
+}
+
+// Abstract : Check the server's answer to an upgrade request
+//
+// Returns  : bool (false if the connection must be failed)
+//
+bool WebSocket::agreed(const HttpParser& response, const std::string& key,
+                       const char* protocol) {
+    if (!HttpParser::hasToken(response.header(hdrUpgrade), "websocket")
+        || !HttpParser::hasToken(response.header(hdrConnection), "upgrade")
+        || HttpParser::trim(response.header("Sec-WebSocket-Accept")) != acceptKey(key)) {
+        return false;
+    }
+    std::string_view selected = HttpParser::trim(response.header("Sec-WebSocket-Protocol"));
+    if (!selected.empty() && (!protocol || selected != protocol)) {
+        return false;
+    }
+    protocol_.assign(selected);
+
+    // Only permessage-deflate was offered, and without a window limit of
+    // the client's
+    std::string_view extension = HttpParser::trim(response.header("Sec-WebSocket-Extensions"));
+    bDeflate_ = !extension.empty();
+    if (bDeflate_) {
+        std::size_t semi = std::min(extension.find(';'), extension.size());
+        if (deflateLevel_ == 0
+            || !HttpParser::equalNames(HttpParser::trim(extension.substr(0, semi)),
+                                       "permessage-deflate")) {
+            return false;
+        }
+        while (semi < extension.size()) {
+            std::size_t next = std::min(extension.find(';', semi + 1), extension.size());
+            std::string_view param = HttpParser::trim(extension.substr(semi + 1, next - semi - 1));
+            semi = next;
+            std::string_view name
+                = HttpParser::trim(param.substr(0, std::min(param.find('='), param.size())));
+            if (!HttpParser::equalNames(name, "server_no_context_takeover")
+                && !HttpParser::equalNames(name, "client_no_context_takeover")
+                && !HttpParser::equalNames(name, "server_max_window_bits")) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void WebSocket::opened(Socket& rSocket, std::string& rest, bool bClient) {
+    pSocket_ = &rSocket;
+    bClient_ = bClient;
+    recvBuf_.swap(rest);
+    recvBegin_ = 0;
+    recvEnd_ = recvBuf_.size();
+    recvBuf_.resize(std::max(recvBuf_.size(), RECV_BUFFER_SIZE));
+    bInFrame_ = false;
+    messageOpcode_ = opContinuation;
+    bFragmenting_ = false;
+    bFailed_ = bCloseSent_ = bClosed_ = false;
+    closeCode_ = 0;
+    if (bDeflate_ && !pInflater_) {
+        pInflater_.reset(new Inflater);
+    }
+}
+
+// Abstract : XOR data with a masking key
+//
+// Params   :
+//   pDst                      Destination, which may be pSrc
+//   pSrc                      Data to mask or unmask
+//   uLength                   Size of the data
+//   key                       Masking key of the frame
+//   uPhase                    Offset of pSrc in the payload of the frame
+//
+void WebSocket::mask(char* pDst, const char* pSrc, std::size_t uLength,
+                     const unsigned char key[4], std::size_t uPhase) {
+    unsigned char rotated[4];
+    for (int k = 0; k < 4; k++) {
+        rotated[k] = key[(uPhase + k) & 3];
+    }
+    uint32_t key32;
+    memcpy(&key32, rotated, 4);
+
+    std::size_t i = 0;
+#ifdef WEBSOCKET_AVX2
+    static const bool bAvx2 = __builtin_cpu_supports("avx2");
+    if (bAvx2) {
+        i = maskAvx2(pDst, pSrc, uLength, key32);
+    } else if (__builtin_cpu_supports("sse2")) {
+        i = maskSse2(pDst, pSrc, uLength, key32);
+    }
+#elif defined(__ARM_NEON)
+    uint8x16_t vKey = vreinterpretq_u8_u32(vdupq_n_u32(key32));
+    for (; i + 16 <= uLength; i += 16) {
+        uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(pSrc + i));
+        vst1q_u8(reinterpret_cast<uint8_t*>(pDst + i), veorq_u8(v, vKey));
+    }
+#elif defined(__SSE2__)
+    __m128i vKey = _mm_set1_epi32(static_cast<int>(key32));
+    for (; i + 16 <= uLength; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), _mm_xor_si128(v, vKey));
+    }
+#endif
+    uint64_t key64 = (static_cast<uint64_t>(key32) << 32) | key32;
+    for (; i + 8 <= uLength; i += 8) {
+        uint64_t word;
+        memcpy(&word, pSrc + i, 8);
+        word ^= key64;
+        memcpy(pDst + i, &word, 8);
+    }
+    for (; i < uLength; i++) {
+        pDst[i] = pSrc[i] ^ rotated[i & 3];
+    }
+}
+
+bool WebSocket::receive(std::string& message, bool* pBinary) {
+    if (pSocket_ == 0 || bClosed_) {
+        return false;
+    }
+    for (;;) {
+        int nResult = step(message, pBinary);
+        // Pongs and the answer to a close go out before more is read
+        if (!queue_.empty() && !flush()) {
+            bClosed_ = true;
+            return false;
+        }
+        if (nResult != 0) {
+            return nResult > 0;
+        }
+        makeRoom();
+        UINT uRead = pSocket_->read(recvBuf_.data() + recvEnd_, recvBuf_.size() - recvEnd_);
+        if (uRead == 0) {
+            closeCode_ = closeAbnormal;
+            bClosed_ = true;
+            return false;
+        }
+        recvEnd_ += uRead;
+    }
+}
+
+Task<bool> WebSocket::async_receive(std::string& message, bool* pBinary) {
+    if (pSocket_ == 0 || bClosed_) {
+        co_return false;
+    }
+    for (;;) {
+        int nResult = step(message, pBinary);
+        if (!queue_.empty() && !co_await async_flush()) {
+            bClosed_ = true;
+            co_return false;
+        }
+        if (nResult != 0) {
+            co_return nResult > 0;
+        }
+        makeRoom();
+        int nRead = co_await pSocket_->async_read(recvBuf_.data() + recvEnd_,
+                                                  recvBuf_.size() - recvEnd_);
+        if (nRead <= 0) {
+            closeCode_ = closeAbnormal;
+            bClosed_ = true;
+            co_return false;
+        }
+        recvEnd_ += nRead;
+    }
+}
+
+// Abstract : Make room in the receive buffer for more data
+//
+// Remarks  : Only a frame header or a control frame is ever waited for
+//            whole, and both fit many times over, so moving what is left
+//            to the front is enough.
+//
+void WebSocket::makeRoom() {
+    std::size_t uAvail = recvEnd_ - recvBegin_;
+    if (recvBegin_ > 0 && (uAvail == 0 || recvBuf_.size() - recvEnd_ < MAX_HEADER + MAX_CONTROL)) {
+        memmove(recvBuf_.data(), recvBuf_.data() + recvBegin_, uAvail);
+        recvBegin_ = 0;
+        recvEnd_ = uAvail;
+    }
+}
+
+// Abstract : Take what can be taken of the receive buffer
+//
+// Returns  : 1 with a whole message; 0 when more data is needed; -1 once
+//            the connection is closed or failed
+//
+int WebSocket::step(std::string& message, bool* pBinary) {
+    for (;;) {
+        if (!bInFrame_) {
+            int nResult = frame(message, pBinary);
+            if (nResult <= 0) {
+                return nResult;
+            }
+        }
+        std::size_t uAvail = recvEnd_ - recvBegin_;
+        const char* pData = recvBuf_.data() + recvBegin_;
+
+        if (frameOpcode_ >= opClose) {
+            // A control frame is handled whole
+            if (uAvail < uFrameLeft_) {
+                return 0;
+            }
+            char payload[MAX_CONTROL];
+            std::size_t uLength = uFrameLeft_;
+            if (bFrameMasked_) {
+                mask(payload, pData, uLength, frameKey_);
+            } else {
+                memcpy(payload, pData, uLength);
+            }
+            recvBegin_ += uLength;
+            bInFrame_ = false;
+            if (control(frameOpcode_, std::string_view(payload, uLength)) < 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        std::size_t uTake = std::min<uint64_t>(uAvail, uFrameLeft_);
+        if (uTake == 0 && uFrameLeft_ > 0) {
+            return 0;
+        }
+        std::string& rDest = bMessageCompressed_ ? compressed_ : message;
+        std::size_t uOld = rDest.size();
+        rDest.resize(uOld + uTake);
+        if (bFrameMasked_) {
+            mask(rDest.data() + uOld, pData, uTake, frameKey_, uFrameDone_);
+        } else {
+            memcpy(rDest.data() + uOld, pData, uTake);
+        }
+        recvBegin_ += uTake;
+        uFrameDone_ += uTake;
+        uFrameLeft_ -= uTake;
+        if (uFrameLeft_ > 0) {
+            return 0;
+        }
+        bInFrame_ = false;
+        if (!bFrameFinal_) {
+            continue;
+        }
+
+        // The message is whole
+        if (bMessageCompressed_) {
+            message.clear();
+            if (!pInflater_->inflateMessage(compressed_, message, uMaxMessage_)) {
+                return fail(message.size() > uMaxMessage_ ? closeTooBig : closeInvalidData);
+            }
+            compressed_.clear();
+        }
+        if (messageOpcode_ == opText
+            && !validUtf8(reinterpret_cast<const unsigned char*>(message.data()), message.size())) {
+            return fail(closeInvalidData);
+        }
+        if (pBinary) {
+            *pBinary = messageOpcode_ == opBinary;
+        }
+        messageOpcode_ = opContinuation;
+        return 1;
+    }
+}
+
+// Abstract : Parse the header of the next frame
+//
+// Returns  : 1 when a frame starts; 0 when more data is needed; -1 if
+//            the frame breaks the protocol
+//
+int WebSocket::frame(std::string& message, bool* /*pBinary*/) {
+    std::size_t uAvail = recvEnd_ - recvBegin_;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(recvBuf_.data() + recvBegin_);
+    if (uAvail < 2) {
+        return 0;
+    }
+    bool bMasked = (p[1] & 0x80) != 0;
+    std::size_t uHeader = 2 + (bMasked ? 4 : 0);
+    uint64_t uLength = p[1] & 0x7f;
+    if (uLength == 126) {
+        uHeader += 2;
+    } else if (uLength == 127) {
+        uHeader += 8;
+    }
+    if (uAvail < uHeader) {
+        return 0;
+    }
+    if (uLength == 126) {
+        uLength = (p[2] << 8) | p[3];
+    } else if (uLength == 127) {
+        uLength = 0;
+        for (int i = 0; i < 8; i++) {
+            uLength = (uLength << 8) | p[2 + i];
+        }
+        if (uLength >> 63) {
+            return fail(closeProtocolError);
+        }
+    }
+
+    bool bFinal = (p[0] & 0x80) != 0;
+    bool bCompressed = (p[0] & 0x40) != 0;
+    int opcode = p[0] & 0x0f;
+    // Frames from a client are masked, those from a server are not
+    if ((p[0] & 0x30) != 0 || bMasked == bClient_) {
+        return fail(closeProtocolError);
+    }
+    if (opcode >= opClose) {
+        if (opcode > opPong || !bFinal || bCompressed || uLength > MAX_CONTROL) {
+            return fail(closeProtocolError);
+        }
+    } else if (opcode == opContinuation) {
+        if (messageOpcode_ == opContinuation || bCompressed) {
+            return fail(closeProtocolError);
+        }
+    } else if (opcode > opBinary || messageOpcode_ != opContinuation
+               || (bCompressed && !bDeflate_)) {
+        return fail(closeProtocolError);
+    } else {
+        messageOpcode_ = opcode;
+        bMessageCompressed_ = bCompressed;
+        message.clear();
+        compressed_.clear();
+    }
+    if (opcode < opClose && message.size() + compressed_.size() + uLength > uMaxMessage_) {
+        return fail(closeTooBig);
+    }
+
+    frameOpcode_ = opcode;
+    bFrameFinal_ = bFinal;
+    bFrameMasked_ = bMasked;
+    if (bMasked) {
+        memcpy(frameKey_, p + uHeader - 4, 4);
+    }
+    uFrameLeft_ = uLength;
+    uFrameDone_ = 0;
+    bInFrame_ = true;
+    recvBegin_ += uHeader;
+    return 1;
+}
+
+// Abstract : Act on a control frame
+//
+// Returns  : 0 to go on; -1 once a close frame is received
+//
+int WebSocket::control(int opcode, std::string_view payload) {
+    if (opcode == opPing) {
+        if (!bCloseSent_) {
+            push(makeFrame(opPong, payload, true, false));
+        }
+        return 0;
+    }
+    if (opcode == opPong) {
+        ++pongs_;
+        return 0;
+    }
+
+    UINT uCode = closeNoStatus;
+    if (payload.size() == 1) {
+        return fail(closeProtocolError);
+    }
+    if (payload.size() >= 2) {
+        uCode = (static_cast<unsigned char>(payload[0]) << 8) | static_cast<unsigned char>(payload[1]);
+        if (!validCloseCode(uCode)) {
+            return fail(closeProtocolError);
+        }
+        if (!validUtf8(reinterpret_cast<const unsigned char*>(payload.data()) + 2,
+                       payload.size() - 2)) {
+            return fail(closeInvalidData);
+        }
+    }
+    closeCode_ = uCode;
+    bClosed_ = true;
+    // The answer echoes the status code
+    if (!bCloseSent_) {
+        bCloseSent_ = true;
+        push(makeFrame(opClose, payload.substr(0, uCode == closeNoStatus ? 0 : 2), true, false));
+    }
+    return -1;
+}
+
+// Abstract : Fail the connection: send a close frame and stop receiving
+//
+// Returns  : -1
+//
+int WebSocket::fail(UINT uCode) {
+    closeCode_ = uCode;
+    bClosed_ = true;
+    if (!bCloseSent_) {
+        bCloseSent_ = true;
+        char payload[2] = { static_cast<char>(uCode >> 8), static_cast<char>(uCode) };
+        push(makeFrame(opClose, std::string_view(payload, 2), true, false));
+    }
+    return -1;
+}
+
+// Abstract : Compress or mask a payload to send, as the connection needs
+//
+// Returns  : std::string_view (the payload to send, which may be in
+//            sendScratch_)
+// Params   :
+//   payload                   Payload as given
+//   bCompress                 Set if the payload may be compressed
+//   bCompressed               Set if it was
+//   pKey                      Masking key of a client frame, or 0
+//
+std::string_view WebSocket::encodePayload(std::string_view payload, bool bCompress,
+                                          bool& bCompressed, const unsigned char* pKey) {
+    bCompressed = false;
+    if (bCompress && bDeflate_ && deflateLevel_ > 0 && payload.size() >= MIN_DEFLATED) {
+        sendScratch_.clear();
+        if (deflateMessage(payload, deflateLevel_, sendScratch_)
+            && sendScratch_.size() < payload.size()) {
+            bCompressed = true;
+            payload = sendScratch_;
+        }
+    }
+    if (pKey) {
+        if (!bCompressed) {
+            sendScratch_.resize(payload.size());
+        }
+        mask(sendScratch_.data(), payload.data(), payload.size(), pKey);
+        payload = std::string_view(sendScratch_.data(), payload.size());
+    }
+    return payload;
+}
+
+std::shared_ptr<WebSocketFrame> WebSocket::makeFrame(int opcode, std::string_view payload,
+                                                     bool bFinal, bool bCompress) {
+    unsigned char key[4];
+    if (bClient_) {
+        RAND_bytes(key, sizeof(key));
+    }
+    bool bCompressed;
+    payload = encodePayload(payload, bCompress, bCompressed, bClient_ ? key : 0);
+    unsigned char head[MAX_HEADER];
+    std::size_t n = encodeHeader(head, opcode, bFinal, bCompressed, payload.size(),
+                                 bClient_ ? key : 0);
+
+    std::shared_ptr<WebSocketFrame> pFrame(new WebSocketFrame);
+    pFrame->plain_.reserve(n + payload.size());
+    pFrame->plain_.append(reinterpret_cast<char*>(head), n);
+    pFrame->plain_.append(payload);
+    return pFrame;
+}
+
+// Abstract : Send one frame at once, on a connection not on an EventLoop
+//
+// Remarks  : The header and the payload go out in one vectored write; a
+//            payload that is neither compressed nor masked is not copied.
+//
+bool WebSocket::sendFrame(int opcode, std::string_view payload, bool bFinal, bool bCompress) {
+    if (pSocket_ == 0 || bFailed_ || (bCloseSent_ && opcode != opClose)) {
+        return false;
+    }
+    if (!queue_.empty() && !flush()) {
+        return false;
+    }
+    unsigned char key[4];
+    if (bClient_) {
+        RAND_bytes(key, sizeof(key));
+    }
+    bool bCompressed;
+    payload = encodePayload(payload, bCompress, bCompressed, bClient_ ? key : 0);
+    unsigned char head[MAX_HEADER];
+    std::size_t n = encodeHeader(head, opcode, bFinal, bCompressed, payload.size(),
+                                 bClient_ ? key : 0);
+    struct iovec vec[2] = {
+        { head, n },
+        { const_cast<char*>(payload.data()), payload.size() }
+    };
+    if (!pSocket_->writev(vec, payload.empty() ? 1 : 2)) {
+        bFailed_ = true;
+    }
+    return !bFailed_;
+}
+
+int WebSocket::fragmentOpcode(bool bBinary, bool bFinal) {
+    int opcode = bFragmenting_ ? opContinuation : (bBinary ? opBinary : opText);
+    bFragmenting_ = !bFinal;
+    return opcode;
+}
+
+bool WebSocket::send(std::string_view message, bool bBinary) {
+    return sendFrame(bBinary ? opBinary : opText, message, true, true);
+}
+
+Task<bool> WebSocket::async_send(std::string_view message, bool bBinary) {
+    if (pSocket_ == 0 || bFailed_ || bCloseSent_) {
+        co_return false;
+    }
+    if (push(makeFrame(bBinary ? opBinary : opText, message, true, true))) {
+        co_return co_await async_flush();
+    }
+    co_return !bFailed_;
+}
+
+bool WebSocket::sendFragment(std::string_view data, bool bBinary, bool bFinal) {
+    return sendFrame(fragmentOpcode(bBinary, bFinal), data, bFinal, false);
+}
+
+Task<bool> WebSocket::async_sendFragment(std::string_view data, bool bBinary, bool bFinal) {
+    if (pSocket_ == 0 || bFailed_ || bCloseSent_) {
+        co_return false;
+    }
+    if (push(makeFrame(fragmentOpcode(bBinary, bFinal), data, bFinal, false))) {
+        co_return co_await async_flush();
+    }
+    co_return !bFailed_;
+}
+
+bool WebSocket::ping(std::string_view payload) {
+    return payload.size() <= MAX_CONTROL && sendFrame(opPing, payload, true, false);
+}
+
+Task<bool> WebSocket::async_ping(std::string_view payload) {
+    if (pSocket_ == 0 || bFailed_ || bCloseSent_ || payload.size() > MAX_CONTROL) {
+        co_return false;
+    }
+    if (push(makeFrame(opPing, payload, true, false))) {
+        co_return co_await async_flush();
+    }
+    co_return !bFailed_;
+}
+
+bool WebSocket::close(UINT uCode, std::string_view reason) {
+    if (bCloseSent_) {
+        return !bFailed_;
+    }
+    std::string payload;
+    payload += static_cast<char>(uCode >> 8);
+    payload += static_cast<char>(uCode);
+    payload.append(reason.substr(0, MAX_CONTROL - 2));
+    bool ok = sendFrame(opClose, payload, true, false);
+    bCloseSent_ = true;
+    return ok;
+}
+
+Task<bool> WebSocket::async_close(UINT uCode, std::string_view reason) {
+    if (bCloseSent_ || pSocket_ == 0) {
+        co_return !bFailed_;
+    }
+    std::string payload;
+    payload += static_cast<char>(uCode >> 8);
+    payload += static_cast<char>(uCode);
+    payload.append(reason.substr(0, MAX_CONTROL - 2));
+    bCloseSent_ = true;
+    if (push(makeFrame(opClose, payload, true, false))) {
+        co_return co_await async_flush();
+    }
+    co_return !bFailed_;
+}
+
+bool WebSocket::queue(std::shared_ptr<const WebSocketFrame> pFrame) {
+    // A broadcast frame is not masked, as a client's must be
+    VERIFY(!bClient_);
+    if (pSocket_ == 0 || bFailed_ || bCloseSent_) {
+        return false;
+    }
+    return push(std::move(pFrame));
+}
+
+bool WebSocket::push(std::shared_ptr<const WebSocketFrame> pFrame) {
+    uQueued_ += pFrame->data(bDeflate_).size();
+    queue_.push_back(std::move(pFrame));
+    return !bFlushing_;
+}
+
+bool WebSocket::flush() {
+    if (bFlushing_) {
+        return !bFailed_;
+    }
+    while (!queue_.empty() && !bFailed_) {
+        struct iovec vec[MAX_FRAMES_PER_WRITE];
+        int count = 0;
+        for (auto it = queue_.begin(); it != queue_.end() && count < MAX_FRAMES_PER_WRITE; ++it) {
+            std::string_view data = (*it)->data(bDeflate_);
+            vec[count++] = { const_cast<char*>(data.data()), data.size() };
+        }
+        if (!pSocket_->writev(vec, count)) {
+            bFailed_ = true;
+        }
+        for (int i = 0; i < count; i++) {
+            uQueued_ -= queue_.front()->data(bDeflate_).size();
+            queue_.pop_front();
+        }
+    }
+    if (bFailed_) {
+        queue_.clear();
+        uQueued_ = 0;
+    }
+    return !bFailed_;
+}
+
+// Abstract : Write the frames queued, on an EventLoop
+//
+// Remarks  : The frames written stay in the queue, and so alive, until
+//            the write completes; frames queued meanwhile are added
+//            behind them and written by the next round.
+//
+Task<bool> WebSocket::async_flush() {
+    if (bFlushing_ || pSocket_ == 0) {
+        co_return !bFailed_;
+    }
+    bFlushing_ = true;
+    while (!queue_.empty() && !bFailed_) {
+        struct iovec vec[MAX_FRAMES_PER_WRITE];
+        int count = 0;
+        for (auto it = queue_.begin(); it != queue_.end() && count < MAX_FRAMES_PER_WRITE; ++it) {
+            std::string_view data = (*it)->data(bDeflate_);
+            vec[count++] = { const_cast<char*>(data.data()), data.size() };
+        }
+        if (!co_await pSocket_->async_writev(vec, count)) {
+            bFailed_ = true;
+        }
+        for (int i = 0; i < count; i++) {
+            uQueued_ -= queue_.front()->data(bDeflate_).size();
+            queue_.pop_front();
+        }
+    }
+    if (bFailed_) {
+        queue_.clear();
+        uQueued_ = 0;
+    }
+    bFlushing_ = false;
+    co_return !bFailed_;
+}